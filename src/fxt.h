@@ -117,7 +117,12 @@ static fxt_t __trace;
 
 #define FUT_DO_PROBE(code, ...) litl_write_probe_pack_0(__trace, code);
 
+#ifdef LITL_INTERN_STRINGS
+/* record only the ID of the string; the string itself is stored once */
+#define FUT_DO_PROBESTR(code, str) litl_write_probe_str(__trace, code, str)
+#else
 #define FUT_DO_PROBESTR(code, str) litl_write_probe_raw(__trace, code, strlen(str), str)
+#endif
 
 /* END -- Events */
 
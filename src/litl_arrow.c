@@ -0,0 +1,760 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include "litl_arrow.h"
+#include "litl_read.h"
+
+#ifndef LITL_ARROW_BATCH_SIZE
+#define LITL_ARROW_BATCH_SIZE (64 * 1024)
+#endif
+
+/* the offsets of the data column are 32-bit: a batch is written before its
+ *   payloads reach this size */
+#ifndef LITL_ARROW_BATCH_DATA_SIZE
+#define LITL_ARROW_BATCH_DATA_SIZE (1024 * 1024 * 1024)
+#endif
+
+/*
+ * The values of the Arrow metadata that are written
+ */
+#define __LITL_ARROW_VERSION_V5 4
+#define __LITL_ARROW_TYPE_INT 2
+#define __LITL_ARROW_TYPE_BINARY 4
+#define __LITL_ARROW_HEADER_SCHEMA 1
+#define __LITL_ARROW_HEADER_RECORD_BATCH 3
+#define __LITL_ARROW_CONTINUATION 0xFFFFFFFF
+
+#define __LITL_ARROW_NB_COLUMNS (7 + LITL_MAX_PARAMS)
+#define __LITL_ARROW_FIRST_PARAM 6
+#define __LITL_ARROW_DATA (__LITL_ARROW_NB_COLUMNS - 1)
+/* each column has a validity bitmap and a buffer of values; the data column
+ *   also has a buffer of offsets */
+#define __LITL_ARROW_NB_BUFFERS (2 * __LITL_ARROW_NB_COLUMNS + 1)
+
+static const char __litl_arrow_magic[8] = "ARROW1";
+static const uint8_t __litl_arrow_padding[8];
+
+/*
+ * The columns of the record batches. The parameters follow the fixed
+ *   columns, and the data is the last column: it has a variable width
+ */
+static const struct {
+  const char* name;
+  uint8_t bit_width;
+} __litl_arrow_columns[__LITL_ARROW_NB_COLUMNS] = { { "process", 16 },
+    { "time", 64 }, { "tid", 64 }, { "code", 32 }, { "type", 8 },
+    { "nb_params", 8 }, { "p0", 64 }, { "p1", 64 }, { "p2", 64 },
+    { "p3", 64 }, { "p4", 64 }, { "p5", 64 }, { "p6", 64 }, { "p7", 64 },
+    { "p8", 64 }, { "p9", 64 }, { "data", 0 } };
+
+/*
+ * A flatbuffer, as used by the Arrow metadata. It is written from front to
+ *   back: the tables, vectors and strings are referenced by the ones written
+ *   before them, and the offsets are filled once the target is written
+ */
+typedef struct {
+  uint8_t* data;
+  litl_size_t size;
+  litl_size_t capacity;
+} __litl_arrow_fb_t;
+
+/*
+ * Appends len zeroed Bytes, aligned on align Bytes, and returns their position
+ */
+static litl_size_t __litl_arrow_fb_alloc(__litl_arrow_fb_t* fb, litl_size_t len,
+                                         litl_size_t align) {
+  litl_size_t pos = (fb->size + align - 1) / align * align;
+
+  if (pos + len > fb->capacity) {
+    fb->capacity = fb->capacity ? 2 * fb->capacity : 4096;
+    if (fb->capacity < pos + len)
+      fb->capacity = pos + len;
+    fb->data = realloc(fb->data, fb->capacity);
+    if (!fb->data) {
+      perror("Could not allocate memory for the Arrow metadata!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memset(fb->data + fb->size, 0, pos + len - fb->size);
+  fb->size = pos + len;
+
+  return pos;
+}
+
+static inline void __litl_arrow_fb_put(__litl_arrow_fb_t* fb, litl_size_t pos,
+                                       const void* value, litl_size_t len) {
+  memcpy(fb->data + pos, value, len);
+}
+
+/*
+ * Makes the offset at pos reference the object at target
+ */
+static inline void __litl_arrow_fb_ref(__litl_arrow_fb_t* fb, litl_size_t pos,
+                                       litl_size_t target) {
+  uint32_t offset = target - pos;
+  __litl_arrow_fb_put(fb, pos, &offset, sizeof(offset));
+}
+
+/*
+ * Writes a table preceded by its vtable. The fields are laid out in order,
+ *   aligned on their size; the absent fields have a size of 0. Returns the
+ *   position of the table, and the positions of its fields in field_pos
+ */
+static litl_size_t __litl_arrow_fb_table(__litl_arrow_fb_t* fb, int nb_fields,
+                                         const uint8_t sizes[],
+                                         litl_size_t field_pos[]) {
+  uint16_t vtable[2 + 8];
+  litl_size_t vtable_pos, table_pos;
+  int32_t soffset;
+  uint16_t offset = sizeof(soffset);
+  int i;
+
+  for (i = 0; i < nb_fields; i++) {
+    if (!sizes[i]) {
+      vtable[2 + i] = 0;
+      continue;
+    }
+    offset = (offset + sizes[i] - 1) / sizes[i] * sizes[i];
+    vtable[2 + i] = offset;
+    offset += sizes[i];
+  }
+  vtable[0] = (2 + nb_fields) * sizeof(uint16_t);
+  vtable[1] = offset;
+
+  vtable_pos = __litl_arrow_fb_alloc(fb, vtable[0], sizeof(uint16_t));
+  __litl_arrow_fb_put(fb, vtable_pos, vtable, vtable[0]);
+  table_pos = __litl_arrow_fb_alloc(fb, offset, 8);
+  soffset = table_pos - vtable_pos;
+  __litl_arrow_fb_put(fb, table_pos, &soffset, sizeof(soffset));
+
+  for (i = 0; i < nb_fields; i++)
+    field_pos[i] = sizes[i] ? table_pos + vtable[2 + i] : 0;
+
+  return table_pos;
+}
+
+/*
+ * Writes a vector of nb elements and returns its position. The elements
+ *   follow its length, aligned on align Bytes
+ */
+static litl_size_t __litl_arrow_fb_vector(__litl_arrow_fb_t* fb,
+                                          litl_size_t nb,
+                                          litl_size_t elem_size,
+                                          litl_size_t align) {
+  uint32_t length = nb;
+  litl_size_t pos;
+
+  while ((fb->size + sizeof(length)) % align || fb->size % sizeof(length))
+    __litl_arrow_fb_alloc(fb, 1, 1);
+  pos = __litl_arrow_fb_alloc(fb, sizeof(length) + nb * elem_size,
+                              sizeof(length));
+  __litl_arrow_fb_put(fb, pos, &length, sizeof(length));
+
+  return pos;
+}
+
+static litl_size_t __litl_arrow_fb_string(__litl_arrow_fb_t* fb,
+                                          const char* str) {
+  litl_size_t len = strlen(str);
+  // the string is followed by a null character
+  litl_size_t pos = __litl_arrow_fb_vector(fb, len, 1, 1);
+
+  __litl_arrow_fb_put(fb, pos + sizeof(uint32_t), str, len);
+  __litl_arrow_fb_alloc(fb, 1, 1);
+
+  return pos;
+}
+
+/*
+ * Starts a flatbuffer with the offset of its root table
+ */
+static void __litl_arrow_fb_init(__litl_arrow_fb_t* fb) {
+  fb->data = NULL;
+  fb->size = 0;
+  fb->capacity = 0;
+  __litl_arrow_fb_alloc(fb, sizeof(uint32_t), sizeof(uint32_t));
+}
+
+/*
+ * Pads a flatbuffer to a multiple of 8 Bytes, as required by the messages
+ */
+static void __litl_arrow_fb_end(__litl_arrow_fb_t* fb) {
+  __litl_arrow_fb_alloc(fb, 0, 8);
+}
+
+/*
+ * Writes the schema table
+ */
+static litl_size_t __litl_arrow_fb_schema(__litl_arrow_fb_t* fb) {
+  // endianness, fields
+  static const uint8_t schema_sizes[] = { 2, 4 };
+  // name, nullable, type_type, type, dictionary, children
+  static const uint8_t field_sizes[] = { 4, 1, 1, 4, 0, 4 };
+  // bitWidth, is_signed
+  static const uint8_t int_sizes[] = { 4, 1 };
+  litl_size_t schema_pos[2], field_pos[6], int_pos[2];
+  litl_size_t schema, fields, field, type;
+  int16_t endianness = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+  uint8_t nullable, type_type;
+  int32_t bit_width;
+  int i;
+
+  schema = __litl_arrow_fb_table(fb, 2, schema_sizes, schema_pos);
+  __litl_arrow_fb_put(fb, schema_pos[0], &endianness, sizeof(endianness));
+  fields = __litl_arrow_fb_vector(fb, __LITL_ARROW_NB_COLUMNS, 4, 4);
+  __litl_arrow_fb_ref(fb, schema_pos[1], fields);
+
+  for (i = 0; i < __LITL_ARROW_NB_COLUMNS; i++) {
+    field = __litl_arrow_fb_table(fb, 6, field_sizes, field_pos);
+    __litl_arrow_fb_ref(fb, fields + 4 + 4 * i, field);
+
+    nullable = i >= __LITL_ARROW_FIRST_PARAM;
+    type_type = i == __LITL_ARROW_DATA ? __LITL_ARROW_TYPE_BINARY :
+      __LITL_ARROW_TYPE_INT;
+    __litl_arrow_fb_put(fb, field_pos[1], &nullable, sizeof(nullable));
+    __litl_arrow_fb_put(fb, field_pos[2], &type_type, sizeof(type_type));
+    __litl_arrow_fb_ref(fb, field_pos[0],
+                        __litl_arrow_fb_string(fb, __litl_arrow_columns[i].name));
+
+    if (i == __LITL_ARROW_DATA) {
+      // the Binary type has no fields
+      type = __litl_arrow_fb_table(fb, 0, int_sizes, int_pos);
+    } else {
+      // the integers are unsigned: is_signed keeps its default value
+      type = __litl_arrow_fb_table(fb, 2, int_sizes, int_pos);
+      bit_width = __litl_arrow_columns[i].bit_width;
+      __litl_arrow_fb_put(fb, int_pos[0], &bit_width, sizeof(bit_width));
+    }
+    __litl_arrow_fb_ref(fb, field_pos[3], type);
+
+    __litl_arrow_fb_ref(fb, field_pos[5], __litl_arrow_fb_vector(fb, 0, 4, 4));
+  }
+
+  return schema;
+}
+
+/*
+ * Writes a message table, and returns the position of its header
+ */
+static void __litl_arrow_fb_message(__litl_arrow_fb_t* fb, uint8_t header_type,
+                                    int64_t body_size,
+                                    litl_size_t* header_pos) {
+  // version, header_type, header, bodyLength
+  static const uint8_t message_sizes[] = { 2, 1, 4, 8 };
+  litl_size_t message_pos[4], message;
+  int16_t version = __LITL_ARROW_VERSION_V5;
+
+  message = __litl_arrow_fb_table(fb, 4, message_sizes, message_pos);
+  __litl_arrow_fb_ref(fb, 0, message);
+  __litl_arrow_fb_put(fb, message_pos[0], &version, sizeof(version));
+  __litl_arrow_fb_put(fb, message_pos[1], &header_type, sizeof(header_type));
+  __litl_arrow_fb_put(fb, message_pos[3], &body_size, sizeof(body_size));
+  *header_pos = message_pos[2];
+}
+
+/*
+ * Writes a whole buffer at an offset of the file
+ */
+static void __litl_arrow_pwritev(int f_handle, struct iovec* iov, int nb_iov,
+                                 uint64_t offset) {
+  ssize_t res;
+
+  while (nb_iov > 0) {
+    res = pwritev(f_handle, iov, nb_iov > IOV_MAX ? IOV_MAX : nb_iov, offset);
+    if (res == -1) {
+      perror("Could not write the Arrow file!");
+      exit(EXIT_FAILURE);
+    }
+    offset += res;
+
+    // skip the parts that were written
+    while (nb_iov > 0 && (size_t) res >= iov->iov_len) {
+      res -= iov->iov_len;
+      iov++;
+      nb_iov--;
+    }
+    if (nb_iov > 0) {
+      iov->iov_base = (uint8_t*) iov->iov_base + res;
+      iov->iov_len -= res;
+    }
+  }
+}
+
+/*
+ * Opens an Arrow file and writes its schema
+ */
+litl_trace_arrow_t* litl_arrow_init(litl_read_trace_t* trace,
+                                    const char* filename) {
+  litl_trace_arrow_t* arrow;
+  __litl_arrow_fb_t fb;
+  litl_size_t header_pos;
+  uint32_t prefix[2];
+  struct iovec iov[3];
+
+  arrow = calloc(1, sizeof(litl_trace_arrow_t));
+  if (!arrow) {
+    perror("Could not allocate memory for exporting the trace!");
+    exit(EXIT_FAILURE);
+  }
+
+  if ((arrow->f_handle = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644))
+      < 0) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  arrow->trace = trace;
+  arrow->batch_capacity = LITL_ARROW_BATCH_SIZE;
+  pthread_mutex_init(&arrow->lock, NULL );
+
+  __litl_arrow_fb_init(&fb);
+  __litl_arrow_fb_message(&fb, __LITL_ARROW_HEADER_SCHEMA, 0, &header_pos);
+  __litl_arrow_fb_ref(&fb, header_pos, __litl_arrow_fb_schema(&fb));
+  __litl_arrow_fb_end(&fb);
+
+  prefix[0] = __LITL_ARROW_CONTINUATION;
+  prefix[1] = fb.size;
+  iov[0].iov_base = (void*) __litl_arrow_magic;
+  iov[0].iov_len = sizeof(__litl_arrow_magic);
+  iov[1].iov_base = prefix;
+  iov[1].iov_len = sizeof(prefix);
+  iov[2].iov_base = fb.data;
+  iov[2].iov_len = fb.size;
+  __litl_arrow_pwritev(arrow->f_handle, iov, 3, 0);
+  arrow->offset = sizeof(__litl_arrow_magic) + sizeof(prefix) + fb.size;
+  free(fb.data);
+
+  return arrow;
+}
+
+/*
+ * Allocates a record batch
+ */
+litl_arrow_batch_t* litl_arrow_init_batch(litl_trace_arrow_t* arrow) {
+  litl_arrow_batch_t* batch;
+  litl_size_t capacity = arrow->batch_capacity;
+  int i, is_allocated;
+
+  batch = calloc(1, sizeof(litl_arrow_batch_t));
+  if (!batch) {
+    perror("Could not allocate memory for a record batch!");
+    exit(EXIT_FAILURE);
+  }
+  batch->arrow = arrow;
+
+  batch->processes = malloc(capacity * sizeof(uint16_t));
+  batch->times = malloc(capacity * sizeof(uint64_t));
+  batch->tids = malloc(capacity * sizeof(uint64_t));
+  batch->codes = malloc(capacity * sizeof(uint32_t));
+  batch->types = malloc(capacity * sizeof(uint8_t));
+  batch->nb_params = malloc(capacity * sizeof(uint8_t));
+  batch->data_offsets = malloc((capacity + 1) * sizeof(int32_t));
+  batch->data_validity = malloc((capacity + 7) / 8);
+  is_allocated = batch->processes && batch->times && batch->tids
+    && batch->codes && batch->types && batch->nb_params && batch->data_offsets
+    && batch->data_validity;
+  for (i = 0; i < LITL_MAX_PARAMS; i++) {
+    batch->params[i] = malloc(capacity * sizeof(uint64_t));
+    batch->validity[i] = malloc((capacity + 7) / 8);
+    is_allocated = is_allocated && batch->params[i] && batch->validity[i];
+  }
+  if (!is_allocated) {
+    perror("Could not allocate memory for a record batch!");
+    exit(EXIT_FAILURE);
+  }
+  batch->data_offsets[0] = 0;
+
+  return batch;
+}
+
+static inline void __litl_arrow_set_valid(uint8_t* validity, litl_size_t index,
+                                          int is_valid) {
+  if (is_valid)
+    validity[index / 8] |= 1 << (index % 8);
+  else
+    validity[index / 8] &= ~(1 << (index % 8));
+}
+
+/*
+ * Appends the payload of an event to the data column
+ */
+static void __litl_arrow_add_data(litl_arrow_batch_t* batch,
+                                  const litl_data_t* data, litl_size_t size) {
+  if (batch->data_size + size > batch->data_capacity) {
+    batch->data_capacity =
+        batch->data_capacity ? 2 * batch->data_capacity : 64 * 1024;
+    if (batch->data_capacity < batch->data_size + size)
+      batch->data_capacity = batch->data_size + size;
+    batch->data = realloc(batch->data, batch->data_capacity);
+    if (!batch->data) {
+      perror("Could not allocate memory for a record batch!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memcpy(batch->data + batch->data_size, data, size);
+  batch->data_size += size;
+}
+
+/*
+ * Adds an event to a record batch
+ */
+void litl_arrow_add_event(litl_arrow_batch_t* batch,
+                          litl_read_process_t* process,
+                          litl_read_event_t* event) {
+  litl_size_t index = batch->nb_events;
+  litl_typed_param_t typed_params[LITL_MAX_PARAMS];
+  const litl_data_t* data;
+  litl_size_t size;
+  int i, nb_params = 0, is_valid[LITL_MAX_PARAMS] = { 0 }, has_data = 0;
+
+  batch->processes[index] = process->index;
+  batch->times[index] = LITL_READ_GET_TIME(event);
+  batch->tids[index] = LITL_READ_GET_TID(event);
+  batch->codes[index] = LITL_READ_GET_CODE(event);
+  batch->types[index] = LITL_READ_GET_TYPE(event);
+  switch (LITL_READ_GET_TYPE(event)) {
+  case LITL_TYPE_REGULAR:
+    nb_params = LITL_READ_REGULAR(event)->nb_params;
+    for (i = 0; i < nb_params; i++) {
+      batch->params[i][index] = LITL_READ_REGULAR(event)->param[i];
+      is_valid[i] = 1;
+    }
+    break;
+  case LITL_TYPE_PACKED:
+    // the packed events are decoded by their schema. The signed integers are
+    //   stored as two's complement, the floating-point numbers as the bits of
+    //   a double. The strings do not fit in a column of integers: like the
+    //   events without a schema, the events with strings keep their payload
+    nb_params = litl_read_get_typed_params(process, event, typed_params);
+    if (nb_params < 0) {
+      nb_params = 0;
+      has_data = 1;
+    }
+    for (i = 0; i < nb_params; i++)
+      switch (typed_params[i].type) {
+      case LITL_PARAM_STRING:
+        batch->params[i][index] = 0;
+        has_data = 1;
+        break;
+      case LITL_PARAM_FLOAT:
+      case LITL_PARAM_DOUBLE:
+        memcpy(&batch->params[i][index], &typed_params[i].value.d,
+               sizeof(uint64_t));
+        is_valid[i] = 1;
+        break;
+      default:
+        batch->params[i][index] = typed_params[i].value.u;
+        is_valid[i] = 1;
+        break;
+      }
+    break;
+  case LITL_TYPE_RAW:
+    has_data = 1;
+    break;
+  default:
+    break;
+  }
+  batch->nb_params[index] = nb_params;
+  // the missing parameters are zeroed, so that the batches do not depend on
+  //   the previous content of the columns
+  for (i = nb_params; i < LITL_MAX_PARAMS; i++)
+    batch->params[i][index] = 0;
+  for (i = 0; i < LITL_MAX_PARAMS; i++)
+    __litl_arrow_set_valid(batch->validity[i], index, is_valid[i]);
+
+  if (has_data) {
+    data = litl_read_get_data(event, &size);
+    __litl_arrow_add_data(batch, data, size);
+  }
+  batch->data_offsets[index + 1] = batch->data_size;
+  __litl_arrow_set_valid(batch->data_validity, index, has_data);
+
+  if (++batch->nb_events == batch->arrow->batch_capacity
+      || batch->data_size >= LITL_ARROW_BATCH_DATA_SIZE)
+    litl_arrow_flush_batch(batch);
+}
+
+/*
+ * Returns the number of nulls of a column
+ */
+static int64_t __litl_arrow_count_nulls(const uint8_t* validity,
+                                        litl_size_t nb_events) {
+  int64_t null_count = 0;
+  litl_size_t e;
+
+  for (e = 0; e < nb_events; e++)
+    if (!(validity[e / 8] & (1 << (e % 8))))
+      null_count++;
+
+  return null_count;
+}
+
+/*
+ * Adds a buffer to the body of a record batch: its location, and the
+ *   vectors that write it. The buffers are 8-Byte aligned within the body
+ */
+static void __litl_arrow_add_buffer(const void* data, int64_t len,
+                                    struct iovec iov[], int* nb_iov,
+                                    int64_t buffers[], int* nb_buffers,
+                                    int64_t* body_size) {
+  buffers[2 * *nb_buffers] = *body_size;
+  buffers[2 * *nb_buffers + 1] = len;
+  (*nb_buffers)++;
+  if (!len)
+    return;
+
+  iov[*nb_iov].iov_base = (void*) data;
+  iov[(*nb_iov)++].iov_len = len;
+  if (len % 8) {
+    iov[*nb_iov].iov_base = (void*) __litl_arrow_padding;
+    iov[(*nb_iov)++].iov_len = 8 - len % 8;
+  }
+  *body_size += (len + 7) / 8 * 8;
+}
+
+/*
+ * Writes a record batch: its metadata, then its columns, without copying
+ *   them
+ */
+void litl_arrow_flush_batch(litl_arrow_batch_t* batch) {
+  // length, nodes, buffers
+  static const uint8_t record_batch_sizes[] = { 8, 4, 4 };
+  litl_trace_arrow_t* arrow = batch->arrow;
+  litl_size_t nb_events = batch->nb_events;
+  struct iovec iov[2 + 2 * __LITL_ARROW_NB_BUFFERS];
+  int64_t nodes[2 * __LITL_ARROW_NB_COLUMNS];
+  int64_t buffers[2 * __LITL_ARROW_NB_BUFFERS];
+  const void* columns[__LITL_ARROW_NB_COLUMNS];
+  const uint8_t* validity;
+  litl_size_t record_batch_pos[3], header_pos, record_batch, pos;
+  __litl_arrow_fb_t fb;
+  litl_arrow_block_t* block;
+  int64_t body_size = 0, null_count, length = nb_events;
+  uint64_t offset;
+  uint32_t prefix[2];
+  int i, nb_iov = 1, nb_buffers = 0;
+
+  if (!nb_events)
+    return;
+
+  columns[0] = batch->processes;
+  columns[1] = batch->times;
+  columns[2] = batch->tids;
+  columns[3] = batch->codes;
+  columns[4] = batch->types;
+  columns[5] = batch->nb_params;
+  for (i = 0; i < LITL_MAX_PARAMS; i++)
+    columns[__LITL_ARROW_FIRST_PARAM + i] = batch->params[i];
+
+  for (i = 0; i < __LITL_ARROW_NB_COLUMNS; i++) {
+    validity = NULL;
+    if (i == __LITL_ARROW_DATA)
+      validity = batch->data_validity;
+    else if (i >= __LITL_ARROW_FIRST_PARAM)
+      validity = batch->validity[i - __LITL_ARROW_FIRST_PARAM];
+    null_count = validity ? __litl_arrow_count_nulls(validity, nb_events) : 0;
+
+    nodes[2 * i] = nb_events;
+    nodes[2 * i + 1] = null_count;
+
+    // the validity bitmap may be omitted when there are no nulls
+    __litl_arrow_add_buffer(validity,
+                            null_count ? (int64_t) (nb_events + 7) / 8 : 0,
+                            iov, &nb_iov, buffers, &nb_buffers, &body_size);
+    if (i == __LITL_ARROW_DATA) {
+      __litl_arrow_add_buffer(batch->data_offsets,
+                              (nb_events + 1) * sizeof(int32_t), iov, &nb_iov,
+                              buffers, &nb_buffers, &body_size);
+      __litl_arrow_add_buffer(batch->data, batch->data_size, iov, &nb_iov,
+                              buffers, &nb_buffers, &body_size);
+    } else
+      __litl_arrow_add_buffer(
+          columns[i], nb_events * (__litl_arrow_columns[i].bit_width / 8), iov,
+          &nb_iov, buffers, &nb_buffers, &body_size);
+  }
+
+  __litl_arrow_fb_init(&fb);
+  __litl_arrow_fb_message(&fb, __LITL_ARROW_HEADER_RECORD_BATCH, body_size,
+                          &header_pos);
+  record_batch = __litl_arrow_fb_table(&fb, 3, record_batch_sizes,
+                                       record_batch_pos);
+  __litl_arrow_fb_ref(&fb, header_pos, record_batch);
+  __litl_arrow_fb_put(&fb, record_batch_pos[0], &length, sizeof(length));
+  pos = __litl_arrow_fb_vector(&fb, __LITL_ARROW_NB_COLUMNS,
+                               2 * sizeof(int64_t), 8);
+  __litl_arrow_fb_put(&fb, pos + 4, nodes, sizeof(nodes));
+  __litl_arrow_fb_ref(&fb, record_batch_pos[1], pos);
+  pos = __litl_arrow_fb_vector(&fb, __LITL_ARROW_NB_BUFFERS,
+                               2 * sizeof(int64_t), 8);
+  __litl_arrow_fb_put(&fb, pos + 4, buffers, sizeof(buffers));
+  __litl_arrow_fb_ref(&fb, record_batch_pos[2], pos);
+  __litl_arrow_fb_end(&fb);
+
+  // the metadata is prefixed by its size, after the message is written
+  prefix[0] = __LITL_ARROW_CONTINUATION;
+  prefix[1] = fb.size;
+  iov[0].iov_base = prefix;
+  iov[0].iov_len = sizeof(prefix);
+  // the metadata follows the prefix, before the body
+  memmove(&iov[2], &iov[1], (nb_iov - 1) * sizeof(struct iovec));
+  iov[1].iov_base = fb.data;
+  iov[1].iov_len = fb.size;
+  nb_iov++;
+
+  // reserve the space of the batch, so that the batches are written in
+  //   parallel
+  pthread_mutex_lock(&arrow->lock);
+  offset = arrow->offset;
+  arrow->offset += sizeof(prefix) + fb.size + body_size;
+  if (arrow->nb_blocks == arrow->nb_allocated_blocks) {
+    arrow->nb_allocated_blocks = arrow->nb_allocated_blocks ?
+      2 * arrow->nb_allocated_blocks : 64;
+    arrow->blocks = realloc(
+        arrow->blocks, arrow->nb_allocated_blocks * sizeof(litl_arrow_block_t));
+    if (!arrow->blocks) {
+      perror("Could not allocate memory for the Arrow blocks!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  block = &arrow->blocks[arrow->nb_blocks++];
+  block->offset = offset;
+  block->metadata_size = sizeof(prefix) + fb.size;
+  block->body_size = body_size;
+  arrow->nb_events += nb_events;
+  pthread_mutex_unlock(&arrow->lock);
+
+  __litl_arrow_pwritev(arrow->f_handle, iov, nb_iov, offset);
+  free(fb.data);
+
+  batch->nb_events = 0;
+  batch->data_size = 0;
+}
+
+/*
+ * Writes the remaining events of a record batch and frees it
+ */
+void litl_arrow_finalize_batch(litl_arrow_batch_t* batch) {
+  int i;
+
+  litl_arrow_flush_batch(batch);
+
+  free(batch->processes);
+  free(batch->times);
+  free(batch->tids);
+  free(batch->codes);
+  free(batch->types);
+  free(batch->nb_params);
+  free(batch->data_offsets);
+  free(batch->data_validity);
+  free(batch->data);
+  for (i = 0; i < LITL_MAX_PARAMS; i++) {
+    free(batch->params[i]);
+    free(batch->validity[i]);
+  }
+  free(batch);
+}
+
+/*
+ * Writes the end of the stream and the footer, which locates the record
+ *   batches, so that they can be read in any order
+ */
+void litl_arrow_finalize(litl_trace_arrow_t* arrow) {
+  // version, schema, dictionaries, recordBatches
+  static const uint8_t footer_sizes[] = { 2, 4, 4, 4 };
+  litl_size_t footer_pos[4], footer, pos, i;
+  int16_t version = __LITL_ARROW_VERSION_V5;
+  __litl_arrow_fb_t fb;
+  uint32_t end_of_stream[2] = { __LITL_ARROW_CONTINUATION, 0 };
+  uint32_t footer_size;
+  struct iovec iov[4];
+
+  __litl_arrow_fb_init(&fb);
+  footer = __litl_arrow_fb_table(&fb, 4, footer_sizes, footer_pos);
+  __litl_arrow_fb_ref(&fb, 0, footer);
+  __litl_arrow_fb_put(&fb, footer_pos[0], &version, sizeof(version));
+  __litl_arrow_fb_ref(&fb, footer_pos[1], __litl_arrow_fb_schema(&fb));
+  __litl_arrow_fb_ref(&fb, footer_pos[2], __litl_arrow_fb_vector(&fb, 0, 24, 8));
+
+  // a block is stored as offset, metaDataLength, padding, bodyLength
+  pos = __litl_arrow_fb_vector(&fb, arrow->nb_blocks, 24, 8);
+  __litl_arrow_fb_ref(&fb, footer_pos[3], pos);
+  for (i = 0; i < arrow->nb_blocks; i++) {
+    litl_size_t block_pos = pos + 4 + 24 * i;
+    __litl_arrow_fb_put(&fb, block_pos, &arrow->blocks[i].offset,
+                        sizeof(uint64_t));
+    __litl_arrow_fb_put(&fb, block_pos + 8, &arrow->blocks[i].metadata_size,
+                        sizeof(uint32_t));
+    __litl_arrow_fb_put(&fb, block_pos + 16, &arrow->blocks[i].body_size,
+                        sizeof(uint64_t));
+  }
+  __litl_arrow_fb_end(&fb);
+  footer_size = fb.size;
+
+  iov[0].iov_base = end_of_stream;
+  iov[0].iov_len = sizeof(end_of_stream);
+  iov[1].iov_base = fb.data;
+  iov[1].iov_len = fb.size;
+  iov[2].iov_base = &footer_size;
+  iov[2].iov_len = sizeof(footer_size);
+  iov[3].iov_base = (void*) __litl_arrow_magic;
+  iov[3].iov_len = strlen(__litl_arrow_magic);
+  __litl_arrow_pwritev(arrow->f_handle, iov, 4, arrow->offset);
+  free(fb.data);
+
+  close(arrow->f_handle);
+  pthread_mutex_destroy(&arrow->lock);
+  free(arrow->blocks);
+  free(arrow);
+}
+
+static void __litl_arrow_visit(litl_read_trace_t* trace
+                                 __attribute__ ((__unused__)),
+                               litl_read_process_t* process,
+                               litl_read_event_t* event, void* state) {
+  litl_arrow_add_event((litl_arrow_batch_t*) state, process, event);
+}
+
+/*
+ * Exports all the events of a trace: each worker fills its own batches
+ */
+uint64_t litl_arrow_export(litl_read_trace_t* trace, const char* filename,
+                           unsigned nb_workers) {
+  litl_trace_arrow_t* arrow;
+  void** batches;
+  uint64_t nb_events;
+  unsigned i;
+
+  if (nb_workers == 0) {
+    long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nb_workers = nb_cpus > 0 ? nb_cpus : 1;
+  }
+
+  arrow = litl_arrow_init(trace, filename);
+  batches = malloc(nb_workers * sizeof(void*));
+  if (!batches) {
+    perror("Could not allocate memory for the record batches!");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nb_workers; i++)
+    batches[i] = litl_arrow_init_batch(arrow);
+
+  litl_read_visit_events(trace, nb_workers, __litl_arrow_visit, batches);
+
+  for (i = 0; i < nb_workers; i++)
+    litl_arrow_finalize_batch((litl_arrow_batch_t*) batches[i]);
+  free(batches);
+  nb_events = arrow->nb_events;
+  litl_arrow_finalize(arrow);
+
+  return nb_events;
+}
@@ -0,0 +1,103 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_ARROW_H_
+#define LITL_ARROW_H_
+
+/**
+ *  \file litl_arrow.h
+ *  \brief litl_arrow Provides a set of functions for exporting traces to the
+ *  Arrow IPC file format, so that the events can be loaded (or memory-mapped)
+ *  as columns by analytical tools
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_arrow LiTL Arrow Export Functions
+ */
+
+/**
+ * \ingroup litl_arrow
+ * \brief Opens an Arrow file and writes its schema. The events are stored in
+ *  the columns process (uint16), time (uint64), tid (uint64), code (uint32),
+ *  type (uint8), nb_params (uint8), p0 to p9 (uint64) and data (binary). The
+ *  parameter columns hold the parameters of the regular events and of the
+ *  packed events, which are decoded by their schema: the signed integers are
+ *  stored as two's complement, the floating-point numbers as the bits of a
+ *  double, and the strings are null. The data column holds the payload of
+ *  the raw events, and of the packed events that have no schema or string
+ *  parameters. The other values are null
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param filename A name of the output file. It must be seekable
+ * \return A pointer to the export object
+ */
+litl_trace_arrow_t* litl_arrow_init(litl_read_trace_t* trace,
+                                    const char* filename);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Allocates a record batch. Several batches of the same export can be
+ *  filled concurrently
+ * \param arrow A pointer to the export object
+ * \return A pointer to the batch
+ */
+litl_arrow_batch_t* litl_arrow_init_batch(litl_trace_arrow_t* arrow);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Adds an event to a record batch. The batch is written to the file
+ *  when it is full
+ * \param batch A pointer to the batch
+ * \param process A pointer to the process of the event
+ * \param event A pointer to the event
+ */
+void litl_arrow_add_event(litl_arrow_batch_t* batch,
+                          litl_read_process_t* process,
+                          litl_read_event_t* event);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Writes the events of a record batch to the file, and empties it
+ * \param batch A pointer to the batch
+ */
+void litl_arrow_flush_batch(litl_arrow_batch_t* batch);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Writes the remaining events of a record batch and frees it
+ * \param batch A pointer to the batch
+ */
+void litl_arrow_finalize_batch(litl_arrow_batch_t* batch);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Writes the footer of the Arrow file, closes it and frees the export
+ *  object. All the batches must be finalized before
+ * \param arrow A pointer to the export object
+ */
+void litl_arrow_finalize(litl_trace_arrow_t* arrow);
+
+/**
+ * \ingroup litl_arrow
+ * \brief Exports all the events of a trace to an Arrow file. The threads of
+ *  the trace are shared among a pool of workers, each of which fills its own
+ *  record batches, so that the events are not in chronological order
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param filename A name of the output file
+ * \param nb_workers A number of workers. If it is 0, one worker per CPU is
+ *  used
+ * \return The number of exported events
+ */
+uint64_t litl_arrow_export(litl_read_trace_t* trace, const char* filename,
+                           unsigned nb_workers);
+
+#endif /* LITL_ARROW_H_ */
@@ -0,0 +1,891 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include "litl_convert.h"
+#include "litl_read.h"
+#include "litl_tools.h"
+#include "litl_pair.h"
+
+#ifndef LITL_CONVERT_BUFFER_SIZE
+#define LITL_CONVERT_BUFFER_SIZE (4 * 1024 * 1024)
+#endif
+
+/*
+ * The fields of the Perfetto messages that are written
+ */
+#define __LITL_PB_TRACE_PACKET 1
+#define __LITL_PB_PACKET_TIMESTAMP 8
+#define __LITL_PB_PACKET_SEQUENCE_ID 10
+#define __LITL_PB_PACKET_TRACK_EVENT 11
+#define __LITL_PB_PACKET_INTERNED_DATA 12
+#define __LITL_PB_PACKET_SEQUENCE_FLAGS 13
+#define __LITL_PB_PACKET_TRACK_DESCRIPTOR 60
+#define __LITL_PB_EVENT_ANNOTATIONS 4
+#define __LITL_PB_EVENT_TYPE 9
+#define __LITL_PB_EVENT_NAME_IID 10
+#define __LITL_PB_EVENT_TRACK_UUID 11
+#define __LITL_PB_ANNOTATION_NAME_IID 1
+#define __LITL_PB_ANNOTATION_UINT 3
+#define __LITL_PB_ANNOTATION_INT 4
+#define __LITL_PB_ANNOTATION_DOUBLE 5
+#define __LITL_PB_ANNOTATION_STRING 6
+#define __LITL_PB_ANNOTATION_POINTER 7
+#define __LITL_PB_INTERNED_EVENT_NAMES 2
+#define __LITL_PB_INTERNED_ANNOTATION_NAMES 3
+#define __LITL_PB_INTERNED_IID 1
+#define __LITL_PB_INTERNED_NAME 2
+#define __LITL_PB_TRACK_UUID 1
+#define __LITL_PB_TRACK_NAME 2
+#define __LITL_PB_TRACK_PROCESS 3
+#define __LITL_PB_TRACK_THREAD 4
+#define __LITL_PB_TRACK_PARENT_UUID 5
+#define __LITL_PB_PROCESS_PID 1
+#define __LITL_PB_PROCESS_NAME 6
+#define __LITL_PB_THREAD_PID 1
+#define __LITL_PB_THREAD_TID 2
+#define __LITL_PB_THREAD_NAME 5
+
+#define __LITL_PB_VARINT 0
+#define __LITL_PB_FIXED64 1
+#define __LITL_PB_LENGTH 2
+
+#define __LITL_PB_EVENT_SLICE_BEGIN 1
+#define __LITL_PB_EVENT_SLICE_END 2
+#define __LITL_PB_EVENT_INSTANT 3
+#define __LITL_PB_SEQUENCE_CLEARED 1
+#define __LITL_PB_SEQUENCE_NEEDED 2
+#define __LITL_PB_SEQUENCE_ID 1
+
+/* the names of the parameters are interned once: p0, p1, ..., then data */
+#define __LITL_CONVERT_DATA_NAME (LITL_MAX_PARAMS + 1)
+
+/*
+ * Writes the formatted events to the output file
+ */
+static void __litl_convert_flush(litl_trace_convert_t* convert) {
+  litl_size_t written = 0;
+  ssize_t res;
+
+  while (written < convert->buffer_size) {
+    res = write(convert->f_handle, convert->buffer + written,
+                convert->buffer_size - written);
+    if (res == -1) {
+      perror("Could not write the converted trace!");
+      exit(EXIT_FAILURE);
+    }
+    written += res;
+  }
+  convert->buffer_size = 0;
+}
+
+/*
+ * Makes room for len more Bytes. The buffer is not flushed while a message is
+ *   being written, since its length is filled afterwards
+ */
+static inline void __litl_convert_reserve(litl_trace_convert_t* convert,
+                                          litl_size_t len) {
+  if (convert->buffer_size + len <= convert->buffer_capacity)
+    return;
+
+  if (!convert->nesting)
+    __litl_convert_flush(convert);
+  while (convert->buffer_size + len > convert->buffer_capacity) {
+    convert->buffer_capacity *= 2;
+    convert->buffer = realloc(convert->buffer, convert->buffer_capacity);
+    if (!convert->buffer) {
+      perror("Could not allocate memory for the converted trace!");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+static inline void __litl_convert_write(litl_trace_convert_t* convert,
+                                        const void* data, litl_size_t len) {
+  __litl_convert_reserve(convert, len);
+  memcpy(convert->buffer + convert->buffer_size, data, len);
+  convert->buffer_size += len;
+}
+
+#define __litl_convert_lit(convert, str)                \
+  __litl_convert_write(convert, str, sizeof(str) - 1)
+
+static void __litl_convert_dec(litl_trace_convert_t* convert, uint64_t value) {
+  char tmp[20];
+  char* pos = tmp + sizeof(tmp);
+
+  do {
+    *--pos = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  __litl_convert_write(convert, pos, tmp + sizeof(tmp) - pos);
+}
+
+static void __litl_convert_hex(litl_trace_convert_t* convert, uint64_t value) {
+  char tmp[18];
+  char* pos = tmp + sizeof(tmp);
+
+  do {
+    *--pos = "0123456789abcdef"[value & 0xf];
+    value >>= 4;
+  } while (value);
+  *--pos = 'x';
+  *--pos = '0';
+  __litl_convert_write(convert, pos, tmp + sizeof(tmp) - pos);
+}
+
+/*
+ * Writes a JSON string
+ */
+static void __litl_convert_json_string(litl_trace_convert_t* convert,
+                                       const char* str, size_t len) {
+  size_t i, start = 0;
+  char escape[8];
+
+  __litl_convert_lit(convert, "\"");
+  for (i = 0; i < len; i++) {
+    unsigned char c = str[i];
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    __litl_convert_write(convert, str + start, i - start);
+    if (c == '"' || c == '\\') {
+      escape[0] = '\\';
+      escape[1] = c;
+      __litl_convert_write(convert, escape, 2);
+    } else {
+      sprintf(escape, "\\u%04x", c);
+      __litl_convert_write(convert, escape, 6);
+    }
+    start = i + 1;
+  }
+  __litl_convert_write(convert, str + start, len - start);
+  __litl_convert_lit(convert, "\"");
+}
+
+/*
+ * Starts a JSON record, and separates it from the previous one
+ */
+static void __litl_convert_json_record(litl_trace_convert_t* convert) {
+  if (convert->nb_records++)
+    __litl_convert_lit(convert, ",\n");
+  __litl_convert_lit(convert, "{");
+}
+
+static void __litl_convert_pb_varint(litl_trace_convert_t* convert,
+                                     uint64_t value) {
+  uint8_t tmp[10];
+  int len = 0;
+
+  while (value >= 0x80) {
+    tmp[len++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  tmp[len++] = value;
+  __litl_convert_write(convert, tmp, len);
+}
+
+static inline void __litl_convert_pb_tag(litl_trace_convert_t* convert,
+                                         unsigned field, unsigned type) {
+  __litl_convert_pb_varint(convert, (field << 3) | type);
+}
+
+static void __litl_convert_pb_uint(litl_trace_convert_t* convert,
+                                   unsigned field, uint64_t value) {
+  __litl_convert_pb_tag(convert, field, __LITL_PB_VARINT);
+  __litl_convert_pb_varint(convert, value);
+}
+
+static void __litl_convert_pb_double(litl_trace_convert_t* convert,
+                                     unsigned field, double value) {
+  __litl_convert_pb_tag(convert, field, __LITL_PB_FIXED64);
+  __litl_convert_write(convert, &value, sizeof(value));
+}
+
+static void __litl_convert_pb_string(litl_trace_convert_t* convert,
+                                     unsigned field, const char* str,
+                                     size_t len) {
+  __litl_convert_pb_tag(convert, field, __LITL_PB_LENGTH);
+  __litl_convert_pb_varint(convert, len);
+  __litl_convert_write(convert, str, len);
+}
+
+/*
+ * Starts a nested message. Its length is not known yet, so it is stored on
+ *   four Bytes, which is a valid (non-minimal) varint
+ */
+static litl_size_t __litl_convert_pb_begin(litl_trace_convert_t* convert,
+                                           unsigned field) {
+  __litl_convert_pb_tag(convert, field, __LITL_PB_LENGTH);
+  __litl_convert_reserve(convert, 4);
+  convert->buffer_size += 4;
+  convert->nesting++;
+
+  return convert->buffer_size;
+}
+
+static void __litl_convert_pb_end(litl_trace_convert_t* convert,
+                                  litl_size_t start) {
+  litl_size_t len = convert->buffer_size - start;
+  uint8_t* pos = convert->buffer + start - 4;
+
+  pos[0] = (len & 0x7f) | 0x80;
+  pos[1] = ((len >> 7) & 0x7f) | 0x80;
+  pos[2] = ((len >> 14) & 0x7f) | 0x80;
+  pos[3] = (len >> 21) & 0x7f;
+  convert->nesting--;
+}
+
+/*
+ * Returns the name of an event code: the name of its schema, if any
+ */
+static const char* __litl_convert_code_name(litl_read_process_t* process,
+                                            litl_code_t code) {
+  litl_event_schema_t* schema = litl_read_get_event_schema(process, code);
+
+  return schema ? (const char*) schema->name : NULL;
+}
+
+/*
+ * Returns the name of an event. Only the packed events have a schema
+ */
+static inline const char* __litl_convert_event_name(
+    litl_read_process_t* process, litl_read_event_t* event) {
+  if (LITL_READ_GET_TYPE(event) != LITL_TYPE_PACKED)
+    return NULL ;
+  return __litl_convert_code_name(process, LITL_READ_GET_CODE(event));
+}
+
+/*
+ * Returns the Perfetto ID of a thread: the process in the upper half, the
+ *   thread in the lower one. The threads are numbered from 1, so that 0 is the
+ *   process itself
+ */
+static inline uint64_t __litl_convert_uuid(litl_med_size_t process_index,
+                                           litl_med_size_t thread_index) {
+  return ((uint64_t) (process_index + 1) << 32) | thread_index;
+}
+
+/*
+ * Writes the descriptions of a process and of its threads
+ */
+static void __litl_convert_add_process(litl_trace_convert_t* convert,
+                                       litl_med_size_t process_index) {
+  litl_read_process_t* process =
+    convert->trace->event_processes[process_index];
+  const char* name = (const char*) process->header->process_name;
+  litl_size_t packet, track, descriptor;
+  litl_med_size_t thread_index;
+  char thread_name[32];
+  int len;
+
+  if (convert->format == LITL_CONVERT_CHROME_JSON) {
+    __litl_convert_json_record(convert);
+    __litl_convert_lit(convert, "\"name\":\"process_name\",\"ph\":\"M\",\"pid\":");
+    __litl_convert_dec(convert, process_index + 1);
+    __litl_convert_lit(convert, ",\"tid\":0,\"args\":{\"name\":");
+    __litl_convert_json_string(convert, name, strnlen(name, 256));
+    __litl_convert_lit(convert, "}}");
+  } else {
+    packet = __litl_convert_pb_begin(convert, __LITL_PB_TRACE_PACKET);
+    track = __litl_convert_pb_begin(convert, __LITL_PB_PACKET_TRACK_DESCRIPTOR);
+    __litl_convert_pb_uint(convert, __LITL_PB_TRACK_UUID,
+                           __litl_convert_uuid(process_index, 0));
+    descriptor = __litl_convert_pb_begin(convert, __LITL_PB_TRACK_PROCESS);
+    __litl_convert_pb_uint(convert, __LITL_PB_PROCESS_PID, process_index + 1);
+    __litl_convert_pb_string(convert, __LITL_PB_PROCESS_NAME, name,
+                             strnlen(name, 256));
+    __litl_convert_pb_end(convert, descriptor);
+    __litl_convert_pb_end(convert, track);
+    __litl_convert_pb_end(convert, packet);
+  }
+
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    litl_tid_t tid = process->threads[thread_index]->thread_pair->tid;
+    len = sprintf(thread_name, "%"PRTIu64, tid);
+
+    if (convert->format == LITL_CONVERT_CHROME_JSON) {
+      __litl_convert_json_record(convert);
+      __litl_convert_lit(convert, "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":");
+      __litl_convert_dec(convert, process_index + 1);
+      __litl_convert_lit(convert, ",\"tid\":");
+      __litl_convert_dec(convert, thread_index + 1);
+      __litl_convert_lit(convert, ",\"args\":{\"name\":");
+      __litl_convert_json_string(convert, thread_name, len);
+      __litl_convert_lit(convert, "}}");
+    } else {
+      // the tids of Perfetto are 32-bit, and shared by all the processes
+      packet = __litl_convert_pb_begin(convert, __LITL_PB_TRACE_PACKET);
+      track = __litl_convert_pb_begin(convert,
+                                      __LITL_PB_PACKET_TRACK_DESCRIPTOR);
+      __litl_convert_pb_uint(convert, __LITL_PB_TRACK_UUID,
+                             __litl_convert_uuid(process_index,
+                                                 thread_index + 1));
+      __litl_convert_pb_uint(convert, __LITL_PB_TRACK_PARENT_UUID,
+                             __litl_convert_uuid(process_index, 0));
+      descriptor = __litl_convert_pb_begin(convert, __LITL_PB_TRACK_THREAD);
+      __litl_convert_pb_uint(convert, __LITL_PB_THREAD_PID, process_index + 1);
+      __litl_convert_pb_uint(convert, __LITL_PB_THREAD_TID,
+                             (process_index + 1) * 65536 + thread_index + 1);
+      __litl_convert_pb_string(convert, __LITL_PB_THREAD_NAME, thread_name,
+                               len);
+      __litl_convert_pb_end(convert, descriptor);
+      __litl_convert_pb_end(convert, track);
+      __litl_convert_pb_end(convert, packet);
+    }
+  }
+}
+
+/*
+ * Starts the Perfetto sequence: the names of the parameters are interned in
+ *   its first packet
+ */
+static void __litl_convert_pb_start_sequence(litl_trace_convert_t* convert) {
+  litl_size_t packet, interned, name;
+  char param_name[8];
+  int i, len;
+
+  packet = __litl_convert_pb_begin(convert, __LITL_PB_TRACE_PACKET);
+  __litl_convert_pb_uint(convert, __LITL_PB_PACKET_SEQUENCE_ID,
+                         __LITL_PB_SEQUENCE_ID);
+  __litl_convert_pb_uint(convert, __LITL_PB_PACKET_SEQUENCE_FLAGS,
+                         __LITL_PB_SEQUENCE_CLEARED);
+  interned = __litl_convert_pb_begin(convert, __LITL_PB_PACKET_INTERNED_DATA);
+  for (i = 0; i <= LITL_MAX_PARAMS; i++) {
+    if (i < LITL_MAX_PARAMS)
+      len = sprintf(param_name, "p%d", i);
+    else
+      len = sprintf(param_name, "data");
+    name = __litl_convert_pb_begin(convert, __LITL_PB_INTERNED_ANNOTATION_NAMES);
+    __litl_convert_pb_uint(convert, __LITL_PB_INTERNED_IID, i + 1);
+    __litl_convert_pb_string(convert, __LITL_PB_INTERNED_NAME, param_name, len);
+    __litl_convert_pb_end(convert, name);
+  }
+  __litl_convert_pb_end(convert, interned);
+  __litl_convert_pb_end(convert, packet);
+}
+
+/*
+ * Opens the output file and writes the descriptions of the processes and
+ *   threads
+ */
+litl_trace_convert_t* litl_convert_init(litl_read_trace_t* trace,
+                                        const char* filename,
+                                        litl_convert_format_t format) {
+  litl_trace_convert_t* convert;
+  litl_med_size_t process_index;
+
+  convert = calloc(1, sizeof(litl_trace_convert_t));
+  if (!convert) {
+    perror("Could not allocate memory for converting the trace!");
+    exit(EXIT_FAILURE);
+  }
+
+  if (strcmp(filename, "-") == 0)
+    convert->f_handle = STDOUT_FILENO;
+  else if ((convert->f_handle = open(filename, O_WRONLY | O_CREAT | O_TRUNC,
+                                     0644)) < 0) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  convert->format = format;
+  convert->trace = trace;
+
+  convert->buffer_capacity = LITL_CONVERT_BUFFER_SIZE;
+  convert->buffer = malloc(convert->buffer_capacity);
+  if (!convert->buffer) {
+    perror("Could not allocate memory for converting the trace!");
+    exit(EXIT_FAILURE);
+  }
+
+  if (format == LITL_CONVERT_CHROME_JSON)
+    __litl_convert_lit(convert, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  else
+    __litl_convert_pb_start_sequence(convert);
+
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++)
+    __litl_convert_add_process(convert, process_index);
+
+  return convert;
+}
+
+/*
+ * Writes the parameters of an event as JSON arguments
+ */
+static void __litl_convert_json_args(litl_trace_convert_t* convert,
+                                     litl_read_process_t* process,
+                                     litl_read_event_t* event) {
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  char param_name[16];
+  char value[32];
+  int i, nb_params, len;
+
+  __litl_convert_lit(convert, ",\"args\":{");
+  switch (LITL_READ_GET_TYPE(event)) {
+  case LITL_TYPE_REGULAR:
+    for (i = 0; i < LITL_READ_REGULAR(event)->nb_params; i++) {
+      len = sprintf(param_name, "%s\"p%d\":\"", i ? "," : "", i);
+      __litl_convert_write(convert, param_name, len);
+      __litl_convert_hex(convert, LITL_READ_REGULAR(event)->param[i]);
+      __litl_convert_lit(convert, "\"");
+    }
+    break;
+  case LITL_TYPE_RAW:
+    __litl_convert_lit(convert, "\"data\":");
+    __litl_convert_json_string(
+        convert, (const char*) LITL_READ_RAW(event)->data,
+        strnlen((const char*) LITL_READ_RAW(event)->data,
+                LITL_READ_RAW(event)->size));
+    break;
+  case LITL_TYPE_PACKED:
+    nb_params = litl_read_get_typed_params(process, event, params);
+    for (i = 0; i < nb_params; i++) {
+      len = sprintf(param_name, "%s\"p%d\":", i ? "," : "", i);
+      __litl_convert_write(convert, param_name, len);
+      switch (params[i].type) {
+      case LITL_PARAM_INT8:
+      case LITL_PARAM_INT16:
+      case LITL_PARAM_INT32:
+      case LITL_PARAM_INT64:
+        if (params[i].value.i < 0)
+          __litl_convert_lit(convert, "-");
+        __litl_convert_dec(convert,
+                           params[i].value.i < 0 ?
+                             -(uint64_t) params[i].value.i :
+                             (uint64_t) params[i].value.i);
+        break;
+      case LITL_PARAM_FLOAT:
+      case LITL_PARAM_DOUBLE:
+        if (isfinite(params[i].value.d)) {
+          len = snprintf(value, sizeof(value), "%.17g", params[i].value.d);
+          __litl_convert_write(convert, value, len);
+        } else
+          __litl_convert_lit(convert, "null");
+        break;
+      case LITL_PARAM_POINTER:
+      case LITL_PARAM_ADDRESS:
+        __litl_convert_lit(convert, "\"");
+        __litl_convert_hex(convert, params[i].value.u);
+        __litl_convert_lit(convert, "\"");
+        break;
+      case LITL_PARAM_STRING:
+        if (params[i].value.s)
+          __litl_convert_json_string(convert, params[i].value.s,
+                                     strlen(params[i].value.s));
+        else
+          __litl_convert_lit(convert, "null");
+        break;
+      default:
+        __litl_convert_dec(convert, params[i].value.u);
+        break;
+      }
+    }
+    break;
+  default:
+    break;
+  }
+  __litl_convert_lit(convert, "}");
+}
+
+/*
+ * Writes the name, the phase and the time stamp of a JSON record
+ */
+static void __litl_convert_json_head(litl_trace_convert_t* convert,
+                                     const char* name, litl_code_t code,
+                                     const char* phase, litl_time_t time) {
+  char fraction[4];
+
+  __litl_convert_json_record(convert);
+  __litl_convert_lit(convert, "\"name\":");
+  if (name)
+    __litl_convert_json_string(convert, name, strlen(name));
+  else {
+    __litl_convert_lit(convert, "\"");
+    __litl_convert_hex(convert, code);
+    __litl_convert_lit(convert, "\"");
+  }
+  __litl_convert_lit(convert, ",\"ph\":");
+  __litl_convert_write(convert, phase, strlen(phase));
+
+  // the timestamps are in microseconds
+  __litl_convert_lit(convert, ",\"ts\":");
+  __litl_convert_dec(convert, time / 1000);
+  fraction[0] = '.';
+  fraction[1] = '0' + time / 100 % 10;
+  fraction[2] = '0' + time / 10 % 10;
+  fraction[3] = '0' + time % 10;
+  __litl_convert_write(convert, fraction, sizeof(fraction));
+}
+
+static void __litl_convert_json_thread(litl_trace_convert_t* convert,
+                                       litl_med_size_t process_index,
+                                       litl_med_size_t thread_id) {
+  __litl_convert_lit(convert, ",\"pid\":");
+  __litl_convert_dec(convert, process_index + 1);
+  __litl_convert_lit(convert, ",\"tid\":");
+  __litl_convert_dec(convert, thread_id);
+}
+
+static void __litl_convert_json_event(litl_trace_convert_t* convert,
+                                      litl_read_process_t* process,
+                                      litl_read_event_t* event,
+                                      litl_read_thread_t* thread) {
+  __litl_convert_json_head(convert, __litl_convert_event_name(process, event),
+                           LITL_READ_GET_CODE(event), "\"i\",\"s\":\"t\"",
+                           LITL_READ_GET_TIME(event));
+  __litl_convert_json_thread(convert, process->index,
+                             thread ? thread->index + 1 : 0);
+  __litl_convert_json_args(convert, process, event);
+  __litl_convert_lit(convert, "}");
+}
+
+/*
+ * Writes the beginning or the end of a slice, with the parameters of its
+ *   entry or exit event. The end of an incomplete slice has no event
+ */
+static void __litl_convert_json_slice(litl_trace_convert_t* convert,
+                                      litl_read_process_t* process,
+                                      litl_read_event_t* event,
+                                      litl_med_size_t process_index,
+                                      litl_med_size_t thread_index,
+                                      litl_code_t code, litl_time_t time,
+                                      const char* phase) {
+  __litl_convert_json_head(convert, __litl_convert_code_name(process, code),
+                           code, phase, time);
+  __litl_convert_json_thread(convert, process_index, thread_index + 1);
+  if (event)
+    __litl_convert_json_args(convert, process, event);
+  else
+    __litl_convert_lit(convert, ",\"args\":{\"incomplete\":true}");
+  __litl_convert_lit(convert, "}");
+}
+
+/*
+ * Returns whether the name of an event was already interned, and adds it
+ *   otherwise
+ */
+static int __litl_convert_is_interned(litl_trace_convert_t* convert,
+                                      uint64_t iid) {
+  litl_size_t first = 0, last = convert->nb_names, middle;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (convert->names[middle] < iid)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  if (first < convert->nb_names && convert->names[first] == iid)
+    return 1;
+
+  if (convert->nb_names == convert->nb_allocated_names) {
+    convert->nb_allocated_names = convert->nb_allocated_names ?
+      2 * convert->nb_allocated_names : 64;
+    convert->names = realloc(convert->names,
+                             convert->nb_allocated_names * sizeof(uint64_t));
+    if (!convert->names) {
+      perror("Could not allocate memory for converting the trace!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memmove(&convert->names[first + 1], &convert->names[first],
+          (convert->nb_names - first) * sizeof(uint64_t));
+  convert->names[first] = iid;
+  convert->nb_names++;
+
+  return 0;
+}
+
+/*
+ * Writes the parameters of an event as Perfetto debug annotations
+ */
+static void __litl_convert_pb_args(litl_trace_convert_t* convert,
+                                   litl_read_process_t* process,
+                                   litl_read_event_t* event) {
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_size_t annotation;
+  int i, nb_params;
+
+  switch (LITL_READ_GET_TYPE(event)) {
+  case LITL_TYPE_REGULAR:
+    for (i = 0; i < LITL_READ_REGULAR(event)->nb_params; i++) {
+      annotation = __litl_convert_pb_begin(convert,
+                                           __LITL_PB_EVENT_ANNOTATIONS);
+      __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_NAME_IID, i + 1);
+      __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_UINT,
+                             LITL_READ_REGULAR(event)->param[i]);
+      __litl_convert_pb_end(convert, annotation);
+    }
+    break;
+  case LITL_TYPE_RAW:
+    annotation = __litl_convert_pb_begin(convert, __LITL_PB_EVENT_ANNOTATIONS);
+    __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_NAME_IID,
+                           __LITL_CONVERT_DATA_NAME);
+    __litl_convert_pb_string(
+        convert, __LITL_PB_ANNOTATION_STRING,
+        (const char*) LITL_READ_RAW(event)->data,
+        strnlen((const char*) LITL_READ_RAW(event)->data,
+                LITL_READ_RAW(event)->size));
+    __litl_convert_pb_end(convert, annotation);
+    break;
+  case LITL_TYPE_PACKED:
+    nb_params = litl_read_get_typed_params(process, event, params);
+    for (i = 0; i < nb_params; i++) {
+      annotation = __litl_convert_pb_begin(convert,
+                                           __LITL_PB_EVENT_ANNOTATIONS);
+      __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_NAME_IID, i + 1);
+      switch (params[i].type) {
+      case LITL_PARAM_INT8:
+      case LITL_PARAM_INT16:
+      case LITL_PARAM_INT32:
+      case LITL_PARAM_INT64:
+        __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_INT,
+                               params[i].value.i);
+        break;
+      case LITL_PARAM_FLOAT:
+      case LITL_PARAM_DOUBLE:
+        __litl_convert_pb_double(convert, __LITL_PB_ANNOTATION_DOUBLE,
+                                 params[i].value.d);
+        break;
+      case LITL_PARAM_POINTER:
+      case LITL_PARAM_ADDRESS:
+        __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_POINTER,
+                               params[i].value.u);
+        break;
+      case LITL_PARAM_STRING:
+        if (params[i].value.s)
+          __litl_convert_pb_string(convert, __LITL_PB_ANNOTATION_STRING,
+                                   params[i].value.s,
+                                   strlen(params[i].value.s));
+        break;
+      default:
+        __litl_convert_pb_uint(convert, __LITL_PB_ANNOTATION_UINT,
+                               params[i].value.u);
+        break;
+      }
+      __litl_convert_pb_end(convert, annotation);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * Starts a packet holding a track event. Its name is interned the first time
+ *   it is used. Returns the positions of the packet and of the track event
+ */
+static void __litl_convert_pb_track_event(litl_trace_convert_t* convert,
+                                          litl_med_size_t process_index,
+                                          uint64_t track_id, litl_time_t time,
+                                          litl_code_t code, const char* name,
+                                          unsigned type, litl_size_t* packet,
+                                          litl_size_t* message) {
+  // the names are interned per process, since the schemas of the processes
+  //   of an archive may differ
+  uint64_t iid = ((uint64_t) process_index << 32 | code) + 1;
+  litl_size_t interned, name_message;
+  char code_name[16];
+
+  *packet = __litl_convert_pb_begin(convert, __LITL_PB_TRACE_PACKET);
+  __litl_convert_pb_uint(convert, __LITL_PB_PACKET_TIMESTAMP, time);
+  __litl_convert_pb_uint(convert, __LITL_PB_PACKET_SEQUENCE_ID,
+                         __LITL_PB_SEQUENCE_ID);
+  __litl_convert_pb_uint(convert, __LITL_PB_PACKET_SEQUENCE_FLAGS,
+                         __LITL_PB_SEQUENCE_NEEDED);
+
+  // the ends of slices have no name
+  if (type != __LITL_PB_EVENT_SLICE_END
+      && !__litl_convert_is_interned(convert, iid)) {
+    if (!name) {
+      sprintf(code_name, "%#"PRTIx32, code);
+      name = code_name;
+    }
+    interned = __litl_convert_pb_begin(convert, __LITL_PB_PACKET_INTERNED_DATA);
+    name_message = __litl_convert_pb_begin(convert,
+                                           __LITL_PB_INTERNED_EVENT_NAMES);
+    __litl_convert_pb_uint(convert, __LITL_PB_INTERNED_IID, iid);
+    __litl_convert_pb_string(convert, __LITL_PB_INTERNED_NAME, name,
+                             strlen(name));
+    __litl_convert_pb_end(convert, name_message);
+    __litl_convert_pb_end(convert, interned);
+  }
+
+  *message = __litl_convert_pb_begin(convert, __LITL_PB_PACKET_TRACK_EVENT);
+  __litl_convert_pb_uint(convert, __LITL_PB_EVENT_TYPE, type);
+  __litl_convert_pb_uint(convert, __LITL_PB_EVENT_TRACK_UUID,
+                         __litl_convert_uuid(process_index, track_id));
+  if (type != __LITL_PB_EVENT_SLICE_END)
+    __litl_convert_pb_uint(convert, __LITL_PB_EVENT_NAME_IID, iid);
+}
+
+static void __litl_convert_pb_event(litl_trace_convert_t* convert,
+                                    litl_read_process_t* process,
+                                    litl_read_event_t* event,
+                                    litl_read_thread_t* thread) {
+  litl_size_t packet, message;
+
+  __litl_convert_pb_track_event(convert, process->index,
+                                thread ? thread->index + 1 : 0,
+                                LITL_READ_GET_TIME(event),
+                                LITL_READ_GET_CODE(event),
+                                __litl_convert_event_name(process, event),
+                                __LITL_PB_EVENT_INSTANT, &packet, &message);
+  __litl_convert_pb_args(convert, process, event);
+  __litl_convert_pb_end(convert, message);
+  __litl_convert_pb_end(convert, packet);
+}
+
+/*
+ * Writes the beginning or the end of a slice, with the parameters of its
+ *   entry or exit event as annotations. The end of an incomplete slice has no
+ *   event
+ */
+static void __litl_convert_pb_slice(litl_trace_convert_t* convert,
+                                    litl_read_process_t* process,
+                                    litl_read_event_t* event,
+                                    litl_med_size_t process_index,
+                                    litl_med_size_t thread_index,
+                                    litl_code_t code, litl_time_t time,
+                                    unsigned type) {
+  litl_size_t packet, message;
+
+  __litl_convert_pb_track_event(convert, process_index, thread_index + 1,
+                                time, code,
+                                __litl_convert_code_name(process, code), type,
+                                &packet, &message);
+  if (event)
+    __litl_convert_pb_args(convert, process, event);
+  __litl_convert_pb_end(convert, message);
+  __litl_convert_pb_end(convert, packet);
+}
+
+/*
+ * Ends the slice of an interval found by the pairing of the events. When the
+ *   interval is complete, it is closed by the event being converted, whose
+ *   parameters are written with the end of the slice
+ */
+static void __litl_convert_interval(const litl_interval_t* interval,
+                                    void* arg) {
+  litl_trace_convert_t* convert = (litl_trace_convert_t*) arg;
+  litl_read_process_t* process =
+    convert->trace->event_processes[interval->process_index];
+  litl_read_event_t* event = NULL;
+
+  if (interval->is_complete && convert->exit_event) {
+    event = convert->exit_event;
+    convert->exit_event = NULL;
+  }
+
+  if (convert->format == LITL_CONVERT_CHROME_JSON)
+    __litl_convert_json_slice(convert, process, event,
+                              interval->process_index, interval->thread_index,
+                              interval->code,
+                              interval->start + interval->duration,
+                              "\"E\"");
+  else
+    __litl_convert_pb_slice(convert, process, event, interval->process_index,
+                            interval->thread_index, interval->code,
+                            interval->start + interval->duration,
+                            __LITL_PB_EVENT_SLICE_END);
+}
+
+/*
+ * Pairs the entry and exit events into intervals
+ */
+void litl_convert_pair_events(litl_trace_convert_t* convert) {
+  if (!convert->pair)
+    convert->pair = litl_pair_init(convert->trace, __litl_convert_interval,
+                                   convert);
+}
+
+/*
+ * Converts an event
+ */
+void litl_convert_event(litl_trace_convert_t* convert,
+                        litl_read_process_t* process,
+                        litl_read_event_t* event) {
+  litl_read_thread_t* thread;
+
+  if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+    return;
+
+  convert->nb_events++;
+  thread = litl_read_find_thread(process, LITL_READ_GET_TID(event));
+
+  // the slices are begun and ended as the events come, so that they carry the
+  //   parameters of their entry and exit events
+  if (convert->pair) {
+    convert->exit_event = event;
+    if (litl_pair_event(convert->pair, process, event)) {
+      // the event did not close any interval, so it is an entry
+      if (convert->exit_event && thread) {
+        if (convert->format == LITL_CONVERT_CHROME_JSON)
+          __litl_convert_json_slice(convert, process, event, process->index,
+                                    thread->index, LITL_READ_GET_CODE(event),
+                                    LITL_READ_GET_TIME(event), "\"B\"");
+        else
+          __litl_convert_pb_slice(convert, process, event, process->index,
+                                  thread->index, LITL_READ_GET_CODE(event),
+                                  LITL_READ_GET_TIME(event),
+                                  __LITL_PB_EVENT_SLICE_BEGIN);
+      }
+      convert->exit_event = NULL;
+      return;
+    }
+    convert->exit_event = NULL;
+  }
+
+  if (convert->format == LITL_CONVERT_CHROME_JSON)
+    __litl_convert_json_event(convert, process, event, thread);
+  else
+    __litl_convert_pb_event(convert, process, event, thread);
+}
+
+/*
+ * Completes the output file and frees the conversion object
+ */
+void litl_convert_finalize(litl_trace_convert_t* convert) {
+  // the entries left are converted as incomplete intervals
+  if (convert->pair)
+    litl_pair_finalize(convert->pair);
+
+  if (convert->format == LITL_CONVERT_CHROME_JSON)
+    __litl_convert_lit(convert, "\n]}\n");
+  __litl_convert_flush(convert);
+
+  if (convert->f_handle != STDOUT_FILENO)
+    close(convert->f_handle);
+  free(convert->buffer);
+  free(convert->names);
+  free(convert);
+}
+
+/*
+ * Converts all the events of a trace in chronological order
+ */
+uint64_t litl_convert_trace(litl_read_trace_t* trace, const char* filename,
+                            litl_convert_format_t format) {
+  litl_trace_convert_t* convert;
+  litl_read_event_t* event;
+  uint64_t nb_events;
+
+  convert = litl_convert_init(trace, filename, format);
+  while ((event = litl_read_next_ordered_event(trace)) != NULL )
+    litl_convert_event(convert, LITL_READ_GET_CUR_PROCESS(trace), event);
+  nb_events = convert->nb_events;
+  litl_convert_finalize(convert);
+
+  return nb_events;
+}
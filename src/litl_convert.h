@@ -0,0 +1,87 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_CONVERT_H_
+#define LITL_CONVERT_H_
+
+/**
+ *  \file litl_convert.h
+ *  \brief litl_convert Provides a set of functions for converting traces to
+ *  the formats of trace viewers: the JSON trace event format of Chrome and
+ *  the protobuf trace format of Perfetto
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_convert LiTL Converting Functions
+ */
+
+/**
+ * \ingroup litl_convert
+ * \brief Opens the output file of a conversion and writes the descriptions of
+ *  the processes and threads of a trace
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param filename A name of the output file
+ * \param format The output format
+ * \return A pointer to the conversion object
+ */
+litl_trace_convert_t* litl_convert_init(litl_read_trace_t* trace,
+                                        const char* filename,
+                                        litl_convert_format_t format);
+
+/**
+ * \ingroup litl_convert
+ * \brief Converts an event. The events are written as they come, so they are
+ *  usually read in chronological order with litl_read_next_ordered_event
+ * \param convert A pointer to the conversion object
+ * \param process A pointer to the process of the event
+ * \param event A pointer to the event
+ */
+void litl_convert_event(litl_trace_convert_t* convert,
+                        litl_read_process_t* process,
+                        litl_read_event_t* event);
+
+/**
+ * \ingroup litl_convert
+ * \brief Converts the entry and exit events as intervals (slices), using the
+ *  pairing of litl_pair. The beginning and the end of each slice are written
+ *  when its entry and exit events are converted (B and E records, or
+ *  SLICE_BEGIN and SLICE_END packets), with their parameters. The entries
+ *  that are closed without their exit end their slice without parameters,
+ *  and are marked as incomplete in the JSON format. The other events are
+ *  still converted as instant events. It should be called before converting
+ *  the events
+ * \param convert A pointer to the conversion object
+ */
+void litl_convert_pair_events(litl_trace_convert_t* convert);
+
+/**
+ * \ingroup litl_convert
+ * \brief Completes the output file and frees the conversion object
+ * \param convert A pointer to the conversion object
+ */
+void litl_convert_finalize(litl_trace_convert_t* convert);
+
+/**
+ * \ingroup litl_convert
+ * \brief Converts all the events of a trace in chronological order. The
+ *  events are streamed, so that the memory does not depend on the size of
+ *  the trace
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param filename A name of the output file
+ * \param format The output format
+ * \return The number of converted events
+ */
+uint64_t litl_convert_trace(litl_read_trace_t* trace, const char* filename,
+                            litl_convert_format_t format);
+
+#endif /* LITL_CONVERT_H_ */
@@ -6,15 +6,33 @@
 
 #define _GNU_SOURCE
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
 
 #include "litl_merge.h"
+#include "litl_read.h"
+#include "litl_write.h"
+#include "litl_tools.h"
 
 static litl_trace_merge_t* __arch;
-static litl_trace_triples_t** __triples;
+
+/*
+ * A task run by the workers on each trace. The buffer of a worker is
+ *   allocated by the task if needed
+ */
+typedef void (*__litl_merge_task_t)(litl_med_size_t trace_index,
+                                    litl_buffer_t* buffer);
+static __litl_merge_task_t __task;
 
 /*
  * Sets a new name for the archive
@@ -34,183 +52,422 @@ static void __litl_merge_set_archive_name(const char* filename) {
 }
 
 /*
- * Adds a trace header:
- *   - The number of traces
- *   - Triples: a file id, a file size, and an offset
+ * Runs the task on the traces that are left
  */
-static void __litl_merge_add_archive_header() {
+static void* __litl_merge_worker(void* arg __attribute__ ((__unused__))) {
+  litl_buffer_t buffer = NULL;
+  unsigned trace_index;
 
-  int trace_in, res __attribute__ ((__unused__));
-  litl_med_size_t trace_index, process_index, general_header_size,
-      process_header_size, global_header_size, nb_processes, total_nb_processes;
-  litl_buffer_t header_buffer;
+  while ((trace_index = __atomic_fetch_add(&__arch->next_trace, 1,
+                                           __ATOMIC_RELAXED))
+      < __arch->nb_traces)
+    __task(trace_index, &buffer);
 
-  total_nb_processes = 0;
-  global_header_size = 0;
-  general_header_size = sizeof(litl_general_header_t);
-  process_header_size = sizeof(litl_process_header_t);
-
-  // create an array of arrays of offsets
-  __triples = (litl_trace_triples_t **) malloc(
-      __arch->nb_traces * sizeof(litl_trace_triples_t *));
+  free(buffer);
+  return NULL ;
+}
 
-  // read all header of traces and write them to the global header of the archive
-  for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++) {
+/*
+ * Runs a task on all the traces with the pool of workers
+ */
+static void __litl_merge_run(__litl_merge_task_t task) {
+  pthread_t* workers;
+  unsigned i;
+
+  __task = task;
+  __arch->next_trace = 0;
+  if (__arch->nb_workers == 1) {
+    __litl_merge_worker(NULL );
+    return;
+  }
 
-    if ((trace_in = open(__arch->traces_names[trace_index], O_RDONLY)) < 0) {
-      fprintf(stderr, "[litl_merge] Cannot open %s to read its header\n",
-              __arch->traces_names[trace_index]);
+  workers = malloc(__arch->nb_workers * sizeof(pthread_t));
+  if (!workers) {
+    perror("Could not allocate memory for the workers!");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < __arch->nb_workers; i++)
+    if (pthread_create(&workers[i], NULL, __litl_merge_worker, NULL ) != 0) {
+      perror("Could not create the workers!");
       exit(EXIT_FAILURE);
     }
+  for (i = 0; i < __arch->nb_workers; i++)
+    pthread_join(workers[i], NULL );
+  free(workers);
+}
 
-    // read the trace header
-    header_buffer = (litl_buffer_t) malloc(general_header_size);
-    res = read(trace_in, header_buffer, general_header_size);
+/*
+ * Opens a trace
+ */
+static int __litl_merge_open_trace(litl_med_size_t trace_index) {
+  int trace_in;
 
-    nb_processes = ((litl_general_header_t *) header_buffer)->nb_processes;
-    __triples[trace_index] = (litl_trace_triples_t *) malloc(
-        nb_processes * sizeof(litl_trace_triples_t));
+  if ((trace_in = open(__arch->traces_names[trace_index], O_RDONLY)) < 0) {
+    fprintf(stderr, "[litl_merge] Cannot open %s\n",
+            __arch->traces_names[trace_index]);
+    exit(EXIT_FAILURE);
+  }
 
-    // add a general header
-    if (trace_index == 0) {
-      sprintf((char*) ((litl_general_header_t *) __arch->buffer)->litl_ver,
-              "%s",
-              (char*) ((litl_general_header_t *) header_buffer)->litl_ver);
-      sprintf((char*) ((litl_general_header_t *) __arch->buffer)->sysinfo, "%s",
-              (char*) ((litl_general_header_t *) header_buffer)->sysinfo);
+  return trace_in;
+}
 
-      global_header_size += general_header_size;
-      __arch->buffer += general_header_size;
-    }
+/*
+ * Reads the headers of a trace and finds the size of its data. The first
+ *   traces are kept open until their data is copied
+ */
+static void __litl_merge_read_header(litl_med_size_t trace_index,
+                                     litl_buffer_t* buffer
+                                       __attribute__ ((__unused__))) {
+  litl_merge_trace_t* trace = &__arch->traces[trace_index];
+  litl_general_header_t general_header;
+  litl_process_header_t* process_header;
+  litl_med_size_t nb_processes;
+  struct stat st;
+  int trace_in;
+
+  trace_in = __litl_merge_open_trace(trace_index);
+
+  if (pread(trace_in, &general_header, sizeof(litl_general_header_t), 0)
+      != sizeof(litl_general_header_t)) {
+    fprintf(stderr, "[litl_merge] Cannot read the header of %s\n",
+            __arch->traces_names[trace_index]);
+    exit(EXIT_FAILURE);
+  }
+  nb_processes = general_header.nb_processes;
+
+  trace->header_size = sizeof(litl_general_header_t)
+    + nb_processes * sizeof(litl_process_header_t);
+  trace->header = malloc(trace->header_size);
+  if (!trace->header) {
+    perror("Could not allocate memory for the headers of the traces!");
+    exit(EXIT_FAILURE);
+  }
+  if (pread(trace_in, trace->header, trace->header_size, 0)
+      != (ssize_t) trace->header_size || fstat(trace_in, &st)) {
+    fprintf(stderr, "[litl_merge] Cannot read the header of %s\n",
+            __arch->traces_names[trace_index]);
+    exit(EXIT_FAILURE);
+  }
+  trace->body_size =
+    st.st_size > (off_t) trace->header_size ?
+      st.st_size - trace->header_size : 0;
+
+  // find the trace size
+  if (nb_processes == 1) {
+    process_header = (litl_process_header_t *) (trace->header
+      + sizeof(litl_general_header_t));
+    process_header->trace_size = trace->body_size;
+  }
 
-    // read headers of processes
-    res = read(trace_in, __arch->buffer, nb_processes * process_header_size);
+  if (trace_index < __arch->nb_open_traces) {
+    trace->f_handle = trace_in;
+  } else {
+    trace->f_handle = -1;
+    close(trace_in);
+  }
+}
 
-    // find the trace size
-    if (nb_processes == 1) {
-      struct stat st;
-      if (fstat(trace_in, &st)) {
-        perror("Cannot apply fstat to the input trace files!");
-        exit(EXIT_FAILURE);
-      }
+/*
+ * Writes a whole buffer at an offset of the archive
+ */
+static void __litl_merge_pwrite(const void* buffer, size_t size, off_t offset) {
+  ssize_t res;
 
-      ((litl_process_header_t *) __arch->buffer)->trace_size =
-        (litl_trace_size_t) st.st_size - general_header_size
-          - process_header_size;
+  while (size > 0) {
+    res = pwrite(__arch->f_handle, buffer, size, offset);
+    if (res == -1) {
+      perror("Cannot write the archive!");
+      exit(EXIT_FAILURE);
     }
+    buffer = (const uint8_t*) buffer + res;
+    size -= res;
+    offset += res;
+  }
+}
 
-    for (process_index = 0; process_index < nb_processes; process_index++) {
-      __triples[trace_index][process_index].nb_processes = nb_processes;
-      __triples[trace_index][process_index].position = global_header_size
-        + (process_index + 1) * process_header_size - sizeof(litl_offset_t);
-      __triples[trace_index][process_index].offset =
-        ((litl_process_header_t *) __arch->buffer)->offset - general_header_size
-          - nb_processes * process_header_size;
-      __arch->buffer += process_header_size;
+/*
+ * Copies a part of a trace to an offset of the archive: within the kernel
+ *   with copy_file_range when possible, through the buffer otherwise
+ */
+static void __litl_merge_copy_range(int trace_in, off_t in_offset,
+                                    off_t out_offset, litl_trace_size_t size,
+                                    litl_buffer_t* buffer) {
+  ssize_t res;
+
+  while (size > 0
+      && __atomic_load_n(&__arch->allow_copy_range, __ATOMIC_RELAXED)) {
+    res = copy_file_range(trace_in, &in_offset, __arch->f_handle, &out_offset,
+                          size, 0);
+    if (res > 0) {
+      size -= res;
+    } else if (res == 0) {
+      fprintf(stderr, "[litl_merge] A trace was truncated while merging\n");
+      exit(EXIT_FAILURE);
+    } else if (errno == ENOSYS || errno == EXDEV || errno == EINVAL
+        || errno == EOPNOTSUPP || errno == EBADF) {
+      // e.g. kernels older than 4.5, or file systems that cannot copy
+      //   between the two files
+      __atomic_store_n(&__arch->allow_copy_range, 0, __ATOMIC_RELAXED);
+    } else if (errno != EINTR) {
+      perror("Cannot copy the data from the traces!");
+      exit(EXIT_FAILURE);
     }
+  }
 
-    total_nb_processes += nb_processes;
-    global_header_size += nb_processes * process_header_size;
+  if (size > 0 && !*buffer) {
+    *buffer = malloc(LITL_MERGE_BUFFER_SIZE);
+    if (!*buffer) {
+      perror("Could not allocate memory for copying the traces!");
+      exit(EXIT_FAILURE);
+    }
+  }
 
-    free(header_buffer);
-    close(trace_in);
+  while (size > 0) {
+    res = pread(trace_in, *buffer,
+                size > LITL_MERGE_BUFFER_SIZE ? LITL_MERGE_BUFFER_SIZE : size,
+                in_offset);
+    if (res <= 0) {
+      perror("Cannot read the data from the traces!");
+      exit(EXIT_FAILURE);
+    }
+    __litl_merge_pwrite(*buffer, res, out_offset);
+    in_offset += res;
+    out_offset += res;
+    size -= res;
   }
+}
+
+/*
+ * Returns the size of the whole blocks of the data of a trace, which start
+ *   after its first bytes (head_size) and can be cloned, or 0
+ */
+static litl_trace_size_t __litl_merge_clone_size(litl_merge_trace_t* trace,
+                                                 litl_trace_size_t* head_size) {
+  *head_size = (__arch->block_size - trace->header_size % __arch->block_size)
+    % __arch->block_size;
+  if (trace->body_size < *head_size + __arch->block_size)
+    return 0;
+  return (trace->body_size - *head_size) / __arch->block_size
+    * __arch->block_size;
+}
 
-  // update the number of processes
+/*
+ * Clones the whole blocks of the data of a trace into the archive, so that
+ *   they share their blocks. The data must have the same offset within a
+ *   block in the trace and in the archive. Returns 0 on success
+ */
+static int __litl_merge_clone_range(
+    litl_merge_trace_t* trace __attribute__ ((__unused__)),
+    int trace_in __attribute__ ((__unused__))) {
+#ifdef FICLONERANGE
+  struct file_clone_range range;
+  litl_trace_size_t head_size;
+
+  range.src_fd = trace_in;
+  range.src_length = __litl_merge_clone_size(trace, &head_size);
+  range.src_offset = trace->header_size + head_size;
+  range.dest_offset = trace->body_offset + head_size;
+  if (range.src_length
+      && ioctl(__arch->f_handle, FICLONERANGE, &range) == 0)
+    return 0;
+#endif
+  return -1;
+}
+
+/*
+ * Lays out the data of the traces in the archive, and fills the archive
+ *   header with their offsets. Blocks are cloned when the data has the same
+ *   offset within a block in the trace and in the archive: the data is then
+ *   moved forward by less than a block. Whether the file system supports it
+ *   is found with the first trace large enough
+ */
+static void __litl_merge_layout() {
+  litl_merge_trace_t* trace;
+  litl_process_header_t* process_header;
+  litl_med_size_t trace_index, process_index, nb_processes,
+      total_nb_processes = 0;
+  litl_trace_size_t head_size, clone_size, padding;
+  litl_buffer_t position;
+  int is_clone_checked = 0, trace_in;
+
+  for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++)
+    total_nb_processes +=
+      ((litl_general_header_t *) __arch->traces[trace_index].header)
+        ->nb_processes;
+
+  // add a general header, and also a set of process headers
+  __arch->buffer_size = sizeof(litl_general_header_t)
+    + total_nb_processes * sizeof(litl_process_header_t);
+  __arch->buffer_ptr = (litl_buffer_t) calloc(__arch->buffer_size, 1);
+  if (!__arch->buffer_ptr) {
+    perror("Could not allocate memory for the archive header!");
+    exit(EXIT_FAILURE);
+  }
+  if (__arch->nb_traces > 0)
+    memcpy(__arch->buffer_ptr, __arch->traces[0].header,
+           sizeof(litl_general_header_t));
   ((litl_general_header_t *) __arch->buffer_ptr)->nb_processes =
     total_nb_processes;
 
-  res = write(__arch->f_handle, __arch->buffer_ptr, global_header_size);
-  __arch->general_offset += global_header_size;
-  __arch->buffer = __arch->buffer_ptr;
+  position = __arch->buffer_ptr + sizeof(litl_general_header_t);
+  __arch->general_offset = __arch->buffer_size;
+
+  for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++) {
+    trace = &__arch->traces[trace_index];
+    trace->body_offset = __arch->general_offset;
+
+    clone_size = __litl_merge_clone_size(trace, &head_size);
+    padding = (trace->header_size % __arch->block_size + __arch->block_size
+      - __arch->general_offset % __arch->block_size) % __arch->block_size;
+    if (__arch->allow_clone && clone_size) {
+      trace->body_offset += padding;
+
+      if (!is_clone_checked) {
+        trace_in = trace->f_handle >= 0 ?
+          trace->f_handle : __litl_merge_open_trace(trace_index);
+        if (ftruncate(__arch->f_handle,
+                      trace->body_offset + head_size + clone_size) == 0
+            && __litl_merge_clone_range(trace, trace_in) == 0) {
+          trace->is_cloned = 1;
+        } else {
+          __arch->allow_clone = 0;
+          trace->body_offset = __arch->general_offset;
+        }
+        if (trace->f_handle < 0)
+          close(trace_in);
+        is_clone_checked = 1;
+      }
+    }
+
+    // update offsets of processes
+    nb_processes = ((litl_general_header_t *) trace->header)->nb_processes;
+    memcpy(position, trace->header + sizeof(litl_general_header_t),
+           nb_processes * sizeof(litl_process_header_t));
+    for (process_index = 0; process_index < nb_processes; process_index++) {
+      process_header = (litl_process_header_t *) position;
+      process_header->offset = process_header->offset - trace->header_size
+        + trace->body_offset;
+      position += sizeof(litl_process_header_t);
+    }
+
+    __arch->general_offset = trace->body_offset + trace->body_size;
+  }
 }
 
 /*
- * Creates and opens an archive for traces.
- * Allocates memory for the buffer
+ * Copies the data of a trace at its offset in the archive
  */
-static void __litl_merge_init_archive(const char* arch_name,
-                                      char** traces_names, const int nb_traces) {
+static void __litl_merge_copy_body(litl_med_size_t trace_index,
+                                   litl_buffer_t* buffer) {
+  litl_merge_trace_t* trace = &__arch->traces[trace_index];
+  litl_trace_size_t head_size, clone_size;
+  int trace_in;
+
+  trace_in = trace->f_handle >= 0 ?
+    trace->f_handle : __litl_merge_open_trace(trace_index);
+
+  clone_size = __litl_merge_clone_size(trace, &head_size);
+  if (clone_size
+      && trace->body_offset % __arch->block_size
+        == trace->header_size % __arch->block_size
+      && (trace->is_cloned
+          || (__atomic_load_n(&__arch->allow_clone, __ATOMIC_RELAXED)
+              && __litl_merge_clone_range(trace, trace_in) == 0))) {
+    // only the first and last bytes are copied
+    __litl_merge_copy_range(trace_in, trace->header_size, trace->body_offset,
+                            head_size, buffer);
+    __litl_merge_copy_range(
+        trace_in, trace->header_size + head_size + clone_size,
+        trace->body_offset + head_size + clone_size,
+        trace->body_size - head_size - clone_size, buffer);
+  } else {
+    __litl_merge_copy_range(trace_in, trace->header_size, trace->body_offset,
+                            trace->body_size, buffer);
+  }
 
-  __arch = (litl_trace_merge_t *) malloc(sizeof(litl_trace_merge_t));
+  close(trace_in);
+  trace->f_handle = -1;
+  free(trace->header);
+  trace->header = NULL;
+}
 
-  // allocate buffer for read/write ops
-  __arch->buffer_size = 16 * 1024 * 1024; // 16 MB
-  __arch->buffer_ptr = (litl_buffer_t) calloc(__arch->buffer_size, 1);
-  __arch->buffer = __arch->buffer_ptr;
+/*
+ * Creates and opens an archive for traces
+ */
+static void __litl_merge_init_archive(const char* arch_name,
+                                      char** traces_names, const int nb_traces,
+                                      unsigned nb_workers) {
+  struct rlimit limit;
+  struct stat st;
+  char* str;
 
+  __arch = (litl_trace_merge_t *) calloc(1, sizeof(litl_trace_merge_t));
   __arch->nb_traces = nb_traces;
   __arch->traces_names = traces_names;
-  __arch->general_offset = 0;
+  __arch->traces = (litl_merge_trace_t *) calloc(
+      nb_traces ? nb_traces : 1, sizeof(litl_merge_trace_t));
+  if (!__arch->traces) {
+    perror("Could not allocate memory for the traces!");
+    exit(EXIT_FAILURE);
+  }
+
+  if (nb_workers == 0) {
+    long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nb_workers = nb_cpus > 0 ? nb_cpus : 1;
+  }
+  __arch->nb_workers = nb_workers;
+
+  // the traces are kept open between reading their header and copying their
+  //   data, as long as the current limit of file descriptors allows it. The
+  //   other ones are opened twice
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    if (limit.rlim_cur > 2 * nb_workers + 64)
+      __arch->nb_open_traces =
+        limit.rlim_cur - 2 * nb_workers - 64 < (rlim_t) nb_traces ?
+          limit.rlim_cur - 2 * nb_workers - 64 : (rlim_t) nb_traces;
+  }
 
   __litl_merge_set_archive_name(arch_name);
 
   // create an archive for trace files in rw-r-r- mode (0644)
-  if ((__arch->f_handle = open(__arch->filename, O_WRONLY | O_CREAT, 0644))
-    < 0) {
+  if ((__arch->f_handle = open(__arch->filename, O_WRONLY | O_CREAT | O_TRUNC,
+                               0644)) < 0) {
     fprintf(stderr, "[litl_merge] Cannot open %s archive\n", __arch->filename);
     exit(EXIT_FAILURE);
   }
 
-  // add a general archive header and also a set of process headers
-  __litl_merge_add_archive_header();
+  // the trace bodies are cloned or copied by the kernel when the file system
+  //   supports it. Both are given up after their first failure, and can be
+  //   disabled by setting LITL_MERGE_ZERO_COPY to 0
+  str = getenv("LITL_MERGE_ZERO_COPY");
+  __arch->block_size =
+    fstat(__arch->f_handle, &st) == 0 && st.st_blksize > 0 ?
+      st.st_blksize : 4096;
+  __arch->allow_copy_range = !(str && strcmp(str, "0") == 0);
+#ifdef FICLONERANGE
+  __arch->allow_clone = __arch->allow_copy_range;
+#else
+  __arch->allow_clone = 0;
+#endif
 }
 
 /*
- * Merges trace files. This is a modified version of the cat implementation
- *   from the Kernighan & Ritchie book
+ * Merges trace files: the headers are read first, so that the offsets of all
+ *   the traces in the archive are known before their data is copied
  */
 static void __litl_merge_create_archive() {
-  int trace_in, res;
-  litl_offset_t offset;
-  litl_med_size_t trace_index, process_index, nb_processes;
-  litl_trace_size_t header_offset, general_header_size, process_header_size;
-
-  general_header_size = sizeof(litl_general_header_t);
-  process_header_size = sizeof(litl_process_header_t);
-
-  for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++) {
-    if ((trace_in = open(__arch->traces_names[trace_index], O_RDONLY)) < 0) {
-      fprintf(stderr, "[litl_merge] Cannot open %s\n",
-              __arch->traces_names[trace_index]);
-      exit(EXIT_FAILURE);
-    }
-
-    // update offsets of processes
-    nb_processes = __triples[trace_index][0].nb_processes;
-    for (process_index = 0; process_index < nb_processes; process_index++) {
-      lseek(__arch->f_handle, __triples[trace_index][process_index].position,
-            SEEK_SET);
-      offset = __triples[trace_index][process_index].offset
-        + __arch->general_offset;
-      res = write(__arch->f_handle, &offset, sizeof(litl_offset_t));
-      lseek(__arch->f_handle, __arch->general_offset, SEEK_SET);
-    }
-
-    // merge traces
-    header_offset = general_header_size + nb_processes * process_header_size;
-    lseek(trace_in, header_offset, SEEK_SET);
-
-    // solution: Reading and writing blocks of data. Use the file size
-    //           to deal with the reading of the last block from the
-    //           traces
-    while (1) {
-      res = read(trace_in, __arch->buffer, __arch->buffer_size);
+  __litl_merge_run(__litl_merge_read_header);
 
-      if (res < 0) {
-        perror("Cannot read the data from the traces!");
-        exit(EXIT_FAILURE);
-      }
-
-      res = write(__arch->f_handle, __arch->buffer, res);
-      __arch->general_offset += res;
+  __litl_merge_layout();
 
-      if ((litl_size_t) res < __arch->buffer_size)
-        break;
-    }
-
-    close(trace_in);
+  // the archive has its final size, so that the workers write anywhere
+  if (ftruncate(__arch->f_handle, __arch->general_offset) != 0) {
+    perror("Cannot resize the archive!");
+    exit(EXIT_FAILURE);
   }
+  __litl_merge_pwrite(__arch->buffer_ptr, __arch->buffer_size, 0);
+
+  __litl_merge_run(__litl_merge_copy_body);
 }
 
 /*
@@ -219,29 +476,239 @@ static void __litl_merge_create_archive() {
 static void __litl_merge_finalize_archive() {
   close(__arch->f_handle);
 
-  // free offsets
-  litl_med_size_t trace_index;
-  for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++)
-    free(__triples[trace_index]);
-  free(__triples);
-
   // free filenames
   free(__arch->filename);
+  litl_med_size_t trace_index;
   for (trace_index = 0; trace_index < __arch->nb_traces; trace_index++)
     free(__arch->traces_names[trace_index]);
   free(__arch->traces_names);
 
+  free(__arch->traces);
   free(__arch->buffer_ptr);
 
   __arch->buffer_ptr = NULL;
+  free(__arch);
   __arch = NULL;
 }
 
 void litl_merge_traces(const char* arch_name, char** traces_names,
                        const int nb_traces) {
-  __litl_merge_init_archive(arch_name, traces_names, nb_traces);
+  litl_merge_traces_parallel(arch_name, traces_names, nb_traces, 1);
+}
+
+void litl_merge_traces_parallel(const char* arch_name, char** traces_names,
+                                const int nb_traces, unsigned nb_workers) {
+  __litl_merge_init_archive(arch_name, traces_names, nb_traces, nb_workers);
 
   __litl_merge_create_archive();
 
   __litl_merge_finalize_archive();
 }
+
+/*
+ * Records an event in the sorted trace with the time of the source event
+ */
+static litl_t* __litl_merge_sort_get_event(litl_write_trace_t* sorted,
+                                           litl_type_t type, litl_code_t code,
+                                           int param_size, litl_time_t time) {
+  litl_t* event = __litl_write_get_event(sorted, type, code, param_size);
+
+  if (!event) {
+    fprintf(stderr, "Cannot record an event of size %d in the sorted trace\n",
+            param_size);
+    exit(EXIT_FAILURE);
+  }
+  // the chunk index is computed from the times of the events when the buffer
+  //   is flushed, so it is also the time index of the sorted trace
+  event->time = time;
+  return event;
+}
+
+/*
+ * Appends data to a buffer, which grows as needed
+ */
+static void __litl_merge_sort_append(litl_buffer_t* buffer,
+                                     litl_trace_size_t* size, const void* data,
+                                     litl_trace_size_t data_size) {
+  *buffer = (litl_buffer_t) realloc(*buffer, *size + data_size);
+  if (!*buffer) {
+    perror("Could not allocate memory for the source processes!");
+    exit(EXIT_FAILURE);
+  }
+  if (data_size)
+    memcpy(*buffer + *size, data, data_size);
+  *size += data_size;
+}
+
+/*
+ * Appends a section to a buffer
+ */
+static void __litl_merge_sort_append_section(litl_buffer_t* buffer,
+                                             litl_trace_size_t* size,
+                                             litl_section_type_t type,
+                                             const void* data,
+                                             litl_trace_size_t data_size) {
+  litl_section_header_t header;
+
+  header.type = type;
+  header.size = data_size;
+  __litl_merge_sort_append(buffer, size, &header, sizeof(header));
+  __litl_merge_sort_append(buffer, size, data, data_size);
+}
+
+/*
+ * Adds a process that recorded events of the trace to the sources of the
+ *   sorted trace, along with its event schemas, interned strings, modules and
+ *   statistics, so that the sorted trace is read on its own
+ */
+static void __litl_merge_sort_add_source(litl_write_trace_t* sorted,
+                                         litl_read_trace_t* trace,
+                                         litl_read_process_t* process) {
+  litl_process_header_t header;
+  litl_buffer_t source = NULL, strings = NULL;
+  litl_trace_size_t size = 0, strings_size = 0;
+  const litl_thread_stats_t* thread_stats;
+  const litl_code_stats_t* code_stats;
+  litl_size_t nb_thread_stats, nb_code_stats;
+  litl_med_size_t thread_index;
+  litl_string_id_t id;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.process_name, process->header->process_name,
+         sizeof(header.process_name));
+  header.nb_threads = process->nb_threads;
+  header.buffer_size = litl_read_get_recorded_buffer_size(process);
+  __litl_merge_sort_append(&source, &size, &header, sizeof(header));
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++)
+    __litl_merge_sort_append(&source, &size,
+                             &process->threads[thread_index]->thread_pair->tid,
+                             sizeof(litl_tid_t));
+
+  if (process->nb_schemas)
+    __litl_merge_sort_append_section(
+        &source, &size, LITL_SECTION_SCHEMAS, process->schemas,
+        process->nb_schemas * sizeof(litl_event_schema_t));
+
+  // the strings that were defined by events are also in the dictionary, as
+  //   all the events were read
+  for (id = 0; id < process->nb_strings; id++)
+    if (process->strings[id]) {
+      __litl_merge_sort_append(&strings, &strings_size, &id,
+                               sizeof(litl_string_id_t));
+      __litl_merge_sort_append(&strings, &strings_size, process->strings[id],
+                               strlen(process->strings[id]) + 1);
+    }
+  if (strings_size)
+    __litl_merge_sort_append_section(&source, &size, LITL_SECTION_STRINGS,
+                                     strings, strings_size);
+
+  if (process->nb_modules)
+    __litl_merge_sort_append_section(
+        &source, &size, LITL_SECTION_MODULES, process->modules,
+        process->nb_modules * sizeof(litl_module_t));
+
+  thread_stats = litl_read_get_thread_stats(trace, process, &nb_thread_stats);
+  code_stats = litl_read_get_code_stats(trace, process, &nb_code_stats);
+  __litl_merge_sort_append_section(
+      &source, &size, LITL_SECTION_THREAD_STATS, thread_stats,
+      nb_thread_stats * sizeof(litl_thread_stats_t));
+  __litl_merge_sort_append_section(&source, &size, LITL_SECTION_CODE_STATS,
+                                   code_stats,
+                                   nb_code_stats * sizeof(litl_code_stats_t));
+
+  __litl_write_append_section(sorted, LITL_SECTION_SOURCE, source, size);
+  free(source);
+  free(strings);
+}
+
+uint64_t litl_merge_sort_trace(const char* sorted_name,
+                               const char* trace_name) {
+  litl_read_trace_t* trace;
+  litl_read_event_t* event;
+  litl_read_process_t* process, *run_process = NULL;
+  litl_write_trace_t* sorted;
+  litl_t* sorted_event;
+  litl_med_size_t process_index;
+  litl_tid_t run_tid = 0;
+  litl_size_t buffer_size = 0, size;
+  uint64_t nb_events = 0;
+  int param_size;
+
+  trace = litl_read_open_trace(trace_name);
+  litl_read_init_processes(trace);
+
+  // any event of the trace fits in the buffer of the sorted trace along with
+  //   a run event, and its chunks, i.e. the granularity of its time index,
+  //   are as large as those of the trace. Sorting a sorted trace keeps its
+  //   buffer size
+  for (process_index = 0; process_index < trace->nb_processes;
+      process_index++) {
+    process = trace->processes[process_index];
+    size = litl_read_get_recorded_buffer_size(process);
+    if (!process->nb_sources)
+      size += __litl_get_reg_event_size(2);
+    if (size > buffer_size)
+      buffer_size = size;
+  }
+
+  sorted = litl_write_init_trace(buffer_size);
+  // LITL_BUFFER_SIZE does not apply, as the events of the trace might not fit
+  //   in a smaller buffer. The buffers are allocated with the first event
+  sorted->buffer_size = buffer_size;
+  litl_write_set_filename(sorted, (char*) sorted_name);
+  litl_write_buffer_flush_on(sorted);
+  // the modules of this process are not those that recorded the events
+  litl_write_modules_recording_off(sorted);
+
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+      continue;
+
+    // each chunk starts with a run event, so that the sorted trace can be
+    //   read from any chunk, e.g. after seeking
+    process = LITL_READ_GET_CUR_PROCESS(trace);
+    if (__litl_write_reserve(sorted, __litl_get_reg_event_size(2)
+                             + __litl_get_gen_event_size(event->event))
+        || process != run_process || LITL_READ_GET_TID(event) != run_tid) {
+      run_process = process;
+      run_tid = LITL_READ_GET_TID(event);
+      sorted_event = __litl_merge_sort_get_event(sorted, LITL_TYPE_REGULAR,
+                                                 LITL_RUN_CODE, 2,
+                                                 LITL_READ_GET_TIME(event));
+      sorted_event->parameters.regular.param[0] = run_process->index;
+      sorted_event->parameters.regular.param[1] = run_tid;
+    }
+
+    switch (LITL_READ_GET_TYPE(event)) {
+    case LITL_TYPE_REGULAR:
+      param_size = event->event->parameters.regular.nb_params;
+      break;
+    case LITL_TYPE_RAW:
+      param_size = event->event->parameters.raw.size;
+      break;
+    default:
+      param_size = event->event->parameters.packed.size;
+      break;
+    }
+    sorted_event = __litl_merge_sort_get_event(sorted,
+                                               LITL_READ_GET_TYPE(event),
+                                               LITL_READ_GET_CODE(event),
+                                               param_size,
+                                               LITL_READ_GET_TIME(event));
+    memcpy(&sorted_event->parameters, &event->event->parameters,
+           __litl_get_gen_event_size(event->event)
+             - offsetof(litl_t, parameters));
+    nb_events++;
+  }
+
+  // the runs refer to the processes that recorded the events by their index
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++)
+    __litl_merge_sort_add_source(sorted, trace,
+                                 trace->event_processes[process_index]);
+
+  litl_write_finalize_trace(sorted);
+  litl_read_finalize_trace(trace);
+
+  return nb_events;
+}
@@ -26,8 +26,11 @@
 
 /**
  * \ingroup litl_merge
- * \brief Merges trace files into an archive. This is a modified version of the
- * implementation of the cat function from the Kernighan & Ritchie book
+ * \brief Merges trace files into an archive. Only the headers are read and
+ * rewritten by the process: the trace bodies are cloned into the archive when
+ * the file system supports reflinks (e.g. Btrfs, XFS), or copied within the
+ * kernel with copy_file_range. Otherwise, or when the LITL_MERGE_ZERO_COPY
+ * environment variable is set to 0, they are copied through a buffer
  * \param arch_name A name of an archive
  * \param traces_names An array of traces names
  * \param nb_traces A number of trace files to be composed into an archive
@@ -35,4 +38,39 @@
 void litl_merge_traces(const char* arch_name, char** traces_names,
                        const int nb_traces);
 
+/**
+ * \ingroup litl_merge
+ * \brief Merges trace files into an archive with a pool of workers. The
+ * headers of the traces are read in parallel, then the offsets of all the
+ * traces in the archive are computed, and their data is copied in parallel
+ * at these offsets. The number of traces is not bounded by the limit of file
+ * descriptors: the traces above the current soft limit, which is not changed,
+ * are closed between reading their header and copying their data
+ * \param arch_name A name of an archive
+ * \param traces_names An array of traces names
+ * \param nb_traces A number of trace files to be composed into an archive
+ * \param nb_workers A number of workers. If it is 0, one worker per CPU is
+ *  used
+ */
+void litl_merge_traces_parallel(const char* arch_name, char** traces_names,
+                                const int nb_traces, unsigned nb_workers);
+
+/**
+ * \ingroup litl_merge
+ * \brief Rewrites a trace or an archive into a trace with a single thread
+ * whose events are sorted by time across all the processes and threads, so
+ * that the k-way merge is performed once instead of each time the archive is
+ * read. The processes that recorded the events are stored in the sorted
+ * trace, with their event schemas, interned strings, modules and statistics.
+ * Each run of consecutive events of the same thread, and each chunk, starts
+ * with an event of code LITL_RUN_CODE, so that the reader reports the events
+ * in these processes and threads, as when reading the source trace. The chunk
+ * index of the sorted trace is its time index, e.g. for litl_read_seek_time
+ * \param sorted_name A name of the sorted trace
+ * \param trace_name A name of the trace or of the archive to be sorted
+ * \return The number of events copied, excluding the run events
+ */
+uint64_t litl_merge_sort_trace(const char* sorted_name,
+                               const char* trace_name);
+
 #endif /* LITL_MERGE_H_ */
@@ -0,0 +1,214 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+
+#include "litl_pair.h"
+#include "litl_read.h"
+
+/*
+ * Starts pairing the events of a trace: a stack of entries per thread
+ */
+litl_pair_t* litl_pair_init(litl_read_trace_t* trace,
+                            litl_pair_callback_t callback, void* arg) {
+  litl_pair_t* pair;
+  litl_read_process_t* process;
+  litl_read_thread_t* read_thread;
+  litl_pair_thread_t* thread;
+  litl_med_size_t process_index, thread_index;
+  char* str;
+  int max_depth;
+
+  pair = calloc(1, sizeof(litl_pair_t));
+  if (!pair) {
+    perror("Could not allocate memory for pairing the events!");
+    exit(EXIT_FAILURE);
+  }
+  pair->trace = trace;
+  pair->exit_offset = LITL_PAIR_EXIT_OFFSET;
+  pair->unpaired_limit = LITL_PAIR_UNPAIRED_LIMIT;
+  pair->callback = callback;
+  pair->arg = arg;
+
+  pair->max_depth = LITL_PAIR_MAX_DEPTH;
+  str = getenv("LITL_PAIR_MAX_DEPTH");
+  if (str) {
+    max_depth = atoi(str);
+    pair->max_depth = max_depth < 1 ? 1 : max_depth > UINT16_MAX ?
+      UINT16_MAX : max_depth;
+  }
+
+  pair->nb_threads = trace->nb_threads;
+  pair->threads = malloc(
+      (pair->nb_threads ? pair->nb_threads : 1) * sizeof(litl_pair_thread_t));
+  if (!pair->threads) {
+    perror("Could not allocate memory for pairing the events!");
+    exit(EXIT_FAILURE);
+  }
+
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++) {
+    process = trace->event_processes[process_index];
+    for (thread_index = 0; thread_index < process->nb_threads;
+        thread_index++) {
+      read_thread = process->threads[thread_index];
+      thread = &pair->threads[read_thread->trace_index];
+      thread->process_index = process_index;
+      thread->tid = read_thread->thread_pair->tid;
+      thread->thread_index = thread_index;
+      thread->last_time = 0;
+      // the stacks are allocated with the first entry of the thread
+      thread->entries = NULL;
+      thread->depth = 0;
+    }
+  }
+
+  return pair;
+}
+
+/*
+ * Changes the coding scheme of the entry and exit events
+ */
+void litl_pair_set_codes(litl_pair_t* pair, litl_code_t exit_offset,
+                         litl_code_t unpaired_limit) {
+  pair->exit_offset = exit_offset;
+  pair->unpaired_limit = unpaired_limit;
+}
+
+/*
+ * Closes the entry at a given depth of the stack of a thread
+ */
+static void __litl_pair_close(litl_pair_t* pair, litl_pair_thread_t* thread,
+                              uint16_t depth, litl_time_t end,
+                              uint8_t is_complete) {
+  litl_interval_t interval;
+
+  interval.start = thread->entries[depth].time;
+  interval.duration = end - interval.start;
+  interval.tid = thread->tid;
+  interval.code = thread->entries[depth].code;
+  interval.process_index = thread->process_index;
+  interval.thread_index = thread->thread_index;
+  interval.depth = depth;
+  interval.is_complete = is_complete;
+
+  pair->nb_intervals++;
+  if (!is_complete)
+    pair->nb_incomplete++;
+  pair->callback(&interval, pair->arg);
+}
+
+/*
+ * Pairs an event: an exit closes the innermost entry it matches, the other
+ *   events are pushed on the stack of their thread
+ */
+int litl_pair_event(litl_pair_t* pair, litl_read_process_t* process,
+                    litl_read_event_t* event) {
+  litl_code_t code = LITL_READ_GET_CODE(event);
+  litl_time_t time = LITL_READ_GET_TIME(event);
+  litl_read_thread_t* read_thread;
+  litl_pair_thread_t* thread;
+  int depth;
+
+  if (code >= pair->unpaired_limit || LITL_READ_GET_TYPE(event)
+      == LITL_TYPE_OFFSET)
+    return 0;
+
+  read_thread = litl_read_find_thread(process, LITL_READ_GET_TID(event));
+  if (!read_thread)
+    return 0;
+  thread = &pair->threads[read_thread->trace_index];
+  thread->last_time = time;
+
+  // most exits match the innermost entry, so the stack is searched from the
+  //   top
+  if (code >= pair->exit_offset) {
+    for (depth = thread->depth - 1; depth >= 0; depth--)
+      if (thread->entries[depth].code + pair->exit_offset == code)
+        break;
+
+    if (depth >= 0) {
+      while (thread->depth - 1 > depth)
+        __litl_pair_close(pair, thread, --thread->depth, time, 0);
+      __litl_pair_close(pair, thread, --thread->depth, time, 1);
+      return 1;
+    }
+  }
+
+  if (!thread->entries) {
+    thread->entries = malloc(pair->max_depth * sizeof(litl_pair_entry_t));
+    if (!thread->entries) {
+      perror("Could not allocate memory for the stack of a thread!");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // the stacks are bounded: the outermost entry is given up
+  if (thread->depth == pair->max_depth) {
+    __litl_pair_close(pair, thread, 0, time, 0);
+    memmove(&thread->entries[0], &thread->entries[1],
+            (thread->depth - 1) * sizeof(litl_pair_entry_t));
+    thread->depth--;
+  }
+
+  thread->entries[thread->depth].time = time;
+  thread->entries[thread->depth].code = code;
+  thread->depth++;
+
+  return 1;
+}
+
+/*
+ * Closes the entries left as incomplete intervals
+ */
+static void __litl_pair_close_all(litl_pair_t* pair) {
+  litl_pair_thread_t* thread;
+  litl_size_t i;
+
+  for (i = 0; i < pair->nb_threads; i++) {
+    thread = &pair->threads[i];
+    while (thread->depth > 0) {
+      thread->depth--;
+      __litl_pair_close(pair, thread, thread->depth, thread->last_time, 0);
+    }
+  }
+}
+
+/*
+ * Closes the entries left and frees the pairing object
+ */
+void litl_pair_finalize(litl_pair_t* pair) {
+  litl_size_t i;
+
+  __litl_pair_close_all(pair);
+  for (i = 0; i < pair->nb_threads; i++)
+    free(pair->threads[i].entries);
+
+  free(pair->threads);
+  free(pair);
+}
+
+/*
+ * Pairs all the events of a trace, thread after thread
+ */
+uint64_t litl_pair_trace(litl_read_trace_t* trace,
+                         litl_pair_callback_t callback, void* arg) {
+  litl_pair_t* pair;
+  litl_read_event_t* event;
+  uint64_t nb_intervals;
+
+  pair = litl_pair_init(trace, callback, arg);
+  while ((event = litl_read_next_event(trace)) != NULL )
+    litl_pair_event(pair, LITL_READ_GET_CUR_PROCESS(trace), event);
+
+  __litl_pair_close_all(pair);
+  nb_intervals = pair->nb_intervals;
+  litl_pair_finalize(pair);
+
+  return nb_intervals;
+}
@@ -0,0 +1,115 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_PAIR_H_
+#define LITL_PAIR_H_
+
+/**
+ *  \file litl_pair.h
+ *  \brief litl_pair Provides a set of functions for pairing the entry and
+ *  exit events of the threads into intervals
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_pair LiTL Pairing Functions
+ */
+
+/**
+ * \ingroup litl_pair
+ * \brief The default difference between an exit code and its entry code
+ *  (FUT_GENERIC_EXIT_OFFSET in fut.h)
+ */
+#ifndef LITL_PAIR_EXIT_OFFSET
+#define LITL_PAIR_EXIT_OFFSET 0x100
+#endif
+
+/**
+ * \ingroup litl_pair
+ * \brief The default limit from which the codes are not paired
+ *  (FUT_UNPAIRED_LIMIT_CODE in fut.h)
+ */
+#ifndef LITL_PAIR_UNPAIRED_LIMIT
+#define LITL_PAIR_UNPAIRED_LIMIT 0xf000
+#endif
+
+/**
+ * \ingroup litl_pair
+ * \brief The default maximum number of entry events that are waiting for
+ *  their exit in a thread. It can be changed with the LITL_PAIR_MAX_DEPTH
+ *  environment variable
+ */
+#ifndef LITL_PAIR_MAX_DEPTH
+#define LITL_PAIR_MAX_DEPTH 256
+#endif
+
+/**
+ * \ingroup litl_pair
+ * \brief Starts pairing the events of a trace. An event whose code is
+ *  exit_offset above the code of an entry event of its thread is the exit
+ *  of the innermost such entry; the other events are entries. When an exit
+ *  event closes an entry, the entries it encloses are closed as incomplete
+ *  intervals. When the stack of a thread is full, its outermost entry is
+ *  closed as an incomplete interval
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param callback A function called on each interval, when it is closed
+ * \param arg An argument of the callback
+ * \return A pointer to the pairing object
+ */
+litl_pair_t* litl_pair_init(litl_read_trace_t* trace,
+                            litl_pair_callback_t callback, void* arg);
+
+/**
+ * \ingroup litl_pair
+ * \brief Changes the coding scheme of the entry and exit events. The default
+ *  one is the scheme of FxT
+ * \param pair A pointer to the pairing object
+ * \param exit_offset A difference between an exit code and its entry code
+ * \param unpaired_limit The codes from this limit are not paired
+ */
+void litl_pair_set_codes(litl_pair_t* pair, litl_code_t exit_offset,
+                         litl_code_t unpaired_limit);
+
+/**
+ * \ingroup litl_pair
+ * \brief Pairs an event. The events of each thread must be given in the
+ *  order they were recorded
+ * \param pair A pointer to the pairing object
+ * \param process A pointer to the process of the event
+ * \param event A pointer to the event
+ * \return 1 if the event is an entry or an exit event. 0 if its code is not
+ *  paired
+ */
+int litl_pair_event(litl_pair_t* pair, litl_read_process_t* process,
+                    litl_read_event_t* event);
+
+/**
+ * \ingroup litl_pair
+ * \brief Closes the entries left as incomplete intervals, which end at the
+ *  last event of their thread, and frees the pairing object
+ * \param pair A pointer to the pairing object
+ */
+void litl_pair_finalize(litl_pair_t* pair);
+
+/**
+ * \ingroup litl_pair
+ * \brief Pairs all the events of a trace. The threads are read one after the
+ *  other, so that the intervals are not in chronological order
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param callback A function called on each interval
+ * \param arg An argument of the callback
+ * \return The number of intervals
+ */
+uint64_t litl_pair_trace(litl_read_trace_t* trace,
+                         litl_pair_callback_t callback, void* arg);
+
+#endif /* LITL_PAIR_H_ */
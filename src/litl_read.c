@@ -4,16 +4,21 @@
  * See COPYING in top-level directory.
  */
 
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <math.h>
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include "litl_tools.h"
 #include "litl_read.h"
 
+static void __litl_read_load_chunk_index(litl_read_trace_t* trace,
+                                         litl_read_process_t* process);
+
 /*
  * Initializes the trace header
  */
@@ -78,10 +83,10 @@ static void __litl_read_init_process_header(litl_read_trace_t* trace,
   process->header_buffer_ptr = (litl_buffer_t) malloc(header_size);
 
   // read threads pairs (tid, offset)
-  lseek(trace->f_handle, process->header->offset, SEEK_SET);
   header_size = (process->header->header_nb_threads + 1)
     * sizeof(litl_thread_pair_t);
-  int res = read(trace->f_handle, process->header_buffer_ptr, header_size);
+  int res = pread(trace->f_handle, process->header_buffer_ptr, header_size,
+                  process->header->offset);
   if (res == -1) {
     perror("Could not read the trace header!");
     exit(EXIT_FAILURE);
@@ -96,14 +101,12 @@ static void __litl_read_next_pairs_buffer(litl_read_trace_t* trace,
                                           litl_read_process_t* process,
                                           litl_offset_t offset) {
 
-  lseek(trace->f_handle, offset, SEEK_SET);
-
   litl_med_size_t nb_threads =
       (process->nb_threads - process->header->header_nb_threads) > NBTHREADS ?
         NBTHREADS : (process->nb_threads - process->header->header_nb_threads);
 
-  int res = read(trace->f_handle, process->header_buffer_ptr,
-                 (nb_threads + 1) * sizeof(litl_thread_pair_t));
+  int res = pread(trace->f_handle, process->header_buffer_ptr,
+                  (nb_threads + 1) * sizeof(litl_thread_pair_t), offset);
   process->header_buffer = process->header_buffer_ptr;
 
   if (res == -1) {
@@ -114,7 +117,247 @@ static void __litl_read_next_pairs_buffer(litl_read_trace_t* trace,
 }
 
 /*
- * Initializes buffers -- one buffer per thread.
+ * Moves a slot of the chunk cache to the head of the LRU list
+ */
+static void __litl_read_cache_touch(litl_read_trace_t* trace,
+                                    litl_read_cache_slot_t* slot) {
+  if (trace->cache_head == slot)
+    return;
+
+  // unlink the slot
+  if (slot->prev)
+    slot->prev->next = slot->next;
+  if (slot->next)
+    slot->next->prev = slot->prev;
+  if (trace->cache_tail == slot)
+    trace->cache_tail = slot->prev;
+
+  // and insert it at the head
+  slot->prev = NULL;
+  slot->next = trace->cache_head;
+  if (trace->cache_head)
+    trace->cache_head->prev = slot;
+  trace->cache_head = slot;
+  if (!trace->cache_tail)
+    trace->cache_tail = slot;
+}
+
+/*
+ * Takes the buffer of a thread back. Its current event, which may still be
+ *   returned, is copied, and its position is kept in its pair, so that the
+ *   buffer is loaded again from there
+ */
+static void __litl_read_cache_evict(litl_read_cache_slot_t* slot) {
+  litl_read_thread_t* thread = slot->thread;
+  litl_buffer_t event = (litl_buffer_t) thread->cur_event.event;
+
+  if (event && event >= slot->buffer && event < slot->buffer + slot->size) {
+    litl_size_t evt_size = __litl_get_gen_event_size(thread->cur_event.event);
+    if (thread->event_copy_size < evt_size) {
+      thread->event_copy = (litl_buffer_t) realloc(thread->event_copy,
+                                                   evt_size);
+      if (!thread->event_copy) {
+        perror("Could not allocate memory for the copy of an event!");
+        exit(EXIT_FAILURE);
+      }
+      thread->event_copy_size = evt_size;
+    }
+    memcpy(thread->event_copy, event, evt_size);
+    thread->cur_event.event = (litl_t*) thread->event_copy;
+  }
+
+  // a thread that reached its end stays there
+  if (thread->buffer) {
+    thread->thread_pair->offset += thread->offset;
+    thread->is_loaded = 0;
+  }
+  thread->buffer_ptr = NULL;
+  thread->buffer = NULL;
+  thread->slot = NULL;
+  slot->thread = NULL;
+}
+
+/*
+ * Provides a buffer to a thread from the chunk cache. Once the cache is full,
+ *   the buffer that was used least recently is taken back from its thread
+ */
+static void __litl_read_cache_acquire(litl_read_trace_t* trace,
+                                      litl_read_process_t* process,
+                                      litl_read_thread_t* thread) {
+  litl_read_cache_slot_t* slot;
+  litl_size_t size = process->header->buffer_size;
+
+  if (!trace->cache_tail || trace->cache_size + size <= trace->cache_budget) {
+    slot = (litl_read_cache_slot_t*) malloc(sizeof(litl_read_cache_slot_t));
+    if (!slot) {
+      perror("Could not allocate memory for the chunk cache!");
+      exit(EXIT_FAILURE);
+    }
+    slot->buffer = NULL;
+    slot->size = 0;
+    slot->prev = slot->next = NULL;
+  } else {
+    slot = trace->cache_tail;
+    __litl_read_cache_evict(slot);
+  }
+
+  // the processes of an archive may have different buffer sizes
+  if (slot->size < size) {
+    slot->buffer = (litl_buffer_t) realloc(slot->buffer, size);
+    if (!slot->buffer) {
+      perror("Could not allocate memory for the chunk cache!");
+      exit(EXIT_FAILURE);
+    }
+    trace->cache_size += size - slot->size;
+    slot->size = size;
+  }
+
+  slot->thread = thread;
+  thread->slot = slot;
+  thread->buffer_ptr = slot->buffer;
+  __litl_read_cache_touch(trace, slot);
+}
+
+/*
+ * Sets the maximum size of the buffers of the chunk cache
+ */
+void litl_read_set_cache_size(litl_read_trace_t* trace, size_t cache_size) {
+  trace->cache_budget = cache_size;
+}
+
+/*
+ * Asks the kernel to read the next chunks of a thread in the background, so
+ *   that they are in the page cache when the thread reaches them. The chunks
+ *   are found in the chunk index
+ */
+static void __litl_read_prefetch(litl_read_trace_t* trace,
+                                 litl_read_process_t* process,
+                                 litl_read_thread_t* thread) {
+  litl_size_t first, last, middle;
+  uint64_t offset, start, end;
+  static long page_size = 0;
+
+  // the chunks of a thread are sorted by time, hence by offset. Search the
+  //   first chunk after the current one
+  first = 0;
+  last = thread->nb_chunks;
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (thread->chunks[middle].offset <= thread->thread_pair->offset)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  if (!page_size)
+    page_size = sysconf(_SC_PAGESIZE);
+
+  for (last = first; last < thread->nb_chunks
+      && last < first + trace->prefetch_depth; last++) {
+    // each chunk is prefetched only once
+    if (thread->chunks[last].offset <= thread->prefetch_offset)
+      continue;
+    thread->prefetch_offset = thread->chunks[last].offset;
+
+    offset = process->header->offset + thread->chunks[last].offset;
+    if (trace->map) {
+      if (offset >= trace->map_size)
+        break;
+      start = offset & ~((uint64_t) page_size - 1);
+      end = offset + process->header->buffer_size;
+      if (end > trace->map_size)
+        end = trace->map_size;
+      madvise(trace->map + start, end - start, MADV_WILLNEED);
+    } else
+      posix_fadvise(trace->f_handle, offset, process->header->buffer_size,
+                    POSIX_FADV_WILLNEED);
+  }
+}
+
+/*
+ * Sets the number of chunks that are prefetched ahead of each thread
+ */
+void litl_read_set_prefetch_depth(litl_read_trace_t* trace, unsigned depth) {
+  trace->prefetch_depth = depth;
+}
+
+/*
+ * Reads a next portion of events from the trace file to the buffer. When the
+ *   trace is mapped, the events are read in place instead
+ */
+static void __litl_read_next_buffer(litl_read_trace_t* trace,
+                                    litl_read_process_t* process,
+				    litl_read_thread_t* thread) {
+  litl_offset_t offset = process->header->offset
+    + thread->thread_pair->offset;
+
+  thread->offset = 0;
+
+  if (trace->map) {
+    // the buffer spans the rest of the file, so no event is ever truncated
+    thread->buffer_ptr = trace->map + offset;
+    thread->tracker = offset < trace->map_size ? trace->map_size - offset : 0;
+  } else {
+    // the threads that are not read with a private buffer borrow one from
+    //   the chunk cache
+    if (!thread->buffer_ptr)
+      __litl_read_cache_acquire(trace, process, thread);
+
+    // read portion of next events
+    int res = pread(trace->f_handle, thread->buffer_ptr,
+                    process->header->buffer_size, offset);
+    if (res == -1) {
+      perror("Could not read the next part of the trace file!");
+      exit(EXIT_FAILURE);
+    }
+    thread->tracker = process->header->buffer_size;
+  }
+
+  thread->buffer = thread->buffer_ptr;
+  thread->is_loaded = 1;
+
+  // decoding this chunk overlaps the reading of the next ones
+  if (trace->prefetch_depth && thread->nb_chunks)
+    __litl_read_prefetch(trace, process, thread);
+}
+
+/*
+ * The room that is added to the buffers of a process for the tail of the
+ *   events and the offset
+ */
+#define __LITL_READ_BUFFER_SLACK \
+  (__litl_get_reg_event_size(LITL_MAX_PARAMS) + __litl_get_reg_event_size(0))
+
+/*
+ * Compares the IDs of two threads
+ */
+static int __litl_read_compare_tids(const void* a, const void* b) {
+  litl_tid_t tid_a = (*(litl_read_thread_t* const *) a)->thread_pair->tid;
+  litl_tid_t tid_b = (*(litl_read_thread_t* const *) b)->thread_pair->tid;
+
+  return (tid_a > tid_b) - (tid_a < tid_b);
+}
+
+/*
+ * Sorts the threads of a process by tid, for litl_read_find_thread
+ */
+static void __litl_read_sort_threads(litl_read_process_t* process) {
+  process->threads_by_tid = (litl_read_thread_t **) malloc(
+      (process->nb_threads ? process->nb_threads : 1)
+      * sizeof(litl_read_thread_t*));
+  if (!process->threads_by_tid) {
+    perror("Could not allocate memory for the threads!");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(process->threads_by_tid, process->threads,
+         process->nb_threads * sizeof(litl_read_thread_t*));
+  qsort(process->threads_by_tid, process->nb_threads,
+        sizeof(litl_read_thread_t*), __litl_read_compare_tids);
+}
+
+/*
+ * Initializes buffers -- one buffer per thread. The buffers are only loaded
+ *   when the threads are first read
  */
 static void __litl_read_init_threads(litl_read_trace_t* trace,
                                      litl_read_process_t* process) {
@@ -128,8 +371,7 @@ static void __litl_read_init_threads(litl_read_trace_t* trace,
       process->nb_threads * sizeof(litl_read_thread_t*));
 
   // increase a bit the buffer size 'cause of the event's tail and the offset
-  process->header->buffer_size += __litl_get_reg_event_size(LITL_MAX_PARAMS)
-    + __litl_get_reg_event_size(0);
+  process->header->buffer_size += __LITL_READ_BUFFER_SLACK;
 
   for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
     // allocate thread structure
@@ -137,8 +379,17 @@ static void __litl_read_init_threads(litl_read_trace_t* trace,
         sizeof(litl_read_thread_t));
     process->threads[thread_index]->thread_pair = (litl_thread_pair_t *) malloc(
         sizeof(litl_thread_pair_t));
-    process->threads[thread_index]->buffer_ptr = (litl_buffer_t) malloc(
-        process->header->buffer_size);
+    process->threads[thread_index]->index = thread_index;
+    process->threads[thread_index]->trace_index = 0;
+    process->threads[thread_index]->run_process = NULL;
+    process->threads[thread_index]->run_tid = 0;
+    process->threads[thread_index]->buffer_ptr = NULL;
+    process->threads[thread_index]->buffer = NULL;
+    process->threads[thread_index]->is_loaded = 0;
+    process->threads[thread_index]->slot = NULL;
+    process->threads[thread_index]->event_copy = NULL;
+    process->threads[thread_index]->event_copy_size = 0;
+    process->threads[thread_index]->cur_event.event = NULL;
 
     // read pairs (tid, offset)
     thread_pair = (litl_thread_pair_t *) process->header_buffer;
@@ -155,29 +406,350 @@ static void __litl_read_init_threads(litl_read_trace_t* trace,
       break;
 
     process->threads[thread_index]->thread_pair->tid = thread_pair->tid;
-    // use two offsets: process and thread. Process offset for a position
-    //  of thread pairs; thread offset for a position of events
-    process->threads[thread_index]->thread_pair->offset = thread_pair->offset
-      + process->header->offset;
-
-    // read chunks of data
-    // use offsets in order to access a chuck of data that corresponds to
-    //   each thread
-    lseek(trace->f_handle, process->threads[thread_index]->thread_pair->offset,
-          SEEK_SET);
-    int res = read(trace->f_handle, process->threads[thread_index]->buffer_ptr,
-                   process->header->buffer_size);
-    if (res == -1) {
-      perror("Could not read the first partition of data from the trace file!");
+    // the offsets of the chunks of events are relative to the process offset,
+    //   like the offsets stored in the trace
+    process->threads[thread_index]->thread_pair->offset = thread_pair->offset;
+    process->threads[thread_index]->first_offset = thread_pair->offset;
+    process->threads[thread_index]->chunks = NULL;
+    process->threads[thread_index]->nb_chunks = 0;
+    process->threads[thread_index]->prefetch_offset = 0;
+
+    process->header_buffer += size;
+  }
+
+  __litl_read_sort_threads(process);
+}
+
+/*
+ * Compares the codes of two event schemas
+ */
+static int __litl_read_compare_schemas(const void* a, const void* b) {
+  litl_code_t code_a = ((const litl_event_schema_t*) a)->code;
+  litl_code_t code_b = ((const litl_event_schema_t*) b)->code;
+
+  return (code_a > code_b) - (code_a < code_b);
+}
+
+/*
+ * Returns the header of the section of a process at a given position, which
+ *   is moved to the next section, or NULL after the last section. The content
+ *   of the section follows its header
+ */
+static litl_section_header_t* __litl_read_next_section(
+    litl_read_process_t* process, litl_trace_size_t* pos) {
+  litl_section_header_t* header;
+
+  if (*pos + sizeof(litl_section_header_t) > process->sections_size)
+    return NULL ;
+
+  header = (litl_section_header_t*) (process->sections + *pos);
+  if (*pos + sizeof(litl_section_header_t) + header->size
+      > process->sections_size)
+    return NULL ;
+
+  *pos += sizeof(litl_section_header_t) + header->size;
+  return header;
+}
+
+/*
+ * Returns a pointer to the content of a section of a given type, or NULL if
+ *   the process does not have such a section
+ */
+static void* __litl_read_find_section(litl_read_process_t* process,
+                                      litl_section_type_t type,
+                                      litl_trace_size_t* size) {
+  litl_trace_size_t pos = 0;
+  litl_section_header_t* header;
+
+  while ((header = __litl_read_next_section(process, &pos)) != NULL )
+    if (header->type == type) {
+      *size = header->size;
+      return header + 1;
+    }
+
+  return NULL ;
+}
+
+/*
+ * Returns the entries of the chunk index stored in the sections of a process,
+ *   or NULL if there is none or if their layout has another version
+ */
+static void* __litl_read_find_chunks_section(litl_read_process_t* process,
+                                             litl_size_t* nb_chunks) {
+  litl_trace_size_t size;
+  litl_size_t version;
+  litl_buffer_t chunks;
+
+  chunks = __litl_read_find_section(process, LITL_SECTION_CHUNKS, &size);
+  if (!chunks || size < sizeof(version) + sizeof(litl_chunk_t))
+    return NULL ;
+
+  memcpy(&version, chunks, sizeof(version));
+  if (version != LITL_CHUNKS_VERSION)
+    return NULL ;
+
+  *nb_chunks = (size - sizeof(version)) / sizeof(litl_chunk_t);
+  return chunks + sizeof(version);
+}
+
+/*
+ * Adds an interned string to the dictionary of a process
+ */
+static void __litl_read_add_string(litl_read_process_t* process,
+                                   litl_string_id_t id, const char* str) {
+  if (id >= process->nb_strings) {
+    litl_string_id_t nb_strings = process->nb_strings ?
+      process->nb_strings : 64;
+    while (nb_strings <= id)
+      nb_strings *= 2;
+
+    process->strings = realloc(process->strings, nb_strings * sizeof(char*));
+    if (!process->strings) {
+      perror("Could not allocate memory for the interned strings!");
       exit(EXIT_FAILURE);
     }
+    memset(process->strings + process->nb_strings, 0,
+           (nb_strings - process->nb_strings) * sizeof(char*));
+    process->nb_strings = nb_strings;
+  }
 
-    process->threads[thread_index]->buffer =
-      process->threads[thread_index]->buffer_ptr;
-    process->threads[thread_index]->tracker = process->header->buffer_size;
-    process->threads[thread_index]->offset = 0;
+  if (!process->strings[id])
+    process->strings[id] = strdup(str);
+}
 
-    process->header_buffer += size;
+/*
+ * Reads the dictionary of interned strings
+ */
+static void __litl_read_init_strings(litl_read_process_t* process,
+                                     litl_buffer_t strings,
+                                     litl_trace_size_t size) {
+  litl_trace_size_t pos = 0;
+  litl_string_id_t id;
+
+  while (pos + sizeof(litl_string_id_t) < size) {
+    memcpy(&id, strings + pos, sizeof(litl_string_id_t));
+    pos += sizeof(litl_string_id_t);
+    __litl_read_add_string(process, id, (char*) strings + pos);
+    pos += strlen((char*) strings + pos) + 1;
+  }
+}
+
+/*
+ * Loads the event schemas, the interned strings and the modules from the
+ *   sections of a process
+ */
+static void __litl_read_load_sections(litl_read_process_t* process) {
+  litl_trace_size_t size;
+
+  // sort the event schemas, so that they can be searched for quickly
+  process->schemas = __litl_read_find_section(process, LITL_SECTION_SCHEMAS,
+                                              &size);
+  if (process->schemas) {
+    process->nb_schemas = size / sizeof(litl_event_schema_t);
+    qsort(process->schemas, process->nb_schemas, sizeof(litl_event_schema_t),
+          __litl_read_compare_schemas);
+  }
+
+  void* strings = __litl_read_find_section(process, LITL_SECTION_STRINGS,
+                                           &size);
+  if (strings) {
+    // make sure the last string is terminated
+    process->sections[process->sections_size] = '\0';
+    __litl_read_init_strings(process, strings, size);
+  }
+
+  process->modules = __litl_read_find_section(process, LITL_SECTION_MODULES,
+                                              &size);
+  if (process->modules)
+    process->nb_modules = size / sizeof(litl_module_t);
+}
+
+/*
+ * Reads the sections stored after the events of a process, if any
+ */
+static void __litl_read_init_sections(litl_read_trace_t* trace,
+                                      litl_read_process_t* process) {
+  litl_trailer_t trailer;
+  litl_trace_size_t trace_size;
+
+  process->sections = NULL;
+  process->sections_size = 0;
+  process->nb_schemas = 0;
+  process->schemas = NULL;
+  process->nb_strings = 0;
+  process->strings = NULL;
+  process->nb_modules = 0;
+  process->modules = NULL;
+  process->nb_chunks = 0;
+  process->chunks = NULL;
+  process->is_chunk_index_loaded = 0;
+  process->thread_stats = NULL;
+  process->nb_thread_stats = 0;
+  process->code_stats = NULL;
+  process->nb_code_stats = 0;
+  process->nb_allocated_code_stats = 0;
+  process->is_stats_loaded = 0;
+
+  // the trailer is at the end of the process data. Traces that were recorded
+  //   by older versions of LiTL do not have any trailer
+  trace_size = process->header->trace_size;
+  if (trace_size < sizeof(litl_trailer_t))
+    return;
+  if (pread(trace->f_handle, &trailer, sizeof(litl_trailer_t),
+            process->header->offset + trace_size - sizeof(litl_trailer_t))
+      != sizeof(litl_trailer_t))
+    return;
+  if (memcmp(trailer.magic, LITL_TRAILER_MAGIC, sizeof(trailer.magic)) != 0
+      || trailer.sections_offset > trace_size - sizeof(litl_trailer_t))
+    return;
+
+  process->sections_size = trace_size - sizeof(litl_trailer_t)
+    - trailer.sections_offset;
+  process->sections = (litl_buffer_t) malloc(process->sections_size + 1);
+  if (!process->sections) {
+    perror("Could not allocate memory for the trace sections!");
+    exit(EXIT_FAILURE);
+  }
+  if (pread(trace->f_handle, process->sections, process->sections_size,
+            process->header->offset + trailer.sections_offset)
+      != (ssize_t) process->sections_size) {
+    perror("Could not read the trace sections!");
+    exit(EXIT_FAILURE);
+  }
+
+  __litl_read_load_sections(process);
+}
+
+/*
+ * Reads the processes whose events were copied into a sorted trace. They do
+ *   not hold any event: their events are read through the sorted process,
+ *   which reports them in these processes
+ */
+static void __litl_read_init_sources(litl_read_process_t* process) {
+  litl_trace_size_t pos = 0, size;
+  litl_section_header_t* section;
+  litl_read_process_t* source;
+  litl_read_thread_t* thread;
+  litl_buffer_t data;
+  litl_med_size_t thread_index;
+
+  process->nb_sources = 0;
+  process->sources = NULL;
+
+  while ((section = __litl_read_next_section(process, &pos)) != NULL ) {
+    if (section->type != LITL_SECTION_SOURCE
+        || section->size < sizeof(litl_process_header_t))
+      continue;
+
+    // the header of the source is followed by the IDs of its threads, then
+    //   by its own sections
+    data = (litl_buffer_t) (section + 1);
+    size = sizeof(litl_process_header_t)
+      + ((litl_process_header_t*) data)->nb_threads * sizeof(litl_tid_t);
+    if (size > section->size)
+      continue;
+
+    source = (litl_read_process_t*) calloc(1, sizeof(litl_read_process_t));
+    process->sources = (litl_read_process_t**) realloc(
+        process->sources,
+        (process->nb_sources + 1) * sizeof(litl_read_process_t*));
+    if (!source || !process->sources) {
+      perror("Could not allocate memory for the source processes!");
+      exit(EXIT_FAILURE);
+    }
+    process->sources[process->nb_sources++] = source;
+
+    source->header_buffer_ptr = (litl_buffer_t) malloc(
+        sizeof(litl_process_header_t));
+    source->nb_threads = ((litl_process_header_t*) data)->nb_threads;
+    source->threads = (litl_read_thread_t **) malloc(
+        (source->nb_threads ? source->nb_threads : 1)
+        * sizeof(litl_read_thread_t*));
+    source->sections_size = section->size - size;
+    source->sections = (litl_buffer_t) malloc(source->sections_size + 1);
+    if (!source->header_buffer_ptr || !source->threads || !source->sections) {
+      perror("Could not allocate memory for the source processes!");
+      exit(EXIT_FAILURE);
+    }
+
+    memcpy(source->header_buffer_ptr, data, sizeof(litl_process_header_t));
+    source->header = (litl_process_header_t*) source->header_buffer_ptr;
+    source->header_buffer = source->header_buffer_ptr;
+    source->header->buffer_size += __LITL_READ_BUFFER_SLACK;
+    source->cur_index = -1;
+    source->is_initialized = 1;
+    source->is_chunk_index_loaded = 1;
+    pthread_mutex_init(&source->lock_strings, NULL );
+
+    for (thread_index = 0; thread_index < source->nb_threads; thread_index++) {
+      thread = (litl_read_thread_t*) calloc(1, sizeof(litl_read_thread_t));
+      if (!thread
+          || !(thread->thread_pair = (litl_thread_pair_t*) calloc(
+              1, sizeof(litl_thread_pair_t)))) {
+        perror("Could not allocate memory for the source processes!");
+        exit(EXIT_FAILURE);
+      }
+      memcpy(&thread->thread_pair->tid,
+             data + sizeof(litl_process_header_t)
+               + thread_index * sizeof(litl_tid_t),
+             sizeof(litl_tid_t));
+      thread->index = thread_index;
+      thread->is_loaded = 1;
+      source->threads[thread_index] = thread;
+    }
+    __litl_read_sort_threads(source);
+
+    memcpy(source->sections, data + size, source->sections_size);
+    __litl_read_load_sections(source);
+
+    // the statistics cannot be computed from the events of the source, which
+    //   are only read through the sorted process
+    if (!__litl_read_find_section(source, LITL_SECTION_THREAD_STATS, &size)
+        || !__litl_read_find_section(source, LITL_SECTION_CODE_STATS, &size))
+      source->is_stats_loaded = 1;
+  }
+}
+
+/*
+ * Lists the processes that recorded the events of a trace: the processes of
+ *   the trace, or the sources of the sorted ones. Their threads are numbered
+ *   by process and tid across the trace
+ */
+static void __litl_read_init_event_processes(litl_read_trace_t* trace) {
+  litl_med_size_t process_index, source_index, thread_index;
+  litl_read_process_t* process;
+
+  trace->nb_event_processes = 0;
+  for (process_index = 0; process_index < trace->nb_processes;
+      process_index++)
+    trace->nb_event_processes += trace->processes[process_index]->nb_sources ?
+      trace->processes[process_index]->nb_sources : 1;
+  trace->event_processes = (litl_read_process_t **) malloc(
+      (trace->nb_event_processes ? trace->nb_event_processes : 1)
+      * sizeof(litl_read_process_t*));
+  if (!trace->event_processes) {
+    perror("Could not allocate memory for the processes!");
+    exit(EXIT_FAILURE);
+  }
+
+  trace->nb_event_processes = 0;
+  for (process_index = 0; process_index < trace->nb_processes;
+      process_index++) {
+    process = trace->processes[process_index];
+    if (!process->nb_sources)
+      trace->event_processes[trace->nb_event_processes++] = process;
+    for (source_index = 0; source_index < process->nb_sources; source_index++)
+      trace->event_processes[trace->nb_event_processes++] =
+        process->sources[source_index];
+  }
+
+  trace->nb_threads = 0;
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++) {
+    process = trace->event_processes[process_index];
+    process->index = process_index;
+    for (thread_index = 0; thread_index < process->nb_threads; thread_index++)
+      process->threads_by_tid[thread_index]->trace_index = trace->nb_threads++;
   }
 }
 
@@ -194,8 +766,52 @@ litl_read_trace_t* litl_read_open_trace(const char* filename) {
     exit(EXIT_FAILURE);
   }
 
+  // map the trace file, so that the events are read in place instead of
+  //   being copied to the thread buffers. The mapping can be disabled by
+  //   setting LITL_READ_MMAP to 0; the trace is then read with pread
+  trace->map = NULL;
+  trace->map_size = 0;
+  char* str = getenv("LITL_READ_MMAP");
+  struct stat st;
+  if (!(str && strcmp(str, "0") == 0) && fstat(trace->f_handle, &st) == 0
+      && st.st_size > 0 && (uint64_t) st.st_size <= SIZE_MAX) {
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, trace->f_handle,
+                     0);
+    if (map != MAP_FAILED) {
+      trace->map = (litl_buffer_t) map;
+      trace->map_size = st.st_size;
+    }
+  }
+
   // init the trace header
   __litl_read_init_trace_header(trace);
+  trace->cur_process = NULL;
+  trace->heap = NULL;
+  trace->heap_size = 0;
+  trace->is_heap_initialized = 0;
+  trace->start_time = 0;
+  trace->end_time = LITL_MAX_TIME;
+
+  trace->cache_head = NULL;
+  trace->cache_tail = NULL;
+  trace->cache_size = 0;
+  trace->cache_budget = LITL_READ_CACHE_SIZE;
+  str = getenv("LITL_READ_CACHE_SIZE");
+  if (str)
+    trace->cache_budget = strtoull(str, NULL, 10);
+
+  trace->filter_codes = NULL;
+  trace->nb_filter_codes = 0;
+  trace->filter_tids = NULL;
+  trace->nb_filter_tids = 0;
+
+  trace->batch_process_index = 0;
+  trace->batch_thread_index = 0;
+
+  trace->prefetch_depth = LITL_READ_PREFETCH;
+  str = getenv("LITL_READ_PREFETCH");
+  if (str)
+    trace->prefetch_depth = atoi(str);
 
   return trace;
 }
@@ -221,15 +837,34 @@ void litl_read_init_processes(litl_read_trace_t* trace) {
       (litl_process_header_t *) trace->header_buffer;
     trace->header_buffer += size;
 
+    trace->processes[process_index]->index = process_index;
     trace->processes[process_index]->cur_index = -1;
     trace->processes[process_index]->is_initialized = 0;
+    trace->processes[process_index]->heap = NULL;
+    trace->processes[process_index]->heap_size = 0;
+    pthread_mutex_init(&trace->processes[process_index]->lock_strings, NULL );
 
     // init the process header
     __litl_read_init_process_header(trace, trace->processes[process_index]);
 
     // init buffers of events: one buffer per thread
     __litl_read_init_threads(trace, trace->processes[process_index]);
+
+    // read the sections that follow the events
+    __litl_read_init_sections(trace, trace->processes[process_index]);
+
+    // the events of a sorted process are reported in its sources
+    __litl_read_init_sources(trace->processes[process_index]);
+
+    // the chunk index, when it is stored in the trace, is used for prefetching
+    //   the chunks of events
+    litl_size_t nb_chunks;
+    if (__litl_read_find_chunks_section(trace->processes[process_index],
+                                        &nb_chunks))
+      __litl_read_load_chunk_index(trace, trace->processes[process_index]);
   }
+
+  __litl_read_init_event_processes(trace);
 }
 
 /*
@@ -266,28 +901,10 @@ litl_size_t litl_read_get_buffer_size(litl_read_trace_t* trace) {
 }
 
 /*
- * Reads a next portion of events from the trace file to the buffer
+ * Returns the buffer size a process was recorded with
  */
-static void __litl_read_next_buffer(litl_read_trace_t* trace,
-                                    litl_read_process_t* process,
-				    litl_read_thread_t* thread) {
-  lseek(trace->f_handle,
-	process->header->offset
-        + thread->thread_pair->offset,
-	SEEK_SET);
-
-  thread->offset = 0;
-
-  // read portion of next events
-  int res = read(trace->f_handle, thread->buffer_ptr,
-                 process->header->buffer_size);
-  if (res == -1) {
-    perror("Could not read the next part of the trace file!");
-    exit(EXIT_FAILURE);
-  }
-
-  thread->buffer = thread->buffer_ptr;
-  thread->tracker = thread ->offset + process->header->buffer_size;
+litl_size_t litl_read_get_recorded_buffer_size(litl_read_process_t* process) {
+  return process->header->buffer_size - __LITL_READ_BUFFER_SLACK;
 }
 
 /*
@@ -302,178 +919,1505 @@ void litl_read_reset_process(litl_read_process_t* process) {
 }
 
 /*
- * Reads an event
+ * Adds the string of a definition event to the dictionary, unless it is
+ *   already there
  */
-static litl_read_event_t* __litl_read_next_thread_event(
-    litl_read_trace_t* trace, litl_read_process_t* process,
-    litl_read_thread_t* thread) {
-
-  litl_data_t to_be_loaded;
-  litl_t* event;
-  litl_buffer_t buffer;
-
-  buffer = thread->buffer;
-  to_be_loaded = 0;
+static void __litl_read_define_string(litl_read_process_t* process,
+                                      litl_t* event) {
+  litl_string_id_t id;
+
+  memcpy(&id, event->parameters.raw.data, sizeof(litl_string_id_t));
+  // the threads of a process may be read in parallel
+  pthread_mutex_lock(&process->lock_strings);
+  if (id >= process->nb_strings || !process->strings[id])
+    __litl_read_add_string(
+        process, id,
+        (char*) event->parameters.raw.data + sizeof(litl_string_id_t));
+  pthread_mutex_unlock(&process->lock_strings);
+}
 
-  if (!buffer) {
-    thread->cur_event.event = NULL;
-    return NULL ;
-  }
+/*
+ * Returns whether the events with a given code pass the filters
+ */
+static inline int __litl_read_filter_code(litl_read_trace_t* trace,
+                                          litl_code_t code) {
+  litl_size_t i;
 
-  event = (litl_t *) buffer;
-
-  // While reading events from the buffer, there can be two situations:
-  // 1. The situation when the buffer contains exact number of events;
-  // 2. The situation when only a part of the last event is loaded.
-  // Check whether the main four components (tid, time, code, nb_params) are
-  //   loaded.
-  // Check whether all arguments are loaded.
-  // If any of these cases is not true, the next part of the trace plus
-  // the current event is loaded to the buffer
-  litl_size_t remaining_size = thread->tracker - thread->offset;
-  if (remaining_size < __litl_get_reg_event_size(0)) {
-    // this event is truncated. We can't even read the nb_param field
-    to_be_loaded = 1;
-  } else {
-    // The nb_param (or size) field is available. Let's check whether
-    //   the event is truncated
-    litl_med_size_t event_size = __litl_get_gen_event_size(event);
-    if (remaining_size < event_size)
-      to_be_loaded = 1;
-  }
+  for (i = 0; i < trace->nb_filter_codes; i++)
+    if (code >= trace->filter_codes[2 * i]
+        && code <= trace->filter_codes[2 * i + 1])
+      return 1;
 
-  // fetch the next block of data from the trace
-  if (to_be_loaded) {
-    __litl_read_next_buffer(trace, process, thread);
-    buffer = thread->buffer;
-    event = (litl_t *) buffer;
-  }
-  to_be_loaded = 0;
+  return 0;
+}
 
-  // event that stores tid and offset
-  if (event->code == LITL_OFFSET_CODE) {
-    if (event->parameters.offset.offset != 0) {
-      thread->thread_pair->offset = event->parameters.offset.offset;
-      to_be_loaded = 1;
-    } else {
-      buffer = NULL;
-      thread->cur_event.event = NULL;
-      return NULL ;
-    }
-  }
+/*
+ * Returns whether the events of a thread ID pass the filters
+ */
+static inline int __litl_read_filter_tid(litl_read_trace_t* trace,
+                                         litl_tid_t tid) {
+  litl_size_t i;
 
-  // fetch the next block of data from the trace
-  if (to_be_loaded) {
-    __litl_read_next_buffer(trace, process, thread);
-    buffer = thread->buffer;
-    event = (litl_t *) buffer;
-  }
+  if (!trace->nb_filter_tids)
+    return 1;
 
-  // move pointer to the next event and update __offset
-  litl_med_size_t evt_size = __litl_get_gen_event_size(event);
-  thread->buffer += evt_size;
-  thread->offset += evt_size;
+  for (i = 0; i < trace->nb_filter_tids; i++)
+    if (tid == trace->filter_tids[i])
+      return 1;
 
-  thread->cur_event.event = event;
-  thread->cur_event.tid = thread->thread_pair->tid;
+  return 0;
+}
 
-  return &thread->cur_event;
+/*
+ * Returns whether the events of a thread pass the filters. The events of the
+ *   sorted processes are filtered by the thread of their run
+ */
+static int __litl_read_filter_thread(litl_read_trace_t* trace,
+                                     litl_read_process_t* process,
+                                     litl_read_thread_t* thread) {
+  return process->nb_sources
+    || __litl_read_filter_tid(trace, thread->thread_pair->tid);
 }
 
-litl_read_event_t* litl_read_next_thread_event(litl_read_trace_t* trace,
-					       litl_read_process_t* process,
-					       litl_read_thread_t* thread) {
-  return __litl_read_next_thread_event(trace, process, thread);
+/*
+ * Returns whether an event starts a run of events of a sorted process
+ */
+static inline int __litl_read_is_run(litl_read_process_t* process,
+                                     litl_t* event) {
+  return process->nb_sources && event->code == LITL_RUN_CODE
+    && event->type == LITL_TYPE_REGULAR;
 }
 
+/*
+ * Starts a run of events of a sorted process: the following events of the
+ *   thread were recorded by a thread of a source process
+ */
+static inline void __litl_read_start_run(litl_read_process_t* process,
+                                         litl_read_thread_t* thread,
+                                         litl_t* event) {
+  litl_param_t source_index = event->parameters.regular.param[0];
+
+  if (event->parameters.regular.nb_params == 2
+      && source_index < process->nb_sources) {
+    thread->run_process = process->sources[source_index];
+    thread->run_tid = event->parameters.regular.param[1];
+  }
+}
 
 /*
- * Searches for the next event inside the trace
+ * Returns the process that recorded the current event of a thread
  */
-litl_read_event_t* litl_read_next_process_event(litl_read_trace_t* trace,
-                                                litl_read_process_t* process) {
+static inline litl_read_process_t* __litl_read_event_process(
+    litl_read_process_t* process, litl_read_thread_t* thread) {
+  return thread->run_process ? thread->run_process : process;
+}
 
-  litl_med_size_t thread_index;
-  litl_time_t min_time = -1;
+/*
+ * Returns the ID of the thread that recorded the current event of a thread
+ */
+static inline litl_tid_t __litl_read_event_tid(litl_read_thread_t* thread) {
+  return thread->run_process ? thread->run_tid : thread->thread_pair->tid;
+}
 
-  if (!process->is_initialized) {
-    for (thread_index = 0; thread_index < process->nb_threads; thread_index++)
-      __litl_read_next_thread_event(trace, process, process->threads[thread_index]);
+/*
+ * Returns whether a chunk may hold events that pass the filters, according
+ *   to the chunk index
+ */
+static int __litl_read_filter_chunk(litl_read_trace_t* trace,
+                                    litl_chunk_t* chunk) {
+  litl_size_t i;
+
+  if (chunk->first_time > trace->end_time)
+    return 0;
+  if (!trace->nb_filter_codes)
+    return 1;
+
+  for (i = 0; i < trace->nb_filter_codes; i++)
+    if (__litl_chunk_may_hold_codes(chunk, trace->filter_codes[2 * i],
+                                    trace->filter_codes[2 * i + 1]))
+      return 1;
+  return 0;
+}
 
-    process->cur_index = -1;
-    process->is_initialized = 1;
+/*
+ * Moves the position of a thread, which is at the beginning of a chunk, to
+ *   the first chunk that may hold events that pass the filters. Returns 0
+ *   when there is no such chunk
+ */
+static int __litl_read_skip_chunks(litl_read_trace_t* trace,
+                                   litl_read_thread_t* thread) {
+  litl_size_t first, last, middle;
+
+  // search the chunk in the index. The chunks without events are not indexed
+  first = 0;
+  last = thread->nb_chunks;
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (thread->chunks[middle].offset < thread->thread_pair->offset)
+      first = middle + 1;
+    else
+      last = middle;
   }
-
-  // read the next event from the buffer
-  if (process->cur_index != -1)
-    __litl_read_next_thread_event(trace, process, process->threads[process->cur_index]);
-
-  int found = 0;
-  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
-    litl_read_event_t *evt =
-      LITL_READ_GET_CUR_EVENT_PER_THREAD(process, thread_index);
-      if ( evt && evt->event && (LITL_READ_GET_TIME(evt) < min_time))
-      {
-        found = 1;
-        min_time = LITL_READ_GET_TIME(evt);
-        process->cur_index = thread_index;
-      }
+  if (first == thread->nb_chunks
+      || thread->chunks[first].offset != thread->thread_pair->offset)
+    return 1;
+
+  for (; first < thread->nb_chunks; first++)
+    if (__litl_read_filter_chunk(trace, &thread->chunks[first])) {
+      thread->thread_pair->offset = thread->chunks[first].offset;
+      return 1;
     }
 
-  if (found)
-    return LITL_READ_GET_CUR_EVENT(process);
-
-  return NULL ;
+  return 0;
 }
 
 /*
- * Reads the next event from a trace
+ * Reads an event
  */
-litl_read_event_t* litl_read_next_event(litl_read_trace_t* trace) {
-  litl_med_size_t process_index;
-  litl_read_event_t* event = NULL;
+static litl_read_event_t* __litl_read_next_thread_event(
+    litl_read_trace_t* trace, litl_read_process_t* process,
+    litl_read_thread_t* thread) {
+
+  litl_t* event;
+  litl_size_t remaining_size, evt_size;
+
+  // the buffer of the thread is loaded when it is first read, or when it was
+  //   evicted from the chunk cache
+  if (!thread->is_loaded) {
+    if (thread->nb_chunks && !__litl_read_skip_chunks(trace, thread)) {
+      thread->buffer = NULL;
+      thread->is_loaded = 1;
+    } else
+      __litl_read_next_buffer(trace, process, thread);
+  } else if (thread->slot)
+    __litl_read_cache_touch(trace, thread->slot);
+
+  for (;;) {
+    if (!thread->buffer) {
+      thread->cur_event.event = NULL;
+      return NULL ;
+    }
+
+    event = (litl_t *) thread->buffer;
+
+    // While reading events from the buffer, there can be two situations:
+    // 1. The situation when the buffer contains exact number of events;
+    // 2. The situation when only a part of the last event is loaded.
+    // Check whether the main four components (tid, time, code, nb_params)
+    //   are loaded.
+    // Check whether all arguments are loaded.
+    // If any of these cases is not true, the next part of the trace plus
+    // the current event is loaded to the buffer
+    remaining_size = thread->tracker - thread->offset;
+    if (remaining_size < __litl_get_reg_event_size(0)
+        || remaining_size < __litl_get_gen_event_size(event)) {
+      if (trace->map) {
+        // the whole file is mapped, so the trace itself is truncated
+        thread->cur_event.event = NULL;
+        return NULL ;
+      }
+
+      // fetch the next block of data from the trace, starting from the
+      //   truncated event
+      thread->thread_pair->offset += thread->offset;
+      __litl_read_next_buffer(trace, process, thread);
+      event = (litl_t *) thread->buffer;
+    }
+
+    // event that stores tid and offset
+    if (event->code == LITL_OFFSET_CODE) {
+      if (event->parameters.offset.offset == 0) {
+        thread->cur_event.event = NULL;
+        return NULL ;
+      }
+
+      // fetch the next block of data from the trace. The chunks that do not
+      //   hold any event that passes the filters are skipped
+      thread->thread_pair->offset = event->parameters.offset.offset;
+      if (thread->nb_chunks && !__litl_read_skip_chunks(trace, thread)) {
+        thread->cur_event.event = NULL;
+        return NULL ;
+      }
+      __litl_read_next_buffer(trace, process, thread);
+      continue;
+    }
+
+    // move pointer to the next event and update __offset
+    evt_size = __litl_get_gen_event_size(event);
+    thread->buffer += evt_size;
+    thread->offset += evt_size;
+
+    // the definitions of interned strings are not returned. They are only
+    //   needed for traces without a dictionary, e.g. when the application
+    //   crashed
+    if (event->code == LITL_STRING_CODE && event->type == LITL_TYPE_RAW) {
+      __litl_read_define_string(process, event);
+      continue;
+    }
+
+    // the run events of a sorted trace are not returned either: they give
+    //   the process and the thread of the following events
+    if (__litl_read_is_run(process, event)) {
+      __litl_read_start_run(process, thread, event);
+      continue;
+    }
+
+    // the events that do not pass the filters are skipped before being
+    //   decoded
+    if (trace->nb_filter_codes && !__litl_read_filter_code(trace, event->code))
+      continue;
+    if (thread->run_process && !__litl_read_filter_tid(trace, thread->run_tid))
+      continue;
+
+    thread->cur_event.event = event;
+    thread->cur_event.tid = __litl_read_event_tid(thread);
+
+    return &thread->cur_event;
+  }
+}
+
+litl_read_event_t* litl_read_next_thread_event(litl_read_trace_t* trace,
+					       litl_read_process_t* process,
+					       litl_read_thread_t* thread) {
+  return __litl_read_next_thread_event(trace, process, thread);
+}
+
+
+/*
+ * Compares two entries of a heap of threads or processes. Events with the
+ *   same time are ordered by index
+ */
+static inline int __litl_read_heap_less(litl_read_heap_entry_t* a,
+                                        litl_read_heap_entry_t* b) {
+  return a->time < b->time
+    || (a->time == b->time && a->index < b->index);
+}
+
+/*
+ * Moves down the entry at a given position of a heap
+ */
+static void __litl_read_heap_sift_down(litl_read_heap_entry_t* heap,
+                                       litl_med_size_t heap_size,
+                                       litl_med_size_t pos) {
+  litl_read_heap_entry_t entry = heap[pos];
+  litl_med_size_t child;
+
+  while ((child = 2 * pos + 1) < heap_size) {
+    if (child + 1 < heap_size
+        && __litl_read_heap_less(&heap[child + 1], &heap[child]))
+      child++;
+    if (!__litl_read_heap_less(&heap[child], &entry))
+      break;
+    heap[pos] = heap[child];
+    pos = child;
+  }
+  heap[pos] = entry;
+}
+
+/*
+ * Builds the heap of threads from their first events
+ */
+static void __litl_read_init_heap(litl_read_trace_t* trace,
+                                  litl_read_process_t* process) {
+  litl_med_size_t thread_index;
+  litl_read_event_t* event;
+
+  process->heap = (litl_read_heap_entry_t*) malloc(
+      (process->nb_threads ? process->nb_threads : 1)
+      * sizeof(litl_read_heap_entry_t));
+  if (!process->heap) {
+    perror("Could not allocate memory for the heap of threads!");
+    exit(EXIT_FAILURE);
+  }
+
+  process->heap_size = 0;
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    if (!__litl_read_filter_thread(trace, process,
+                                   process->threads[thread_index]))
+      continue;
+    event = __litl_read_next_thread_event(trace, process,
+                                          process->threads[thread_index]);
+    if (event && event->event) {
+      process->heap[process->heap_size].time = LITL_READ_GET_TIME(event);
+      process->heap[process->heap_size].index = thread_index;
+      process->heap_size++;
+    }
+  }
+
+  for (thread_index = process->heap_size / 2; thread_index > 0; thread_index--)
+    __litl_read_heap_sift_down(process->heap, process->heap_size,
+                               thread_index - 1);
+}
+
+/*
+ * Searches for the next event inside the trace. The threads are kept in a
+ *   heap ordered by the time of their current event, so that finding the
+ *   next event costs O(log(nb_threads))
+ */
+litl_read_event_t* litl_read_next_process_event(litl_read_trace_t* trace,
+                                                litl_read_process_t* process) {
+  litl_read_event_t* event;
+
+  if (!process->is_initialized) {
+    __litl_read_init_heap(trace, process);
+
+    process->cur_index = -1;
+    process->is_initialized = 1;
+  }
+
+  // read the next event of the thread that returned the previous event, which
+  //   is at the top of the heap
+  if (process->cur_index != -1) {
+    event = __litl_read_next_thread_event(trace, process,
+                                          process->threads[process->cur_index]);
+    if (event && event->event)
+      process->heap[0].time = LITL_READ_GET_TIME(event);
+    else
+      process->heap[0] = process->heap[--process->heap_size];
+    if (process->heap_size)
+      __litl_read_heap_sift_down(process->heap, process->heap_size, 0);
+  }
+
+  // the events are returned in order, so the following events are also out
+  //   of the time window
+  if (!process->heap_size || process->heap[0].time > trace->end_time) {
+    process->cur_index = -1;
+    return NULL ;
+  }
+
+  process->cur_index = process->heap[0].index;
+  return LITL_READ_GET_CUR_EVENT(process);
+}
+
+/*
+ * Reads the next event from a trace
+ */
+litl_read_event_t* litl_read_next_event(litl_read_trace_t* trace) {
+  litl_med_size_t process_index;
+  litl_read_process_t* process;
+  litl_read_event_t* event = NULL;
 
   for (process_index = 0; process_index < trace->nb_processes;
       process_index++) {
     event = litl_read_next_process_event(trace,
                                          trace->processes[process_index]);
 
-    if (event != NULL )
+    if (event != NULL ) {
+      process = trace->processes[process_index];
+      trace->cur_process = __litl_read_event_process(
+          process, process->threads[process->cur_index]);
       break;
+    }
   }
 
   return event;
 }
 
 /*
- * Closes the trace and frees the buffer
+ * Reads the next event of all the processes of a trace in chronological
+ *   order. The processes are kept in a heap ordered by the time of their
+ *   current event, and each process orders its threads with its own heap
  */
-void litl_read_finalize_trace(litl_read_trace_t* trace) {
+litl_read_event_t* litl_read_next_ordered_event(litl_read_trace_t* trace) {
+  litl_med_size_t process_index;
+  litl_read_process_t* process;
+  litl_read_event_t* event;
+
+  if (!trace->is_heap_initialized) {
+    trace->heap = (litl_read_heap_entry_t*) malloc(
+        (trace->nb_processes ? trace->nb_processes : 1)
+        * sizeof(litl_read_heap_entry_t));
+    if (!trace->heap) {
+      perror("Could not allocate memory for the heap of processes!");
+      exit(EXIT_FAILURE);
+    }
+
+    trace->heap_size = 0;
+    for (process_index = 0; process_index < trace->nb_processes;
+        process_index++) {
+      event = litl_read_next_process_event(trace,
+                                           trace->processes[process_index]);
+      if (event) {
+        trace->heap[trace->heap_size].time = LITL_READ_GET_TIME(event);
+        trace->heap[trace->heap_size].index = process_index;
+        trace->heap_size++;
+      }
+    }
+    for (process_index = trace->heap_size / 2; process_index > 0;
+        process_index--)
+      __litl_read_heap_sift_down(trace->heap, trace->heap_size,
+                                 process_index - 1);
+
+    trace->is_heap_initialized = 1;
+  } else if (trace->heap_size) {
+    // read the next event of the process that returned the previous event,
+    //   which is at the top of the heap
+    event = litl_read_next_process_event(trace,
+                                         trace->processes[trace->heap[0].index]);
+    if (event)
+      trace->heap[0].time = LITL_READ_GET_TIME(event);
+    else
+      trace->heap[0] = trace->heap[--trace->heap_size];
+    if (trace->heap_size)
+      __litl_read_heap_sift_down(trace->heap, trace->heap_size, 0);
+  }
+
+  if (!trace->heap_size)
+    return NULL ;
+
+  process = trace->processes[trace->heap[0].index];
+  trace->cur_process = __litl_read_event_process(
+      process, process->threads[process->cur_index]);
+  return LITL_READ_GET_CUR_EVENT(process);
+}
+
+/*
+ * Returns the index of the first chunk of a thread that ends at or after a
+ *   given time, or the number of chunks if all its events occurred before.
+ *   The chunk index must be loaded
+ */
+static litl_size_t __litl_read_find_chunk(litl_read_thread_t* thread,
+                                          litl_time_t time) {
+  litl_size_t first = 0, last = thread->nb_chunks, middle;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (thread->chunks[middle].last_time < time)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  return first;
+}
+
+/*
+ * The work shared by the workers of litl_read_visit_events: each work item is
+ *   a thread of a process
+ */
+typedef struct {
+  litl_read_trace_t* trace;
+  litl_read_visitor_t visitor;
+  void** states;
+  litl_med_size_t* items; /* pairs of process and thread indexes */
+  unsigned nb_items;
+  unsigned next_item;
+  unsigned next_worker;
+} __litl_read_visit_t;
+
+/*
+ * Visits the events of the threads picked from the list of work items. Each
+ *   thread is read with a private cursor, so that the threads of the trace
+ *   are not modified
+ */
+static void* __litl_read_visit_worker(void* arg) {
+  __litl_read_visit_t* visit = arg;
+  litl_read_trace_t* trace = visit->trace;
+  unsigned worker = __atomic_fetch_add(&visit->next_worker, 1,
+                                       __ATOMIC_RELAXED);
+  void* state = visit->states ? visit->states[worker] : NULL;
+  litl_read_thread_t cursor;
+  litl_thread_pair_t thread_pair;
+  litl_buffer_t buffer = NULL;
+  litl_size_t buffer_size = 0;
+  litl_read_event_t* event;
+  litl_size_t chunk_index;
+  unsigned item;
+
+  while ((item = __atomic_fetch_add(&visit->next_item, 1, __ATOMIC_RELAXED))
+         < visit->nb_items) {
+    litl_read_process_t* process = trace->processes[visit->items[2 * item]];
+    litl_read_thread_t* thread = process->threads[visit->items[2 * item + 1]];
+
+    if (!__litl_read_filter_thread(trace, process, thread))
+      continue;
+
+    // the processes of an archive may have different buffer sizes
+    if (!trace->map && buffer_size < process->header->buffer_size) {
+      buffer_size = process->header->buffer_size;
+      buffer = (litl_buffer_t) realloc(buffer, buffer_size);
+      if (!buffer) {
+        perror("Could not allocate memory for a worker buffer!");
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    // start from the first chunk of events of the thread, or from the chunk
+    //   where the time window starts
+    thread_pair.tid = thread->thread_pair->tid;
+    thread_pair.offset = thread->first_offset;
+    if (trace->start_time) {
+      chunk_index = __litl_read_find_chunk(thread, trace->start_time);
+      if (chunk_index == thread->nb_chunks)
+        continue;
+      thread_pair.offset = thread->chunks[chunk_index].offset;
+    }
+    cursor.thread_pair = &thread_pair;
+    cursor.buffer_ptr = buffer;
+    cursor.slot = NULL;
+    cursor.first_offset = thread->first_offset;
+    cursor.chunks = thread->chunks;
+    cursor.nb_chunks = thread->nb_chunks;
+    cursor.prefetch_offset = 0;
+    cursor.run_process = NULL;
+    __litl_read_next_buffer(trace, process, &cursor);
+
+    // the events of the chunk that occurred before the time window are
+    //   skipped
+    while ((event = __litl_read_next_thread_event(trace, process, &cursor))
+           != NULL && event->event && LITL_READ_GET_TIME(event) <= trace->end_time)
+      if (LITL_READ_GET_TIME(event) >= trace->start_time)
+        visit->visitor(trace, __litl_read_event_process(process, &cursor),
+                       event, state);
+  }
+
+  free(buffer);
+  return NULL ;
+}
+
+/*
+ * Calls a visitor on each event of a trace. The threads of the trace are
+ *   shared among a pool of workers
+ */
+int litl_read_visit_events(litl_read_trace_t* trace, unsigned nb_workers,
+                           litl_read_visitor_t visitor, void** states) {
+  __litl_read_visit_t visit;
+  pthread_t* workers;
   litl_med_size_t process_index, thread_index;
+  unsigned i;
 
-  // close the file
-  close(trace->f_handle);
-  trace->f_handle = -1;
+  if (nb_workers == 0) {
+    long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nb_workers = nb_cpus > 0 ? nb_cpus : 1;
+  }
 
-  // free traces
-  for (process_index = 0; process_index < trace->nb_processes;
-      process_index++) {
+  visit.trace = trace;
+  visit.visitor = visitor;
+  visit.states = states;
+  visit.nb_items = 0;
+  visit.next_item = 0;
+  visit.next_worker = 0;
+  for (process_index = 0; process_index < trace->nb_processes; process_index++)
+    visit.nb_items += trace->processes[process_index]->nb_threads;
+  visit.items = (litl_med_size_t*) malloc(
+      (visit.nb_items ? visit.nb_items : 1) * 2 * sizeof(litl_med_size_t));
+  workers = (pthread_t*) malloc(nb_workers * sizeof(pthread_t));
+  if (!visit.items || !workers) {
+    perror("Could not allocate memory for the workers!");
+    exit(EXIT_FAILURE);
+  }
 
+  // the workers seek the start of the time window through the chunk index,
+  //   which is loaded before they share the processes
+  if (trace->start_time)
+    for (process_index = 0; process_index < trace->nb_processes;
+        process_index++)
+      __litl_read_load_chunk_index(trace, trace->processes[process_index]);
+
+  i = 0;
+  for (process_index = 0; process_index < trace->nb_processes; process_index++)
     for (thread_index = 0;
         thread_index < trace->processes[process_index]->nb_threads;
         thread_index++) {
-      free(trace->processes[process_index]->threads[thread_index]->thread_pair);
-      free(trace->processes[process_index]->threads[thread_index]->buffer_ptr);
-      free(trace->processes[process_index]->threads[thread_index]);
+      visit.items[i++] = process_index;
+      visit.items[i++] = thread_index;
+    }
+
+  for (i = 0; i < nb_workers; i++)
+    if (pthread_create(&workers[i], NULL, __litl_read_visit_worker, &visit)
+        != 0) {
+      perror("Could not create a worker thread!");
+      exit(EXIT_FAILURE);
     }
+  for (i = 0; i < nb_workers; i++)
+    pthread_join(workers[i], NULL );
+
+  free(workers);
+  free(visit.items);
+
+  return 0;
+}
+
+/*
+ * Only reads the events whose code is within a range
+ */
+void litl_read_filter_codes(litl_read_trace_t* trace, litl_code_t first,
+                            litl_code_t last) {
+  trace->filter_codes = (litl_code_t*) realloc(
+      trace->filter_codes,
+      2 * (trace->nb_filter_codes + 1) * sizeof(litl_code_t));
+  if (!trace->filter_codes) {
+    perror("Could not allocate memory for the filters!");
+    exit(EXIT_FAILURE);
+  }
+  trace->filter_codes[2 * trace->nb_filter_codes] = first;
+  trace->filter_codes[2 * trace->nb_filter_codes + 1] = last;
+  trace->nb_filter_codes++;
+}
 
-    free(trace->processes[process_index]->threads);
-    free(trace->processes[process_index]->header_buffer_ptr);
-    free(trace->processes[process_index]);
+/*
+ * Only reads the events of a thread
+ */
+void litl_read_filter_tid(litl_read_trace_t* trace, litl_tid_t tid) {
+  trace->filter_tids = (litl_tid_t*) realloc(
+      trace->filter_tids, (trace->nb_filter_tids + 1) * sizeof(litl_tid_t));
+  if (!trace->filter_tids) {
+    perror("Could not allocate memory for the filters!");
+    exit(EXIT_FAILURE);
   }
+  trace->filter_tids[trace->nb_filter_tids++] = tid;
+}
+
+/*
+ * Allocates a batch of events
+ */
+litl_read_batch_t* litl_read_init_batch(litl_size_t capacity) {
+  litl_read_batch_t* batch;
+  litl_data_t p;
+
+  batch = (litl_read_batch_t*) calloc(1, sizeof(litl_read_batch_t));
+  if (!batch) {
+    perror("Could not allocate memory for a batch of events!");
+    exit(EXIT_FAILURE);
+  }
+
+  batch->capacity = capacity ? capacity : 1;
+  batch->times = (litl_time_t*) malloc(batch->capacity * sizeof(litl_time_t));
+  batch->codes = (litl_code_t*) malloc(batch->capacity * sizeof(litl_code_t));
+  batch->tids = (litl_tid_t*) malloc(batch->capacity * sizeof(litl_tid_t));
+  batch->types = (litl_type_t*) malloc(batch->capacity * sizeof(litl_type_t));
+  batch->nb_params = (litl_data_t*) malloc(
+      batch->capacity * sizeof(litl_data_t));
+  batch->events = (litl_t**) malloc(batch->capacity * sizeof(litl_t*));
+  if (!batch->times || !batch->codes || !batch->tids || !batch->types
+      || !batch->nb_params || !batch->events) {
+    perror("Could not allocate memory for a batch of events!");
+    exit(EXIT_FAILURE);
+  }
+
+  for (p = 0; p < LITL_MAX_PARAMS; p++) {
+    batch->params[p] = (litl_param_t*) malloc(
+        batch->capacity * sizeof(litl_param_t));
+    if (!batch->params[p]) {
+      perror("Could not allocate memory for a batch of events!");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return batch;
+}
+
+/*
+ * Frees a batch of events
+ */
+void litl_read_finalize_batch(litl_read_batch_t* batch) {
+  litl_data_t p;
+
+  if (!batch)
+    return;
+
+  free(batch->times);
+  free(batch->codes);
+  free(batch->tids);
+  free(batch->types);
+  free(batch->nb_params);
+  free(batch->events);
+  for (p = 0; p < LITL_MAX_PARAMS; p++)
+    free(batch->params[p]);
+  free(batch);
+}
+
+/*
+ * Appends an event to a batch
+ */
+static inline void __litl_read_batch_add(litl_read_batch_t* batch,
+                                         litl_tid_t tid, litl_t* event) {
+  litl_size_t i = batch->nb_events++;
+  litl_data_t p, nb_params = 0;
+
+  batch->times[i] = event->time;
+  batch->codes[i] = event->code;
+  batch->tids[i] = tid;
+  batch->types[i] = event->type;
+  batch->events[i] = event;
+  if (event->type == LITL_TYPE_REGULAR) {
+    nb_params = event->parameters.regular.nb_params;
+    for (p = 0; p < nb_params; p++)
+      batch->params[p][i] = event->parameters.regular.param[p];
+  }
+  batch->nb_params[i] = nb_params;
+}
+
+/*
+ * Decodes the events of a thread into a batch, until the batch is full.
+ *   Returns 1 when the thread has no events left
+ */
+static int __litl_read_batch_thread(litl_read_trace_t* trace,
+                                    litl_read_process_t* process,
+                                    litl_read_thread_t* thread,
+                                    litl_read_batch_t* batch) {
+  litl_read_event_t* read_event;
+  litl_read_process_t* event_process;
+  litl_t* event;
+  litl_size_t remaining_size, evt_size;
+  const litl_size_t min_size = __litl_get_reg_event_size(0);
+
+  while (batch->nb_events < batch->capacity) {
+    // decode the events of the current buffer in place. The end of the
+    //   buffer and the offsets are left to __litl_read_next_thread_event.
+    //   A batch holds the events of a single process, so that it ends when a
+    //   run of a sorted trace moves to another source process
+    if (thread->is_loaded && thread->buffer) {
+      while (batch->nb_events < batch->capacity) {
+        remaining_size = thread->tracker - thread->offset;
+        if (remaining_size < min_size)
+          break;
+        event = (litl_t*) thread->buffer;
+        if (event->code == LITL_OFFSET_CODE)
+          break;
+        // the sizes of the most common events are computed inline
+        if (event->type == LITL_TYPE_REGULAR)
+          evt_size = LITL_BASE_SIZE + sizeof(litl_data_t)
+            + event->parameters.regular.nb_params * sizeof(litl_param_t);
+        else if (event->type == LITL_TYPE_PACKED
+                 || event->type == LITL_TYPE_RAW)
+          evt_size = LITL_BASE_SIZE + sizeof(litl_size_t)
+            + event->parameters.packed.size;
+        else
+          evt_size = __litl_get_gen_event_size(event);
+        if (remaining_size < evt_size)
+          break;
+
+        if (event->code == LITL_STRING_CODE && event->type == LITL_TYPE_RAW)
+          __litl_read_define_string(process, event);
+        else if (__litl_read_is_run(process, event))
+          __litl_read_start_run(process, thread, event);
+        else if (event->time > trace->end_time)
+          return 1;
+        else if ((!trace->nb_filter_codes
+                  || __litl_read_filter_code(trace, event->code))
+                 && (!thread->run_process
+                     || __litl_read_filter_tid(trace, thread->run_tid))) {
+          event_process = __litl_read_event_process(process, thread);
+          if (batch->nb_events && event_process != batch->process)
+            return 0;
+          batch->process = event_process;
+          __litl_read_batch_add(batch, __litl_read_event_tid(thread), event);
+        }
+        thread->buffer += evt_size;
+        thread->offset += evt_size;
+      }
+      if (batch->nb_events == batch->capacity)
+        break;
+
+      // with pread, loading the next chunk would overwrite the events of the
+      //   batch, so that the batch ends here
+      if (!trace->map && batch->nb_events)
+        break;
+    }
+
+    read_event = __litl_read_next_thread_event(trace, process, thread);
+    if (!read_event || !read_event->event)
+      return 1;
+    event_process = __litl_read_event_process(process, thread);
+    if (read_event->event->time > trace->end_time
+        || (batch->nb_events && event_process != batch->process)) {
+      // the event is read again by the next call
+      evt_size = __litl_get_gen_event_size(read_event->event);
+      thread->buffer -= evt_size;
+      thread->offset -= evt_size;
+      return read_event->event->time > trace->end_time;
+    }
+    batch->process = event_process;
+    __litl_read_batch_add(batch, read_event->tid, read_event->event);
+  }
+
+  return 0;
+}
+
+/*
+ * Reads the next events of a thread into a batch
+ */
+litl_size_t litl_read_next_thread_batch(litl_read_trace_t* trace,
+                                        litl_read_process_t* process,
+                                        litl_read_thread_t* thread,
+                                        litl_read_batch_t* batch) {
+  batch->nb_events = 0;
+  batch->process = process;
+  __litl_read_batch_thread(trace, process, thread, batch);
+
+  return batch->nb_events;
+}
+
+/*
+ * Reads the next events of a trace into a batch. The threads are read one
+ *   after the other
+ */
+litl_size_t litl_read_next_batch(litl_read_trace_t* trace,
+                                 litl_read_batch_t* batch) {
+  litl_read_process_t* process;
+
+  batch->nb_events = 0;
+  batch->process = NULL;
+
+  while (trace->batch_process_index < trace->nb_processes) {
+    process = trace->processes[trace->batch_process_index];
+
+    if (trace->batch_thread_index < process->nb_threads) {
+      // a batch holds the events of a single process. With pread, it also
+      //   holds the events of a single buffer
+      if (batch->nb_events && !trace->map)
+        break;
+      if (!batch->nb_events)
+        batch->process = process;
+      if (__litl_read_filter_thread(
+          trace, process, process->threads[trace->batch_thread_index])
+          && !__litl_read_batch_thread(
+              trace, process, process->threads[trace->batch_thread_index],
+              batch))
+        break;
+      trace->batch_thread_index++;
+    } else {
+      trace->batch_process_index++;
+      trace->batch_thread_index = 0;
+      if (batch->nb_events)
+        break;
+    }
+  }
+
+  return batch->nb_events;
+}
+
+/*
+ * Compares two chunks by thread, then by time
+ */
+static int __litl_read_compare_chunks(const void* a, const void* b) {
+  const litl_chunk_t* chunk_a = (const litl_chunk_t*) a;
+  const litl_chunk_t* chunk_b = (const litl_chunk_t*) b;
+
+  if (chunk_a->thread_offset != chunk_b->thread_offset)
+    return chunk_a->thread_offset < chunk_b->thread_offset ? -1 : 1;
+  if (chunk_a->first_time != chunk_b->first_time)
+    return chunk_a->first_time < chunk_b->first_time ? -1 : 1;
+  return (chunk_a->offset > chunk_b->offset)
+    - (chunk_a->offset < chunk_b->offset);
+}
+
+/*
+ * Reads all the events of a process to build its chunk index, if build_index
+ *   is set, and its statistics, unless they are loaded. It is only needed for
+ *   the traces that were recorded without the index or the statistics. Each
+ *   thread is read with a private cursor, so that the threads are not modified
+ */
+static void __litl_read_scan_events(litl_read_trace_t* trace,
+                                    litl_read_process_t* process,
+                                    int build_index) {
+  litl_read_thread_t cursor;
+  litl_thread_pair_t thread_pair;
+  litl_buffer_t buffer = NULL;
+  litl_read_event_t* event;
+  litl_chunk_t* chunk = NULL;
+  litl_size_t nb_allocated_chunks = 0;
+  litl_med_size_t thread_index;
+  litl_size_t nb_filter_codes, size;
+  litl_thread_stats_t* thread_stats;
+  litl_code_stats_t* code_stats;
+  litl_time_t time;
+
+  if (!trace->map) {
+    buffer = (litl_buffer_t) malloc(process->header->buffer_size);
+    if (!buffer) {
+      perror("Could not allocate memory for reading the events!");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // the statistics of the events are computed along with the index, unless
+  //   they were already loaded
+  if (!process->is_stats_loaded) {
+    process->thread_stats = (litl_thread_stats_t*) calloc(
+        process->nb_threads ? process->nb_threads : 1,
+        sizeof(litl_thread_stats_t));
+    if (!process->thread_stats) {
+      perror("Could not allocate memory for the statistics of the events!");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // the index describes all the events, whatever the filters
+  nb_filter_codes = trace->nb_filter_codes;
+  trace->nb_filter_codes = 0;
+
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    litl_read_thread_t* thread = process->threads[thread_index];
+
+    thread_pair.tid = thread->thread_pair->tid;
+    thread_pair.offset = thread->first_offset;
+    cursor.thread_pair = &thread_pair;
+    cursor.buffer_ptr = buffer;
+    cursor.slot = NULL;
+    cursor.first_offset = thread->first_offset;
+    cursor.nb_chunks = 0;
+    cursor.run_process = NULL;
+    __litl_read_next_buffer(trace, process, &cursor);
+
+    chunk = NULL;
+    while ((event = __litl_read_next_thread_event(trace, process, &cursor))
+           != NULL && event->event) {
+      time = LITL_READ_GET_TIME(event);
+
+      if (build_index) {
+        // the cursor moved to another chunk, so it starts a new entry. With
+        //   pread, the cursor may also be reloaded from a truncated event:
+        //   the entry then starts at this event, which is as good a place to
+        //   seek to
+        if (!chunk || chunk->offset != thread_pair.offset) {
+          if (process->nb_chunks == nb_allocated_chunks) {
+            nb_allocated_chunks = nb_allocated_chunks ?
+              2 * nb_allocated_chunks : 256;
+            process->chunks = (litl_chunk_t*) realloc(
+                process->chunks, nb_allocated_chunks * sizeof(litl_chunk_t));
+            if (!process->chunks) {
+              perror("Could not allocate memory for the chunk index!");
+              exit(EXIT_FAILURE);
+            }
+          }
+          chunk = &process->chunks[process->nb_chunks++];
+          chunk->tid = thread_pair.tid;
+          chunk->thread_offset = thread->first_offset;
+          chunk->offset = thread_pair.offset;
+          chunk->first_time = time;
+          chunk->nb_events = 0;
+          __litl_chunk_init_codes(chunk);
+        }
+        chunk->last_time = time;
+        chunk->nb_events++;
+        __litl_chunk_add_code(chunk, LITL_READ_GET_CODE(event));
+      }
+
+      if (process->is_stats_loaded)
+        continue;
+      size = __litl_get_gen_event_size(event->event);
+      thread_stats = &process->thread_stats[process->nb_thread_stats];
+      if (!thread_stats->nb_events) {
+        thread_stats->tid = thread_pair.tid;
+        thread_stats->thread_offset = thread->first_offset;
+        thread_stats->first_time = time;
+      }
+      thread_stats->nb_events++;
+      thread_stats->size += size;
+      thread_stats->last_time = time;
+      code_stats = __litl_get_code_stats(&process->code_stats,
+                                         &process->nb_code_stats,
+                                         &process->nb_allocated_code_stats,
+                                         LITL_READ_GET_CODE(event));
+      code_stats->nb_events++;
+      code_stats->size += size;
+    }
+
+    if (!process->is_stats_loaded
+        && process->thread_stats[process->nb_thread_stats].nb_events)
+      process->nb_thread_stats++;
+  }
+
+  process->is_stats_loaded = 1;
+  trace->nb_filter_codes = nb_filter_codes;
+  free(buffer);
+}
+
+/*
+ * Loads the chunk index of a process from its section, or builds it when
+ *   the trace does not have one. Then, assigns its chunks to each thread
+ */
+static void __litl_read_load_chunk_index(litl_read_trace_t* trace,
+                                         litl_read_process_t* process) {
+  litl_med_size_t thread_index;
+  litl_size_t first, last, middle, nb_chunks;
+  void* chunks;
+
+  if (process->is_chunk_index_loaded)
+    return;
+
+  chunks = __litl_read_find_chunks_section(process, &nb_chunks);
+  if (chunks) {
+    process->chunks = (litl_chunk_t*) malloc(nb_chunks * sizeof(litl_chunk_t));
+    if (!process->chunks) {
+      perror("Could not allocate memory for the chunk index!");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(process->chunks, chunks, nb_chunks * sizeof(litl_chunk_t));
+    process->nb_chunks = nb_chunks;
+  } else
+    __litl_read_scan_events(trace, process, 1);
+
+  if (process->nb_chunks)
+    qsort(process->chunks, process->nb_chunks, sizeof(litl_chunk_t),
+          __litl_read_compare_chunks);
+
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    litl_read_thread_t* thread = process->threads[thread_index];
+
+    // search the first chunk of the thread
+    first = 0;
+    last = process->nb_chunks;
+    while (first < last) {
+      middle = first + (last - first) / 2;
+      if (process->chunks[middle].thread_offset < thread->first_offset)
+        first = middle + 1;
+      else
+        last = middle;
+    }
+
+    thread->chunks = process->chunks + first;
+    thread->nb_chunks = 0;
+    while (first + thread->nb_chunks < process->nb_chunks
+           && thread->chunks[thread->nb_chunks].thread_offset
+             == thread->first_offset)
+      thread->nb_chunks++;
+  }
+
+  process->is_chunk_index_loaded = 1;
+}
+
+/*
+ * Returns the chunks of events of a thread sorted by time
+ */
+const litl_chunk_t* litl_read_get_thread_chunks(litl_read_trace_t* trace,
+                                                litl_read_process_t* process,
+                                                litl_read_thread_t* thread,
+                                                litl_size_t* nb_chunks) {
+  __litl_read_load_chunk_index(trace, process);
+
+  *nb_chunks = thread->nb_chunks;
+  return thread->chunks;
+}
+
+/*
+ * Loads the statistics of the events of a process from its sections. For the
+ *   traces that were recorded without them, they are computed by reading the
+ *   events
+ */
+static void __litl_read_load_stats(litl_read_trace_t* trace,
+                                   litl_read_process_t* process) {
+  litl_trace_size_t thread_size = 0, code_size = 0;
+  void* thread_stats, *code_stats;
+
+  if (process->is_stats_loaded)
+    return;
+
+  thread_stats = __litl_read_find_section(process, LITL_SECTION_THREAD_STATS,
+                                          &thread_size);
+  code_stats = __litl_read_find_section(process, LITL_SECTION_CODE_STATS,
+                                        &code_size);
+  if (!thread_stats || !code_stats) {
+    // the statistics are computed while building the chunk index, or by
+    //   reading the events again when the index was loaded from its section
+    __litl_read_load_chunk_index(trace, process);
+    if (!process->is_stats_loaded)
+      __litl_read_scan_events(trace, process, 0);
+    return;
+  }
+
+  process->thread_stats = (litl_thread_stats_t*) malloc(thread_size + 1);
+  process->code_stats = (litl_code_stats_t*) malloc(code_size + 1);
+  if (!process->thread_stats || !process->code_stats) {
+    perror("Could not allocate memory for the statistics of the events!");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(process->thread_stats, thread_stats, thread_size);
+  process->nb_thread_stats = thread_size / sizeof(litl_thread_stats_t);
+  memcpy(process->code_stats, code_stats, code_size);
+  process->nb_code_stats = code_size / sizeof(litl_code_stats_t);
+  process->nb_allocated_code_stats = process->nb_code_stats;
+  process->is_stats_loaded = 1;
+}
+
+/*
+ * Returns the statistics of the events of each thread of a process
+ */
+const litl_thread_stats_t* litl_read_get_thread_stats(
+    litl_read_trace_t* trace, litl_read_process_t* process,
+    litl_size_t* nb_threads) {
+  __litl_read_load_stats(trace, process);
+
+  *nb_threads = process->nb_thread_stats;
+  return process->thread_stats;
+}
+
+/*
+ * Returns the statistics of the events of a process per code
+ */
+const litl_code_stats_t* litl_read_get_code_stats(litl_read_trace_t* trace,
+                                                  litl_read_process_t* process,
+                                                  litl_size_t* nb_codes) {
+  __litl_read_load_stats(trace, process);
+
+  *nb_codes = process->nb_code_stats;
+  return process->code_stats;
+}
+
+/*
+ * Compares the statistics of two codes
+ */
+static int __litl_read_compare_code_stats(const void* a, const void* b) {
+  const litl_code_stats_t* stats_a = (const litl_code_stats_t*) a;
+  const litl_code_stats_t* stats_b = (const litl_code_stats_t*) b;
+
+  return (stats_a->code > stats_b->code) - (stats_a->code < stats_b->code);
+}
+
+/*
+ * Returns the statistics of the events of a process with a given code
+ */
+const litl_code_stats_t* litl_read_find_code_stats(litl_read_trace_t* trace,
+                                                   litl_read_process_t* process,
+                                                   litl_code_t code) {
+  litl_code_stats_t key;
+
+  __litl_read_load_stats(trace, process);
+  if (!process->nb_code_stats)
+    return NULL ;
+
+  key.code = code;
+  return bsearch(&key, process->code_stats, process->nb_code_stats,
+                 sizeof(litl_code_stats_t), __litl_read_compare_code_stats);
+}
+
+/*
+ * Moves a thread to its first event that occurred at or after a given time
+ */
+void litl_read_seek_thread_time(litl_read_trace_t* trace,
+                                litl_read_process_t* process,
+                                litl_read_thread_t* thread, litl_time_t time) {
+  litl_read_event_t* event;
+  litl_size_t first;
+
+  __litl_read_load_chunk_index(trace, process);
+
+  first = __litl_read_find_chunk(thread, time);
+  if (first == thread->nb_chunks) {
+    // all the events of the thread occurred before the time
+    thread->buffer = NULL;
+    thread->is_loaded = 1;
+    thread->cur_event.event = NULL;
+    return;
+  }
+
+  thread->thread_pair->offset = thread->chunks[first].offset;
+  thread->prefetch_offset = 0;
+  __litl_read_next_buffer(trace, process, thread);
+
+  // skip the events of the chunk that occurred before the time
+  while ((event = __litl_read_next_thread_event(trace, process, thread))
+         != NULL && event->event) {
+    if (LITL_READ_GET_TIME(event) >= time) {
+      // the event is in the current buffer: step back, so that it is the next
+      //   event to be read
+      litl_size_t evt_size = __litl_get_gen_event_size(event->event);
+      thread->buffer -= evt_size;
+      thread->offset -= evt_size;
+      return;
+    }
+  }
+}
+
+/*
+ * Moves all the threads of a trace to their first event that occurred at or
+ *   after a given time
+ */
+void litl_read_seek_time(litl_read_trace_t* trace, litl_time_t time) {
+  litl_med_size_t process_index, thread_index;
+
+  for (process_index = 0; process_index < trace->nb_processes;
+      process_index++) {
+    litl_read_process_t* process = trace->processes[process_index];
+
+    for (thread_index = 0; thread_index < process->nb_threads; thread_index++)
+      litl_read_seek_thread_time(trace, process,
+                                 process->threads[thread_index], time);
+
+    // the heap of threads is built again from the new positions
+    free(process->heap);
+    process->heap = NULL;
+    process->heap_size = 0;
+    process->cur_index = -1;
+    process->is_initialized = 0;
+  }
+
+  free(trace->heap);
+  trace->heap = NULL;
+  trace->heap_size = 0;
+  trace->is_heap_initialized = 0;
+  trace->cur_process = NULL;
+}
+
+/*
+ * Restricts the reading of a trace to the events that occurred within a
+ *   time window
+ */
+void litl_read_set_time_window(litl_read_trace_t* trace, litl_time_t start,
+                               litl_time_t end) {
+  litl_read_seek_time(trace, start);
+  trace->start_time = start;
+  trace->end_time = end;
+}
+
+/*
+ * Returns the schema of an event code
+ */
+litl_event_schema_t* litl_read_get_event_schema(litl_read_process_t* process,
+                                                litl_code_t code) {
+  litl_event_schema_t key;
+
+  if (!process->nb_schemas)
+    return NULL ;
+
+  key.code = code;
+  return bsearch(&key, process->schemas, process->nb_schemas,
+                 sizeof(litl_event_schema_t), __litl_read_compare_schemas);
+}
+
+/*
+ * Returns an interned string
+ */
+const char* litl_read_get_string(litl_read_process_t* process,
+                                 litl_string_id_t id) {
+  if (id >= process->nb_strings)
+    return NULL ;
+
+  return process->strings[id];
+}
+
+/*
+ * Returns the thread of a process that has a given ID
+ */
+litl_read_thread_t* litl_read_find_thread(litl_read_process_t* process,
+                                          litl_tid_t tid) {
+  litl_med_size_t first = 0, last = process->nb_threads, middle;
+  litl_read_thread_t* thread;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    thread = process->threads_by_tid[middle];
+    if (thread->thread_pair->tid < tid)
+      first = middle + 1;
+    else if (thread->thread_pair->tid > tid)
+      last = middle;
+    else
+      return thread;
+  }
+
+  return NULL ;
+}
+
+/*
+ * Returns the module that contained a code address at a given time
+ */
+const litl_module_t* litl_read_find_module(litl_read_process_t* process,
+                                           litl_param_t address,
+                                           litl_time_t time) {
+  const litl_module_t* module = NULL;
+  litl_size_t i;
+
+  // several modules may have been loaded at the same address over time: pick
+  //   the last one loaded before the given time. The modules are snapshot
+  //   after they are loaded, so fall back to the first one loaded afterwards
+  for (i = 0; i < process->nb_modules; i++) {
+    const litl_module_t* p_module = &process->modules[i];
+    if (address < p_module->start || address >= p_module->end)
+      continue;
+    if (!module || (p_module->load_time <= time)
+        || (module->load_time > time && p_module->load_time < module->load_time))
+      module = p_module;
+  }
+
+  return module;
+}
+
+/*
+ * Returns the payload of a raw or packed event. The payload is not copied: it
+ *   points to the buffer the event was read into
+ */
+const litl_data_t* litl_read_get_data(litl_read_event_t* event,
+                                      litl_size_t* size) {
+  switch (LITL_READ_GET_TYPE(event)) {
+  case LITL_TYPE_RAW:
+    *size = LITL_READ_RAW(event)->size;
+    return LITL_READ_RAW(event)->data;
+  case LITL_TYPE_PACKED:
+    *size = LITL_READ_PACKED(event)->size;
+    return LITL_READ_PACKED(event)->param;
+  default:
+    *size = 0;
+    return NULL ;
+  }
+}
+
+/*
+ * Decodes the parameters of a packed event according to its schema
+ */
+int litl_read_get_typed_params(litl_read_process_t* process,
+                               litl_read_event_t* event,
+                               litl_typed_param_t params[LITL_MAX_PARAMS]) {
+  litl_event_schema_t* schema;
+  litl_data_t i;
+  litl_size_t size = 0;
+
+  if (LITL_READ_GET_TYPE(event) != LITL_TYPE_PACKED)
+    return -1;
+
+  schema = litl_read_get_event_schema(process, LITL_READ_GET_CODE(event));
+  if (!schema)
+    return -1;
+
+  for (i = 0; i < schema->nb_params; i++)
+    size += __litl_get_param_type_size(schema->types[i]);
+  if (size != LITL_READ_PACKED(event)->size)
+    return -1;
+
+  void* _ptr_ = &LITL_READ_PACKED(event)->param[0];
+  for (i = 0; i < schema->nb_params; i++) {
+    params[i].type = schema->types[i];
+    switch (schema->types[i]) {
+    case LITL_PARAM_UINT8: {
+      uint8_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.u = param;
+      break;
+    }
+    case LITL_PARAM_INT8: {
+      int8_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.i = param;
+      break;
+    }
+    case LITL_PARAM_UINT16: {
+      uint16_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.u = param;
+      break;
+    }
+    case LITL_PARAM_INT16: {
+      int16_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.i = param;
+      break;
+    }
+    case LITL_PARAM_UINT32: {
+      uint32_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.u = param;
+      break;
+    }
+    case LITL_PARAM_INT32: {
+      int32_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.i = param;
+      break;
+    }
+    case LITL_PARAM_UINT64:
+    case LITL_PARAM_POINTER:
+    case LITL_PARAM_ADDRESS: {
+      uint64_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.u = param;
+      break;
+    }
+    case LITL_PARAM_INT64: {
+      int64_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.i = param;
+      break;
+    }
+    case LITL_PARAM_FLOAT: {
+      float param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.d = param;
+      break;
+    }
+    case LITL_PARAM_STRING: {
+      litl_string_id_t param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.s = litl_read_get_string(process, param);
+      break;
+    }
+    case LITL_PARAM_DOUBLE: {
+      double param;
+      __LITL_READ_GET_ARG_PACKED(_ptr_, param);
+      params[i].value.d = param;
+      break;
+    }
+    default:
+      return -1;
+    }
+  }
+
+  return schema->nb_params;
+}
+
+/*
+ * Frees a process, along with its sources
+ */
+static void __litl_read_finalize_process(litl_read_process_t* process) {
+  litl_med_size_t thread_index, source_index;
+  litl_string_id_t i;
+
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    free(process->threads[thread_index]->thread_pair);
+    free(process->threads[thread_index]->event_copy);
+    free(process->threads[thread_index]);
+  }
+
+  for (source_index = 0; source_index < process->nb_sources; source_index++)
+    __litl_read_finalize_process(process->sources[source_index]);
+  free(process->sources);
+
+  free(process->threads);
+  free(process->threads_by_tid);
+  free(process->heap);
+  free(process->header_buffer_ptr);
+  free(process->sections);
+  free(process->chunks);
+  free(process->thread_stats);
+  free(process->code_stats);
+  for (i = 0; i < process->nb_strings; i++)
+    free(process->strings[i]);
+  free(process->strings);
+  pthread_mutex_destroy(&process->lock_strings);
+  free(process);
+}
+
+/*
+ * Closes the trace and frees the buffer
+ */
+void litl_read_finalize_trace(litl_read_trace_t* trace) {
+  litl_med_size_t process_index;
+
+  // close the file
+  close(trace->f_handle);
+  trace->f_handle = -1;
+  if (trace->map)
+    munmap(trace->map, trace->map_size);
+
+  // free traces
+  for (process_index = 0; process_index < trace->nb_processes;
+      process_index++)
+    __litl_read_finalize_process(trace->processes[process_index]);
+
+  // free the chunk cache
+  while (trace->cache_head) {
+    litl_read_cache_slot_t* slot = trace->cache_head;
+    trace->cache_head = slot->next;
+    free(slot->buffer);
+    free(slot);
+  }
+
+  free(trace->filter_codes);
+  free(trace->filter_tids);
 
   // free a trace structure
   free(trace->processes);
+  free(trace->event_processes);
+  free(trace->heap);
   free(trace->header_buffer_ptr);
   free(trace);
 
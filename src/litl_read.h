@@ -49,7 +49,9 @@ litl_read_trace_t* litl_read_open_trace(const char* filename);
 
 /**
  * \ingroup litl_read_init
- * \brief Initializes the event reading structure
+ * \brief Initializes the event reading structure. The events of a trace
+ *  sorted by litl_merge_sort_trace are reported in the processes and the
+ *  threads of the source trace, which are listed in trace->event_processes
  * \param trace A pointer to the trace object
  */
 void litl_read_init_processes(litl_read_trace_t* trace);
@@ -88,6 +90,40 @@ void litl_read_set_buffer_size(litl_read_trace_t* trace,
  */
 litl_size_t litl_read_get_buffer_size(litl_read_trace_t* trace);
 
+/**
+ * \ingroup litl_read_init
+ * \brief Returns the buffer size a process was recorded with. The buffer size
+ *  of the process header is larger, as the reader keeps room for the tail of
+ *  the events
+ * \param process A pointer to the process object
+ * \return A buffer size (in Byte)
+ */
+litl_size_t litl_read_get_recorded_buffer_size(litl_read_process_t* process);
+
+/**
+ * \ingroup litl_read_init
+ * \brief Sets the maximum size of the buffers that are kept in memory when
+ *  the trace is read with pread. The threads borrow a buffer when they are
+ *  read, and the buffer that was used least recently is taken back once the
+ *  cache is full. At least one buffer is always allocated. By default, it is
+ *  LITL_READ_CACHE_SIZE
+ * \param trace A pointer to the trace object
+ * \param cache_size A size (in Bytes)
+ */
+void litl_read_set_cache_size(litl_read_trace_t* trace, size_t cache_size);
+
+/**
+ * \ingroup litl_read_init
+ * \brief Sets the number of chunks of events that are prefetched ahead of
+ *  each thread, so that reading the trace file overlaps decoding the events.
+ *  The chunks are found in the chunk index of the trace; traces without it
+ *  are not prefetched. By default, it is LITL_READ_PREFETCH; 0 disables the
+ *  prefetching
+ * \param trace A pointer to the trace object
+ * \param depth A number of chunks
+ */
+void litl_read_set_prefetch_depth(litl_read_trace_t* trace, unsigned depth);
+
 /**
  * \ingroup litl_read_main
  * \brief Resets the trace pointer
@@ -122,6 +158,277 @@ litl_read_event_t* litl_read_next_thread_event(litl_read_trace_t* trace,
  */
 litl_read_event_t* litl_read_next_event(litl_read_trace_t* trace);
 
+/**
+ * \ingroup litl_read_main
+ * \brief Reads the next event from a trace file in chronological order. Unlike
+ *  litl_read_next_event, which returns all the events of a process before the
+ *  events of the next process, the events of all the processes of an archive
+ *  are merged. The memory used does not depend on the number of events.
+ *  This function should not be mixed with the other reading functions
+ * \param trace A pointer to the trace object
+ */
+litl_read_event_t* litl_read_next_ordered_event(litl_read_trace_t* trace);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Calls a visitor on each event of a trace, using a pool of worker
+ *  threads. Each thread of the trace is visited by a single worker, in the
+ *  order its events were recorded, but there is no global order. Each worker
+ *  has its own state, so that the results can be computed without locks and
+ *  reduced once all the events are visited. The threads of the trace are not
+ *  modified: this function can be called before or after reading the trace
+ * \param trace A pointer to the trace object
+ * \param nb_workers A number of workers. If it is 0, one worker per CPU is
+ *  used and states must be NULL
+ * \param visitor A function called on each event
+ * \param states An array of nb_workers states, one per worker, or NULL
+ * \return 0
+ */
+int litl_read_visit_events(litl_read_trace_t* trace, unsigned nb_workers,
+                           litl_read_visitor_t visitor, void** states);
+
+/**
+ * \ingroup litl_read_init
+ * \brief Only reads the events whose code is between first and last
+ *  (included). It may be called several times: the events whose code is
+ *  within any of the ranges are read. The other events are skipped by all the
+ *  reading functions before being decoded. The filters should be set before
+ *  reading the events
+ * \param trace A pointer to the trace object
+ * \param first The first code of the range
+ * \param last The last code of the range
+ */
+void litl_read_filter_codes(litl_read_trace_t* trace, litl_code_t first,
+                            litl_code_t last);
+
+/**
+ * \ingroup litl_read_init
+ * \brief Only reads the events of a thread. It may be called several times:
+ *  the events of any of the threads are read. The other threads are skipped
+ *  as a whole by litl_read_next_event, litl_read_next_ordered_event,
+ *  litl_read_next_batch and litl_read_visit_events. The filters should be set
+ *  before reading the events
+ * \param trace A pointer to the trace object
+ * \param tid A thread ID
+ */
+void litl_read_filter_tid(litl_read_trace_t* trace, litl_tid_t tid);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Allocates a batch of events, which stores one array per field of the
+ *  events
+ * \param capacity The maximum number of events in the batch
+ * \return A pointer to the batch
+ */
+litl_read_batch_t* litl_read_init_batch(litl_size_t capacity);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Frees a batch of events
+ * \param batch A pointer to the batch
+ */
+void litl_read_finalize_batch(litl_read_batch_t* batch);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Reads the next events of a thread into a batch. The events are
+ *  decoded in place from the buffer of the thread. When the trace is read with
+ *  pread, a batch does not span several buffers, so that it may hold fewer
+ *  events than its capacity. The events after the end of the time window are
+ *  not read
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param thread A pointer to the thread object
+ * \param batch A pointer to the batch
+ * \return The number of events in the batch. 0 when the thread has no events
+ *  left
+ */
+litl_size_t litl_read_next_thread_batch(litl_read_trace_t* trace,
+                                        litl_read_process_t* process,
+                                        litl_read_thread_t* thread,
+                                        litl_read_batch_t* batch);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Reads the next events of a trace into a batch. The threads are read
+ *  one after the other, so that the events are not in chronological order.
+ *  A batch only holds the events of one process (batch->process). This
+ *  function should not be mixed with the other reading functions
+ * \param trace A pointer to the trace object
+ * \param batch A pointer to the batch
+ * \return The number of events in the batch. 0 when the trace has no events
+ *  left
+ */
+litl_size_t litl_read_next_batch(litl_read_trace_t* trace,
+                                 litl_read_batch_t* batch);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Returns the statistics of the events of each thread of a process:
+ *  their number, size and time span. They are read from the trace without
+ *  reading the events. For the traces that were recorded without them, they
+ *  are computed by reading all the events of the process once
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param nb_threads A pointer to the number of threads
+ * \return A pointer to the statistics of the first thread
+ */
+const litl_thread_stats_t* litl_read_get_thread_stats(
+    litl_read_trace_t* trace, litl_read_process_t* process,
+    litl_size_t* nb_threads);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Returns the number and size of the events of a process per code,
+ *  sorted by code. As for litl_read_get_thread_stats, they are read from the
+ *  trace when it holds them
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param nb_codes A pointer to the number of codes
+ * \return A pointer to the statistics of the first code
+ */
+const litl_code_stats_t* litl_read_get_code_stats(litl_read_trace_t* trace,
+                                                  litl_read_process_t* process,
+                                                  litl_size_t* nb_codes);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Returns the number and size of the events of a process with a given
+ *  code
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param code An event code
+ * \return A pointer to the statistics of the code, or NULL if the process
+ *  has no event with this code
+ */
+const litl_code_stats_t* litl_read_find_code_stats(litl_read_trace_t* trace,
+                                                   litl_read_process_t* process,
+                                                   litl_code_t code);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Returns the chunks of events of a thread, sorted by time. The chunk
+ *  index is read from the trace. For the traces that were recorded without
+ *  it, it is built by reading all the events of the process once
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param thread A pointer to the thread object
+ * \param nb_chunks A pointer to the number of chunks
+ * \return A pointer to the first chunk of the thread
+ */
+const litl_chunk_t* litl_read_get_thread_chunks(litl_read_trace_t* trace,
+                                                litl_read_process_t* process,
+                                                litl_read_thread_t* thread,
+                                                litl_size_t* nb_chunks);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Moves a thread to its first event that occurred at or after a given
+ *  time. Thanks to the chunk index, only the events of one chunk are skipped
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process object
+ * \param thread A pointer to the thread object
+ * \param time A time stamp
+ */
+void litl_read_seek_thread_time(litl_read_trace_t* trace,
+                                litl_read_process_t* process,
+                                litl_read_thread_t* thread, litl_time_t time);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Moves all the threads of a trace to their first event that occurred
+ *  at or after a given time. The next call to litl_read_next_event,
+ *  litl_read_next_process_event or litl_read_next_ordered_event returns the
+ *  events from that time on. The end of the time window is not changed
+ * \param trace A pointer to the trace object
+ * \param time A time stamp
+ */
+void litl_read_seek_time(litl_read_trace_t* trace, litl_time_t time);
+
+/**
+ * \ingroup litl_read_main
+ * \brief Restricts the reading of a trace to the events that occurred between
+ *  start and end (included). litl_read_next_event,
+ *  litl_read_next_process_event, litl_read_next_ordered_event, the batches and
+ *  litl_read_visit_events do not return the earlier and the later events
+ * \param trace A pointer to the trace object
+ * \param start The beginning of the time window
+ * \param end The end of the time window, or LITL_MAX_TIME
+ */
+void litl_read_set_time_window(litl_read_trace_t* trace, litl_time_t start,
+                               litl_time_t end);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Returns the schema that was registered for an event code
+ * \param process A pointer to the process object
+ * \param code An event code
+ * \return A pointer to the schema or NULL if the code was not registered
+ */
+litl_event_schema_t* litl_read_get_event_schema(litl_read_process_t* process,
+                                                litl_code_t code);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Decodes the parameters of a packed event according to the schema of
+ *  its code
+ * \param process A pointer to the process object the event belongs to
+ * \param event An event
+ * \param params An array where the decoded parameters are stored
+ * \return The number of parameters or -1 if the event can not be decoded
+ */
+int litl_read_get_typed_params(litl_read_process_t* process,
+                               litl_read_event_t* event,
+                               litl_typed_param_t params[LITL_MAX_PARAMS]);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Returns the module (executable or shared library) that contained a
+ *  code address. Use litl_symbol_resolve() to find the function
+ * \param process A pointer to the process object
+ * \param address A code address
+ * \param time The time the address was recorded, since another module may
+ *  have been loaded at the same address at another time
+ * \return A pointer to the module or NULL if the address is not in any module
+ */
+const litl_module_t* litl_read_find_module(litl_read_process_t* process,
+                                           litl_param_t address,
+                                           litl_time_t time);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Returns the payload of a raw or packed event as a contiguous span of
+ *  bytes, whatever its size. The payload is not copied, so it is only valid
+ *  until the next event of the same thread is read
+ * \param event An event
+ * \param size The size (in Bytes) of the payload
+ * \return A pointer to the payload or NULL if the event has no payload
+ */
+const litl_data_t* litl_read_get_data(litl_read_event_t* event,
+                                      litl_size_t* size);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Returns an interned string
+ * \param process A pointer to the process object
+ * \param id An ID of the string
+ * \return The string or NULL if the ID is unknown
+ */
+const char* litl_read_get_string(litl_read_process_t* process,
+                                 litl_string_id_t id);
+
+/**
+ * \ingroup litl_read_process
+ * \brief Returns the thread of a process that has a given ID. The index of
+ *  the process and the trace_index of the thread locate them in the arrays
+ *  that tools keep per process or per thread
+ * \param process A pointer to the process object
+ * \param tid A thread ID, e.g. LITL_READ_GET_TID(event)
+ * \return A pointer to the thread or NULL if the process has no such thread
+ */
+litl_read_thread_t* litl_read_find_thread(litl_read_process_t* process,
+                                          litl_tid_t tid);
+
 /**
  * \ingroup litl_read_main
  * \brief Closes the trace and frees the allocated memory
@@ -187,7 +494,7 @@ void litl_read_finalize_trace(litl_read_trace_t* trace);
  */
 #define __LITL_READ_GET_ARG_REGULAR(_ptr_, arg) do {	\
     arg = (typeof(arg)) *(litl_param_t*)_ptr_;		\
-    (litl_param_t*)_ptr_++;				\
+    _ptr_ = ((litl_param_t*)_ptr_) + 1;			\
   } while(0)
 
 /*
@@ -217,6 +524,16 @@ void litl_read_finalize_trace(litl_read_trace_t* trace);
 #define LITL_READ_GET_CUR_EVENT(process) \
   LITL_READ_GET_CUR_EVENT_PER_THREAD(process, (process)->cur_index)
 
+/**
+ * \ingroup litl_read_process
+ * \brief Returns the process of the last event returned by
+ *  litl_read_next_event or litl_read_next_ordered_event. For a sorted trace,
+ *  it is the source process that recorded the event, see
+ *  litl_read_trace_t::event_processes
+ * \param trace A pointer to the trace object
+ */
+#define LITL_READ_GET_CUR_PROCESS(trace) (trace)->cur_process
+
 /**
  * \ingroup litl_read_process
  * \brief Returns a thread id of a given event
@@ -0,0 +1,364 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "litl_stats.h"
+#include "litl_pair.h"
+#include "litl_read.h"
+
+#define __LITL_HISTOGRAM_SUB_BUCKETS (1 << LITL_HISTOGRAM_PRECISION)
+
+/*
+ * Returns the bucket of a value: the values below the number of sub-buckets
+ *   are exact, the other ones keep LITL_HISTOGRAM_PRECISION bits after their
+ *   most significant bit
+ */
+static inline unsigned __litl_histogram_bucket(uint64_t value) {
+  unsigned shift;
+
+  if (value < __LITL_HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  shift = 63 - __builtin_clzll(value) - LITL_HISTOGRAM_PRECISION;
+  return ((shift + 1) << LITL_HISTOGRAM_PRECISION)
+    + (unsigned) (value >> shift) - __LITL_HISTOGRAM_SUB_BUCKETS;
+}
+
+/*
+ * Returns the smallest value of a bucket, and its width
+ */
+static inline uint64_t __litl_histogram_bucket_value(unsigned bucket,
+                                                     uint64_t* width) {
+  unsigned shift;
+
+  if (bucket < __LITL_HISTOGRAM_SUB_BUCKETS) {
+    *width = 1;
+    return bucket;
+  }
+
+  shift = (bucket >> LITL_HISTOGRAM_PRECISION) - 1;
+  *width = (uint64_t) 1 << shift;
+  return ((uint64_t) __LITL_HISTOGRAM_SUB_BUCKETS
+    + (bucket & (__LITL_HISTOGRAM_SUB_BUCKETS - 1))) << shift;
+}
+
+/*
+ * Allocates an empty histogram
+ */
+litl_histogram_t* litl_histogram_init() {
+  litl_histogram_t* histogram = calloc(1, sizeof(litl_histogram_t));
+
+  if (!histogram) {
+    perror("Could not allocate memory for a histogram!");
+    exit(EXIT_FAILURE);
+  }
+  histogram->min = UINT64_MAX;
+
+  return histogram;
+}
+
+void litl_histogram_add(litl_histogram_t* histogram, uint64_t value) {
+  histogram->counts[__litl_histogram_bucket(value)]++;
+  histogram->nb_values++;
+  histogram->sum += value;
+  if (value < histogram->min)
+    histogram->min = value;
+  if (value > histogram->max)
+    histogram->max = value;
+}
+
+void litl_histogram_merge(litl_histogram_t* histogram,
+                          const litl_histogram_t* other) {
+  unsigned i;
+
+  if (!other->nb_values)
+    return;
+
+  for (i = 0; i < LITL_HISTOGRAM_NB_BUCKETS; i++)
+    histogram->counts[i] += other->counts[i];
+  histogram->nb_values += other->nb_values;
+  histogram->sum += other->sum;
+  if (other->min < histogram->min)
+    histogram->min = other->min;
+  if (other->max > histogram->max)
+    histogram->max = other->max;
+}
+
+/*
+ * Returns a quantile: the middle of the bucket that holds the value of its
+ *   rank, within the range of the values
+ */
+uint64_t litl_histogram_quantile(const litl_histogram_t* histogram,
+                                 double quantile) {
+  uint64_t rank, nb_values = 0, value, width;
+  unsigned i;
+
+  if (!histogram->nb_values)
+    return 0;
+
+  if (quantile <= 0)
+    return histogram->min;
+  if (quantile >= 1)
+    return histogram->max;
+
+  rank = (uint64_t) (quantile * histogram->nb_values);
+  if (rank < quantile * histogram->nb_values || rank == 0)
+    rank++;
+
+  for (i = 0; i < LITL_HISTOGRAM_NB_BUCKETS; i++) {
+    nb_values += histogram->counts[i];
+    if (nb_values >= rank)
+      break;
+  }
+
+  value = __litl_histogram_bucket_value(i, &width) + width / 2;
+  if (value < histogram->min)
+    return histogram->min;
+  if (value > histogram->max)
+    return histogram->max;
+  return value;
+}
+
+/*
+ * Allocates empty statistics
+ */
+litl_duration_stats_t* litl_stats_init() {
+  litl_duration_stats_t* stats = calloc(1, sizeof(litl_duration_stats_t));
+
+  if (!stats) {
+    perror("Could not allocate memory for the statistics!");
+    exit(EXIT_FAILURE);
+  }
+
+  return stats;
+}
+
+/*
+ * Returns the position of a code in the sorted histograms of the codes
+ */
+static litl_size_t __litl_stats_code_index(const litl_duration_stats_t* stats,
+                                           litl_code_t code) {
+  litl_size_t first = 0, last = stats->nb_codes, middle;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if (stats->codes[middle].code < code)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  return first;
+}
+
+/*
+ * Returns the histogram of a code, which is added if needed
+ */
+static litl_histogram_t* __litl_stats_get_code(litl_duration_stats_t* stats,
+                                               litl_code_t code) {
+  litl_size_t index;
+
+  // the intervals of a thread often have the same code
+  if (stats->cur_code < stats->nb_codes
+      && stats->codes[stats->cur_code].code == code)
+    return stats->codes[stats->cur_code].histogram;
+
+  index = __litl_stats_code_index(stats, code);
+  if (index == stats->nb_codes || stats->codes[index].code != code) {
+    if (stats->nb_codes == stats->nb_allocated_codes) {
+      stats->nb_allocated_codes = stats->nb_allocated_codes ?
+        2 * stats->nb_allocated_codes : 16;
+      stats->codes = realloc(
+          stats->codes,
+          stats->nb_allocated_codes * sizeof(litl_code_histogram_t));
+      if (!stats->codes) {
+        perror("Could not allocate memory for the statistics!");
+        exit(EXIT_FAILURE);
+      }
+    }
+    memmove(&stats->codes[index + 1], &stats->codes[index],
+            (stats->nb_codes - index) * sizeof(litl_code_histogram_t));
+    stats->codes[index].code = code;
+    stats->codes[index].histogram = litl_histogram_init();
+    stats->nb_codes++;
+  }
+
+  stats->cur_code = index;
+  return stats->codes[index].histogram;
+}
+
+/*
+ * Returns the histogram of a thread, which is added if needed
+ */
+static litl_histogram_t* __litl_stats_get_thread(
+    litl_duration_stats_t* stats, litl_med_size_t process_index,
+    litl_tid_t tid) {
+  litl_size_t first = 0, last = stats->nb_threads, middle;
+  litl_thread_histogram_t* thread;
+
+  if (stats->cur_thread < stats->nb_threads) {
+    thread = &stats->threads[stats->cur_thread];
+    if (thread->process_index == process_index && thread->tid == tid)
+      return thread->histogram;
+  }
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    thread = &stats->threads[middle];
+    if (thread->process_index < process_index
+        || (thread->process_index == process_index && thread->tid < tid))
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  if (first == stats->nb_threads
+      || stats->threads[first].process_index != process_index
+      || stats->threads[first].tid != tid) {
+    if (stats->nb_threads == stats->nb_allocated_threads) {
+      stats->nb_allocated_threads = stats->nb_allocated_threads ?
+        2 * stats->nb_allocated_threads : 16;
+      stats->threads = realloc(
+          stats->threads,
+          stats->nb_allocated_threads * sizeof(litl_thread_histogram_t));
+      if (!stats->threads) {
+        perror("Could not allocate memory for the statistics!");
+        exit(EXIT_FAILURE);
+      }
+    }
+    memmove(&stats->threads[first + 1], &stats->threads[first],
+            (stats->nb_threads - first) * sizeof(litl_thread_histogram_t));
+    stats->threads[first].process_index = process_index;
+    stats->threads[first].tid = tid;
+    stats->threads[first].histogram = litl_histogram_init();
+    stats->nb_threads++;
+  }
+
+  stats->cur_thread = first;
+  return stats->threads[first].histogram;
+}
+
+void litl_stats_add_interval(litl_duration_stats_t* stats,
+                             const litl_interval_t* interval) {
+  if (!interval->is_complete) {
+    stats->nb_incomplete++;
+    return;
+  }
+
+  litl_histogram_add(__litl_stats_get_code(stats, interval->code),
+                     interval->duration);
+  litl_histogram_add(
+      __litl_stats_get_thread(stats, interval->process_index, interval->tid),
+      interval->duration);
+}
+
+void litl_stats_merge(litl_duration_stats_t* stats,
+                      const litl_duration_stats_t* other) {
+  litl_size_t i;
+
+  for (i = 0; i < other->nb_codes; i++)
+    litl_histogram_merge(__litl_stats_get_code(stats, other->codes[i].code),
+                         other->codes[i].histogram);
+  for (i = 0; i < other->nb_threads; i++)
+    litl_histogram_merge(
+        __litl_stats_get_thread(stats, other->threads[i].process_index,
+                                other->threads[i].tid),
+        other->threads[i].histogram);
+  stats->nb_incomplete += other->nb_incomplete;
+}
+
+const litl_histogram_t* litl_stats_find_code(
+    const litl_duration_stats_t* stats, litl_code_t code) {
+  litl_size_t index = __litl_stats_code_index(stats, code);
+
+  if (index == stats->nb_codes || stats->codes[index].code != code)
+    return NULL ;
+  return stats->codes[index].histogram;
+}
+
+/*
+ * The state of a worker of litl_stats_trace: the events of its threads are
+ *   paired into its own statistics
+ */
+typedef struct {
+  litl_pair_t* pair;
+  litl_duration_stats_t* stats;
+} __litl_stats_worker_t;
+
+static void __litl_stats_add_interval(const litl_interval_t* interval,
+                                      void* arg) {
+  litl_stats_add_interval((litl_duration_stats_t*) arg, interval);
+}
+
+static void __litl_stats_visit(litl_read_trace_t* trace
+                                 __attribute__ ((__unused__)),
+                               litl_read_process_t* process,
+                               litl_read_event_t* event, void* state) {
+  litl_pair_event(((__litl_stats_worker_t*) state)->pair, process, event);
+}
+
+/*
+ * Computes the statistics of a trace with a pool of workers
+ */
+litl_duration_stats_t* litl_stats_trace(litl_read_trace_t* trace,
+                                        unsigned nb_workers) {
+  __litl_stats_worker_t* workers;
+  litl_duration_stats_t* stats;
+  void** states;
+  unsigned i;
+
+  if (nb_workers == 0) {
+    long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nb_workers = nb_cpus > 0 ? nb_cpus : 1;
+  }
+
+  workers = malloc(nb_workers * sizeof(__litl_stats_worker_t));
+  states = malloc(nb_workers * sizeof(void*));
+  if (!workers || !states) {
+    perror("Could not allocate memory for the workers!");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].stats = litl_stats_init();
+    workers[i].pair = litl_pair_init(trace, __litl_stats_add_interval,
+                                     workers[i].stats);
+    states[i] = &workers[i];
+  }
+
+  litl_read_visit_events(trace, nb_workers, __litl_stats_visit, states);
+
+  // each thread was paired by a single worker, whose entries left are
+  //   closed before the statistics are merged
+  stats = workers[0].stats;
+  for (i = 0; i < nb_workers; i++) {
+    litl_pair_finalize(workers[i].pair);
+    if (i > 0) {
+      litl_stats_merge(stats, workers[i].stats);
+      litl_stats_finalize(workers[i].stats);
+    }
+  }
+
+  free(states);
+  free(workers);
+
+  return stats;
+}
+
+void litl_stats_finalize(litl_duration_stats_t* stats) {
+  litl_size_t i;
+
+  for (i = 0; i < stats->nb_codes; i++)
+    free(stats->codes[i].histogram);
+  for (i = 0; i < stats->nb_threads; i++)
+    free(stats->threads[i].histogram);
+  free(stats->codes);
+  free(stats->threads);
+  free(stats);
+}
@@ -0,0 +1,121 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_STATS_H_
+#define LITL_STATS_H_
+
+/**
+ *  \file litl_stats.h
+ *  \brief litl_stats Provides a set of functions for computing the
+ *  distributions of the durations of the intervals of a trace, as histograms
+ *  that can be merged
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_stats LiTL Statistics Functions
+ */
+
+/**
+ * \ingroup litl_stats
+ * \brief Allocates an empty histogram
+ * \return A pointer to the histogram
+ */
+litl_histogram_t* litl_histogram_init();
+
+/**
+ * \ingroup litl_stats
+ * \brief Adds a value to a histogram
+ * \param histogram A pointer to the histogram
+ * \param value The value
+ */
+void litl_histogram_add(litl_histogram_t* histogram, uint64_t value);
+
+/**
+ * \ingroup litl_stats
+ * \brief Adds the values of a histogram to another one
+ * \param histogram A pointer to the histogram that is updated
+ * \param other A pointer to the histogram whose values are added
+ */
+void litl_histogram_merge(litl_histogram_t* histogram,
+                          const litl_histogram_t* other);
+
+/**
+ * \ingroup litl_stats
+ * \brief Returns a quantile of the values of a histogram. Its relative error
+ *  is below 2^-LITL_HISTOGRAM_PRECISION
+ * \param histogram A pointer to the histogram
+ * \param quantile The quantile, between 0 and 1 (e.g. 0.99 for p99)
+ * \return The value of the quantile, 0 if the histogram is empty
+ */
+uint64_t litl_histogram_quantile(const litl_histogram_t* histogram,
+                                 double quantile);
+
+/**
+ * \ingroup litl_stats
+ * \brief Allocates empty statistics of durations
+ * \return A pointer to the statistics
+ */
+litl_duration_stats_t* litl_stats_init();
+
+/**
+ * \ingroup litl_stats
+ * \brief Adds the duration of an interval to the histograms of its code and
+ *  of its thread. The incomplete intervals are only counted
+ * \param stats A pointer to the statistics
+ * \param interval A pointer to the interval
+ */
+void litl_stats_add_interval(litl_duration_stats_t* stats,
+                             const litl_interval_t* interval);
+
+/**
+ * \ingroup litl_stats
+ * \brief Adds statistics to other ones, e.g. the statistics computed by
+ *  several workers, or for several traces
+ * \param stats A pointer to the statistics that are updated
+ * \param other A pointer to the statistics that are added
+ */
+void litl_stats_merge(litl_duration_stats_t* stats,
+                      const litl_duration_stats_t* other);
+
+/**
+ * \ingroup litl_stats
+ * \brief Returns the histogram of the durations of an entry code
+ * \param stats A pointer to the statistics
+ * \param code A code of the entry events
+ * \return A pointer to the histogram, or NULL if the code has no interval
+ */
+const litl_histogram_t* litl_stats_find_code(
+    const litl_duration_stats_t* stats, litl_code_t code);
+
+/**
+ * \ingroup litl_stats
+ * \brief Computes the statistics of the durations of the intervals of a
+ *  trace in a single pass. The threads of the trace are shared among a pool
+ *  of workers, which pair the events of their threads with litl_pair; their
+ *  statistics are merged at the end
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param nb_workers A number of workers. If it is 0, one worker per CPU is
+ *  used
+ * \return A pointer to the statistics
+ */
+litl_duration_stats_t* litl_stats_trace(litl_read_trace_t* trace,
+                                        unsigned nb_workers);
+
+/**
+ * \ingroup litl_stats
+ * \brief Frees statistics of durations
+ * \param stats A pointer to the statistics
+ */
+void litl_stats_finalize(litl_duration_stats_t* stats);
+
+#endif /* LITL_STATS_H_ */
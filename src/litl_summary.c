@@ -0,0 +1,468 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "litl_summary.h"
+#include "litl_pair.h"
+#include "litl_read.h"
+
+/*
+ * The summary being built: the buckets of the finest level of each thread,
+ *   indexed by the trace_index of the thread. Each thread is filled by a
+ *   single worker
+ */
+typedef struct {
+  litl_summary_header_t header;
+  litl_summary_thread_t* threads;
+  litl_summary_bucket_t** buckets;
+  litl_size_t nb_buckets;
+} __litl_summary_builder_t;
+
+/*
+ * The state of a worker of litl_summary_build
+ */
+typedef struct {
+  __litl_summary_builder_t* builder;
+  litl_pair_t* pair;
+  uint64_t nb_events;
+} __litl_summary_worker_t;
+
+/*
+ * Returns the number of buckets of each thread at a level
+ */
+static litl_size_t __litl_summary_nb_buckets(const litl_summary_header_t* header,
+                                             unsigned level) {
+  if (header->shift + level >= 64)
+    return 1;
+  return ((header->end_time - header->start_time) >> (header->shift + level))
+    + 1;
+}
+
+/*
+ * Returns the bucket of the finest level that holds a time
+ */
+static litl_size_t __litl_summary_bucket(const __litl_summary_builder_t* builder,
+                                         litl_time_t time) {
+  litl_size_t bucket;
+
+  if (time <= builder->header.start_time)
+    return 0;
+  bucket = (time - builder->header.start_time) >> builder->header.shift;
+  return bucket < builder->nb_buckets ? bucket : builder->nb_buckets - 1;
+}
+
+/*
+ * Adds the busy time of an outermost interval to the buckets it overlaps
+ */
+static void __litl_summary_add_interval(const litl_interval_t* interval,
+                                        void* arg) {
+  __litl_summary_worker_t* worker = (__litl_summary_worker_t*) arg;
+  __litl_summary_builder_t* builder = worker->builder;
+  litl_summary_bucket_t* buckets;
+  litl_time_t start, end, bucket_end;
+  litl_size_t bucket;
+
+  if (interval->depth > 0 || interval->duration == 0)
+    return;
+
+  buckets = builder->buckets[worker->pair->trace->event_processes[
+      interval->process_index]->threads[interval->thread_index]->trace_index];
+  start = interval->start;
+  end = interval->start + interval->duration;
+  for (bucket = __litl_summary_bucket(builder, start); start < end;
+      bucket++) {
+    bucket_end = builder->header.start_time
+      + ((litl_time_t) (bucket + 1) << builder->header.shift);
+    if (bucket == builder->nb_buckets - 1 || bucket_end > end)
+      bucket_end = end;
+    buckets[bucket].busy_time += bucket_end - start;
+    start = bucket_end;
+  }
+}
+
+static void __litl_summary_visit(litl_read_trace_t* trace
+                                   __attribute__ ((__unused__)),
+                                 litl_read_process_t* process,
+                                 litl_read_event_t* event, void* state) {
+  __litl_summary_worker_t* worker = (__litl_summary_worker_t*) state;
+  __litl_summary_builder_t* builder = worker->builder;
+  litl_read_thread_t* thread;
+
+  if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+    return;
+
+  thread = litl_read_find_thread(process, LITL_READ_GET_TID(event));
+  if (!thread)
+    return;
+
+  builder->buckets[thread->trace_index][__litl_summary_bucket(
+      builder, LITL_READ_GET_TIME(event))].nb_events++;
+  worker->nb_events++;
+
+  litl_pair_event(worker->pair, process, event);
+}
+
+/*
+ * Writes a whole buffer at an offset of the file
+ */
+static void __litl_summary_pwrite(int f_handle, const void* buffer,
+                                  size_t size, off_t offset) {
+  ssize_t res;
+
+  while (size > 0) {
+    res = pwrite(f_handle, buffer, size, offset);
+    if (res == -1) {
+      perror("Could not write the summary file!");
+      exit(EXIT_FAILURE);
+    }
+    buffer = (const uint8_t*) buffer + res;
+    size -= res;
+    offset += res;
+  }
+}
+
+/*
+ * Finds the threads of a trace and its time span, and allocates the buckets
+ *   of the finest level
+ */
+static void __litl_summary_init_builder(__litl_summary_builder_t* builder,
+                                        litl_read_trace_t* trace) {
+  const litl_thread_stats_t* thread_stats;
+  litl_read_process_t* process;
+  litl_read_thread_t* thread;
+  litl_med_size_t process_index, thread_index;
+  litl_size_t i, nb_stats, nb_threads = trace->nb_threads,
+    max_buckets = LITL_SUMMARY_NB_BUCKETS;
+  litl_time_t start_time = LITL_MAX_TIME, end_time = 0;
+  char* str;
+
+  str = getenv("LITL_SUMMARY_NB_BUCKETS");
+  if (str && atol(str) > 0)
+    max_buckets = atol(str);
+
+  builder->threads = malloc(
+      (nb_threads ? nb_threads : 1) * sizeof(litl_summary_thread_t));
+  builder->buckets = malloc(
+      (nb_threads ? nb_threads : 1) * sizeof(litl_summary_bucket_t*));
+  if (!builder->threads || !builder->buckets) {
+    perror("Could not allocate memory for the summary!");
+    exit(EXIT_FAILURE);
+  }
+
+  // the threads of the trace are numbered by process and tid, as the
+  //   threads of the summary are sorted
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++) {
+    process = trace->event_processes[process_index];
+    for (thread_index = 0; thread_index < process->nb_threads;
+        thread_index++) {
+      thread = process->threads[thread_index];
+      builder->threads[thread->trace_index].process_index = process_index;
+      builder->threads[thread->trace_index].thread_index = thread_index;
+      builder->threads[thread->trace_index].tid = thread->thread_pair->tid;
+    }
+
+    // the time span is known from the statistics of the threads, without
+    //   reading the events
+    thread_stats = litl_read_get_thread_stats(trace, process, &nb_stats);
+    for (i = 0; i < nb_stats; i++) {
+      if (!thread_stats[i].nb_events)
+        continue;
+      if (thread_stats[i].first_time < start_time)
+        start_time = thread_stats[i].first_time;
+      if (thread_stats[i].last_time > end_time)
+        end_time = thread_stats[i].last_time;
+    }
+  }
+
+  if (start_time > end_time)
+    start_time = end_time = 0;
+
+  memset(&builder->header, 0, sizeof(litl_summary_header_t));
+  strcpy(builder->header.magic, LITL_SUMMARY_MAGIC);
+  builder->header.version = LITL_SUMMARY_VERSION;
+  builder->header.nb_threads = nb_threads;
+  builder->header.start_time = start_time;
+  builder->header.end_time = end_time;
+
+  // the finest level has at most max_buckets buckets, and each level halves
+  //   the number of buckets of the previous one
+  while (__litl_summary_nb_buckets(&builder->header, 0) > max_buckets)
+    builder->header.shift++;
+  builder->nb_buckets = __litl_summary_nb_buckets(&builder->header, 0);
+  builder->header.nb_levels = 1;
+  while (__litl_summary_nb_buckets(&builder->header,
+                                   builder->header.nb_levels - 1) > 1)
+    builder->header.nb_levels++;
+
+  for (i = 0; i < nb_threads; i++) {
+    builder->buckets[i] = calloc(builder->nb_buckets,
+                                 sizeof(litl_summary_bucket_t));
+    if (!builder->buckets[i]) {
+      perror("Could not allocate memory for the summary!");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/*
+ * Writes the levels of the summary: the buckets of each level are merged in
+ *   place by pairs to make the next one
+ */
+static void __litl_summary_write(__litl_summary_builder_t* builder,
+                                 const char* filename) {
+  litl_summary_header_t* header = &builder->header;
+  litl_summary_bucket_t* buckets;
+  litl_size_t thread, bucket, nb_buckets, next_nb_buckets;
+  unsigned level;
+  off_t offset;
+  int f_handle;
+
+  if ((f_handle = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  __litl_summary_pwrite(f_handle, header, sizeof(litl_summary_header_t), 0);
+  offset = sizeof(litl_summary_header_t);
+  __litl_summary_pwrite(f_handle, builder->threads,
+                        header->nb_threads * sizeof(litl_summary_thread_t),
+                        offset);
+  offset += header->nb_threads * sizeof(litl_summary_thread_t);
+
+  for (level = 0; level < header->nb_levels; level++) {
+    nb_buckets = __litl_summary_nb_buckets(header, level);
+    next_nb_buckets = __litl_summary_nb_buckets(header, level + 1);
+
+    for (thread = 0; thread < header->nb_threads; thread++) {
+      buckets = builder->buckets[thread];
+      __litl_summary_pwrite(f_handle, buckets,
+                            nb_buckets * sizeof(litl_summary_bucket_t),
+                            offset);
+      offset += nb_buckets * sizeof(litl_summary_bucket_t);
+
+      for (bucket = 0; bucket < next_nb_buckets; bucket++) {
+        buckets[bucket] = buckets[2 * bucket];
+        if (2 * bucket + 1 < nb_buckets) {
+          buckets[bucket].nb_events += buckets[2 * bucket + 1].nb_events;
+          buckets[bucket].busy_time += buckets[2 * bucket + 1].busy_time;
+        }
+      }
+    }
+  }
+
+  close(f_handle);
+}
+
+/*
+ * Builds the summary of a trace with a pool of workers
+ */
+uint64_t litl_summary_build(litl_read_trace_t* trace, const char* filename,
+                            unsigned nb_workers) {
+  __litl_summary_builder_t builder;
+  __litl_summary_worker_t* workers;
+  void** states;
+  uint64_t nb_events = 0;
+  litl_size_t i;
+
+  if (nb_workers == 0) {
+    long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nb_workers = nb_cpus > 0 ? nb_cpus : 1;
+  }
+
+  __litl_summary_init_builder(&builder, trace);
+
+  workers = calloc(nb_workers, sizeof(__litl_summary_worker_t));
+  states = malloc(nb_workers * sizeof(void*));
+  if (!workers || !states) {
+    perror("Could not allocate memory for the workers!");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].builder = &builder;
+    workers[i].pair = litl_pair_init(trace, __litl_summary_add_interval,
+                                     &workers[i]);
+    states[i] = &workers[i];
+  }
+
+  litl_read_visit_events(trace, nb_workers, __litl_summary_visit, states);
+
+  // the intervals left end at the last event of their thread
+  for (i = 0; i < nb_workers; i++) {
+    litl_pair_finalize(workers[i].pair);
+    nb_events += workers[i].nb_events;
+  }
+
+  __litl_summary_write(&builder, filename);
+
+  for (i = 0; i < builder.header.nb_threads; i++)
+    free(builder.buckets[i]);
+  free(builder.buckets);
+  free(builder.threads);
+  free(states);
+  free(workers);
+
+  return nb_events;
+}
+
+/*
+ * Maps a summary file and finds its levels
+ */
+litl_summary_t* litl_summary_open(const char* filename) {
+  litl_summary_t* summary;
+  litl_buffer_t position;
+  struct stat st;
+  litl_size_t size;
+  unsigned level;
+
+  summary = malloc(sizeof(litl_summary_t));
+  if (!summary) {
+    perror("Could not allocate memory for the summary!");
+    exit(EXIT_FAILURE);
+  }
+
+  if ((summary->f_handle = open(filename, O_RDONLY)) < 0) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  if (fstat(summary->f_handle, &st) != 0
+      || (size_t) st.st_size < sizeof(litl_summary_header_t)) {
+    fprintf(stderr, "%s is not a summary file\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  summary->map_size = st.st_size;
+  summary->map = mmap(NULL, summary->map_size, PROT_READ, MAP_SHARED,
+                      summary->f_handle, 0);
+  if (summary->map == MAP_FAILED) {
+    perror("Could not map the summary file!");
+    exit(EXIT_FAILURE);
+  }
+
+  summary->header = (litl_summary_header_t*) summary->map;
+  if (strcmp(summary->header->magic, LITL_SUMMARY_MAGIC) != 0
+      || summary->header->version != LITL_SUMMARY_VERSION) {
+    fprintf(stderr, "%s is not a summary file of this version of LiTL\n",
+            filename);
+    exit(EXIT_FAILURE);
+  }
+
+  position = summary->map + sizeof(litl_summary_header_t);
+  summary->threads = (litl_summary_thread_t*) position;
+  position += summary->header->nb_threads * sizeof(litl_summary_thread_t);
+
+  summary->levels = malloc(
+      summary->header->nb_levels * sizeof(litl_summary_bucket_t*));
+  if (!summary->levels) {
+    perror("Could not allocate memory for the summary!");
+    exit(EXIT_FAILURE);
+  }
+  for (level = 0; level < summary->header->nb_levels; level++) {
+    summary->levels[level] = (litl_summary_bucket_t*) position;
+    size = summary->header->nb_threads
+      * __litl_summary_nb_buckets(summary->header, level)
+      * sizeof(litl_summary_bucket_t);
+    position += size;
+  }
+
+  if (position > summary->map + summary->map_size) {
+    fprintf(stderr, "The summary file %s is truncated\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  return summary;
+}
+
+unsigned litl_summary_find_level(const litl_summary_t* summary,
+                                 litl_time_t width) {
+  unsigned level = 0;
+
+  while (level + 1 < summary->header->nb_levels
+      && summary->header->shift + level + 1 < 64
+      && ((litl_time_t) 1 << (summary->header->shift + level + 1)) <= width)
+    level++;
+
+  return level;
+}
+
+const litl_summary_bucket_t* litl_summary_get_buckets(
+    const litl_summary_t* summary, unsigned level, litl_size_t thread,
+    litl_size_t* nb_buckets) {
+  *nb_buckets = __litl_summary_nb_buckets(summary->header, level);
+  return summary->levels[level] + thread * *nb_buckets;
+}
+
+/*
+ * Renders a thread: each bucket of the level that overlaps the time window
+ *   is spread over its pixels
+ */
+void litl_summary_render(const litl_summary_t* summary, litl_size_t thread,
+                         litl_time_t start, litl_time_t end,
+                         litl_size_t nb_pixels, litl_summary_bucket_t* pixels) {
+  const litl_summary_bucket_t* buckets;
+  litl_size_t nb_buckets, bucket, last_bucket, pixel;
+  litl_time_t bucket_start, bucket_end, width, overlap_start, overlap_end,
+      pixel_end;
+  double pixel_width;
+  unsigned level;
+
+  memset(pixels, 0, nb_pixels * sizeof(litl_summary_bucket_t));
+  if (start < summary->header->start_time)
+    start = summary->header->start_time;
+  if (end > summary->header->end_time + 1)
+    end = summary->header->end_time + 1;
+  if (nb_pixels == 0 || start >= end)
+    return;
+
+  pixel_width = (double) (end - start) / nb_pixels;
+  level = litl_summary_find_level(summary, (litl_time_t) pixel_width);
+  buckets = litl_summary_get_buckets(summary, level, thread, &nb_buckets);
+  width = summary->header->shift + level < 64 ?
+    (litl_time_t) 1 << (summary->header->shift + level) : LITL_MAX_TIME;
+
+  bucket = (start - summary->header->start_time) / width;
+  last_bucket = (end - 1 - summary->header->start_time) / width;
+  for (; bucket <= last_bucket && bucket < nb_buckets; bucket++) {
+    if (!buckets[bucket].nb_events && !buckets[bucket].busy_time)
+      continue;
+
+    bucket_start = summary->header->start_time + bucket * width;
+    bucket_end = bucket == nb_buckets - 1 ?
+      summary->header->end_time + 1 : bucket_start + width;
+    overlap_start = bucket_start > start ? bucket_start : start;
+    overlap_end = bucket_end < end ? bucket_end : end;
+
+    pixel = (overlap_start - start) / pixel_width;
+    if (pixel >= nb_pixels)
+      pixel = nb_pixels - 1;
+    pixels[pixel].nb_events += buckets[bucket].nb_events;
+
+    // the busy time is shared in proportion to the overlap of each pixel
+    while (overlap_start < overlap_end && pixel < nb_pixels) {
+      pixel_end = pixel == nb_pixels - 1 ?
+        end : start + (litl_time_t) ((pixel + 1) * pixel_width);
+      if (pixel_end > overlap_end)
+        pixel_end = overlap_end;
+      pixels[pixel].busy_time += (litl_time_t) ((double) buckets[bucket]
+          .busy_time * (pixel_end - overlap_start) / (bucket_end - bucket_start));
+      overlap_start = pixel_end;
+      pixel++;
+    }
+  }
+}
+
+void litl_summary_close(litl_summary_t* summary) {
+  munmap(summary->map, summary->map_size);
+  close(summary->f_handle);
+  free(summary->levels);
+  free(summary);
+}
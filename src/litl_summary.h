@@ -0,0 +1,103 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_SUMMARY_H_
+#define LITL_SUMMARY_H_
+
+/**
+ *  \file litl_summary.h
+ *  \brief litl_summary Provides a set of functions for building and reading
+ *  the timeline summaries of traces: the number of events and the busy time
+ *  of each thread per time bucket, at power-of-two resolutions. A zoomed-out
+ *  view of a trace is then rendered from its summary in a time that depends
+ *  on the number of pixels rather than on the number of events
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_summary LiTL Timeline Summary Functions
+ */
+
+/**
+ * \ingroup litl_summary
+ * \brief Builds the summary of a trace in a single pass and writes it to a
+ *  file, usually next to the trace (e.g. trace.summary). The threads of the
+ *  trace are shared among a pool of workers. The busy time of a thread is the
+ *  time spent within its outermost intervals, as paired by litl_pair
+ * \param trace A pointer to the trace object, whose processes are initialized
+ * \param filename A name of the summary file
+ * \param nb_workers A number of workers. If it is 0, one worker per CPU is
+ *  used
+ * \return The number of events of the trace
+ */
+uint64_t litl_summary_build(litl_read_trace_t* trace, const char* filename,
+                            unsigned nb_workers);
+
+/**
+ * \ingroup litl_summary
+ * \brief Opens a summary file. It is mapped in memory, so that only the
+ *  buckets that are rendered are read
+ * \param filename A name of the summary file
+ * \return A pointer to the summary
+ */
+litl_summary_t* litl_summary_open(const char* filename);
+
+/**
+ * \ingroup litl_summary
+ * \brief Returns the coarsest level whose buckets are not wider than a given
+ *  time, or the finest level when all of them are wider
+ * \param summary A pointer to the summary
+ * \param width A time, e.g. the time covered by a pixel
+ * \return The level
+ */
+unsigned litl_summary_find_level(const litl_summary_t* summary,
+                                 litl_time_t width);
+
+/**
+ * \ingroup litl_summary
+ * \brief Returns the buckets of a thread at a given level
+ * \param summary A pointer to the summary
+ * \param level A level, 0 being the finest one
+ * \param thread An index of the thread in the summary
+ * \param nb_buckets A pointer to the number of buckets
+ * \return A pointer to the first bucket, which starts at the start time of
+ *  the summary
+ */
+const litl_summary_bucket_t* litl_summary_get_buckets(
+    const litl_summary_t* summary, unsigned level, litl_size_t thread,
+    litl_size_t* nb_buckets);
+
+/**
+ * \ingroup litl_summary
+ * \brief Renders the activity of a thread during a time window into pixels.
+ *  Only the buckets of the level that matches the width of the pixels are
+ *  read. The busy time of a bucket is shared among the pixels it overlaps,
+ *  and its events are counted in the pixel where it starts
+ * \param summary A pointer to the summary
+ * \param thread An index of the thread in the summary
+ * \param start The beginning of the time window
+ * \param end The end of the time window (excluded)
+ * \param nb_pixels A number of pixels
+ * \param pixels An array of nb_pixels buckets, which is filled
+ */
+void litl_summary_render(const litl_summary_t* summary, litl_size_t thread,
+                         litl_time_t start, litl_time_t end,
+                         litl_size_t nb_pixels, litl_summary_bucket_t* pixels);
+
+/**
+ * \ingroup litl_summary
+ * \brief Closes a summary file
+ * \param summary A pointer to the summary
+ */
+void litl_summary_close(litl_summary_t* summary);
+
+#endif /* LITL_SUMMARY_H_ */
@@ -0,0 +1,295 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "litl_read.h"
+#include "litl_symbol.h"
+
+/*
+ * Initializes the symbolization of the code addresses of a process
+ */
+litl_symbolizer_t* litl_symbol_init(litl_read_process_t* process) {
+  litl_symbolizer_t* symbolizer = malloc(sizeof(litl_symbolizer_t));
+  if (!symbolizer) {
+    perror("Could not allocate memory for the symbolizer!");
+    exit(EXIT_FAILURE);
+  }
+
+  symbolizer->process = process;
+  symbolizer->tables = calloc(process->nb_modules ? process->nb_modules : 1,
+                              sizeof(litl_symbol_table_t));
+  if (!symbolizer->tables) {
+    perror("Could not allocate memory for the symbol tables!");
+    exit(EXIT_FAILURE);
+  }
+
+  return symbolizer;
+}
+
+/*
+ * Maps an ELF file in memory. Returns NULL if the file is not a valid ELF file
+ */
+static ElfW(Ehdr)* __litl_symbol_map_file(const char* path, size_t* size) {
+  struct stat st;
+  ElfW(Ehdr)* ehdr;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) < 0)
+    return NULL ;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ElfW(Ehdr))) {
+    close(fd);
+    return NULL ;
+  }
+
+  *size = st.st_size;
+  ehdr = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ehdr == MAP_FAILED)
+    return NULL ;
+
+  // only the ELF files of the native class can be read
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0
+      || ehdr->e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 :
+                                     ELFCLASS32)
+      || ehdr->e_shentsize != sizeof(ElfW(Shdr))
+      || ehdr->e_shoff + ehdr->e_shnum * sizeof(ElfW(Shdr)) > *size) {
+    munmap(ehdr, *size);
+    return NULL ;
+  }
+
+  return ehdr;
+}
+
+/*
+ * Returns the section headers of an ELF file
+ */
+static ElfW(Shdr)* __litl_symbol_get_sections(ElfW(Ehdr)* ehdr) {
+  return (ElfW(Shdr)*) ((char*) ehdr + ehdr->e_shoff);
+}
+
+/*
+ * Checks whether the build-id of an ELF file matches the build-id of a module.
+ *   Modules without build-id match any file
+ */
+static int __litl_symbol_check_build_id(ElfW(Ehdr)* ehdr, size_t size,
+                                        const litl_module_t* module) {
+  ElfW(Shdr)* shdr = __litl_symbol_get_sections(ehdr);
+  ElfW(Half) i;
+
+  if (!module->build_id_size)
+    return 1;
+
+  for (i = 0; i < ehdr->e_shnum; i++) {
+    if (shdr[i].sh_type != SHT_NOTE || shdr[i].sh_offset + shdr[i].sh_size > size)
+      continue;
+
+    const char* note = (const char*) ehdr + shdr[i].sh_offset;
+    const char* end = note + shdr[i].sh_size;
+    while (note + sizeof(ElfW(Nhdr)) <= end) {
+      const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr)*) note;
+      const char* name = note + sizeof(ElfW(Nhdr));
+      const char* desc = name + ((nhdr->n_namesz + 3) & ~3);
+
+      if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4
+          && memcmp(name, "GNU", 4) == 0)
+        return desc + module->build_id_size <= end
+          && memcmp(desc, module->build_id, module->build_id_size) == 0;
+      note = desc + ((nhdr->n_descsz + 3) & ~3);
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Compares two symbols by address
+ */
+static int __litl_symbol_compare(const void* a, const void* b) {
+  const litl_elf_symbol_t* s1 = a;
+  const litl_elf_symbol_t* s2 = b;
+
+  if (s1->address < s2->address)
+    return -1;
+  return s1->address > s2->address;
+}
+
+/*
+ * Reads the functions of the symbol table of a given type (.symtab or .dynsym)
+ */
+static void __litl_symbol_read_symbols(litl_symbol_table_t* table,
+                                       ElfW(Ehdr)* ehdr, size_t size,
+                                       ElfW(Word) type) {
+  ElfW(Shdr)* shdr = __litl_symbol_get_sections(ehdr);
+  ElfW(Half) i;
+  size_t j;
+
+  for (i = 0; i < ehdr->e_shnum; i++) {
+    if (shdr[i].sh_type != type || shdr[i].sh_link >= ehdr->e_shnum
+        || shdr[i].sh_offset + shdr[i].sh_size > size)
+      continue;
+
+    ElfW(Shdr)* strtab = &shdr[shdr[i].sh_link];
+    if (strtab->sh_offset + strtab->sh_size > size)
+      continue;
+
+    ElfW(Sym)* syms = (ElfW(Sym)*) ((char*) ehdr + shdr[i].sh_offset);
+    size_t nb_syms = shdr[i].sh_size / sizeof(ElfW(Sym));
+    const char* names = (const char*) ehdr + strtab->sh_offset;
+
+    table->symbols = realloc(table->symbols,
+                             (table->nb_symbols + nb_syms)
+                             * sizeof(litl_elf_symbol_t));
+    if (!table->symbols) {
+      perror("Could not allocate memory for the symbols!");
+      exit(EXIT_FAILURE);
+    }
+
+    for (j = 0; j < nb_syms; j++) {
+      if ((ELF64_ST_TYPE(syms[j].st_info) != STT_FUNC
+           && ELF64_ST_TYPE(syms[j].st_info) != STT_GNU_IFUNC)
+          || syms[j].st_shndx == SHN_UNDEF || syms[j].st_name >= strtab->sh_size)
+        continue;
+
+      litl_elf_symbol_t* symbol = &table->symbols[table->nb_symbols++];
+      symbol->address = syms[j].st_value;
+      symbol->size = syms[j].st_size;
+      symbol->name = names + syms[j].st_name;
+    }
+  }
+}
+
+/*
+ * Loads the symbol table of a module from an ELF file. Returns 0 in case of
+ *   success
+ */
+static int __litl_symbol_load_file(litl_symbol_table_t* table,
+                                   const litl_module_t* module,
+                                   const char* path) {
+  size_t size;
+  ElfW(Ehdr)* ehdr = __litl_symbol_map_file(path, &size);
+
+  if (!ehdr)
+    return -1;
+
+  if (__litl_symbol_check_build_id(ehdr, size, module)) {
+    // the .symtab section contains all the functions, but it is usually
+    //   stripped. The .dynsym section only contains the exported functions
+    __litl_symbol_read_symbols(table, ehdr, size, SHT_SYMTAB);
+    if (!table->nb_symbols)
+      __litl_symbol_read_symbols(table, ehdr, size, SHT_DYNSYM);
+  }
+
+  if (!table->nb_symbols) {
+    munmap(ehdr, size);
+    return -1;
+  }
+
+  qsort(table->symbols, table->nb_symbols, sizeof(litl_elf_symbol_t),
+        __litl_symbol_compare);
+  table->file = ehdr;
+  table->file_size = size;
+
+  return 0;
+}
+
+/*
+ * Loads the symbol table of a module. The separate debug file, which is found
+ *   from the build-id, is preferred to the module itself
+ */
+static void __litl_symbol_load_table(litl_symbol_table_t* table,
+                                     const litl_module_t* module) {
+  char path[LITL_MODULE_PATH_SIZE + 64];
+  litl_data_t i;
+  int len;
+
+  table->is_loaded = 1;
+
+  if (module->build_id_size > 1) {
+    len = sprintf(path, "/usr/lib/debug/.build-id/%02x/",
+                  module->build_id[0]);
+    for (i = 1; i < module->build_id_size; i++)
+      len += sprintf(path + len, "%02x", module->build_id[i]);
+    strcpy(path + len, ".debug");
+
+    if (__litl_symbol_load_file(table, module, path) == 0)
+      return;
+  }
+
+  __litl_symbol_load_file(table, module, (const char*) module->path);
+}
+
+/*
+ * Maps a code address to a module and a function
+ */
+int litl_symbol_resolve(litl_symbolizer_t* symbolizer, litl_param_t address,
+                        litl_time_t time, litl_symbol_t* symbol) {
+  const litl_module_t* module;
+  litl_symbol_table_t* table;
+  litl_size_t first, last;
+
+  symbol->module = NULL;
+  symbol->offset = address;
+  symbol->name = NULL;
+  symbol->name_offset = 0;
+
+  module = litl_read_find_module(symbolizer->process, address, time);
+  if (!module)
+    return -1;
+
+  symbol->module = module;
+  symbol->offset = address - module->base;
+
+  table = &symbolizer->tables[module - symbolizer->process->modules];
+  if (!table->is_loaded)
+    __litl_symbol_load_table(table, module);
+  if (!table->nb_symbols || table->symbols[0].address > symbol->offset)
+    return 0;
+
+  // find the last symbol that starts before the address
+  first = 0;
+  last = table->nb_symbols - 1;
+  while (first < last) {
+    litl_size_t middle = first + (last - first + 1) / 2;
+    if (table->symbols[middle].address <= symbol->offset)
+      first = middle;
+    else
+      last = middle - 1;
+  }
+
+  // symbols without size are assumed to extend to the next symbol
+  litl_elf_symbol_t* p_symbol = &table->symbols[first];
+  if (p_symbol->size == 0
+      || symbol->offset < p_symbol->address + p_symbol->size) {
+    symbol->name = p_symbol->name;
+    symbol->name_offset = symbol->offset - p_symbol->address;
+  }
+
+  return 0;
+}
+
+/*
+ * Frees the symbolizer and the symbol tables
+ */
+void litl_symbol_finalize(litl_symbolizer_t* symbolizer) {
+  litl_size_t i;
+
+  for (i = 0; i < symbolizer->process->nb_modules; i++) {
+    if (symbolizer->tables[i].file)
+      munmap(symbolizer->tables[i].file, symbolizer->tables[i].file_size);
+    free(symbolizer->tables[i].symbols);
+  }
+  free(symbolizer->tables);
+  free(symbolizer);
+}
@@ -0,0 +1,58 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+#ifndef LITL_SYMBOL_H_
+#define LITL_SYMBOL_H_
+
+/**
+ *  \file litl_symbol.h
+ *  \brief litl_symbol Provides a set of functions for mapping the code
+ *  addresses recorded in a trace to modules and functions
+ *
+ *  \authors
+ *    Developers are : \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#include "litl_types.h"
+
+/**
+ * \defgroup litl_symbol LiTL Symbolization Functions
+ */
+
+/**
+ * \ingroup litl_symbol
+ * \brief Initializes the symbolization of the code addresses of a process.
+ *  The symbol tables of the modules are loaded lazily from their ELF files
+ *  (or from their separate debug files, if any). A file whose build-id does
+ *  not match the recorded one is ignored
+ * \param process A pointer to the process object
+ * \return A pointer to the symbolizer
+ */
+litl_symbolizer_t* litl_symbol_init(litl_read_process_t* process);
+
+/**
+ * \ingroup litl_symbol
+ * \brief Maps a code address to a module and, if the symbol table of the
+ *  module is available, to a function
+ * \param symbolizer A pointer to the symbolizer
+ * \param address A code address
+ * \param time The time the address was recorded
+ * \param symbol The symbolized address
+ * \return 0 if the address was found in a module, -1 otherwise
+ */
+int litl_symbol_resolve(litl_symbolizer_t* symbolizer, litl_param_t address,
+                        litl_time_t time, litl_symbol_t* symbol);
+
+/**
+ * \ingroup litl_symbol
+ * \brief Frees the symbolizer and the symbol tables
+ * \param symbolizer A pointer to the symbolizer
+ */
+void litl_symbol_finalize(litl_symbolizer_t* symbolizer);
+
+#endif /* LITL_SYMBOL_H_ */
@@ -4,9 +4,11 @@
  * See COPYING in top-level directory.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <math.h>
+#include <string.h>
 
 #include "litl_tools.h"
 #include "litl_write.h"
@@ -56,3 +58,121 @@ litl_size_t __litl_get_gen_event_size(litl_t *p_evt) {
 
   return 0;
 }
+
+/*
+ * Returns the size in bytes of a parameter of a given type
+ */
+litl_size_t __litl_get_param_type_size(litl_param_type_t type) {
+  switch (type) {
+  case LITL_PARAM_UINT8:
+  case LITL_PARAM_INT8:
+    return 1;
+  case LITL_PARAM_UINT16:
+  case LITL_PARAM_INT16:
+    return 2;
+  case LITL_PARAM_UINT32:
+  case LITL_PARAM_INT32:
+  case LITL_PARAM_FLOAT:
+  case LITL_PARAM_STRING:
+    return 4;
+  case LITL_PARAM_UINT64:
+  case LITL_PARAM_INT64:
+  case LITL_PARAM_DOUBLE:
+  case LITL_PARAM_POINTER:
+  case LITL_PARAM_ADDRESS:
+    return 8;
+  default:
+    fprintf(stderr, "Unknown parameter type %d!\n", type);
+    abort();
+  }
+
+  return 0;
+}
+
+/*
+ * Each code sets two bits of the Bloom filter of a chunk, which are taken
+ *   from a multiplicative hash of the code
+ */
+#define __LITL_CHUNK_CODES_BITS (LITL_CHUNK_CODES_SIZE * 8)
+#define __LITL_CHUNK_HASH(code) ((uint32_t) (code) * 0x9E3779B1u)
+#define __LITL_CHUNK_BIT_1(hash) ((hash) >> 25 & (__LITL_CHUNK_CODES_BITS - 1))
+#define __LITL_CHUNK_BIT_2(hash) ((hash) >> 18 & (__LITL_CHUNK_CODES_BITS - 1))
+
+void __litl_chunk_init_codes(litl_chunk_t* chunk) {
+  chunk->min_code = (litl_code_t) -1;
+  chunk->max_code = 0;
+  memset(chunk->codes, 0, LITL_CHUNK_CODES_SIZE);
+}
+
+void __litl_chunk_add_code(litl_chunk_t* chunk, litl_code_t code) {
+  uint32_t hash = __LITL_CHUNK_HASH(code);
+
+  if (code < chunk->min_code)
+    chunk->min_code = code;
+  if (code > chunk->max_code)
+    chunk->max_code = code;
+  chunk->codes[__LITL_CHUNK_BIT_1(hash) / 8] |= 1 << __LITL_CHUNK_BIT_1(hash) % 8;
+  chunk->codes[__LITL_CHUNK_BIT_2(hash) / 8] |= 1 << __LITL_CHUNK_BIT_2(hash) % 8;
+}
+
+int __litl_chunk_may_hold_codes(const litl_chunk_t* chunk, litl_code_t first,
+                                litl_code_t last) {
+  litl_code_t code;
+  uint32_t hash;
+
+  if (first < chunk->min_code)
+    first = chunk->min_code;
+  if (last > chunk->max_code)
+    last = chunk->max_code;
+  if (first > last)
+    return 0;
+
+  // the wide ranges would set most of the bits anyway
+  if (last - first >= __LITL_CHUNK_CODES_BITS)
+    return 1;
+
+  for (code = first;; code++) {
+    hash = __LITL_CHUNK_HASH(code);
+    if ((chunk->codes[__LITL_CHUNK_BIT_1(hash) / 8]
+         & 1 << __LITL_CHUNK_BIT_1(hash) % 8)
+        && (chunk->codes[__LITL_CHUNK_BIT_2(hash) / 8]
+            & 1 << __LITL_CHUNK_BIT_2(hash) % 8))
+      return 1;
+    if (code == last)
+      return 0;
+  }
+}
+
+litl_code_stats_t* __litl_get_code_stats(litl_code_stats_t** stats,
+                                         litl_size_t* nb_stats,
+                                         litl_size_t* nb_allocated,
+                                         litl_code_t code) {
+  litl_size_t first = 0, last = *nb_stats, middle;
+
+  while (first < last) {
+    middle = first + (last - first) / 2;
+    if ((*stats)[middle].code < code)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  if (first < *nb_stats && (*stats)[first].code == code)
+    return &(*stats)[first];
+
+  if (*nb_stats == *nb_allocated) {
+    *nb_allocated = *nb_allocated ? 2 * *nb_allocated : 64;
+    *stats = realloc(*stats, *nb_allocated * sizeof(litl_code_stats_t));
+    if (!*stats) {
+      perror("Could not allocate memory for the statistics of the events!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memmove(&(*stats)[first + 1], &(*stats)[first],
+          (*nb_stats - first) * sizeof(litl_code_stats_t));
+  (*nb_stats)++;
+  (*stats)[first].code = code;
+  (*stats)[first].nb_events = 0;
+  (*stats)[first].size = 0;
+
+  return &(*stats)[first];
+}
@@ -53,4 +53,57 @@ litl_size_t __litl_get_event_size(litl_type_t type, int param_size);
  */
 litl_size_t __litl_get_gen_event_size(litl_t *p_evt);
 
+/**
+ * \ingroup litl_tools
+ * \brief Returns the size (in Bytes) used for storing a parameter of a given
+ *  type in a packed event
+ * \param type A parameter type
+ * \return A size of the parameter
+ */
+litl_size_t __litl_get_param_type_size(litl_param_type_t type);
+
+/**
+ * \ingroup litl_tools
+ * \brief Clears the summary of the codes of a chunk
+ * \param chunk A pointer to a chunk
+ */
+void __litl_chunk_init_codes(litl_chunk_t* chunk);
+
+/**
+ * \ingroup litl_tools
+ * \brief Adds the code of an event to the summary of the codes of a chunk
+ * \param chunk A pointer to a chunk
+ * \param code An event code
+ */
+void __litl_chunk_add_code(litl_chunk_t* chunk, litl_code_t code);
+
+/**
+ * \ingroup litl_tools
+ * \brief Returns whether a chunk may hold events whose code is between first
+ *  and last (included). The answer may be a false positive, but never a
+ *  false negative
+ * \param chunk A pointer to a chunk
+ * \param first The first code of the range
+ * \param last The last code of the range
+ * \return 0 when the chunk does not hold any of these codes
+ */
+int __litl_chunk_may_hold_codes(const litl_chunk_t* chunk, litl_code_t first,
+                                litl_code_t last);
+
+/**
+ * \ingroup litl_tools
+ * \brief Returns the statistics of an event code from an array sorted by
+ *  code. The code is inserted when it is not in the array yet
+ * \param stats A pointer to the array, which may be reallocated
+ * \param nb_stats A pointer to the number of codes in the array
+ * \param nb_allocated A pointer to the number of codes that can be stored
+ * \param code An event code
+ * \return A pointer to the statistics of the code, which is valid until the
+ *  next insertion
+ */
+litl_code_stats_t* __litl_get_code_stats(litl_code_stats_t** stats,
+                                         litl_size_t* nb_stats,
+                                         litl_size_t* nb_allocated,
+                                         litl_code_t code);
+
 #endif /* LITL_TOOLS_H_ */
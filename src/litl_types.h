@@ -49,14 +49,38 @@
  * \ingroup litl_types
  */
 
+/**
+ * \defgroup litl_types_symbol Data Types for Symbolizing Code Addresses
+ * \ingroup litl_types
+ */
+
+/**
+ * \defgroup litl_types_pair Data Types for Pairing Events
+ * \ingroup litl_types
+ */
+
+/**
+ * \defgroup litl_types_stats Data Types for the Statistics of Durations
+ * \ingroup litl_types
+ */
+
+/**
+ * \defgroup litl_types_summary Data Types for the Timeline Summaries
+ * \ingroup litl_types
+ */
+
+/**
+ * \defgroup litl_types_convert Data Types for Converting Traces
+ * \ingroup litl_types
+ */
+
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #if USE_GETTID
 #include <unistd.h>
 #include <sys/syscall.h>  // For SYS_xxx definitions
-#else
-#include <pthread.h>
 #endif
 
 // current thread id
@@ -155,6 +179,11 @@ typedef uint16_t litl_med_size_t;
  * \brief A data type for the optimized storage of parameters
  */
 typedef uint8_t litl_data_t;
+/**
+ * \ingroup litl_types_general
+ * \brief A data type for storing the IDs of interned strings
+ */
+typedef uint32_t litl_string_id_t;
 
 /**
  * \ingroup litl_types_general
@@ -162,6 +191,23 @@ typedef uint8_t litl_data_t;
  */
 #define LITL_OFFSET_CODE 13
 
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the code of a raw event that defines an interned string. Its
+ *  data contain the string ID followed by the string
+ */
+#define LITL_STRING_CODE 0xffffff01
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the code of a regular event that starts a run of events of
+ *  the same thread in a trace sorted by litl_merge_sort_trace. Its parameters
+ *  are the index of the source process among the LITL_SECTION_SOURCE
+ *  sections of the sorted trace and the thread ID. The reader applies the
+ *  runs, so that it does not return these events
+ */
+#define LITL_RUN_CODE 0xffffff02
+
 /**
  * \ingroup litl_types_general
  * \brief Defines the maximum number of parameters
@@ -169,7 +215,9 @@ typedef uint8_t litl_data_t;
 #define LITL_MAX_PARAMS 10
 /**
  * \ingroup litl_types_general
- * \brief Defines the "maximum" size of raw data
+ * \brief Defines the "maximum" size of raw data recorded by the packing
+ *  macros. Larger payloads, up to nearly the buffer size, can be recorded with
+ *  litl_write_probe_raw and litl_write_probe_data
  */
 #define LITL_MAX_DATA (LITL_MAX_PARAMS * sizeof(litl_param_t))
 
@@ -233,6 +281,184 @@ typedef struct {
   } parameters;
 }__attribute__((packed)) litl_t;
 
+/**
+ * \ingroup litl_types_general
+ * \brief The enumeration of parameter types that can be used in event schemas.
+ *  Each parameter is stored with its natural width
+ */
+typedef enum {
+  LITL_PARAM_UINT8 /**< uint8_t */,
+  LITL_PARAM_INT8 /**< int8_t */,
+  LITL_PARAM_UINT16 /**< uint16_t */,
+  LITL_PARAM_INT16 /**< int16_t */,
+  LITL_PARAM_UINT32 /**< uint32_t */,
+  LITL_PARAM_INT32 /**< int32_t */,
+  LITL_PARAM_UINT64 /**< uint64_t */,
+  LITL_PARAM_INT64 /**< int64_t */,
+  LITL_PARAM_FLOAT /**< float */,
+  LITL_PARAM_DOUBLE /**< double */,
+  LITL_PARAM_POINTER /**< A pointer, always stored on 8 bytes */,
+  LITL_PARAM_STRING /**< A string, stored as the ID of the interned string */,
+  LITL_PARAM_ADDRESS /**< A code address, stored on 8 bytes. It is symbolized when the trace is read */
+}__attribute__((packed)) litl_param_type_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the maximum length of an event name in a schema
+ */
+#define LITL_SCHEMA_NAME_SIZE 64
+
+/**
+ * \ingroup litl_types_general
+ * \brief An event schema: the name of an event code and the types of its
+ *  parameters. Schemas are stored in the trace, so that the parameters of
+ *  packed events can be decoded without knowing their layout in advance
+ */
+typedef struct {
+  litl_code_t code; /**< An event code */
+  litl_data_t nb_params; /**< A number of parameters */
+  litl_param_type_t types[LITL_MAX_PARAMS]; /**< Types of the parameters */
+  litl_data_t name[LITL_SCHEMA_NAME_SIZE]; /**< A name of the event */
+}__attribute__((packed)) litl_event_schema_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief A parameter decoded according to an event schema
+ */
+typedef struct {
+  litl_param_type_t type; /**< A type of the parameter */
+  union {
+    uint64_t u; /**< The value of an unsigned integer or a pointer */
+    int64_t i; /**< The value of a signed integer */
+    double d; /**< The value of a floating-point number */
+    const char* s; /**< The value of a string (NULL if the string is unknown) */
+  } value; /**< The value of the parameter */
+} litl_typed_param_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief The enumeration of the sections stored at the end of a trace
+ */
+typedef enum {
+  LITL_SECTION_SCHEMAS = 1 /**< An array of litl_event_schema_t */,
+  LITL_SECTION_STRINGS /**< A sequence of interned strings: ID followed by the null-terminated string */,
+  LITL_SECTION_MODULES /**< An array of litl_module_t */,
+  LITL_SECTION_CHUNKS /**< LITL_CHUNKS_VERSION, followed by an array of litl_chunk_t */,
+  LITL_SECTION_THREAD_STATS /**< An array of litl_thread_stats_t */,
+  LITL_SECTION_CODE_STATS /**< An array of litl_code_stats_t sorted by code */,
+  LITL_SECTION_SOURCE /**< A process whose events were copied into a sorted trace: its litl_process_header_t, the litl_tid_t of its threads, then its own sections */
+} litl_section_type_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief A header of a section. The content of the section follows the header
+ */
+typedef struct {
+  litl_code_t type; /**< A type of the section (litl_section_type_t) */
+  litl_trace_size_t size; /**< A size of the section content (in Bytes) */
+}__attribute__((packed)) litl_section_header_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the maximum length of the path of a module
+ */
+#define LITL_MODULE_PATH_SIZE 256
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the maximum length of the build-id of a module
+ */
+#define LITL_BUILD_ID_SIZE 32
+
+/**
+ * \ingroup litl_types_general
+ * \brief A module (executable or shared library) loaded by the process. The
+ *  modules are stored in the trace, so that the code addresses can be
+ *  symbolized when the trace is read
+ */
+typedef struct {
+  litl_time_t load_time; /**< The time the module was found to be loaded */
+  litl_param_t base; /**< The load bias: an address in the ELF file plus the bias is the address in memory */
+  litl_param_t start; /**< The lowest address of the loaded segments */
+  litl_param_t end; /**< The highest address (excluded) of the loaded segments */
+  litl_data_t build_id_size; /**< A size of the build-id (0 if the module has none) */
+  litl_data_t build_id[LITL_BUILD_ID_SIZE]; /**< The GNU build-id of the module */
+  litl_data_t path[LITL_MODULE_PATH_SIZE]; /**< A path of the module */
+}__attribute__((packed)) litl_module_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief A size (in Bytes) of the Bloom filter of the codes of a chunk
+ */
+#define LITL_CHUNK_CODES_SIZE 16
+
+/**
+ * \ingroup litl_types_general
+ * \brief A chunk of events, i.e. the events of a thread that were flushed
+ *  together. The index of chunks allows to start reading a thread from a
+ *  given time without reading its previous events, and to skip the chunks
+ *  that do not hold the requested codes
+ */
+typedef struct {
+  litl_tid_t tid; /**< A thread ID */
+  litl_offset_t thread_offset; /**< An offset of the first chunk of the thread, which identifies the thread */
+  litl_offset_t offset; /**< An offset of the chunk */
+  litl_time_t first_time; /**< The time of the first event of the chunk */
+  litl_time_t last_time; /**< The time of the last event of the chunk */
+  litl_size_t nb_events; /**< A number of events in the chunk */
+  litl_code_t min_code; /**< The smallest code of the events of the chunk */
+  litl_code_t max_code; /**< The largest code of the events of the chunk */
+  litl_data_t codes[LITL_CHUNK_CODES_SIZE]; /**< A Bloom filter of the codes of the events of the chunk */
+}__attribute__((packed)) litl_chunk_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the version of the layout of litl_chunk_t, which is stored at
+ *  the beginning of the chunks section. The reader ignores the chunks sections
+ *  of other versions, and builds the chunk index by reading the events
+ */
+#define LITL_CHUNKS_VERSION 2
+
+/**
+ * \ingroup litl_types_general
+ * \brief The statistics of the events of a thread, which are computed while
+ *  recording
+ */
+typedef struct {
+  litl_tid_t tid; /**< A thread ID */
+  litl_offset_t thread_offset; /**< An offset of the first chunk of the thread, which identifies the thread */
+  uint64_t nb_events; /**< A number of events */
+  litl_trace_size_t size; /**< A size of the events (in Bytes) */
+  litl_time_t first_time; /**< The time of the first event */
+  litl_time_t last_time; /**< The time of the last event */
+}__attribute__((packed)) litl_thread_stats_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief The statistics of the events with a given code
+ */
+typedef struct {
+  litl_code_t code; /**< An event code */
+  uint64_t nb_events; /**< A number of events */
+  litl_trace_size_t size; /**< A size of the events (in Bytes) */
+}__attribute__((packed)) litl_code_stats_t;
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the signature of the trace trailer
+ */
+#define LITL_TRAILER_MAGIC "LiTLsec"
+
+/**
+ * \ingroup litl_types_general
+ * \brief A trailer written at the very end of the events of a process. It
+ *  locates the sections that follow the events
+ */
+typedef struct {
+  litl_offset_t sections_offset; /**< An offset (from the process data) to the first section */
+  litl_data_t magic[8]; /**< LITL_TRAILER_MAGIC */
+}__attribute__((packed)) litl_trailer_t;
+
 /**
  * \ingroup litl_types_general
  * \brief Defines the maximum number of threads (pairs of tid and offset) stored
@@ -285,27 +511,96 @@ typedef struct {
   litl_offset_t offset; /**< An offset to process-specific data */
 } litl_trace_triples_t;
 
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the size of a cache line. It is used for separating data that
+ *  is accessed by different threads
+ */
+#define LITL_CACHELINE_SIZE 64
+
+/**
+ * \ingroup litl_types_general
+ * \brief Defines the size (in Bytes) from which the payloads of events are
+ *  copied with non-temporal stores, so that they do not evict the data of the
+ *  application from the cache
+ */
+#ifndef LITL_NT_COPY_THRESHOLD
+#define LITL_NT_COPY_THRESHOLD 4096
+#endif
+
 /**
  * \ingroup litl_types_write
- * \brief Thread-specific buffer
+ * \brief Thread-specific buffer. Each buffer is aligned on a cache line and
+ *  only written by its owner thread while recording events, so that recording
+ *  threads do not share cache lines
  */
 typedef struct {
-  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the buffer */
   litl_buffer_t buffer; /**< A pointer to the next free slot */
+  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the buffer */
+  int initialized; /**< Indicates whether the buffer was allocated */
 
   litl_tid_t tid; /**< An ID of the working thread */
   litl_offset_t offset; /**< An offset to the next buffer in the trace file */
 
   litl_data_t already_flushed; /**< Handles the situation when some threads start after the header was flushed, i.e. their tids and offsets were not included into the header*/
-  int initialized;
-} litl_write_buffer_t;
+  litl_offset_t first_offset; /**< An offset of the first chunk of events of the thread */
+  litl_thread_stats_t stats; /**< The statistics of the events of the thread, which are updated when the buffer is flushed */
+}__attribute__((aligned(LITL_CACHELINE_SIZE))) litl_write_buffer_t;
+
+/**
+ * \ingroup litl_types_write
+ * \brief Defines the number of buckets of the hash table of event schemas
+ */
+#define LITL_SCHEMA_HASH_SIZE 256
 
 /**
  * \ingroup litl_types_write
- * \brief A data structure for recording events
+ * \brief An event schema registered for recording
+ */
+typedef struct litl_write_schema {
+  litl_event_schema_t schema; /**< The schema */
+  litl_size_t param_size; /**< A size of the parameters (in Bytes) */
+  struct litl_write_schema* next; /**< The next schema in the same bucket */
+} litl_write_schema_t;
+
+/**
+ * \ingroup litl_types_write
+ * \brief Defines the number of buckets of the hash table of interned strings
+ */
+#define LITL_STRING_HASH_SIZE 4096
+
+/**
+ * \ingroup litl_types_write
+ * \brief An interned string
+ */
+typedef struct litl_write_string {
+  uint32_t hash; /**< A hash of the string */
+  litl_string_id_t id; /**< An ID of the string */
+  struct litl_write_string* next; /**< The next string in the same bucket */
+  char str[]; /**< The null-terminated string */
+} litl_write_string_t;
+
+/**
+ * \ingroup litl_types_write
+ * \brief A data structure for recording events.
+ *
+ *  The first cache line holds the fields that are read each time an event is
+ *  recorded and that are seldom modified. The fields that are modified when
+ *  flushing buffers or registering threads are stored on separate cache lines
  */
 typedef struct {
-  int f_handle; /**< A file handler */
+  litl_data_t is_litl_initialized; /**< Ensures that a performance analysis library does not start recording events before the initialization is finished */
+  volatile litl_data_t is_recording_paused; /**< Indicates whether LiTL stops recording events (1) for a while or not (0) */
+  litl_data_t is_buffer_full; /**< Indicates whether the buffer is full */
+  litl_data_t allow_buffer_flush; /**< Indicates whether buffer flush is enabled (1) or not (0). In case the flushing is disabled, the recording of events is stopped. By default, it is activated */
+  litl_data_t allow_thread_safety; /**< Indicates whether LiTL uses thread-safety (1) or not (0). By default, it is activated */
+  litl_data_t allow_tid_recording; /**< Indicates whether LiTL records tid (1) or not (0). By default, it is activated */
+  litl_size_t buffer_size; /**< A buffer size */
+  pthread_key_t index; /**< A private thread variable that holds a pointer to its buffer */
+  litl_write_schema_t** schemas; /**< A hash table of the registered event schemas */
+  litl_write_string_t** strings; /**< A hash table of the interned strings */
+
+  int f_handle __attribute__((aligned(LITL_CACHELINE_SIZE))); /**< A file handler */
   char* filename; /**< A file name */
 
   litl_offset_t general_offset; /**< An offset from the beginning of the trace file to the next free slot */
@@ -317,25 +612,41 @@ typedef struct {
   litl_med_size_t header_nb_threads; /**< A number of threads in the header */
   litl_data_t is_header_flushed; /**< Indicates whether the header with threads pairs has been flushed */
 
-  litl_med_size_t nb_threads; /**< A number of threads */
   litl_med_size_t nb_slots; /**< A number of chunks with the information on threads (tid, offset); first chunk, which is in the header, does not count; each contains at most NBTHREADS threads */
   litl_param_t threads_offset; /**< An offset to the next chunk of pairs (tid, offset) for a given thread */
 
+  pthread_mutex_t lock_litl_flush; /**< Handles write conflicts while using pthread */
+
+  litl_med_size_t nb_threads __attribute__((aligned(LITL_CACHELINE_SIZE))); /**< A number of threads */
   litl_write_buffer_t **buffers; /**< An array of thread-specific buffers */
   litl_size_t nb_allocated_buffers; /**< A number of thread-specific buffers that are allocated */
-  litl_size_t buffer_size; /**< A buffer size */
-  litl_data_t is_buffer_full; /**< Indicates whether the buffer is full */
 
-  pthread_once_t index_once; /**< Guarantees that the initialization function is called only once */
-  pthread_key_t index; /**< A private thread variable that holds its index */
-  pthread_mutex_t lock_litl_flush; /**< Handles write conflicts while using pthread */
   pthread_mutex_t lock_buffer_init; /**< Handles race conditions while initializing threads pairs and buffers pointers */
 
-  litl_data_t is_litl_initialized; /**< Ensures that a performance analysis library does not start recording events before the initialization is finished */
-  volatile litl_data_t is_recording_paused; /**< Indicates whether LiTL stops recording events (1) for a while or not (0) */
-  litl_data_t allow_buffer_flush; /**< Indicates whether buffer flush is enabled (1) or not (0). In case the flushing is disabled, the recording of events is stopped. By default, it is activated */
-  litl_data_t allow_thread_safety; /**< Indicates whether LiTL uses thread-safety (1) or not (0). By default, it is activated */
-  litl_data_t allow_tid_recording; /**< Indicates whether LiTL records tid (1) or not (0). By default, it is activated */
+  litl_size_t nb_schemas; /**< A number of registered event schemas */
+  pthread_mutex_t lock_schemas; /**< Protects the registration of event schemas */
+
+  litl_string_id_t nb_strings; /**< A number of interned strings */
+  litl_trace_size_t strings_size; /**< A size of the interned strings section (in Bytes) */
+  pthread_mutex_t lock_strings; /**< Protects the interning of strings */
+
+  litl_data_t allow_modules_recording; /**< Indicates whether LiTL records the loaded modules (1) or not (0). By default, it is activated */
+  litl_module_t* modules; /**< An array of the modules that were loaded */
+  litl_size_t nb_modules; /**< A number of modules */
+  litl_size_t nb_allocated_modules; /**< A number of modules that can be stored in the array */
+  unsigned long long modules_adds; /**< The number of modules loaded by the dynamic linker at the last snapshot */
+  pthread_mutex_t lock_modules; /**< Protects the snapshots of modules */
+
+  litl_chunk_t* chunks; /**< An index of the chunks of events that were flushed */
+  litl_size_t nb_chunks; /**< A number of chunks */
+  litl_size_t nb_allocated_chunks; /**< A number of chunks that can be stored in the array */
+
+  litl_code_stats_t* code_stats; /**< The statistics of the events per code, sorted by code */
+  litl_size_t nb_code_stats; /**< A number of codes */
+  litl_size_t nb_allocated_code_stats; /**< A number of codes that can be stored in the array */
+
+  litl_buffer_t sections; /**< The sections that are written after the others, e.g. the source processes of a sorted trace */
+  litl_trace_size_t sections_size; /**< A size of these sections (in Bytes) */
 } litl_write_trace_t;
 
 /**
@@ -347,36 +658,136 @@ typedef struct {
   litl_t *event; /**< A pointer to the read event */
 } litl_read_event_t;
 
+/**
+ * \ingroup litl_types_read
+ * \brief Defines the default size (in Bytes) of the buffers that the reader
+ *  keeps in memory when the trace is read with pread. It can be changed with
+ *  the LITL_READ_CACHE_SIZE environment variable
+ */
+#ifndef LITL_READ_CACHE_SIZE
+#define LITL_READ_CACHE_SIZE (256 * 1024 * 1024)
+#endif
+
+/**
+ * \ingroup litl_types_read
+ * \brief Defines the default number of chunks that are prefetched ahead of
+ *  each thread. It can be changed with the LITL_READ_PREFETCH environment
+ *  variable
+ */
+#ifndef LITL_READ_PREFETCH
+#define LITL_READ_PREFETCH 2
+#endif
+
+/**
+ * \ingroup litl_types_read
+ * \brief A buffer of the chunk cache. When a trace is read with pread, the
+ *  threads borrow their buffers from the cache, so that the memory used does
+ *  not depend on the number of threads
+ */
+typedef struct litl_read_cache_slot {
+  litl_buffer_t buffer; /**< A buffer of events */
+  litl_size_t size; /**< A size of the buffer (in Bytes) */
+  struct litl_read_thread* thread; /**< The thread that uses the buffer */
+  struct litl_read_cache_slot* prev; /**< The slot that was used more recently */
+  struct litl_read_cache_slot* next; /**< The slot that was used less recently */
+} litl_read_cache_slot_t;
+
 /**
  * \ingroup litl_types_read
  * \brief A data structure for reading thread-specific events
  */
-typedef struct {
+typedef struct litl_read_thread {
   litl_thread_pair_t* thread_pair; /**< A thread pair (tid, offset) */
+  litl_med_size_t index; /**< An index of the thread within its process */
+  litl_size_t trace_index; /**< An index of the thread among the threads of the event processes of the trace, sorted by process and tid, e.g. for indexing per-thread arrays. It is 0 for the threads of the sorted processes */
 
-  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the buffer */
+  litl_data_t is_loaded; /**< Indicates whether the buffer holds the events at the position of the thread. The buffers are loaded when the thread is first read */
+  litl_read_cache_slot_t* slot; /**< The slot of the chunk cache that holds the buffer, if any */
+  litl_buffer_t event_copy; /**< A copy of the current event, which is made when the buffer is evicted from the cache */
+  litl_size_t event_copy_size; /**< A size of the copy of the current event */
+
+  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the buffer. When the trace is mapped, it points to the mapping */
   litl_buffer_t buffer; /**< A pointer to the current position in the buffer */
 
   litl_offset_t offset; /**< An offset from the beginning of the buffer */
   litl_offset_t tracker; /**< An indicator of the end of the buffer, which equals to offset + buffer_size */
 
   litl_read_event_t cur_event; /**< The current event */
+
+  litl_offset_t first_offset; /**< An offset of the first chunk of events of the thread */
+
+  litl_chunk_t* chunks; /**< The chunks of the thread sorted by time, or NULL if the chunk index is not loaded */
+  litl_size_t nb_chunks; /**< A number of chunks */
+  litl_offset_t prefetch_offset; /**< An offset of the last chunk that was prefetched */
+
+  struct litl_read_process* run_process; /**< The source process of the current run of events of a sorted trace, or NULL */
+  litl_tid_t run_tid; /**< The thread ID of the current run of events of a sorted trace */
 } litl_read_thread_t;
 
 /**
  * \ingroup litl_types_read
- * \brief A data structure for reading process-specific events
+ * \brief Defines the largest time stamp, i.e. the end of a time window that
+ *  is not bounded
+ */
+#define LITL_MAX_TIME ((litl_time_t) -1)
+
+/**
+ * \ingroup litl_types_read
+ * \brief An entry of the heaps that order the threads of a process, or the
+ *  processes of a trace, by the time of their current event
  */
 typedef struct {
+  litl_time_t time; /**< The time of the current event */
+  litl_med_size_t index; /**< An index of the thread or of the process */
+} litl_read_heap_entry_t;
+
+/**
+ * \ingroup litl_types_read
+ * \brief A data structure for reading process-specific events
+ */
+typedef struct litl_read_process {
   litl_process_header_t* header; /**< A pointer to the process header */
   litl_buffer_t header_buffer_ptr; /**< A pointer to the beginning of the header buffer */
   litl_buffer_t header_buffer; /**< A pointer to the current position within the header buffer */
 
+  litl_med_size_t index; /**< An index of the process among the processes that recorded the events of the trace, see litl_read_trace_t::event_processes */
   litl_med_size_t nb_threads; /**< A number of threads */
   litl_read_thread_t **threads; /**< An array of threads */
+  litl_read_thread_t **threads_by_tid; /**< The threads sorted by tid, for litl_read_find_thread */
 
   int cur_index; /**< An index of the current thread */
   int is_initialized; /**< Indicates that the process was initialized */
+
+  litl_read_heap_entry_t* heap; /**< A binary min-heap of the threads that have events left */
+  litl_med_size_t heap_size; /**< A number of threads in the heap */
+
+  litl_buffer_t sections; /**< The sections stored at the end of the process data, if any */
+  litl_trace_size_t sections_size; /**< A size of the sections (in Bytes) */
+
+  litl_size_t nb_schemas; /**< A number of event schemas */
+  litl_event_schema_t* schemas; /**< An array of event schemas sorted by code */
+
+  litl_string_id_t nb_strings; /**< A size of the array of interned strings */
+  char** strings; /**< An array of interned strings indexed by their IDs */
+
+  litl_size_t nb_modules; /**< A number of modules */
+  litl_module_t* modules; /**< An array of the modules loaded by the process */
+
+  litl_chunk_t* chunks; /**< An index of the chunks of events sorted by thread and time */
+  litl_size_t nb_chunks; /**< A number of chunks */
+  int is_chunk_index_loaded; /**< Indicates that the chunk index was loaded or built */
+
+  litl_thread_stats_t* thread_stats; /**< The statistics of the events of each thread */
+  litl_size_t nb_thread_stats; /**< A number of threads with statistics */
+  litl_code_stats_t* code_stats; /**< The statistics of the events per code, sorted by code */
+  litl_size_t nb_code_stats; /**< A number of codes */
+  litl_size_t nb_allocated_code_stats; /**< A number of codes that can be stored in the array */
+  int is_stats_loaded; /**< Indicates that the statistics were loaded or computed */
+
+  pthread_mutex_t lock_strings; /**< Protects the dictionary of strings when threads are read in parallel */
+
+  litl_med_size_t nb_sources; /**< A number of source processes, which is not 0 only for the traces sorted by litl_merge_sort_trace */
+  struct litl_read_process** sources; /**< The processes whose events were copied into the sorted trace. Their events are read through the sorted process */
 } litl_read_process_t;
 
 /**
@@ -386,6 +797,8 @@ typedef struct {
  */
 typedef struct {
   int f_handle; /**< A file handler */
+  litl_buffer_t map; /**< The mapping of the trace file, or NULL if the trace is read with pread */
+  size_t map_size; /**< A size of the mapping */
 
   litl_general_header_t* header; /**< A pointer to the trace header */
   litl_buffer_t header_buffer_ptr; /**< A pointer to the beginning of the header buffer */
@@ -393,8 +806,89 @@ typedef struct {
 
   litl_med_size_t nb_processes; /**< A number of processes */
   litl_read_process_t **processes; /**< An array of processes */
+  litl_read_process_t *cur_process; /**< The event process of the last event returned by litl_read_next_event */
+  litl_med_size_t nb_event_processes; /**< A number of processes that recorded the events */
+  litl_read_process_t **event_processes; /**< The processes that recorded the events: the processes of the trace, or the source processes of the sorted ones. The events are reported in these processes */
+  litl_size_t nb_threads; /**< A number of threads of the event processes */
+
+  litl_read_heap_entry_t* heap; /**< A binary min-heap of the processes that have events left, used by litl_read_next_ordered_event */
+  litl_med_size_t heap_size; /**< A number of processes in the heap */
+  int is_heap_initialized; /**< Indicates that the heap of processes was built */
+
+  litl_time_t start_time; /**< The beginning of the time window: the earlier events are not visited */
+  litl_time_t end_time; /**< The end of the time window: the later events are not returned */
+
+  litl_read_cache_slot_t* cache_head; /**< The slot of the chunk cache that was used most recently */
+  litl_read_cache_slot_t* cache_tail; /**< The slot of the chunk cache that was used least recently */
+  size_t cache_size; /**< A size of the buffers of the chunk cache (in Bytes) */
+  size_t cache_budget; /**< The maximum size of the buffers of the chunk cache (in Bytes) */
+
+  unsigned prefetch_depth; /**< A number of chunks that are prefetched ahead of each thread */
+
+  litl_code_t* filter_codes; /**< Pairs of codes (first and last): only the events whose code is within one of these ranges are read */
+  litl_size_t nb_filter_codes; /**< A number of ranges of codes, 0 when the codes are not filtered */
+  litl_tid_t* filter_tids; /**< The IDs of the threads that are read */
+  litl_size_t nb_filter_tids; /**< A number of thread IDs, 0 when the threads are not filtered */
+
+  litl_med_size_t batch_process_index; /**< An index of the process read by litl_read_next_batch */
+  litl_med_size_t batch_thread_index; /**< An index of the thread read by litl_read_next_batch */
 } litl_read_trace_t;
 
+/**
+ * \ingroup litl_types_read
+ * \brief A batch of events decoded into one array per field, so that analysis
+ *  loops read contiguous and aligned values instead of packed events
+ */
+typedef struct {
+  litl_size_t capacity; /**< The maximum number of events in the batch */
+  litl_size_t nb_events; /**< A number of events in the batch */
+  litl_read_process_t* process; /**< The process of the events */
+
+  litl_time_t* times; /**< The time stamps of the events */
+  litl_code_t* codes; /**< The codes of the events */
+  litl_tid_t* tids; /**< The thread IDs of the events */
+  litl_type_t* types; /**< The types of the events */
+  litl_data_t* nb_params; /**< The numbers of parameters of the regular events, 0 for the other types */
+  litl_param_t* params[LITL_MAX_PARAMS]; /**< One column per parameter of the regular events. params[p][i] is only set when p < nb_params[i] */
+  litl_t** events; /**< Pointers to the events, e.g. for reading the data of raw and packed events. They are valid until the next batch is read */
+} litl_read_batch_t;
+
+/**
+ * \ingroup litl_types_read
+ * \brief A function called on each event by litl_read_visit_events. The
+ *  events of a thread are visited in order by the same worker, but the
+ *  threads are visited concurrently
+ * \param trace A pointer to the trace object
+ * \param process A pointer to the process the event belongs to
+ * \param event The event
+ * \param state The state of the worker that visits the event
+ */
+typedef void (*litl_read_visitor_t)(litl_read_trace_t* trace,
+                                    litl_read_process_t* process,
+                                    litl_read_event_t* event, void* state);
+
+/**
+ * \ingroup litl_types_merge
+ * \brief Defines the size (in Bytes) of the buffers used for copying the
+ *  traces when the kernel cannot copy them
+ */
+#ifndef LITL_MERGE_BUFFER_SIZE
+#define LITL_MERGE_BUFFER_SIZE (16 * 1024 * 1024)
+#endif
+
+/**
+ * \ingroup litl_types_merge
+ * \brief A trace being merged into an archive
+ */
+typedef struct {
+  int f_handle; /**< A file handler, or -1 when the trace is closed between reading its header and copying its body */
+  litl_buffer_t header; /**< The general header and the process headers of the trace */
+  litl_trace_size_t header_size; /**< A size of the headers */
+  litl_trace_size_t body_size; /**< A size of the data after the headers */
+  litl_offset_t body_offset; /**< An offset of the data in the archive */
+  litl_data_t is_cloned; /**< Indicates that the blocks of the data were already cloned into the archive */
+} litl_merge_trace_t;
+
 /**
  * \ingroup litl_types_merge
  * \brief A data structure for merging trace files into an archive of traces
@@ -405,12 +899,20 @@ typedef struct {
 
   litl_med_size_t nb_traces; /**< A number of traces */
   char** traces_names; /**< An array of traces names */
+  litl_merge_trace_t* traces; /**< The traces */
+  litl_med_size_t nb_open_traces; /**< A number of traces that are kept open between reading their header and copying their body, below the limit of file descriptors */
 
-  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the buffer */
-  litl_buffer_t buffer; /**< A pointer to the current position in the buffer */
-  litl_size_t buffer_size; /**< A buffer size */
+  litl_buffer_t buffer_ptr; /**< A pointer to the beginning of the archive header */
+  litl_size_t buffer_size; /**< A size of the archive header */
 
-  litl_offset_t general_offset; /**< An offset from the beginning of the trace file till the current position */
+  litl_offset_t general_offset; /**< An offset from the beginning of the archive till the end of the data laid out */
+
+  unsigned nb_workers; /**< A number of workers that read the headers and copy the data of the traces */
+  unsigned next_trace; /**< An index of the next trace to be processed by a worker */
+
+  litl_size_t block_size; /**< A block size of the archive file */
+  litl_data_t allow_clone; /**< Indicates whether the trace bodies may be cloned into the archive (1) or not (0), i.e. whether the file system supports reflinks */
+  litl_data_t allow_copy_range; /**< Indicates whether the trace bodies may be copied by the kernel with copy_file_range (1) or not (0) */
 } litl_trace_merge_t;
 
 /**
@@ -431,6 +933,344 @@ typedef struct {
   litl_size_t buffer_size; /**< A buffer size */
 } litl_trace_split_t;
 
+/**
+ * \ingroup litl_types_symbol
+ * \brief A symbol of an ELF symbol table
+ */
+typedef struct {
+  litl_param_t address; /**< An address of the symbol in the ELF file */
+  litl_param_t size; /**< A size of the symbol */
+  const char* name; /**< A name of the symbol */
+} litl_elf_symbol_t;
+
+/**
+ * \ingroup litl_types_symbol
+ * \brief The symbol table of a module. It is loaded the first time an address
+ *  in the module is symbolized
+ */
+typedef struct {
+  litl_data_t is_loaded; /**< Indicates whether the module was already looked for */
+  void* file; /**< The mapping of the ELF file, which holds the symbol names */
+  size_t file_size; /**< A size of the mapping */
+  litl_size_t nb_symbols; /**< A number of symbols */
+  litl_elf_symbol_t* symbols; /**< An array of symbols sorted by address */
+} litl_symbol_table_t;
+
+/**
+ * \ingroup litl_types_symbol
+ * \brief A data structure for symbolizing the code addresses of a process
+ */
+typedef struct {
+  litl_read_process_t* process; /**< The process whose addresses are symbolized */
+  litl_symbol_table_t* tables; /**< The symbol tables, one per module of the process */
+} litl_symbolizer_t;
+
+/**
+ * \ingroup litl_types_symbol
+ * \brief A symbolized code address
+ */
+typedef struct {
+  const litl_module_t* module; /**< The module that contains the address */
+  litl_param_t offset; /**< An offset of the address in the ELF file of the module */
+  const char* name; /**< A name of the function that contains the address, or NULL if it is unknown */
+  litl_param_t name_offset; /**< An offset of the address from the beginning of the function */
+} litl_symbol_t;
+
+/**
+ * \ingroup litl_types_pair
+ * \brief An interval between an entry event and its exit event
+ */
+typedef struct {
+  litl_time_t start; /**< A time stamp of the entry event */
+  litl_time_t duration; /**< A time between the entry and exit events */
+  litl_tid_t tid; /**< A thread ID */
+  litl_code_t code; /**< A code of the entry event */
+  litl_med_size_t process_index; /**< An index of the process of the thread */
+  litl_med_size_t thread_index; /**< An index of the thread within its process */
+  uint16_t depth; /**< A number of enclosing intervals of the thread */
+  uint8_t is_complete; /**< 0 when the exit event was not found: the interval ends at the next exit of an enclosing interval, or at the last event of the thread */
+} litl_interval_t;
+
+/**
+ * \ingroup litl_types_pair
+ * \brief A function called on each interval
+ * \param interval The interval
+ * \param arg The argument given when the pairing started
+ */
+typedef void (*litl_pair_callback_t)(const litl_interval_t* interval,
+                                     void* arg);
+
+/**
+ * \ingroup litl_types_pair
+ * \brief An entry event waiting for its exit event
+ */
+typedef struct {
+  litl_time_t time; /**< A time stamp of the entry event */
+  litl_code_t code; /**< A code of the entry event */
+} litl_pair_entry_t;
+
+/**
+ * \ingroup litl_types_pair
+ * \brief The stack of entry events of a thread
+ */
+typedef struct {
+  litl_med_size_t process_index; /**< An index of the process of the thread */
+  litl_tid_t tid; /**< A thread ID */
+  litl_med_size_t thread_index; /**< An index of the thread within its process */
+  litl_time_t last_time; /**< A time stamp of the last event of the thread */
+  litl_pair_entry_t* entries; /**< The entry events, the innermost last */
+  uint16_t depth; /**< A number of entry events in the stack */
+} litl_pair_thread_t;
+
+/**
+ * \ingroup litl_types_pair
+ * \brief A data structure for pairing the entry and exit events of the
+ *  threads of a trace
+ */
+typedef struct {
+  litl_read_trace_t* trace; /**< The trace whose events are paired */
+  litl_code_t exit_offset; /**< A difference between the exit code and the entry code of an interval */
+  litl_code_t unpaired_limit; /**< The codes from this limit are not paired */
+  uint16_t max_depth; /**< The maximum number of entry events in the stack of a thread */
+
+  litl_pair_callback_t callback; /**< A function called on each interval */
+  void* arg; /**< An argument of the callback */
+
+  litl_pair_thread_t* threads; /**< The threads of all the processes, indexed by their trace_index */
+  litl_size_t nb_threads; /**< A number of threads */
+
+  uint64_t nb_intervals; /**< A number of intervals */
+  uint64_t nb_incomplete; /**< A number of intervals whose exit event was not found */
+} litl_pair_t;
+
+/**
+ * \ingroup litl_types_stats
+ * \brief Defines the precision of the histograms: each power of two is
+ *  divided into 2^LITL_HISTOGRAM_PRECISION buckets, so that the relative
+ *  error of a value is below 2^-LITL_HISTOGRAM_PRECISION
+ */
+#define LITL_HISTOGRAM_PRECISION 7
+
+/**
+ * \ingroup litl_types_stats
+ * \brief Defines the number of buckets of a histogram: the values below
+ *  2^LITL_HISTOGRAM_PRECISION have their own bucket, and the 64-bit values
+ *  above, up to UINT64_MAX, are split into log-linear buckets
+ */
+#define LITL_HISTOGRAM_NB_BUCKETS \
+  ((65 - LITL_HISTOGRAM_PRECISION) << LITL_HISTOGRAM_PRECISION)
+
+/**
+ * \ingroup litl_types_stats
+ * \brief A histogram of durations with log-linear buckets (as HDR
+ *  histograms). Two histograms are merged by adding their buckets
+ */
+typedef struct {
+  uint64_t nb_values; /**< A number of values */
+  uint64_t min; /**< The minimum value */
+  uint64_t max; /**< The maximum value */
+  uint64_t sum; /**< The sum of the values */
+  uint64_t counts[LITL_HISTOGRAM_NB_BUCKETS]; /**< The numbers of values in each bucket */
+} litl_histogram_t;
+
+/**
+ * \ingroup litl_types_stats
+ * \brief The histogram of the durations of the intervals of an entry code
+ */
+typedef struct {
+  litl_code_t code; /**< A code of the entry events */
+  litl_histogram_t* histogram; /**< The histogram of the durations */
+} litl_code_histogram_t;
+
+/**
+ * \ingroup litl_types_stats
+ * \brief The histogram of the durations of the intervals of a thread
+ */
+typedef struct {
+  litl_med_size_t process_index; /**< An index of the process of the thread */
+  litl_tid_t tid; /**< A thread ID */
+  litl_histogram_t* histogram; /**< The histogram of the durations */
+} litl_thread_histogram_t;
+
+/**
+ * \ingroup litl_types_stats
+ * \brief The statistics of the durations of the intervals of a trace, per
+ *  code and per thread
+ */
+typedef struct {
+  litl_code_histogram_t* codes; /**< The histograms of the codes, sorted by code */
+  litl_size_t nb_codes; /**< A number of codes */
+  litl_size_t nb_allocated_codes; /**< A number of codes that can be stored in the array */
+  litl_thread_histogram_t* threads; /**< The histograms of the threads, sorted by process and tid */
+  litl_size_t nb_threads; /**< A number of threads */
+  litl_size_t nb_allocated_threads; /**< A number of threads that can be stored in the array */
+  litl_size_t cur_code; /**< An index of the code of the last interval */
+  litl_size_t cur_thread; /**< An index of the thread of the last interval */
+  uint64_t nb_incomplete; /**< A number of incomplete intervals, which are not in the histograms */
+} litl_duration_stats_t;
+
+/**
+ * \ingroup litl_types_summary
+ * \brief Defines the maximum number of buckets of each thread at the finest
+ *  level of a timeline summary. It can be changed with the
+ *  LITL_SUMMARY_NB_BUCKETS environment variable
+ */
+#ifndef LITL_SUMMARY_NB_BUCKETS
+#define LITL_SUMMARY_NB_BUCKETS 4096
+#endif
+
+/**
+ * \ingroup litl_types_summary
+ * \brief Defines the magic number at the beginning of a summary file
+ */
+#define LITL_SUMMARY_MAGIC "LITLSUM"
+
+/**
+ * \ingroup litl_types_summary
+ * \brief Defines the version of the format of the summary files
+ */
+#define LITL_SUMMARY_VERSION 1
+
+/**
+ * \ingroup litl_types_summary
+ * \brief The header of a summary file. It is followed by the threads, then by
+ *  the levels from the finest to the coarsest one. Each level holds the
+ *  buckets of the first thread, then those of the second one, etc. The
+ *  buckets of level l are 2^(shift + l) wide, and the coarsest level has a
+ *  single bucket per thread
+ */
+typedef struct {
+  char magic[8]; /**< LITL_SUMMARY_MAGIC */
+  uint32_t version; /**< LITL_SUMMARY_VERSION */
+  uint32_t nb_threads; /**< A number of threads */
+  uint32_t nb_levels; /**< A number of levels */
+  uint32_t shift; /**< The log2 of the width of the buckets of the finest level */
+  litl_time_t start_time; /**< The time of the first event of the trace, where the first bucket of each level starts */
+  litl_time_t end_time; /**< The time of the last event of the trace */
+}__attribute__((packed)) litl_summary_header_t;
+
+/**
+ * \ingroup litl_types_summary
+ * \brief A thread of a summary file
+ */
+typedef struct {
+  litl_med_size_t process_index; /**< An index of the process of the thread */
+  litl_med_size_t thread_index; /**< An index of the thread within its process */
+  litl_tid_t tid; /**< A thread ID */
+}__attribute__((packed)) litl_summary_thread_t;
+
+/**
+ * \ingroup litl_types_summary
+ * \brief The activity of a thread during a time bucket
+ */
+typedef struct {
+  uint64_t nb_events; /**< A number of events */
+  litl_time_t busy_time; /**< A time spent within the outermost intervals of the thread */
+}__attribute__((packed)) litl_summary_bucket_t;
+
+/**
+ * \ingroup litl_types_summary
+ * \brief A summary file mapped in memory
+ */
+typedef struct {
+  int f_handle; /**< A file handler */
+  litl_buffer_t map; /**< The mapping of the summary file */
+  size_t map_size; /**< A size of the mapping */
+
+  litl_summary_header_t* header; /**< The header of the summary */
+  litl_summary_thread_t* threads; /**< The threads, sorted by process and tid */
+  litl_summary_bucket_t** levels; /**< The first bucket of each level */
+} litl_summary_t;
+
+/**
+ * \ingroup litl_types_convert
+ * \brief The formats a trace can be converted to
+ */
+typedef enum {
+  LITL_CONVERT_CHROME_JSON, /**< The JSON trace event format of Chrome */
+  LITL_CONVERT_PERFETTO /**< The protobuf trace format of Perfetto */
+} litl_convert_format_t;
+
+/**
+ * \ingroup litl_types_convert
+ * \brief A data structure for converting a trace. The events are formatted
+ *  into a buffer, which is written to the output file when it is full
+ */
+typedef struct {
+  int f_handle; /**< A file handler */
+  litl_convert_format_t format; /**< The output format */
+  litl_read_trace_t* trace; /**< The trace that is converted */
+
+  litl_buffer_t buffer; /**< A buffer of formatted events */
+  litl_size_t buffer_size; /**< A size of the formatted events in the buffer */
+  litl_size_t buffer_capacity; /**< A size of the buffer */
+
+  uint64_t* names; /**< The IDs of the event names that were already interned, sorted (Perfetto) */
+  litl_size_t nb_names; /**< A number of interned names */
+  litl_size_t nb_allocated_names; /**< A number of names that can be stored in the array */
+
+  litl_data_t nesting; /**< A number of nested messages being written, during which the buffer grows instead of being flushed (Perfetto) */
+  litl_pair_t* pair; /**< The pairing of the entry and exit events into intervals, NULL when all the events are converted as instant events */
+  litl_read_event_t* exit_event; /**< The event being paired, whose parameters are written with the end of the slice it closes, if any */
+  uint64_t nb_records; /**< A number of records written to the output, including the descriptions of processes and threads */
+  uint64_t nb_events; /**< A number of converted events */
+} litl_trace_convert_t;
+
+/**
+ * \ingroup litl_types_convert
+ * \brief The location of a record batch in an Arrow file
+ */
+typedef struct {
+  uint64_t offset; /**< An offset of the message in the file */
+  uint32_t metadata_size; /**< A size of the message metadata, including its prefix */
+  uint64_t body_size; /**< A size of the message body */
+} litl_arrow_block_t;
+
+/**
+ * \ingroup litl_types_convert
+ * \brief A data structure for exporting a trace to an Arrow file. The record
+ *  batches are filled by several workers, and written at increasing offsets
+ */
+typedef struct {
+  int f_handle; /**< A file handler */
+  litl_read_trace_t* trace; /**< The trace that is exported */
+  litl_size_t batch_capacity; /**< The maximum number of events in a record batch */
+
+  pthread_mutex_t lock; /**< A lock that protects the offset and the blocks */
+  uint64_t offset; /**< An offset of the next record batch in the file */
+  litl_arrow_block_t* blocks; /**< The record batches that were written */
+  litl_size_t nb_blocks; /**< A number of record batches */
+  litl_size_t nb_allocated_blocks; /**< A number of blocks that can be stored in the array */
+
+  uint64_t nb_events; /**< A number of exported events */
+} litl_trace_arrow_t;
+
+/**
+ * \ingroup litl_types_convert
+ * \brief A record batch of the Arrow export: one array per column, with the
+ *  fixed width of the column, except for the payloads that are concatenated
+ *  in data. The params[p][i] and the payloads are only meaningful when they
+ *  are marked as valid
+ */
+typedef struct {
+  litl_trace_arrow_t* arrow; /**< The export the batch belongs to */
+  litl_size_t nb_events; /**< A number of events in the batch */
+
+  uint16_t* processes; /**< The indexes of the processes of the events */
+  uint64_t* times; /**< The time stamps of the events */
+  uint64_t* tids; /**< The thread IDs of the events */
+  uint32_t* codes; /**< The codes of the events */
+  uint8_t* types; /**< The types of the events */
+  uint8_t* nb_params; /**< The numbers of parameters of the regular and decoded packed events, 0 for the other events */
+  uint64_t* params[LITL_MAX_PARAMS]; /**< One column per parameter of the regular and decoded packed events */
+  uint8_t* validity[LITL_MAX_PARAMS]; /**< The validity bitmaps of the parameter columns */
+  int32_t* data_offsets; /**< The offsets of the payloads in data, plus the end of the last one */
+  uint8_t* data_validity; /**< The validity bitmap of the data column */
+  uint8_t* data; /**< The payloads of the raw events and of the packed events that cannot be decoded */
+  litl_size_t data_size; /**< A size of the payloads */
+  litl_size_t data_capacity; /**< A size of the allocated payloads */
+} litl_arrow_batch_t;
+
 /*
  * Defining formats for printing data
  */
@@ -7,6 +7,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <math.h>
 #include <pthread.h>
@@ -16,12 +17,18 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/mman.h>
+#include <link.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "litl_timer.h"
 #include "litl_tools.h"
 #include "litl_write.h"
 #include "litl_config.h"
 
+static void __litl_write_snapshot_modules(litl_write_trace_t* trace);
+
 /*
  * Adds a header to the trace file with the information regarding:
  *   - OS
@@ -61,9 +68,10 @@ static void __litl_write_add_trace_header(litl_write_trace_t* trace) {
   filename++;
   sprintf((char*) ((litl_process_header_t *) trace->header)->process_name, "%s",
 	  filename);
-  ((litl_process_header_t *) trace->header)->nb_threads = trace->nb_threads;
+  ((litl_process_header_t *) trace->header)->nb_threads =
+    trace->header_nb_threads;
   ((litl_process_header_t *) trace->header)->header_nb_threads =
-    trace->nb_threads;
+    trace->header_nb_threads;
   ((litl_process_header_t *) trace->header)->buffer_size = trace->buffer_size;
   ((litl_process_header_t *) trace->header)->trace_size = 0;
   ((litl_process_header_t *) trace->header)->offset =
@@ -76,6 +84,22 @@ static void __litl_write_add_trace_header(litl_write_trace_t* trace) {
   trace->header += sizeof(litl_process_header_t);
 }
 
+/*
+ * Allocates a thread-specific buffer descriptor on its own cache line
+ */
+static litl_write_buffer_t* __litl_write_alloc_buffer_desc() {
+  litl_write_buffer_t* buf;
+
+  if (posix_memalign((void**) &buf, LITL_CACHELINE_SIZE,
+		     sizeof(litl_write_buffer_t)) != 0) {
+    perror("Could not allocate memory for a thread\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(buf, 0, sizeof(litl_write_buffer_t));
+
+  return buf;
+}
+
 /*
  * Initializes the trace buffer
  */
@@ -83,11 +107,14 @@ litl_write_trace_t* litl_write_init_trace(const litl_size_t buf_size) {
   litl_med_size_t i;
   litl_write_trace_t* trace;
 
-  trace = (litl_write_trace_t*) malloc(sizeof(litl_write_trace_t));
-  if (!trace) {
+  // the trace is aligned on a cache line, so that the fields read by the
+  //   recording threads do not share a cache line with other data
+  if (posix_memalign((void**) &trace, LITL_CACHELINE_SIZE,
+		     sizeof(litl_write_trace_t)) != 0) {
     perror("Could not allocate memory for the trace!");
     exit(EXIT_FAILURE);
   }
+  memset(trace, 0, sizeof(litl_write_trace_t));
 
   // set variables
   trace->filename = NULL;
@@ -112,19 +139,40 @@ litl_write_trace_t* litl_write_init_trace(const litl_size_t buf_size) {
   }
 
   for (i = 0; i < trace->nb_allocated_buffers; i++) {
-    // initialize the array already_flushed
-    trace->buffers[i] = malloc(sizeof(litl_write_buffer_t));
-    if (!trace->buffers[i]) {
-      perror("Could not allocate memory for a thread\n");
-      exit(EXIT_FAILURE);
-    }
-    trace->buffers[i]->already_flushed = 0;
-
-    // initialize tids by zeros; this is needed for __is_tid and __find_slot
-    trace->buffers[i]->tid = 0;
+    // the descriptor is zeroed: already_flushed and tid are initialized to 0;
+    //   this is needed for __is_tid and __find_slot
+    trace->buffers[i] = __litl_write_alloc_buffer_desc();
   }
   trace->nb_threads = 0;
 
+  trace->schemas = calloc(LITL_SCHEMA_HASH_SIZE, sizeof(litl_write_schema_t*));
+  if (!trace->schemas) {
+    perror("Could not allocate memory for the event schemas!");
+    exit(EXIT_FAILURE);
+  }
+  trace->nb_schemas = 0;
+  pthread_mutex_init(&trace->lock_schemas, NULL );
+
+  trace->strings = calloc(LITL_STRING_HASH_SIZE, sizeof(litl_write_string_t*));
+  if (!trace->strings) {
+    perror("Could not allocate memory for the interned strings!");
+    exit(EXIT_FAILURE);
+  }
+  trace->nb_strings = 0;
+  trace->strings_size = 0;
+  pthread_mutex_init(&trace->lock_strings, NULL );
+
+  trace->chunks = NULL;
+  trace->nb_chunks = 0;
+  trace->nb_allocated_chunks = 0;
+
+  trace->code_stats = NULL;
+  trace->nb_code_stats = 0;
+  trace->nb_allocated_code_stats = 0;
+
+  trace->sections = NULL;
+  trace->sections_size = 0;
+
   // initialize the timing mechanism
   litl_time_initialize();
 
@@ -159,6 +207,16 @@ litl_write_trace_t* litl_write_init_trace(const litl_size_t buf_size) {
   if (str && (strcmp(str, "0") == 0))
     litl_write_tid_recording_off(trace);
 
+  // set trace->allow_modules_recording using the environment variable.
+  //   By default the loaded modules are recorded, so that code addresses
+  //   can be symbolized
+  trace->allow_modules_recording = 1;
+  str = getenv("LITL_MODULES_RECORDING");
+  if (str && (strcmp(str, "0") == 0))
+    trace->allow_modules_recording = 0;
+  pthread_mutex_init(&trace->lock_modules, NULL );
+  __litl_write_snapshot_modules(trace);
+
   trace->is_recording_paused = 0;
   trace->is_litl_initialized = 1;
 
@@ -175,9 +233,8 @@ static litl_size_t __litl_write_get_header_size(litl_write_trace_t* trace) {
 /*
  * Computes the size of data in buffer
  */
-static litl_size_t __litl_write_get_buffer_size(litl_write_trace_t* trace,
-						litl_med_size_t pos) {
-  return (trace->buffers[pos]->buffer - trace->buffers[pos]->buffer_ptr);
+static litl_size_t __litl_write_get_buffer_size(litl_write_buffer_t* p_buffer) {
+  return (p_buffer->buffer - p_buffer->buffer_ptr);
 }
 
 /*
@@ -265,18 +322,21 @@ void litl_write_set_filename(litl_write_trace_t* trace, char* filename) {
  * Records an event with offset only
  */
 static void __litl_write_probe_offset(litl_write_trace_t* trace,
-				      litl_med_size_t index) {
-  if (!trace->is_litl_initialized || trace->is_recording_paused)
+				      litl_write_buffer_t* p_buffer) {
+  // the offset event terminates a chunk of events. It is recorded even when
+  //   the recording is paused, otherwise the reader would not find the end of
+  //   the chunk
+  if (!trace->is_litl_initialized)
     return;
 
-  litl_t* cur_ptr = (litl_t *) trace->buffers[index]->buffer;
+  litl_t* cur_ptr = (litl_t *) p_buffer->buffer;
   cur_ptr->time = 0;
   cur_ptr->code = LITL_OFFSET_CODE;
   cur_ptr->type = LITL_TYPE_REGULAR;
   cur_ptr->parameters.offset.nb_params = 1;
   cur_ptr->parameters.offset.offset = 0;
 
-  trace->buffers[index]->buffer += __litl_get_gen_event_size(cur_ptr);
+  p_buffer->buffer += __litl_get_gen_event_size(cur_ptr);
 }
 
 /* Open the trace file. If the file already exists, delete it first
@@ -329,15 +389,22 @@ static void __litl_write_flush_header(litl_write_trace_t* trace) {
     // open the trace file
     __litl_open_new_file(trace);
 
+    // threads may start meanwhile: the header only holds the threads that
+    //   are registered now, the others are added when they flush
+    litl_med_size_t i, nb_threads;
+    pthread_mutex_lock(&trace->lock_buffer_init);
+    nb_threads = trace->nb_threads;
+    pthread_mutex_unlock(&trace->lock_buffer_init);
+    trace->header_nb_threads = nb_threads;
+
     // add a header to the trace file
     trace->header_size = sizeof(litl_general_header_t)
       + sizeof(litl_process_header_t)
-      + (trace->nb_threads + 1) * sizeof(litl_thread_pair_t);
+      + (nb_threads + 1) * sizeof(litl_thread_pair_t);
     __litl_write_add_trace_header(trace);
 
     // add information about each working thread: (tid, offset)
-    litl_med_size_t i;
-    for (i = 0; i < trace->nb_threads; i++) {
+    for (i = 0; i < nb_threads; i++) {
       ((litl_thread_pair_t *) trace->header)->tid = trace->buffers[i]->tid;
       ((litl_thread_pair_t *) trace->header)->offset = 0;
 
@@ -364,7 +431,6 @@ static void __litl_write_flush_header(litl_write_trace_t* trace) {
 
     trace->general_offset = __litl_write_get_header_size(trace);
 
-    trace->header_nb_threads = trace->nb_threads;
     trace->threads_offset = 0;
     trace->nb_slots = 0;
 
@@ -377,7 +443,7 @@ static void __litl_write_flush_header(litl_write_trace_t* trace) {
  * Write the thread-specific header to disk
  */
 static void __litl_write_flush_thread_header(litl_write_trace_t* trace,
-					     litl_med_size_t index,
+					     litl_write_buffer_t* p_buffer,
 					     litl_offset_t header_size) {
   litl_offset_t offset;
   int res;
@@ -402,8 +468,7 @@ static void __litl_write_flush_thread_header(litl_write_trace_t* trace,
 
   // add a new pair (tid, offset)
   lseek(trace->f_handle, trace->header_offset, SEEK_SET);
-  res = write(trace->f_handle, &trace->buffers[index]->tid,
-	      sizeof(litl_tid_t));
+  res = write(trace->f_handle, &p_buffer->tid, sizeof(litl_tid_t));
   assert(res >= 0);
   offset = trace->general_offset - header_size;
   res = write(trace->f_handle, &offset, sizeof(litl_offset_t));
@@ -418,7 +483,7 @@ static void __litl_write_flush_thread_header(litl_write_trace_t* trace,
   assert(res >= 0);
 
   trace->header_offset += sizeof(litl_thread_pair_t);
-  trace->buffers[index]->already_flushed = 1;
+  p_buffer->already_flushed = 1;
 
   // updated the number of threads
   // TODO: perform update only once 'cause there is duplication
@@ -431,26 +496,98 @@ static void __litl_write_flush_thread_header(litl_write_trace_t* trace,
  * Update the thread-specific header and write it to disk
  */
 static void __litl_write_update_thread_header(litl_write_trace_t* trace,
-					      litl_med_size_t index,
+					      litl_write_buffer_t* p_buffer,
 					      litl_offset_t header_size) {
     // update the previous offset of the current thread,
     //   updating the location in the file
-    lseek(trace->f_handle, trace->buffers[index]->offset, SEEK_SET);
+    lseek(trace->f_handle, p_buffer->offset, SEEK_SET);
     litl_offset_t offset = trace->general_offset - header_size;
     int res = write(trace->f_handle, &offset, sizeof(litl_offset_t));
     assert(res >= 0);
 }
 
+/*
+ * Adds the chunk of events of a buffer, which is about to be flushed at a
+ *   given offset, to the chunk index
+ */
+static void __litl_write_index_chunk(litl_write_trace_t* trace,
+				     litl_write_buffer_t* p_buffer,
+				     litl_offset_t offset) {
+  litl_chunk_t chunk;
+  litl_code_stats_t* code_stats = NULL;
+  litl_buffer_t pos;
+  litl_size_t size;
+  litl_t* event;
+
+  chunk.nb_events = 0;
+  chunk.first_time = chunk.last_time = 0;
+  __litl_chunk_init_codes(&chunk);
+  for (pos = p_buffer->buffer_ptr; pos < p_buffer->buffer; pos += size) {
+    event = (litl_t*) pos;
+    size = __litl_get_gen_event_size(event);
+    // the definitions of interned strings and the runs of sorted traces are
+    //   not returned by the reader
+    if ((event->code == LITL_STRING_CODE && event->type == LITL_TYPE_RAW)
+	|| (event->code == LITL_RUN_CODE && event->type == LITL_TYPE_REGULAR))
+      continue;
+    if (!chunk.nb_events)
+      chunk.first_time = event->time;
+    chunk.last_time = event->time;
+    chunk.nb_events++;
+    __litl_chunk_add_code(&chunk, event->code);
+
+    // the events of a chunk often have the same code as the previous one
+    if (!code_stats || code_stats->code != event->code)
+      code_stats = __litl_get_code_stats(&trace->code_stats,
+                                         &trace->nb_code_stats,
+                                         &trace->nb_allocated_code_stats,
+                                         event->code);
+    code_stats->nb_events++;
+    code_stats->size += size;
+    p_buffer->stats.size += size;
+  }
+
+  if (!chunk.nb_events)
+    return;
+
+  if (!p_buffer->stats.nb_events) {
+    p_buffer->stats.tid = p_buffer->tid;
+    p_buffer->stats.thread_offset = p_buffer->first_offset;
+    p_buffer->stats.first_time = chunk.first_time;
+  }
+  p_buffer->stats.nb_events += chunk.nb_events;
+  p_buffer->stats.last_time = chunk.last_time;
+
+  chunk.tid = p_buffer->tid;
+  chunk.thread_offset = p_buffer->first_offset;
+  chunk.offset = offset;
+
+  if (trace->nb_chunks == trace->nb_allocated_chunks) {
+    trace->nb_allocated_chunks = trace->nb_allocated_chunks ?
+      2 * trace->nb_allocated_chunks : 256;
+    trace->chunks = realloc(trace->chunks,
+			    trace->nb_allocated_chunks * sizeof(litl_chunk_t));
+    if (!trace->chunks) {
+      perror("Could not allocate memory for the chunk index!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  trace->chunks[trace->nb_chunks++] = chunk;
+}
+
 /*
  * Writes the recorded events from the buffer to the trace file
  */
 static void __litl_write_flush_buffer(litl_write_trace_t* trace,
-				      litl_med_size_t index) {
+				      litl_write_buffer_t* p_buffer) {
   int res __attribute__ ((__unused__));
   litl_offset_t header_size;
   if (!trace->is_litl_initialized)
     return;
 
+  // modules may have been loaded with dlopen since the last flush
+  __litl_write_snapshot_modules(trace);
+
   if (trace->allow_thread_safety)
     pthread_mutex_lock(&trace->lock_litl_flush);
 
@@ -461,51 +598,53 @@ static void __litl_write_flush_buffer(litl_write_trace_t* trace,
 
   header_size = sizeof(litl_general_header_t) + sizeof(litl_process_header_t);
   // handle the situation when some threads start after the header was flushed
-  if (!trace->buffers[index]->already_flushed) {
-    __litl_write_flush_thread_header(trace, index, header_size);
+  if (!p_buffer->already_flushed) {
+    __litl_write_flush_thread_header(trace, p_buffer, header_size);
   } else {
-    __litl_write_update_thread_header(trace, index, header_size);
+    __litl_write_update_thread_header(trace, p_buffer, header_size);
   }
 
+  // the chunks are never written at offset 0, which is taken by the pairs
+  if (!p_buffer->first_offset)
+    p_buffer->first_offset = trace->general_offset - header_size;
+  __litl_write_index_chunk(trace, p_buffer,
+			   trace->general_offset - header_size);
+
   // add an event with offset
-  __litl_write_probe_offset(trace, index);
+  __litl_write_probe_offset(trace, p_buffer);
   lseek(trace->f_handle, trace->general_offset, SEEK_SET);
-  if (write(trace->f_handle, trace->buffers[index]->buffer_ptr,
-	    __litl_write_get_buffer_size(trace, index)) == -1) {
+  if (write(trace->f_handle, p_buffer->buffer_ptr,
+	    __litl_write_get_buffer_size(p_buffer)) == -1) {
     perror(
 	"Flushing the buffer. Could not write measured data to the trace file!");
     exit(EXIT_FAILURE);
   }
 
   // update the general_offset
-  trace->general_offset += __litl_write_get_buffer_size(trace, index);
+  trace->general_offset += __litl_write_get_buffer_size(p_buffer);
   // update the current offset of the thread
-  trace->buffers[index]->offset = trace->general_offset - sizeof(litl_offset_t);
+  p_buffer->offset = trace->general_offset - sizeof(litl_offset_t);
 
   if (trace->allow_thread_safety)
     pthread_mutex_unlock(&trace->lock_litl_flush);
 
-  trace->buffers[index]->buffer = trace->buffers[index]->buffer_ptr;
+  p_buffer->buffer = p_buffer->buffer_ptr;
 }
 
 /*
- * Checks whether the trace buffer was allocated. If no, then allocate
- *    the buffer and, for otherwise too, returns the position of
- *    the thread buffer in the array buffer_ptr/buffer.
+ * Allocates the buffer of the current thread and stores a pointer to its
+ *    descriptor in the thread-specific key
  */
 static void __litl_write_allocate_buffer(litl_write_trace_t* trace) {
-  litl_med_size_t* pos;
+  litl_write_buffer_t* p_buffer;
 
   // thread safe region
   pthread_mutex_lock(&trace->lock_buffer_init);
 
-  pos = malloc(sizeof(litl_med_size_t));
-  *pos = trace->nb_threads;
-  int thread_id = *pos;
-  pthread_setspecific(trace->index, pos);
+  litl_size_t thread_id = trace->nb_threads;
   trace->nb_threads++;
 
-  if (*pos >= trace->nb_allocated_buffers) {
+  if (thread_id >= trace->nb_allocated_buffers) {
     // We need to allocate a bigger array of buffers
     void* ptr = realloc(
 	trace->buffers,
@@ -519,19 +658,15 @@ static void __litl_write_allocate_buffer(litl_write_trace_t* trace) {
     unsigned i;
     for (i = trace->nb_allocated_buffers; i < 2 * trace->nb_allocated_buffers;
 	i++) {
-      trace->buffers[i] = malloc(sizeof(litl_write_buffer_t));
-      if (!trace->buffers[i]) {
-	perror("Could not allocate memory for a thread\n!");
-	exit(EXIT_FAILURE);
-      }
-      trace->buffers[i]->already_flushed = 0;
-      trace->buffers[i]->initialized = 0;
+      trace->buffers[i] = __litl_write_alloc_buffer_desc();
     }
     trace->nb_allocated_buffers *= 2;
   }
 
-  trace->buffers[thread_id]->tid = CUR_TID;
-  trace->buffers[thread_id]->already_flushed = 0;
+  p_buffer = trace->buffers[thread_id];
+  p_buffer->tid = CUR_TID;
+  p_buffer->already_flushed = 0;
+  pthread_setspecific(trace->index, p_buffer);
 
   pthread_mutex_unlock(&trace->lock_buffer_init);
 
@@ -551,13 +686,13 @@ static void __litl_write_allocate_buffer(litl_write_trace_t* trace) {
   mmap_flags |= MAP_POPULATE;
 #endif
 
-  trace->buffers[thread_id]->buffer_ptr = mmap(NULL,
-					       length,
-					       PROT_READ|PROT_WRITE,
-					       mmap_flags,
-					       -1,
-					       0);
-  if(trace->buffers[thread_id]->buffer_ptr == MAP_FAILED) {
+  p_buffer->buffer_ptr = mmap(NULL,
+			      length,
+			      PROT_READ|PROT_WRITE,
+			      mmap_flags,
+			      -1,
+			      0);
+  if(p_buffer->buffer_ptr == MAP_FAILED) {
     perror("mmap");
   }
 
@@ -566,24 +701,24 @@ static void __litl_write_allocate_buffer(litl_write_trace_t* trace) {
   if(length> 1024*1024)
     length=1024*1024;
 #endif	/* if MAP_POPULATE is not available, touch the whole buffer to avoid future page faults */
-  memset(trace->buffers[thread_id]->buffer_ptr, 0, length);
+  memset(p_buffer->buffer_ptr, 0, length);
 
 #else  /* USE_MMAP */
   size_t length = trace->buffer_size + __litl_get_reg_event_size(LITL_MAX_PARAMS) + __litl_get_reg_event_size(1);
-  trace->buffers[thread_id]->buffer_ptr = malloc(length);
+  p_buffer->buffer_ptr = malloc(length);
 #endif	/* USE_MMAP */
 
-  if (!trace->buffers[thread_id]->buffer_ptr) {
+  if (!p_buffer->buffer_ptr) {
     perror("Could not allocate memory buffer for the thread\n!");
     exit(EXIT_FAILURE);
   }
 
   // touch the memory so that it is allocated for real (otherwise, this may
   //    cause performance issues on NUMA machines)
-  memset(trace->buffers[thread_id]->buffer_ptr, 1, 1);
-  trace->buffers[thread_id]->buffer = trace->buffers[thread_id]->buffer_ptr;
+  memset(p_buffer->buffer_ptr, 1, 1);
+  p_buffer->buffer = p_buffer->buffer_ptr;
 
-  trace->buffers[thread_id]->initialized = 1;
+  p_buffer->initialized = 1;
 }
 
 /*
@@ -592,30 +727,30 @@ static void __litl_write_allocate_buffer(litl_write_trace_t* trace) {
  */
 litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
 			       litl_code_t code, int param_size) {
-  litl_med_size_t index = 0;
   litl_t*retval = NULL;
   litl_size_t event_size = __litl_get_event_size(type, param_size);
 
+  // the event would not fit even in an empty buffer
+  if (trace && event_size >= trace->buffer_size)
+    return NULL;
+
   if (trace && trace->is_litl_initialized && !trace->is_recording_paused
     && !trace->is_buffer_full) {
 
-    // find the thread index
-    litl_med_size_t *p_index = pthread_getspecific(trace->index);
-    if (!p_index) {
+    // find the thread buffer
+    litl_write_buffer_t *p_buffer = pthread_getspecific(trace->index);
+    if (!p_buffer) {
       __litl_write_allocate_buffer(trace);
-      p_index = pthread_getspecific(trace->index);
-      if(!p_index)
+      p_buffer = pthread_getspecific(trace->index);
+      if(!p_buffer)
 	return NULL;
     }
-    index = *(litl_med_size_t *) p_index;
 
-    if(trace->buffers[index]->initialized == 0)
+    if(p_buffer->initialized == 0)
       return NULL;
 
-    litl_write_buffer_t *p_buffer = trace->buffers[index];
-
     // is there enough space in the buffer?
-    litl_size_t used_memory= __litl_write_get_buffer_size(trace, index);
+    litl_size_t used_memory= __litl_write_get_buffer_size(p_buffer);
 
     if (used_memory+event_size < trace->buffer_size) {
       // there is enough space for this event
@@ -628,7 +763,8 @@ litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
 
       switch (type) {
       case LITL_TYPE_REGULAR:
-	cur_ptr->parameters.regular.nb_params = (param_size) / sizeof(litl_param_t);
+	// for regular events, param_size is the number of parameters
+	cur_ptr->parameters.regular.nb_params = param_size;
 	break;
       case LITL_TYPE_RAW:
 	cur_ptr->parameters.raw.size = param_size;
@@ -650,7 +786,7 @@ litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
       goto out;
     } else if (trace->allow_buffer_flush) {
       // not enough space. flush the buffer and retry
-      __litl_write_flush_buffer(trace, index);
+      __litl_write_flush_buffer(trace, p_buffer);
       retval =  __litl_write_get_event(trace, type, code, param_size);
       goto out;
     } else {
@@ -666,6 +802,30 @@ litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
 }
 
 
+/*
+ * For internal use only.
+ * Flushes the buffer of the current thread, unless events of a given size fit
+ *   in it. Returns 1 when these events start a chunk
+ */
+int __litl_write_reserve(litl_write_trace_t* trace, litl_size_t size) {
+  litl_write_buffer_t *p_buffer;
+
+  if (!trace || !trace->is_litl_initialized || trace->is_recording_paused
+      || trace->is_buffer_full)
+    return 0;
+
+  // the buffer is allocated with the first event
+  p_buffer = pthread_getspecific(trace->index);
+  if (!p_buffer)
+    return 1;
+
+  if (__litl_write_get_buffer_size(p_buffer) + size >= trace->buffer_size
+      && trace->allow_buffer_flush)
+    __litl_write_flush_buffer(trace, p_buffer);
+
+  return p_buffer->buffer == p_buffer->buffer_ptr;
+}
+
 /* Common function for recording a regular event.
  * This function fills all the fiels except for the parameters
  */
@@ -872,6 +1032,43 @@ litl_t* litl_write_probe_reg_10(litl_write_trace_t* trace, litl_code_t code,
   return cur_ptr;
 }
 
+/*
+ * Copies the payload of an event to the buffer. Large payloads are copied with
+ *   non-temporal stores: they are not read again before the buffer is flushed,
+ *   so there is no point in polluting the cache with them
+ */
+static void __litl_write_copy_data(void* dest, const void* src, size_t size) {
+#ifdef __SSE2__
+  if (size >= LITL_NT_COPY_THRESHOLD) {
+    // events are packed, so copy the first bytes until the destination is
+    //   aligned
+    size_t head = (-(uintptr_t) dest) & 15;
+    memcpy(dest, src, head);
+
+    char* d = (char*) dest + head;
+    const char* s = (const char*) src + head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+      __m128i x0 = _mm_loadu_si128((const __m128i *) s);
+      __m128i x1 = _mm_loadu_si128((const __m128i *) (s + 16));
+      __m128i x2 = _mm_loadu_si128((const __m128i *) (s + 32));
+      __m128i x3 = _mm_loadu_si128((const __m128i *) (s + 48));
+      _mm_stream_si128((__m128i *) d, x0);
+      _mm_stream_si128((__m128i *) (d + 16), x1);
+      _mm_stream_si128((__m128i *) (d + 32), x2);
+      _mm_stream_si128((__m128i *) (d + 48), x3);
+    }
+    // the non-temporal stores have to be visible before the buffer is flushed
+    _mm_sfence();
+
+    memcpy(d, s, size);
+    return;
+  }
+#endif
+  memcpy(dest, src, size);
+}
+
 /*
  * Records an event in a raw state, where the size is #args in the void* array.
  * That helps to discover places where the application has crashed
@@ -883,15 +1080,684 @@ litl_t* litl_write_probe_raw(litl_write_trace_t* trace, litl_code_t code,
 					  code,
 					  size+1);
   if(retval) {
-    litl_size_t i;
-    for (i = 0; i < size; i++) {
-      retval->parameters.raw.data[i] = data[i];
-    }
+    __litl_write_copy_data(retval->parameters.raw.data, data, size);
     retval->parameters.raw.data[size]='\0';
   }
   return retval;
 }
 
+/*
+ * Records a packed event with a binary payload of any size that fits in
+ *   the buffer
+ */
+litl_t* litl_write_probe_data(litl_write_trace_t* trace, litl_code_t code,
+			      litl_size_t size, const void* data) {
+  litl_t* retval = __litl_write_get_event(trace, LITL_TYPE_PACKED, code, size);
+  if (retval)
+    __litl_write_copy_data(retval->parameters.packed.param, data, size);
+  return retval;
+}
+
+/*
+ * Returns the maximum size of the payload of an event
+ */
+litl_size_t litl_write_get_max_data_size(litl_write_trace_t* trace) {
+  litl_size_t event_size = __litl_get_event_size(LITL_TYPE_PACKED, 0);
+
+  if (trace->buffer_size <= event_size)
+    return 0;
+  return trace->buffer_size - event_size - 1;
+}
+
+/*
+ * Returns the bucket of an event code in the hash table of schemas
+ */
+static litl_size_t __litl_write_schema_hash(litl_code_t code) {
+  return (code ^ (code >> 8) ^ (code >> 16)) % LITL_SCHEMA_HASH_SIZE;
+}
+
+/*
+ * Searches for the schema of an event code. Schemas are never removed, and a
+ *   new schema is published only once it is filled, so no lock is needed
+ */
+static litl_write_schema_t* __litl_write_find_schema(litl_write_trace_t* trace,
+						     litl_code_t code) {
+  litl_write_schema_t* p_schema = __atomic_load_n(
+      &trace->schemas[__litl_write_schema_hash(code)], __ATOMIC_ACQUIRE);
+
+  while (p_schema && p_schema->schema.code != code)
+    p_schema = p_schema->next;
+
+  return p_schema;
+}
+
+/*
+ * Registers the name and the parameter types of an event code
+ */
+int litl_write_register_event(litl_write_trace_t* trace, litl_code_t code,
+			      const char* name, litl_data_t nb_params,
+			      const litl_param_type_t types[]) {
+  litl_write_schema_t* p_schema;
+  litl_data_t i;
+
+  if (!trace || nb_params > LITL_MAX_PARAMS)
+    return -1;
+
+  pthread_mutex_lock(&trace->lock_schemas);
+  if (__litl_write_find_schema(trace, code)) {
+    pthread_mutex_unlock(&trace->lock_schemas);
+    return -1;
+  }
+
+  p_schema = calloc(1, sizeof(litl_write_schema_t));
+  if (!p_schema) {
+    perror("Could not allocate memory for an event schema!");
+    exit(EXIT_FAILURE);
+  }
+
+  p_schema->schema.code = code;
+  p_schema->schema.nb_params = nb_params;
+  p_schema->param_size = 0;
+  for (i = 0; i < nb_params; i++) {
+    p_schema->schema.types[i] = types[i];
+    p_schema->param_size += __litl_get_param_type_size(types[i]);
+  }
+  if (name)
+    strncpy((char*) p_schema->schema.name, name, LITL_SCHEMA_NAME_SIZE - 1);
+
+  // publish the schema
+  litl_size_t bucket = __litl_write_schema_hash(code);
+  p_schema->next = trace->schemas[bucket];
+  __atomic_store_n(&trace->schemas[bucket], p_schema, __ATOMIC_RELEASE);
+  trace->nb_schemas++;
+
+  pthread_mutex_unlock(&trace->lock_schemas);
+  return 0;
+}
+
+/*
+ * Computes the hash of a string (FNV-1a)
+ */
+static uint32_t __litl_write_string_hash(const char* str) {
+  uint32_t hash = 2166136261u;
+
+  while (*str) {
+    hash ^= (uint8_t) *str++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/*
+ * Searches for an interned string. As for schemas, strings are published once
+ *   they are filled, so no lock is needed
+ */
+static litl_write_string_t* __litl_write_find_string(litl_write_trace_t* trace,
+						     const char* str,
+						     uint32_t hash) {
+  litl_write_string_t* p_string = __atomic_load_n(
+      &trace->strings[hash % LITL_STRING_HASH_SIZE], __ATOMIC_ACQUIRE);
+
+  while (p_string && (p_string->hash != hash || strcmp(p_string->str, str)))
+    p_string = p_string->next;
+
+  return p_string;
+}
+
+/*
+ * Returns the ID of a string. The first time a string is interned, an event
+ *   that defines the string is recorded
+ */
+litl_string_id_t litl_write_intern_string(litl_write_trace_t* trace,
+					  const char* str) {
+  litl_write_string_t* p_string;
+  uint32_t hash = __litl_write_string_hash(str);
+
+  p_string = __litl_write_find_string(trace, str, hash);
+  if (p_string)
+    return p_string->id;
+
+  pthread_mutex_lock(&trace->lock_strings);
+  // another thread may have interned the string in the meantime
+  p_string = __litl_write_find_string(trace, str, hash);
+  if (!p_string) {
+    size_t len = strlen(str);
+
+    p_string = malloc(sizeof(litl_write_string_t) + len + 1);
+    if (!p_string) {
+      perror("Could not allocate memory for an interned string!");
+      exit(EXIT_FAILURE);
+    }
+    p_string->hash = hash;
+    p_string->id = trace->nb_strings++;
+    memcpy(p_string->str, str, len + 1);
+    trace->strings_size += sizeof(litl_string_id_t) + len + 1;
+
+    // record the definition before publishing the string, so that the
+    //   events that use the string are recorded after its definition
+    litl_t* retval = __litl_write_get_event(trace, LITL_TYPE_RAW,
+					    LITL_STRING_CODE,
+					    sizeof(litl_string_id_t) + len + 1);
+    if (retval) {
+      memcpy(retval->parameters.raw.data, &p_string->id,
+	     sizeof(litl_string_id_t));
+      memcpy(retval->parameters.raw.data + sizeof(litl_string_id_t), str,
+	     len + 1);
+    }
+
+    litl_size_t bucket = hash % LITL_STRING_HASH_SIZE;
+    p_string->next = trace->strings[bucket];
+    __atomic_store_n(&trace->strings[bucket], p_string, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&trace->lock_strings);
+
+  return p_string->id;
+}
+
+/*
+ * Records a packed event whose parameters are described by a schema
+ */
+litl_t* litl_write_probe_typed(litl_write_trace_t* trace, litl_code_t code,
+			       ...) {
+  litl_write_schema_t* p_schema;
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_data_t i;
+  va_list ap;
+
+  if (!trace || !trace->is_litl_initialized || trace->is_recording_paused)
+    return NULL;
+
+  p_schema = __litl_write_find_schema(trace, code);
+  if (!p_schema)
+    return NULL;
+
+  // fetch the parameters first: interning a string may record an event, so
+  //   it has to be done before allocating this event
+  va_start(ap, code);
+  for (i = 0; i < p_schema->schema.nb_params; i++) {
+    switch (p_schema->schema.types[i]) {
+    case LITL_PARAM_UINT8:
+    case LITL_PARAM_INT8:
+    case LITL_PARAM_UINT16:
+    case LITL_PARAM_INT16:
+      params[i].value.u = va_arg(ap, int);
+      break;
+    case LITL_PARAM_UINT32:
+    case LITL_PARAM_INT32:
+      params[i].value.u = va_arg(ap, uint32_t);
+      break;
+    case LITL_PARAM_UINT64:
+    case LITL_PARAM_INT64:
+      params[i].value.u = va_arg(ap, uint64_t);
+      break;
+    case LITL_PARAM_FLOAT:
+    case LITL_PARAM_DOUBLE:
+      params[i].value.d = va_arg(ap, double);
+      break;
+    case LITL_PARAM_POINTER:
+    case LITL_PARAM_ADDRESS:
+      params[i].value.u = (uintptr_t) va_arg(ap, void*);
+      break;
+    case LITL_PARAM_STRING:
+      params[i].value.u = litl_write_intern_string(trace,
+						   va_arg(ap, const char*));
+      break;
+    default:
+      fprintf(stderr, "Unknown parameter type %d\n",
+	      p_schema->schema.types[i]);
+      abort();
+    }
+  }
+  va_end(ap);
+
+  litl_t* retval = __litl_write_get_event(trace, LITL_TYPE_PACKED, code,
+					  p_schema->param_size);
+  if (!retval)
+    return NULL;
+
+  void* _ptr_ = &retval->parameters.packed.param[0];
+  for (i = 0; i < p_schema->schema.nb_params; i++) {
+    switch (__litl_get_param_type_size(p_schema->schema.types[i])) {
+    case 1: {
+      uint8_t param = params[i].value.u;
+      __LITL_WRITE_ADD_ARG(_ptr_, param);
+      break;
+    }
+    case 2: {
+      uint16_t param = params[i].value.u;
+      __LITL_WRITE_ADD_ARG(_ptr_, param);
+      break;
+    }
+    case 4: {
+      if (p_schema->schema.types[i] == LITL_PARAM_FLOAT) {
+	float param = params[i].value.d;
+	__LITL_WRITE_ADD_ARG(_ptr_, param);
+      } else {
+	uint32_t param = params[i].value.u;
+	__LITL_WRITE_ADD_ARG(_ptr_, param);
+      }
+      break;
+    }
+    default:
+      // 8-byte parameters are copied as is, including doubles
+      __LITL_WRITE_ADD_ARG(_ptr_, params[i].value.u);
+      break;
+    }
+  }
+
+  return retval;
+}
+
+/*
+ * Makes sure that an event code has a schema with a single parameter of a
+ *   given type. The first time the code is used, its schema is registered
+ */
+static int __litl_write_check_single_schema(litl_write_trace_t* trace,
+					    litl_code_t code,
+					    litl_param_type_t type) {
+  litl_write_schema_t* p_schema;
+
+  p_schema = __litl_write_find_schema(trace, code);
+  if (!p_schema) {
+    litl_write_register_event(trace, code, NULL, 1, &type);
+    p_schema = __litl_write_find_schema(trace, code);
+  }
+  if (p_schema->schema.nb_params != 1 || p_schema->schema.types[0] != type)
+    return -1;
+
+  return 0;
+}
+
+/*
+ * Records an event whose parameter is an interned string
+ */
+litl_t* litl_write_probe_str(litl_write_trace_t* trace, litl_code_t code,
+			     const char* str) {
+  if (!trace
+      || __litl_write_check_single_schema(trace, code, LITL_PARAM_STRING) != 0)
+    return NULL;
+
+  return litl_write_probe_typed(trace, code, str);
+}
+
+/*
+ * Records an event whose parameter is a code address
+ */
+litl_t* litl_write_probe_address(litl_write_trace_t* trace, litl_code_t code,
+				 const void* address) {
+  if (!trace
+      || __litl_write_check_single_schema(trace, code, LITL_PARAM_ADDRESS) != 0)
+    return NULL;
+
+  return litl_write_probe_typed(trace, code, address);
+}
+
+/*
+ * Records an event whose parameter is the address the function is called from
+ */
+__attribute__((noinline))
+litl_t* litl_write_probe_call_site(litl_write_trace_t* trace,
+				   litl_code_t code) {
+  return litl_write_probe_address(trace, code, __builtin_return_address(0));
+}
+
+/*
+ * Reads the GNU build-id of a loaded module from its notes
+ */
+static void __litl_write_get_build_id(struct dl_phdr_info* info,
+				      const ElfW(Phdr)* phdr,
+				      litl_module_t* module) {
+  const char* note = (const char*) (info->dlpi_addr + phdr->p_vaddr);
+  const char* end = note + phdr->p_memsz;
+
+  while (note + sizeof(ElfW(Nhdr)) <= end) {
+    const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr)*) note;
+    const char* name = note + sizeof(ElfW(Nhdr));
+    const char* desc = name + ((nhdr->n_namesz + 3) & ~3);
+
+    if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4
+	&& memcmp(name, "GNU", 4) == 0) {
+      module->build_id_size = nhdr->n_descsz < LITL_BUILD_ID_SIZE ?
+	nhdr->n_descsz : LITL_BUILD_ID_SIZE;
+      memcpy(module->build_id, desc, module->build_id_size);
+      return;
+    }
+    note = desc + ((nhdr->n_descsz + 3) & ~3);
+  }
+}
+
+/*
+ * Adds a loaded module to the list of modules, unless it was already there.
+ *   This is called by dl_iterate_phdr for each module
+ */
+static int __litl_write_add_module(struct dl_phdr_info* info,
+				   size_t size __attribute__ ((__unused__)),
+				   void* data) {
+  litl_write_trace_t* trace = data;
+  litl_module_t module;
+  litl_size_t i;
+  ssize_t len;
+
+  // the first module is the executable. If no module was loaded or unloaded
+  //   since the last snapshot, stop here
+  if (info->dlpi_name && info->dlpi_name[0] == '\0') {
+    if (trace->nb_modules
+	&& info->dlpi_adds == trace->modules_adds)
+      return 1;
+    trace->modules_adds = info->dlpi_adds;
+  }
+
+  memset(&module, 0, sizeof(module));
+  module.load_time = litl_get_time();
+  module.base = info->dlpi_addr;
+  module.start = (litl_param_t) -1;
+  for (i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+
+    if (phdr->p_type == PT_LOAD) {
+      if (info->dlpi_addr + phdr->p_vaddr < module.start)
+	module.start = info->dlpi_addr + phdr->p_vaddr;
+      if (info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz > module.end)
+	module.end = info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz;
+    } else if (phdr->p_type == PT_NOTE && !module.build_id_size) {
+      __litl_write_get_build_id(info, phdr, &module);
+    }
+  }
+  if (module.start >= module.end)
+    return 0;
+
+  if (info->dlpi_name && info->dlpi_name[0] != '\0') {
+    strncpy((char*) module.path, info->dlpi_name, LITL_MODULE_PATH_SIZE - 1);
+  } else {
+    len = readlink("/proc/self/exe", (char*) module.path,
+		   LITL_MODULE_PATH_SIZE - 1);
+    if (len < 0)
+      len = 0;
+    module.path[len] = '\0';
+  }
+
+  // the module is already known if the last module loaded at this address is
+  //   the same
+  for (i = trace->nb_modules; i > 0; i--) {
+    litl_module_t* p_module = &trace->modules[i - 1];
+    if (p_module->start == module.start) {
+      if (p_module->base == module.base && p_module->end == module.end
+	  && strcmp((char*) p_module->path, (char*) module.path) == 0)
+	return 0;
+      break;
+    }
+  }
+
+  if (trace->nb_modules == trace->nb_allocated_modules) {
+    trace->nb_allocated_modules = trace->nb_allocated_modules ?
+      2 * trace->nb_allocated_modules : 64;
+    trace->modules = realloc(trace->modules,
+			     trace->nb_allocated_modules * sizeof(litl_module_t));
+    if (!trace->modules) {
+      perror("Could not allocate memory for the modules!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  trace->modules[trace->nb_modules++] = module;
+
+  return 0;
+}
+
+/*
+ * Takes a snapshot of the modules loaded by the process. The snapshot is
+ *   cheap when no module was loaded since the previous one
+ */
+static void __litl_write_snapshot_modules(litl_write_trace_t* trace) {
+  if (!trace->allow_modules_recording)
+    return;
+
+  pthread_mutex_lock(&trace->lock_modules);
+  dl_iterate_phdr(__litl_write_add_module, trace);
+  pthread_mutex_unlock(&trace->lock_modules);
+}
+
+/*
+ * Records the modules that were loaded since the last snapshot
+ */
+void litl_write_update_modules(litl_write_trace_t* trace) {
+  if (trace && trace->is_litl_initialized)
+    __litl_write_snapshot_modules(trace);
+}
+
+/*
+ * Enables recording the loaded modules
+ */
+void litl_write_modules_recording_on(litl_write_trace_t* trace) {
+  pthread_mutex_lock(&trace->lock_modules);
+  trace->allow_modules_recording = 1;
+  // the next snapshot must not be skipped
+  trace->modules_adds = 0;
+  pthread_mutex_unlock(&trace->lock_modules);
+  __litl_write_snapshot_modules(trace);
+}
+
+/*
+ * Disables recording the loaded modules and forgets the recorded ones
+ */
+void litl_write_modules_recording_off(litl_write_trace_t* trace) {
+  pthread_mutex_lock(&trace->lock_modules);
+  trace->allow_modules_recording = 0;
+  trace->nb_modules = 0;
+  pthread_mutex_unlock(&trace->lock_modules);
+}
+
+/*
+ * Writes a section after the events
+ */
+static void __litl_write_add_section(litl_write_trace_t* trace,
+				     litl_section_type_t type,
+				     const void* data, litl_trace_size_t size) {
+  litl_section_header_t header;
+
+  header.type = type;
+  header.size = size;
+
+  lseek(trace->f_handle, trace->general_offset, SEEK_SET);
+  if (write(trace->f_handle, &header, sizeof(header)) == -1
+      || (size && write(trace->f_handle, data, size) == -1)) {
+    perror("Could not write a section to the trace file!");
+    exit(EXIT_FAILURE);
+  }
+  trace->general_offset += sizeof(header) + size;
+}
+
+/*
+ * For internal use only.
+ * Adds a section that is written after the others
+ */
+void __litl_write_append_section(litl_write_trace_t* trace,
+				 litl_section_type_t type, const void* data,
+				 litl_trace_size_t size) {
+  litl_section_header_t header;
+
+  header.type = type;
+  header.size = size;
+
+  trace->sections = realloc(trace->sections,
+			    trace->sections_size + sizeof(header) + size);
+  if (!trace->sections) {
+    perror("Could not allocate memory for the trace sections!");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(trace->sections + trace->sections_size, &header, sizeof(header));
+  if (size)
+    memcpy(trace->sections + trace->sections_size + sizeof(header), data,
+	   size);
+  trace->sections_size += sizeof(header) + size;
+}
+
+/*
+ * Writes the table of event schemas
+ */
+static void __litl_write_add_schemas_section(litl_write_trace_t* trace) {
+  litl_event_schema_t* schemas;
+  litl_write_schema_t* p_schema;
+  litl_size_t i, nb_schemas = 0;
+
+  if (!trace->nb_schemas)
+    return;
+
+  schemas = malloc(trace->nb_schemas * sizeof(litl_event_schema_t));
+  if (!schemas) {
+    perror("Could not allocate memory for the event schemas!");
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < LITL_SCHEMA_HASH_SIZE; i++)
+    for (p_schema = trace->schemas[i]; p_schema; p_schema = p_schema->next)
+      schemas[nb_schemas++] = p_schema->schema;
+
+  __litl_write_add_section(trace, LITL_SECTION_SCHEMAS, schemas,
+			   nb_schemas * sizeof(litl_event_schema_t));
+  free(schemas);
+}
+
+/*
+ * Writes the dictionary of interned strings
+ */
+static void __litl_write_add_strings_section(litl_write_trace_t* trace) {
+  litl_buffer_t strings, ptr;
+  litl_write_string_t* p_string;
+  litl_size_t i;
+
+  if (!trace->nb_strings)
+    return;
+
+  strings = malloc(trace->strings_size);
+  if (!strings) {
+    perror("Could not allocate memory for the interned strings!");
+    exit(EXIT_FAILURE);
+  }
+
+  ptr = strings;
+  for (i = 0; i < LITL_STRING_HASH_SIZE; i++)
+    for (p_string = trace->strings[i]; p_string; p_string = p_string->next) {
+      size_t len = strlen(p_string->str) + 1;
+      memcpy(ptr, &p_string->id, sizeof(litl_string_id_t));
+      memcpy(ptr + sizeof(litl_string_id_t), p_string->str, len);
+      ptr += sizeof(litl_string_id_t) + len;
+    }
+
+  __litl_write_add_section(trace, LITL_SECTION_STRINGS, strings,
+			   trace->strings_size);
+  free(strings);
+}
+
+/*
+ * Writes the list of modules loaded by the process
+ */
+static void __litl_write_add_modules_section(litl_write_trace_t* trace) {
+  // take a last snapshot, in case modules were loaded since the last flush
+  __litl_write_snapshot_modules(trace);
+
+  if (!trace->nb_modules)
+    return;
+
+  __litl_write_add_section(trace, LITL_SECTION_MODULES, trace->modules,
+			   trace->nb_modules * sizeof(litl_module_t));
+}
+
+/*
+ * Writes the index of the chunks of events
+ */
+static void __litl_write_add_chunks_section(litl_write_trace_t* trace) {
+  litl_size_t version = LITL_CHUNKS_VERSION;
+  litl_trace_size_t size;
+  litl_buffer_t chunks;
+
+  if (!trace->nb_chunks)
+    return;
+
+  // the layout of the chunks is preceded by its version
+  size = sizeof(version) + trace->nb_chunks * sizeof(litl_chunk_t);
+  chunks = malloc(size);
+  if (!chunks) {
+    perror("Could not allocate memory for the chunk index!");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(chunks, &version, sizeof(version));
+  memcpy(chunks + sizeof(version), trace->chunks,
+	 trace->nb_chunks * sizeof(litl_chunk_t));
+
+  __litl_write_add_section(trace, LITL_SECTION_CHUNKS, chunks, size);
+  free(chunks);
+}
+
+/*
+ * Writes the statistics of the events per thread and per code
+ */
+static void __litl_write_add_stats_sections(litl_write_trace_t* trace) {
+  litl_thread_stats_t* thread_stats;
+  litl_med_size_t i, nb_threads = 0;
+
+  thread_stats = malloc(
+      (trace->nb_threads ? trace->nb_threads : 1) * sizeof(litl_thread_stats_t));
+  if (!thread_stats) {
+    perror("Could not allocate memory for the statistics of the events!");
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < trace->nb_threads; i++)
+    if (trace->buffers[i]->stats.nb_events)
+      thread_stats[nb_threads++] = trace->buffers[i]->stats;
+
+  __litl_write_add_section(trace, LITL_SECTION_THREAD_STATS, thread_stats,
+			   nb_threads * sizeof(litl_thread_stats_t));
+  __litl_write_add_section(trace, LITL_SECTION_CODE_STATS, trace->code_stats,
+			   trace->nb_code_stats * sizeof(litl_code_stats_t));
+  free(thread_stats);
+}
+
+/*
+ * Writes the sections and the trailer after the events. Then, updates the
+ *   trace size in the process header, so that the trailer can be found
+ */
+static void __litl_write_flush_sections(litl_write_trace_t* trace) {
+  litl_trailer_t trailer;
+  litl_trace_size_t trace_size;
+  litl_offset_t header_size = sizeof(litl_general_header_t)
+    + sizeof(litl_process_header_t);
+  int res __attribute__ ((__unused__));
+
+  trailer.sections_offset = trace->general_offset - header_size;
+  memcpy(trailer.magic, LITL_TRAILER_MAGIC, sizeof(trailer.magic));
+
+  __litl_write_add_schemas_section(trace);
+  __litl_write_add_strings_section(trace);
+  __litl_write_add_modules_section(trace);
+  __litl_write_add_chunks_section(trace);
+  __litl_write_add_stats_sections(trace);
+
+  // the sections added with __litl_write_append_section are already laid out
+  if (trace->sections_size) {
+    lseek(trace->f_handle, trace->general_offset, SEEK_SET);
+    if (write(trace->f_handle, trace->sections, trace->sections_size) == -1) {
+      perror("Could not write a section to the trace file!");
+      exit(EXIT_FAILURE);
+    }
+    trace->general_offset += trace->sections_size;
+  }
+
+  lseek(trace->f_handle, trace->general_offset, SEEK_SET);
+  if (write(trace->f_handle, &trailer, sizeof(trailer)) == -1) {
+    perror("Could not write the trailer to the trace file!");
+    exit(EXIT_FAILURE);
+  }
+  trace->general_offset += sizeof(trailer);
+
+  trace_size = trace->general_offset - header_size;
+  lseek(trace->f_handle, sizeof(litl_general_header_t)
+	+ __litl_offset_of(litl_process_header_t, trace_size), SEEK_SET);
+  res = write(trace->f_handle, &trace_size, sizeof(litl_trace_size_t));
+  assert(res >= 0);
+}
+
 /*
  * This function finalizes the trace
  */
@@ -901,10 +1767,14 @@ void litl_write_finalize_trace(litl_write_trace_t* trace) {
     return;
 
   for (i = 0; i < trace->nb_threads; i++) {
-    __litl_write_flush_buffer(trace, i);
+    __litl_write_flush_buffer(trace, trace->buffers[i]);
   }
 
-  close(trace->f_handle);
+  if (trace->is_header_flushed) {
+    __litl_write_flush_sections(trace);
+
+    close(trace->f_handle);
+  }
   trace->f_handle = -1;
 
   for (i = 0; i < trace->nb_allocated_buffers; i++) {
@@ -917,16 +1787,44 @@ void litl_write_finalize_trace(litl_write_trace_t* trace) {
       free(trace->buffers[i]->buffer_ptr);
 #endif
       trace->buffers[i]->buffer_ptr = NULL;
-    } else {
-      break;
     }
+    free(trace->buffers[i]);
   }
+  free(trace->buffers);
+  pthread_key_delete(trace->index);
 
   if (trace->allow_thread_safety) {
     pthread_mutex_destroy(&trace->lock_litl_flush);
   }
   pthread_mutex_destroy(&trace->lock_buffer_init);
 
+  for (i = 0; i < LITL_SCHEMA_HASH_SIZE; i++) {
+    while (trace->schemas[i]) {
+      litl_write_schema_t* p_schema = trace->schemas[i];
+      trace->schemas[i] = p_schema->next;
+      free(p_schema);
+    }
+  }
+  free(trace->schemas);
+  pthread_mutex_destroy(&trace->lock_schemas);
+
+  for (i = 0; i < LITL_STRING_HASH_SIZE; i++) {
+    while (trace->strings[i]) {
+      litl_write_string_t* p_string = trace->strings[i];
+      trace->strings[i] = p_string->next;
+      free(p_string);
+    }
+  }
+  free(trace->strings);
+  pthread_mutex_destroy(&trace->lock_strings);
+
+  free(trace->modules);
+  pthread_mutex_destroy(&trace->lock_modules);
+
+  free(trace->chunks);
+  free(trace->code_stats);
+  free(trace->sections);
+
   free(trace->filename);
   trace->filename = NULL;
   trace->is_litl_initialized = 0;
@@ -44,6 +44,11 @@
  * \ingroup litl_write
  */
 
+/**
+ * \defgroup litl_write_schema Functions for Recording Typed Events
+ * \ingroup litl_write
+ */
+
 /**
  * \ingroup litl_write_init
  * \brief Initializes the trace buffer
@@ -94,6 +99,23 @@ void litl_write_tid_recording_on(litl_write_trace_t* trace);
  */
 void litl_write_tid_recording_off(litl_write_trace_t* trace);
 
+/**
+ * \ingroup litl_write_init
+ * \brief Enable recording the loaded modules
+ * \param trace A pointer to the event recording object
+ */
+void litl_write_modules_recording_on(litl_write_trace_t* trace);
+
+/**
+ * \ingroup litl_write_init
+ * \brief Disable recording the loaded modules, and forget those recorded so
+ *  far, e.g. when the events of the trace were recorded by another process.
+ *  By default, it is enabled unless the LITL_MODULES_RECORDING environment
+ *  variable is set to 0
+ * \param trace A pointer to the event recording object
+ */
+void litl_write_modules_recording_off(litl_write_trace_t* trace);
+
 /**
  * \ingroup litl_write_init
  * \brief Pauses the event recording
@@ -306,16 +328,45 @@ litl_t* litl_write_probe_reg_10(litl_write_trace_t* trace, litl_code_t code,
 
 /**
  * \ingroup litl_write_raw
- * \brief Records an event with data in a string format
+ * \brief Records an event with data in a string format. A terminating NUL
+ *  is stored after the data, so the data can be as large as
+ *  litl_write_get_max_data_size() - 1 Bytes
  * \param trace A pointer to the event recording object
  * \param code An event code
  * \param size Size (in Bytes) of the data to store
  * \param data Data to store with this event
- * \return a pointer to the event that was recorded or NULL in case of error
+ * \return a pointer to the event that was recorded or NULL in case of error,
+ *  e.g. if the data does not fit in a buffer
  */
 litl_t* litl_write_probe_raw(litl_write_trace_t* trace, litl_code_t code,
 			     litl_size_t size, litl_data_t data[]);
 
+/**
+ * \ingroup litl_write_raw
+ * \brief Records an event with a binary payload. Unlike the packing macros,
+ *  the payload is not limited to LITL_MAX_DATA: it can be as large as
+ *  litl_write_get_max_data_size() Bytes. Large payloads are copied with
+ *  non-temporal stores
+ * \param trace A pointer to the event recording object
+ * \param code An event code
+ * \param size Size (in Bytes) of the data to store
+ * \param data Data to store with this event
+ * \return a pointer to the event that was recorded or NULL in case of error,
+ *  e.g. if the payload does not fit in a buffer
+ */
+litl_t* litl_write_probe_data(litl_write_trace_t* trace, litl_code_t code,
+			      litl_size_t size, const void* data);
+
+/**
+ * \ingroup litl_write_raw
+ * \brief Returns the maximum size of the payload of an event recorded with
+ *  litl_write_probe_data, which depends on the buffer size. The data of
+ *  litl_write_probe_raw is one Byte smaller
+ * \param trace A pointer to the event recording object
+ * \return The maximum size (in Bytes) of the payload
+ */
+litl_size_t litl_write_get_max_data_size(litl_write_trace_t* trace);
+
 /*** Internal-use macros ***/
 
 /**
@@ -330,6 +381,30 @@ litl_t* litl_write_probe_raw(litl_write_trace_t* trace, litl_code_t code,
 litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
                                litl_code_t code, int size);
 
+/**
+ * \ingroup litl_write_pack
+ * \brief For internal use only. Flushes the buffer of the current thread,
+ *  unless events of a given size fit in it, so that these events are stored
+ *  in the same chunk
+ * \param trace A pointer to the event recording object
+ * \param size A size of the events (in Bytes)
+ * \return 1 when the events start a chunk, 0 otherwise
+ */
+int __litl_write_reserve(litl_write_trace_t* trace, litl_size_t size);
+
+/**
+ * \ingroup litl_write_pack
+ * \brief For internal use only. Adds a section that is written after the
+ *  sections of the trace when it is finalized
+ * \param trace A pointer to the event recording object
+ * \param type A type of the section
+ * \param data The content of the section
+ * \param size A size of the content (in Bytes)
+ */
+void __litl_write_append_section(litl_write_trace_t* trace,
+                                 litl_section_type_t type, const void* data,
+                                 litl_trace_size_t size);
+
 /**
  * \ingroup litl_write_pack
  * \brief For internal use only. Adds a parameter to a packed event
@@ -740,6 +815,111 @@ litl_t* __litl_write_get_event(litl_write_trace_t* trace, litl_type_t type,
     retval = p_evt;							\
   } while(0)
 
+/*** Typed events ***/
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Registers the schema of an event code: its name and the types of
+ *  its parameters. The schema is stored in the trace
+ * \param trace A pointer to the event recording object
+ * \param code An event code
+ * \param name A name of the event
+ * \param nb_params A number of parameters (at most LITL_MAX_PARAMS)
+ * \param types An array of nb_params parameter types
+ * \return Returns -1 if an error occurs (e.g. the code is already
+ *  registered). Otherwise, returns 0
+ */
+int litl_write_register_event(litl_write_trace_t* trace, litl_code_t code,
+			      const char* name, litl_data_t nb_params,
+			      const litl_param_type_t types[]);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records a packed event whose parameters are stored with their
+ *  natural width, as given by the registered schema of the event code
+ * \param trace A pointer to the event recording object
+ * \param code An event code that was registered with
+ *  litl_write_register_event
+ * \param ... The parameters of the event. Each parameter must be passed with
+ *  the type it was registered with (e.g. uint64_t for LITL_PARAM_UINT64)
+ * \return a pointer to the event that was recorded or NULL in case of error
+ */
+litl_t* litl_write_probe_typed(litl_write_trace_t* trace, litl_code_t code,
+			       ...);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Interns a string. The first time a string is interned, an event that
+ *  defines it is recorded. The dictionary of strings is also stored in the
+ *  trace
+ * \param trace A pointer to the event recording object
+ * \param str A null-terminated string
+ * \return The ID of the string
+ */
+litl_string_id_t litl_write_intern_string(litl_write_trace_t* trace,
+					  const char* str);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records an event whose only parameter is a string. The string is
+ *  interned, so that the event only stores its 32-bit ID
+ * \param trace A pointer to the event recording object
+ * \param code An event code. It is registered with a single LITL_PARAM_STRING
+ *  parameter the first time it is used
+ * \param str A null-terminated string
+ * \return a pointer to the event that was recorded or NULL in case of error
+ */
+litl_t* litl_write_probe_str(litl_write_trace_t* trace, litl_code_t code,
+			     const char* str);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records an event whose only parameter is a code address. Only the
+ *  address is recorded: it is mapped to a module and a symbol when the trace
+ *  is read
+ * \param trace A pointer to the event recording object
+ * \param code An event code. It is registered with a single LITL_PARAM_ADDRESS
+ *  parameter the first time it is used
+ * \param address A code address
+ * \return a pointer to the event that was recorded or NULL in case of error
+ */
+litl_t* litl_write_probe_address(litl_write_trace_t* trace, litl_code_t code,
+				 const void* address);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records an event whose only parameter is the address this function
+ *  is called from, i.e. the call site of the probe
+ * \param trace A pointer to the event recording object
+ * \param code An event code
+ * \return a pointer to the event that was recorded or NULL in case of error
+ */
+litl_t* litl_write_probe_call_site(litl_write_trace_t* trace,
+				   litl_code_t code);
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records an event whose only parameter is the return address of the
+ *  current function, i.e. the call site of the current function in its caller
+ * \param trace A pointer to the event recording object
+ * \param code An event code
+ */
+#define litl_write_probe_caller(trace, code)				\
+  litl_write_probe_address(trace, code, __builtin_return_address(0))
+
+/**
+ * \ingroup litl_write_schema
+ * \brief Records the modules (executable and shared libraries) that were
+ *  loaded since the last snapshot. The modules are checked at initialization
+ *  and each time a buffer is flushed; this function should be called after
+ *  dlopen, so that the modules that are unloaded before the next flush are
+ *  also recorded.
+ *  The recording of modules can be disabled by setting the LITL_MODULES_RECORDING
+ *  environment variable to 0
+ * \param trace A pointer to the event recording object
+ */
+void litl_write_update_modules(litl_write_trace_t* trace);
+
 /**
  * \ingroup litl_write_init
  * \brief Finalizes the trace
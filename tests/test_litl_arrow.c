@@ -0,0 +1,283 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the export of traces to the Arrow IPC file format: the
+ * record batches listed in the footer hold all the events, whatever the
+ * number of workers that exported them. The parameters of the packed events
+ * are decoded, and the payloads that cannot be decoded are kept
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_arrow.h"
+
+#define NBTHREAD 4
+#define NBITER 50000
+
+#define CODE_TYPED 0x106
+
+/* the columns that are checked */
+#define COLUMN_TIME 1
+#define COLUMN_P1 7
+#define COLUMN_DATA 16
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+  litl_data_t data[32] = "raw data";
+
+  for (i = 0; i < NBITER; i++) {
+    switch (i % 6) {
+    case 0:
+      CHECK(litl_write_probe_reg_0(__trace, 0x100));
+      break;
+    case 1:
+      CHECK(litl_write_probe_reg_2(__trace, 0x101, i, 2 * i));
+      break;
+    case 2:
+      CHECK(litl_write_probe_reg_5(__trace, 0x102, i, i, i, i, i));
+      break;
+    case 3:
+      CHECK(litl_write_probe_raw(__trace, 0x105, sizeof(data), data));
+      break;
+    case 4:
+      CHECK(litl_write_probe_typed(__trace, CODE_TYPED, (uint32_t) i,
+                                   (int64_t) -i, i * 0.5));
+      break;
+    default:
+      CHECK(litl_write_probe_str(__trace, 0x107, i % 2 ? "odd" : "even"));
+      break;
+    }
+  }
+
+  return NULL ;
+}
+
+/*
+ * Returns a field of a flatbuffer table, or NULL if it is absent
+ */
+static const uint8_t* fb_field(const uint8_t* table, int id) {
+  int32_t soffset;
+  const uint16_t* vtable;
+
+  memcpy(&soffset, table, sizeof(soffset));
+  vtable = (const uint16_t*) (table - soffset);
+  if (4 + 2 * id >= vtable[0] || !vtable[2 + id])
+    return NULL ;
+  return table + vtable[2 + id];
+}
+
+static const uint8_t* fb_deref(const uint8_t* pos) {
+  CHECK(pos);
+  return pos + *(const uint32_t*) pos;
+}
+
+/*
+ * The sums of the columns that are checked
+ */
+typedef struct {
+  uint64_t time_sum;
+  uint64_t nb_p1;
+  uint64_t p1_sum;
+  uint64_t nb_data;
+  uint64_t data_size;
+} sums_t;
+
+/*
+ * Reads an Arrow file, and returns the number of its rows and the sums of
+ *   their columns
+ */
+static uint64_t read_arrow(const char* filename, sums_t* sums) {
+  FILE* f = fopen(filename, "r");
+  uint8_t* data;
+  const uint8_t *footer, *blocks, *message, *record_batch, *buffers, *body;
+  size_t size;
+  uint32_t footer_size, nb_blocks, i;
+  uint64_t nb_rows = 0;
+  int64_t length, offset, e;
+  const uint64_t *times, *p1;
+  const uint8_t *validity, *data_validity;
+  const int32_t* data_offsets;
+
+  CHECK(f);
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(size);
+  CHECK(fread(data, 1, size, f) == size);
+  fclose(f);
+
+  CHECK(memcmp(data, "ARROW1\0\0", 8) == 0);
+  CHECK(memcmp(data + size - 6, "ARROW1", 6) == 0);
+  memcpy(&footer_size, data + size - 10, sizeof(footer_size));
+  footer = fb_deref(data + size - 10 - footer_size);
+
+  memset(sums, 0, sizeof(*sums));
+  blocks = fb_deref(fb_field(footer, 3));
+  nb_blocks = *(const uint32_t*) blocks;
+  for (i = 0; i < nb_blocks; i++) {
+    const uint8_t* block = blocks + 4 + 24 * i;
+    uint32_t metadata_size = *(const uint32_t*) (block + 8);
+    memcpy(&offset, block, sizeof(offset));
+
+    CHECK(offset % 8 == 0 && metadata_size % 8 == 0);
+    CHECK(*(const uint32_t*) (data + offset) == 0xFFFFFFFF);
+    message = fb_deref(data + offset + 8);
+    // a record batch message
+    CHECK(*fb_field(message, 1) == 3);
+    record_batch = fb_deref(fb_field(message, 2));
+    memcpy(&length, fb_field(record_batch, 0), sizeof(length));
+    buffers = fb_deref(fb_field(record_batch, 2)) + 4;
+    body = data + offset + metadata_size;
+
+    memcpy(&offset, buffers + 16 * (2 * COLUMN_TIME + 1), sizeof(offset));
+    times = (const uint64_t*) (body + offset);
+    memcpy(&offset, buffers + 16 * (2 * COLUMN_P1), sizeof(offset));
+    validity = body + offset;
+    memcpy(&offset, buffers + 16 * (2 * COLUMN_P1 + 1), sizeof(offset));
+    p1 = (const uint64_t*) (body + offset);
+    // the data column has a validity bitmap, offsets and payloads
+    memcpy(&offset, buffers + 16 * (2 * COLUMN_DATA), sizeof(offset));
+    data_validity = body + offset;
+    memcpy(&offset, buffers + 16 * (2 * COLUMN_DATA + 1), sizeof(offset));
+    data_offsets = (const int32_t*) (body + offset);
+    CHECK(data_offsets[0] == 0);
+    for (e = 0; e < length; e++) {
+      sums->time_sum += times[e];
+      if (validity[e / 8] & (1 << (e % 8))) {
+        sums->nb_p1++;
+        sums->p1_sum += p1[e];
+      }
+      if (data_validity[e / 8] & (1 << (e % 8))) {
+        sums->nb_data++;
+        sums->data_size += data_offsets[e + 1] - data_offsets[e];
+      } else
+        CHECK(data_offsets[e + 1] == data_offsets[e]);
+    }
+    nb_rows += length;
+  }
+
+  free(data);
+  return nb_rows;
+}
+
+static void export_trace(const char* filename, const char* arrow_filename,
+                         unsigned nb_workers) {
+  litl_read_trace_t* trace;
+  litl_read_event_t* event;
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_size_t size;
+  sums_t sums, arrow_sums;
+  int nb_params;
+
+  memset(&sums, 0, sizeof(sums));
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    sums.time_sum += LITL_READ_GET_TIME(event);
+    switch (LITL_READ_GET_TYPE(event)) {
+    case LITL_TYPE_REGULAR:
+      if (LITL_READ_REGULAR(event)->nb_params > 1) {
+        sums.nb_p1++;
+        sums.p1_sum += LITL_READ_REGULAR(event)->param[1];
+      }
+      break;
+    case LITL_TYPE_PACKED:
+      nb_params = litl_read_get_typed_params(LITL_READ_GET_CUR_PROCESS(trace),
+                                             event, params);
+      if (LITL_READ_GET_CODE(event) == CODE_TYPED) {
+        CHECK(nb_params == 3);
+        sums.nb_p1++;
+        sums.p1_sum += (uint64_t) params[1].value.i;
+      } else {
+        // the string events keep their payload
+        CHECK(nb_params == 1 && params[0].type == LITL_PARAM_STRING);
+        sums.nb_data++;
+        litl_read_get_data(event, &size);
+        sums.data_size += size;
+      }
+      break;
+    case LITL_TYPE_RAW:
+      sums.nb_data++;
+      litl_read_get_data(event, &size);
+      sums.data_size += size;
+      break;
+    default:
+      break;
+    }
+  }
+  litl_read_finalize_trace(trace);
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(litl_arrow_export(trace, arrow_filename, nb_workers)
+        == NBTHREAD * NBITER);
+  litl_read_finalize_trace(trace);
+
+  CHECK(read_arrow(arrow_filename, &arrow_sums) == NBTHREAD * NBITER);
+  CHECK(arrow_sums.time_sum == sums.time_sum);
+  CHECK(arrow_sums.nb_p1 == sums.nb_p1);
+  CHECK(arrow_sums.p1_sum == sums.p1_sum);
+  CHECK(arrow_sums.nb_data == sums.nb_data);
+  CHECK(arrow_sums.data_size == sums.data_size);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  char arrow_filename[1024];
+  pthread_t tid[NBTHREAD];
+  const litl_param_type_t typed_types[] = { LITL_PARAM_UINT32,
+      LITL_PARAM_INT64, LITL_PARAM_DOUBLE };
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_arrow.trace";
+  sprintf(arrow_filename, "%s.arrow", filename);
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+  CHECK(litl_write_register_event(__trace, CODE_TYPED, "typed", 3,
+                                  typed_types) == 0);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Exporting the trace to the Arrow format\n\n");
+  export_trace(filename, arrow_filename, 1);
+  export_trace(filename, arrow_filename, 3);
+  setenv("LITL_READ_MMAP", "0", 1);
+  export_trace(filename, arrow_filename, 2);
+
+  printf("Yes, the trace was exported successfully\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the conversion of traces to the formats of trace
+ * viewers: all the events are exported, in chronological order, both to the
+ * Chrome JSON format and to the Perfetto protobuf format. When the entry and
+ * exit events are paired into slices, their parameters are kept
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_convert.h"
+
+#define NBTHREAD 4
+#define NBITER 10000
+
+#define CODE_TYPED 0x201
+#define CODE_ENTRY 0x110
+#define CODE_EXIT (CODE_ENTRY + 0x100)
+#define NBSLICES 1000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+  litl_data_t data[32] = "raw \"data\"\n";
+
+  for (i = 0; i < NBITER; i++) {
+    switch (i % 5) {
+    case 0:
+      CHECK(litl_write_probe_reg_0(__trace, 0x100));
+      break;
+    case 1:
+      CHECK(litl_write_probe_reg_2(__trace, 0x101, i, 2 * i));
+      break;
+    case 2:
+      CHECK(litl_write_probe_typed(__trace, CODE_TYPED, -i, i * 0.5,
+                                   (uint64_t) i << 40));
+      break;
+    case 3:
+      CHECK(litl_write_probe_str(__trace, 0x104, i % 2 ? "odd" : "even"));
+      break;
+    default:
+      CHECK(litl_write_probe_raw(__trace, 0x105, sizeof(data), data));
+      break;
+    }
+  }
+
+  return NULL ;
+}
+
+void* write_slices(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBSLICES; i++) {
+    CHECK(litl_write_probe_reg_2(__trace, CODE_ENTRY, 0x1000 + i, 7));
+    CHECK(litl_write_probe_reg_1(__trace, CODE_EXIT, 0x2000 + i));
+  }
+  // the last entry is not closed
+  CHECK(litl_write_probe_reg_2(__trace, CODE_ENTRY, 0x3000, 7));
+
+  return NULL ;
+}
+
+/*
+ * Reads the whole output file
+ */
+static char* read_file(const char* filename, size_t* size) {
+  FILE* f = fopen(filename, "r");
+  char* data;
+
+  CHECK(f);
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(*size + 1);
+  CHECK(fread(data, 1, *size, f) == *size);
+  data[*size] = '\0';
+  fclose(f);
+
+  return data;
+}
+
+static uint64_t read_varint(const uint8_t** pos, const uint8_t* end) {
+  uint64_t value = 0;
+  int shift = 0;
+
+  do {
+    CHECK(*pos < end && shift < 64);
+    value |= (uint64_t) (**pos & 0x7f) << shift;
+    shift += 7;
+  } while (*(*pos)++ & 0x80);
+
+  return value;
+}
+
+/*
+ * Checks a JSON output: its records and the order of its events
+ */
+static void check_json(const char* filename) {
+  size_t size;
+  char* data = read_file(filename, &size);
+  char* pos;
+  int nb_events = 0;
+  double ts, last_ts = 0;
+
+  CHECK(strncmp(data, "{\"displayTimeUnit\"", 18) == 0);
+  CHECK(strcmp(data + size - 4, "\n]}\n") == 0);
+  CHECK(strstr(data, "\"name\":\"typed\"") != NULL);
+  CHECK(strstr(data, "\"p0\":\"even\"") != NULL);
+  CHECK(strstr(data, "\"data\":\"raw \\\"data\\\"\\u000a\"") != NULL);
+
+  for (pos = strstr(data, "\"ph\":\"i\""); pos;
+      pos = strstr(pos + 1, "\"ph\":\"i\"")) {
+    pos = strstr(pos, "\"ts\":");
+    CHECK(pos);
+    ts = strtod(pos + 5, NULL);
+    CHECK(ts >= last_ts);
+    last_ts = ts;
+    nb_events++;
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+
+  free(data);
+}
+
+/*
+ * Checks a Perfetto output: its packets and the order of its events
+ */
+static void check_perfetto(const char* filename) {
+  size_t size;
+  char* data = read_file(filename, &size);
+  const uint8_t* pos = (const uint8_t*) data;
+  const uint8_t* end = pos + size;
+  const uint8_t* packet_end;
+  uint64_t key, len, timestamp, last_timestamp = 0;
+  int nb_events = 0, nb_tracks = 0, is_event;
+
+  while (pos < end) {
+    // each packet is a field 1 of the trace
+    CHECK(read_varint(&pos, end) == ((1 << 3) | 2));
+    len = read_varint(&pos, end);
+    packet_end = pos + len;
+    CHECK(packet_end <= end);
+
+    timestamp = 0;
+    is_event = 0;
+    while (pos < packet_end) {
+      key = read_varint(&pos, packet_end);
+      switch (key & 7) {
+      case 0:
+        if (key >> 3 == 8)
+          timestamp = read_varint(&pos, packet_end);
+        else
+          read_varint(&pos, packet_end);
+        break;
+      case 1:
+        pos += 8;
+        break;
+      case 2:
+        len = read_varint(&pos, packet_end);
+        if (key >> 3 == 11)
+          is_event = 1;
+        else if (key >> 3 == 60)
+          nb_tracks++;
+        pos += len;
+        break;
+      default:
+        CHECK(0);
+      }
+      CHECK(pos <= packet_end);
+    }
+
+    if (is_event) {
+      CHECK(timestamp >= last_timestamp);
+      last_timestamp = timestamp;
+      nb_events++;
+    }
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+  // a track per process and per thread
+  CHECK(nb_tracks == NBTHREAD + 1);
+
+  free(data);
+}
+
+/*
+ * Checks a JSON output whose slices were paired: each beginning and each end
+ *   carries the parameters of its event
+ */
+static void check_paired_json(const char* filename) {
+  size_t size;
+  char* data = read_file(filename, &size);
+  char* pos;
+  char* end;
+  char expected[64];
+  int nb_begins = 0, nb_ends = 0;
+
+  for (pos = strstr(data, "\"ph\":\"B\""); pos;
+      pos = strstr(pos + 1, "\"ph\":\"B\"")) {
+    end = strchr(pos, '}');
+    sprintf(expected, "\"args\":{\"p0\":\"0x%x\",\"p1\":\"0x7\"",
+            nb_begins < NBSLICES ? 0x1000 + nb_begins : 0x3000);
+    CHECK(strstr(pos, expected) && strstr(pos, expected) < end);
+    nb_begins++;
+  }
+  CHECK(nb_begins == NBSLICES + 1);
+
+  for (pos = strstr(data, "\"ph\":\"E\""); pos;
+      pos = strstr(pos + 1, "\"ph\":\"E\"")) {
+    end = strchr(pos, '}');
+    if (nb_ends < NBSLICES)
+      sprintf(expected, "\"args\":{\"p0\":\"0x%x\"}", 0x2000 + nb_ends);
+    else
+      sprintf(expected, "\"args\":{\"incomplete\":true}");
+    CHECK(strstr(pos, expected) && strstr(pos, expected) < end + 1);
+    nb_ends++;
+  }
+  CHECK(nb_ends == NBSLICES + 1);
+  CHECK(strstr(data, "\"ph\":\"i\"") == NULL);
+
+  free(data);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  char json_filename[1024], perfetto_filename[1024];
+  char paired_filename[1024], paired_json_filename[1024];
+  litl_trace_convert_t* convert;
+  litl_read_event_t* event;
+  pthread_t tid[NBTHREAD];
+  litl_read_trace_t* trace;
+  const litl_param_type_t typed_types[] = { LITL_PARAM_INT32,
+      LITL_PARAM_DOUBLE, LITL_PARAM_POINTER };
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_convert.trace";
+  sprintf(json_filename, "%s.json", filename);
+  sprintf(perfetto_filename, "%s.perfetto", filename);
+  sprintf(paired_filename, "%s.paired", filename);
+  sprintf(paired_json_filename, "%s.paired.json", filename);
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+  CHECK(litl_write_register_event(__trace, CODE_TYPED, "typed", 3,
+                                  typed_types) == 0);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Converting the trace to the Chrome JSON format\n\n");
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(litl_convert_trace(trace, json_filename, LITL_CONVERT_CHROME_JSON)
+        == NBTHREAD * NBITER);
+  litl_read_finalize_trace(trace);
+  check_json(json_filename);
+
+  printf("Converting the trace to the Perfetto format\n\n");
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(litl_convert_trace(trace, perfetto_filename, LITL_CONVERT_PERFETTO)
+        == NBTHREAD * NBITER);
+  litl_read_finalize_trace(trace);
+  check_perfetto(perfetto_filename);
+
+  printf("Converting the entry and exit events to slices\n\n");
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, paired_filename);
+  litl_write_buffer_flush_on(__trace);
+  pthread_create(&tid[0], NULL, write_slices, NULL);
+  pthread_join(tid[0], NULL );
+  litl_write_finalize_trace(__trace);
+
+  trace = litl_read_open_trace(paired_filename);
+  litl_read_init_processes(trace);
+  convert = litl_convert_init(trace, paired_json_filename,
+                              LITL_CONVERT_CHROME_JSON);
+  litl_convert_pair_events(convert);
+  while ((event = litl_read_next_ordered_event(trace)) != NULL )
+    litl_convert_event(convert, LITL_READ_GET_CUR_PROCESS(trace), event);
+  litl_convert_finalize(convert);
+  litl_read_finalize_trace(trace);
+  check_paired_json(paired_json_filename);
+
+  printf("Yes, the trace was converted successfully\n");
+
+  return EXIT_SUCCESS;
+}
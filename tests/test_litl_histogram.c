@@ -0,0 +1,198 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the histograms of durations: their quantiles are
+ * within the precision of the buckets, they can be merged, and the statistics
+ * of a trace do not depend on the number of workers that compute them
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_pair.h"
+#include "litl_stats.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+#define NBVALUES 1000000
+
+#define CODE_OUTER 0x101
+#define CODE_INNER 0x102
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER, i));
+    CHECK(litl_write_probe_reg_0(__trace, CODE_INNER));
+    if (i % 10 == 0)
+      usleep(1);
+    CHECK(litl_write_probe_reg_0(__trace, CODE_INNER + LITL_PAIR_EXIT_OFFSET));
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER + LITL_PAIR_EXIT_OFFSET, i));
+  }
+
+  return NULL ;
+}
+
+/*
+ * Checks that a quantile is within the relative error of the buckets
+ */
+static void check_quantile(const litl_histogram_t* histogram, double quantile,
+                           uint64_t exact) {
+  uint64_t value = litl_histogram_quantile(histogram, quantile);
+  uint64_t error = value > exact ? value - exact : exact - value;
+
+  CHECK(error <= exact >> LITL_HISTOGRAM_PRECISION);
+}
+
+static void check_histograms() {
+  litl_histogram_t *histogram, *first, *second;
+  uint64_t i, value;
+
+  histogram = litl_histogram_init();
+  first = litl_histogram_init();
+  second = litl_histogram_init();
+
+  // the values are spread over several powers of two
+  for (i = 1; i <= NBVALUES; i++) {
+    value = i * i;
+    litl_histogram_add(histogram, value);
+    litl_histogram_add(i % 2 ? first : second, value);
+  }
+
+  CHECK(histogram->nb_values == NBVALUES);
+  CHECK(histogram->min == 1);
+  CHECK(histogram->max == (uint64_t) NBVALUES * NBVALUES);
+  check_quantile(histogram, 0.5, (uint64_t) (NBVALUES / 2) * (NBVALUES / 2));
+  check_quantile(histogram, 0.99,
+                 (uint64_t) (NBVALUES / 100 * 99) * (NBVALUES / 100 * 99));
+  check_quantile(histogram, 0.999,
+                 (uint64_t) (NBVALUES / 1000 * 999) * (NBVALUES / 1000 * 999));
+  CHECK(litl_histogram_quantile(histogram, 0) == 1);
+  CHECK(litl_histogram_quantile(histogram, 1) == histogram->max);
+
+  // the small values are exact
+  CHECK(litl_histogram_quantile(histogram, 3.0 / NBVALUES) == 9);
+
+  litl_histogram_merge(first, second);
+  CHECK(memcmp(first, histogram, sizeof(litl_histogram_t)) == 0);
+
+  // the largest values, e.g. wrapped durations, are in the last bucket
+  free(histogram);
+  histogram = litl_histogram_init();
+  litl_histogram_add(histogram, 1);
+  litl_histogram_add(histogram, UINT64_MAX);
+  litl_histogram_add(histogram, UINT64_MAX);
+  CHECK(histogram->counts[LITL_HISTOGRAM_NB_BUCKETS - 1] == 2);
+  check_quantile(histogram, 0.5, UINT64_MAX);
+  CHECK(litl_histogram_quantile(histogram, 1) == UINT64_MAX);
+
+  free(histogram);
+  free(first);
+  free(second);
+}
+
+/*
+ * Computes the statistics of a trace with a given number of workers
+ */
+static litl_duration_stats_t* compute_stats(char* filename,
+                                            unsigned nb_workers) {
+  litl_read_trace_t* trace;
+  litl_duration_stats_t* stats;
+  const litl_histogram_t* outer, *inner;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  stats = litl_stats_trace(trace, nb_workers);
+  litl_read_finalize_trace(trace);
+
+  CHECK(stats->nb_codes == 2);
+  CHECK(stats->nb_threads == NBTHREAD);
+  CHECK(stats->nb_incomplete == 0);
+  outer = litl_stats_find_code(stats, CODE_OUTER);
+  inner = litl_stats_find_code(stats, CODE_INNER);
+  CHECK(outer && inner && !litl_stats_find_code(stats, 0x103));
+  CHECK(outer->nb_values == NBTHREAD * NBITER);
+  CHECK(inner->nb_values == NBTHREAD * NBITER);
+
+  // the outer intervals enclose the inner ones
+  CHECK(outer->min >= inner->min && outer->max >= inner->max);
+  CHECK(litl_histogram_quantile(outer, 0.5) <= litl_histogram_quantile(outer, 0.99));
+  CHECK(litl_histogram_quantile(outer, 0.99) <= litl_histogram_quantile(outer, 0.999));
+  CHECK(litl_histogram_quantile(outer, 0.999) <= outer->max);
+
+  return stats;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  litl_duration_stats_t *stats, *parallel_stats;
+  litl_size_t c;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_histogram.trace";
+
+  printf("Checking the quantiles of the histograms\n\n");
+  check_histograms();
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Computing the durations with 1 and 3 workers\n\n");
+  stats = compute_stats(filename, 1);
+  parallel_stats = compute_stats(filename, 3);
+  for (c = 0; c < stats->nb_codes; c++) {
+    CHECK(stats->codes[c].code == parallel_stats->codes[c].code);
+    CHECK(memcmp(stats->codes[c].histogram, parallel_stats->codes[c].histogram,
+                 sizeof(litl_histogram_t)) == 0);
+  }
+  litl_stats_finalize(parallel_stats);
+
+  // merging the statistics of the same trace doubles the counts
+  parallel_stats = compute_stats(filename, 2);
+  litl_stats_merge(parallel_stats, stats);
+  CHECK(litl_stats_find_code(parallel_stats, CODE_OUTER)->nb_values
+        == 2 * NBTHREAD * NBITER);
+  CHECK(litl_histogram_quantile(litl_stats_find_code(parallel_stats, CODE_OUTER), 0.5)
+        == litl_histogram_quantile(litl_stats_find_code(stats, CODE_OUTER), 0.5));
+  litl_stats_finalize(parallel_stats);
+  litl_stats_finalize(stats);
+
+  printf("Yes, the durations were computed successfully\n");
+
+  return EXIT_SUCCESS;
+}
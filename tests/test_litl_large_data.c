@@ -0,0 +1,139 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the recording of events whose payload is larger than
+ * LITL_MAX_DATA: the payloads are read back as contiguous spans of bytes
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define BUFFER_SIZE (256 * 1024)
+#define NBITER 10
+
+#define CODE_DATA 0x401
+#define CODE_RAW 0x402
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static const litl_size_t __sizes[] = { 0, 1, 80, 81, 1000, 4095, 4096, 4097,
+    65535, 65536, 100000 };
+#define NBSIZES (sizeof(__sizes) / sizeof(__sizes[0]))
+
+static litl_data_t __payload[BUFFER_SIZE];
+
+static void write_trace(char* filename) {
+  int i, j;
+  litl_write_trace_t* trace;
+  litl_size_t max_size;
+
+  trace = litl_write_init_trace(BUFFER_SIZE);
+  litl_write_set_filename(trace, filename);
+  litl_write_buffer_flush_on(trace);
+
+  max_size = litl_write_get_max_data_size(trace);
+  CHECK(max_size > 100000 && max_size < BUFFER_SIZE);
+
+  for (i = 0; i < NBITER; i++)
+    for (j = 0; j < (int) NBSIZES; j++) {
+      CHECK(litl_write_probe_data(trace, CODE_DATA, __sizes[j], __payload + i));
+      CHECK(litl_write_probe_raw(trace, CODE_RAW, __sizes[j], __payload + j));
+    }
+
+  // the largest payload fills a whole buffer, and raw data also needs room
+  //   for its terminating NUL
+  CHECK(litl_write_probe_data(trace, CODE_DATA, max_size, __payload));
+  CHECK(litl_write_probe_raw(trace, CODE_RAW, max_size - 1, __payload));
+  // larger payloads do not fit in a buffer
+  CHECK(litl_write_probe_data(trace, CODE_DATA, max_size + 1, __payload) == NULL);
+  CHECK(litl_write_probe_raw(trace, CODE_RAW, max_size, __payload) == NULL);
+
+  litl_write_finalize_trace(trace);
+}
+
+static void read_trace(char* filename) {
+  int nb_data = 0, nb_raw = 0;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  const litl_data_t* data;
+  litl_size_t size;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    data = litl_read_get_data(event, &size);
+    CHECK(data);
+
+    switch (LITL_READ_GET_CODE(event)) {
+    case CODE_DATA:
+      if (nb_data == NBITER * NBSIZES) {
+        // the last event fills a whole buffer
+        CHECK(memcmp(data, __payload, size) == 0);
+      } else {
+        CHECK(size == __sizes[nb_data % NBSIZES]);
+        CHECK(memcmp(data, __payload + nb_data / NBSIZES, size) == 0);
+      }
+      nb_data++;
+      break;
+    case CODE_RAW:
+      // raw events are terminated by '\0'
+      if (nb_raw == NBITER * NBSIZES) {
+        // the last event fills a whole buffer
+        CHECK(memcmp(data, __payload, size - 1) == 0);
+      } else {
+        CHECK(size == __sizes[nb_raw % NBSIZES] + 1);
+        CHECK(memcmp(data, __payload + nb_raw % NBSIZES, size - 1) == 0);
+      }
+      CHECK(data[size - 1] == '\0');
+      nb_raw++;
+      break;
+    default:
+      CHECK(0);
+    }
+  }
+
+  litl_read_finalize_trace(trace);
+
+  CHECK(nb_data == NBITER * NBSIZES + 1);
+  CHECK(nb_raw == NBITER * NBSIZES + 1);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_large_data.trace";
+
+  for (i = 0; i < BUFFER_SIZE; i++)
+    __payload[i] = (i * 7 + i / 251) & 0xff;
+
+  printf("Recording events with large payloads\n\n");
+  write_trace(filename);
+
+  printf("Reading events with large payloads\n\n");
+  read_trace(filename);
+
+  printf("Yes, the large payloads were recorded successfully\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the merging of traces: the archives built by the
+ * kernel (cloning or copy_file_range) and through a buffer, by one or several
+ * workers, and with few file descriptors, hold the same events, and each
+ * process of the archive holds the events of its trace
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_merge.h"
+
+#define NBTRACES 5
+#define NBITER 20000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+/*
+ * Returns the names of the traces, which are freed by litl_merge_traces
+ */
+static char** trace_names(char* filename) {
+  char** filenames = malloc(NBTRACES * sizeof(char*));
+  int j;
+
+  for (j = 0; j < NBTRACES; j++)
+    CHECK(asprintf(&filenames[j], "%s_%d", filename, j) > 0);
+  return filenames;
+}
+
+/*
+ * Records the traces: their sizes range from a few events, smaller than a
+ *   block, to several blocks
+ */
+static void write_traces(char** filenames) {
+  litl_write_trace_t* trace;
+  int i, j;
+
+  for (j = 0; j < NBTRACES; j++) {
+    trace = litl_write_init_trace(16 * 1024);
+    litl_write_set_filename(trace, filenames[j]);
+    litl_write_buffer_flush_on(trace);
+    for (i = 0; i < (j ? j * NBITER : 10); i++)
+      CHECK(litl_write_probe_reg_2(trace, 0x100 + j, i, j));
+    litl_write_finalize_trace(trace);
+  }
+}
+
+/*
+ * Reads an archive, and returns a checksum of its events
+ */
+static uint64_t read_archive(char* archive) {
+  litl_read_trace_t* trace;
+  litl_read_event_t* event;
+  litl_param_t iter, trace_index;
+  uint64_t nb_events[NBTRACES], checksum = 0;
+  int j;
+
+  memset(nb_events, 0, sizeof(nb_events));
+  trace = litl_read_open_trace(archive);
+  litl_read_init_processes(trace);
+  CHECK(trace->nb_processes == NBTRACES);
+
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+      continue;
+    litl_read_get_param_2(event, iter, trace_index);
+    CHECK(trace_index < NBTRACES);
+    CHECK(LITL_READ_GET_CUR_PROCESS(trace) == trace->processes[trace_index]);
+    CHECK(LITL_READ_GET_CODE(event) == 0x100 + trace_index);
+    CHECK(iter == nb_events[trace_index]);
+    nb_events[trace_index]++;
+    checksum = checksum * 31 + LITL_READ_GET_TIME(event);
+  }
+
+  for (j = 0; j < NBTRACES; j++)
+    CHECK(nb_events[j] == (uint64_t) (j ? j * NBITER : 10));
+
+  litl_read_finalize_trace(trace);
+  return checksum;
+}
+
+int main(int argc, char **argv) {
+  char* filename;
+  char archive[1024], copied_archive[1024];
+  uint64_t checksum;
+  struct rlimit limit;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_merge.trace";
+  sprintf(archive, "%s.archive", filename);
+  sprintf(copied_archive, "%s.copied_archive", filename);
+
+  printf("Recording %d traces\n\n", NBTRACES);
+  write_traces(trace_names(filename));
+
+  printf("Merging the traces\n\n");
+  unlink(archive);
+  litl_merge_traces(archive, trace_names(filename), NBTRACES);
+  checksum = read_archive(archive);
+
+  printf("Merging the traces through a buffer\n\n");
+  setenv("LITL_MERGE_ZERO_COPY", "0", 1);
+  unlink(copied_archive);
+  litl_merge_traces(copied_archive, trace_names(filename), NBTRACES);
+  unsetenv("LITL_MERGE_ZERO_COPY");
+  CHECK(read_archive(copied_archive) == checksum);
+
+  printf("Merging the traces with 3 workers\n\n");
+  litl_merge_traces_parallel(copied_archive, trace_names(filename), NBTRACES, 3);
+  CHECK(read_archive(copied_archive) == checksum);
+
+  // the traces are opened twice when they cannot be kept open
+  printf("Merging the traces with few file descriptors\n\n");
+  limit.rlim_cur = limit.rlim_max = 32;
+  CHECK(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+  litl_merge_traces_parallel(copied_archive, trace_names(filename), NBTRACES, 2);
+  CHECK(read_archive(copied_archive) == checksum);
+
+  printf("Yes, the traces were merged successfully\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,353 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the sorting of an archive: the sorted trace holds the
+ * events of all the processes and threads of the archive in the order in which
+ * litl_read_next_ordered_event returns them, the reader reports them in the
+ * processes and the threads that recorded them, with the interned strings,
+ * the modules and the statistics of these processes, and the chunk index of
+ * the sorted trace allows seeking in time. The sorted trace has the buffer
+ * size of the archive and room for the run events, whatever LITL_BUFFER_SIZE
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_tools.h"
+#include "litl_merge.h"
+
+#define NBTRACES 3
+#define NBTHREAD 2
+#define NBITER 10000
+// the definitions of the interned strings are not returned by the reader, so
+//   only the events that record their IDs are copied
+#define NBSTRING_EVENTS NBTRACES
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+static int __trace_index;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  uint8_t data[LITL_MAX_DATA * 4];
+  int i;
+
+  memset(data, __trace_index, sizeof(data));
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_2(__trace, 0x100 + __trace_index, i,
+                                 __trace_index));
+    // large raw events are copied as well
+    if (i % 100 == 0)
+      CHECK(litl_write_probe_raw(__trace, 0x200, sizeof(data), data));
+  }
+
+  return NULL ;
+}
+
+/*
+ * Records traces whose processes record in turn, with several threads each
+ */
+static void write_traces(char** filenames) {
+  pthread_t tid[NBTRACES][NBTHREAD];
+  litl_write_trace_t* traces[NBTRACES];
+  litl_string_id_t id = 0;
+  char str[64];
+  int i, j, k;
+
+  for (j = 0; j < NBTRACES; j++) {
+    traces[j] = litl_write_init_trace(16 * 1024);
+    litl_write_set_filename(traces[j], filenames[j]);
+    litl_write_buffer_flush_on(traces[j]);
+
+    // the same ID stands for different strings in the processes
+    for (k = 0; k <= j; k++) {
+      sprintf(str, "trace %d string %d", j, k);
+      id = litl_write_intern_string(traces[j], str);
+    }
+    CHECK(litl_write_probe_reg_2(traces[j], 0x300, id, j));
+  }
+
+  // the threads of a trace share the global variables, so the traces record
+  //   in turn for short periods of time
+  for (i = 0; i < 5; i++)
+    for (j = 0; j < NBTRACES; j++) {
+      __trace = traces[j];
+      __trace_index = j;
+      for (k = 0; k < NBTHREAD; k++)
+        pthread_create(&tid[j][k], NULL, write_trace, NULL);
+      for (k = 0; k < NBTHREAD; k++)
+        pthread_join(tid[j][k], NULL );
+    }
+
+  for (j = 0; j < NBTRACES; j++)
+    litl_write_finalize_trace(traces[j]);
+}
+
+/*
+ * Reads the next event of the archive in chronological order
+ */
+static litl_read_event_t* next_archive_event(litl_read_trace_t* archive) {
+  litl_read_event_t* event;
+
+  do {
+    event = litl_read_next_ordered_event(archive);
+  } while (event && LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET);
+  return event;
+}
+
+/*
+ * Checks that the statistics of a process of the sorted trace are those of
+ *   the process of the archive
+ */
+static void check_stats(litl_read_trace_t* archive,
+                        litl_read_process_t* archive_process,
+                        litl_read_trace_t* sorted,
+                        litl_read_process_t* sorted_process) {
+  const litl_thread_stats_t *archive_threads, *sorted_threads;
+  const litl_code_stats_t *archive_codes, *sorted_codes;
+  litl_size_t nb_archive, nb_sorted;
+
+  archive_threads = litl_read_get_thread_stats(archive, archive_process,
+                                               &nb_archive);
+  sorted_threads = litl_read_get_thread_stats(sorted, sorted_process,
+                                              &nb_sorted);
+  CHECK(nb_archive > NBTHREAD && nb_sorted == nb_archive);
+  CHECK(memcmp(archive_threads, sorted_threads,
+               nb_archive * sizeof(litl_thread_stats_t)) == 0);
+
+  archive_codes = litl_read_get_code_stats(archive, archive_process,
+                                           &nb_archive);
+  sorted_codes = litl_read_get_code_stats(sorted, sorted_process, &nb_sorted);
+  CHECK(nb_archive > 0 && nb_sorted == nb_archive);
+  CHECK(memcmp(archive_codes, sorted_codes,
+               nb_archive * sizeof(litl_code_stats_t)) == 0);
+}
+
+static void check_sorted(char* archive_name, char* sorted_name) {
+  litl_read_trace_t *archive, *sorted;
+  litl_read_event_t *event, *archive_event;
+  litl_read_process_t *process, *run_process = NULL;
+  litl_read_batch_t* batch;
+  litl_param_t iter, trace_index, id;
+  litl_tid_t run_tid = 0, tid;
+  litl_med_size_t process_index;
+  const litl_thread_stats_t* thread_stats;
+  const char* str;
+  char expected[64];
+  litl_time_t last_time = 0, middle_time;
+  const litl_chunk_t* chunks;
+  litl_size_t nb_chunks, nb_stats, i;
+  uint64_t nb_events = 0, nb_runs = 0;
+
+  archive = litl_read_open_trace(archive_name);
+  litl_read_init_processes(archive);
+  sorted = litl_read_open_trace(sorted_name);
+  litl_read_init_processes(sorted);
+  CHECK(sorted->nb_processes == 1);
+  CHECK(sorted->processes[0]->nb_threads == 1);
+  // the sorted trace does not record the modules of the process that sorted
+  //   it, but it holds the processes of the archive
+  CHECK(sorted->processes[0]->nb_modules == 0);
+  CHECK(sorted->nb_event_processes == NBTRACES);
+  CHECK(sorted->nb_threads == archive->nb_threads);
+  for (process_index = 0; process_index < NBTRACES; process_index++) {
+    process = sorted->event_processes[process_index];
+    CHECK(process->index == process_index);
+    CHECK(strcmp((char*) process->header->process_name,
+                 (char*) archive->processes[process_index]->header->process_name)
+          == 0);
+    CHECK(process->nb_threads == archive->processes[process_index]->nb_threads);
+    CHECK(litl_read_get_recorded_buffer_size(process) == 16 * 1024);
+    CHECK(process->nb_modules > 0);
+    CHECK(process->nb_modules
+          == archive->processes[process_index]->nb_modules);
+    check_stats(archive, archive->processes[process_index], sorted, process);
+  }
+
+  while ((event = litl_read_next_event(sorted)) != NULL ) {
+    if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+      continue;
+    CHECK(LITL_READ_GET_TIME(event) >= last_time);
+    last_time = LITL_READ_GET_TIME(event);
+    // the runs are applied by the reader
+    CHECK(LITL_READ_GET_CODE(event) != LITL_RUN_CODE);
+
+    process = LITL_READ_GET_CUR_PROCESS(sorted);
+    CHECK(process->index < NBTRACES);
+    CHECK(process == sorted->event_processes[process->index]);
+    CHECK(litl_read_find_thread(process, LITL_READ_GET_TID(event)));
+    if (process != run_process || LITL_READ_GET_TID(event) != run_tid) {
+      run_process = process;
+      run_tid = LITL_READ_GET_TID(event);
+      nb_runs++;
+    }
+
+    // the events are those of the archive, in the same order and in the same
+    //   processes and threads
+    archive_event = next_archive_event(archive);
+    CHECK(archive_event);
+    CHECK(LITL_READ_GET_CUR_PROCESS(archive)->index == process->index);
+    CHECK(LITL_READ_GET_TID(archive_event) == LITL_READ_GET_TID(event));
+    CHECK(__litl_get_gen_event_size(event->event)
+          == __litl_get_gen_event_size(archive_event->event));
+    CHECK(memcmp(event->event, archive_event->event,
+                 __litl_get_gen_event_size(event->event)) == 0);
+
+    if (LITL_READ_GET_CODE(event) == 0x300) {
+      // the strings are resolved in the sorted trace alone
+      litl_read_get_param_2(event, id, trace_index);
+      CHECK(trace_index == process->index);
+      CHECK(id == trace_index);
+      sprintf(expected, "trace %d string %d", (int) trace_index,
+              (int) trace_index);
+      str = litl_read_get_string(process, (litl_string_id_t) id);
+      CHECK(str && strcmp(str, expected) == 0);
+    } else if (LITL_READ_GET_TYPE(event) == LITL_TYPE_REGULAR) {
+      litl_read_get_param_2(event, iter, trace_index);
+      CHECK(trace_index == process->index);
+      CHECK(iter < NBITER);
+    }
+    nb_events++;
+  }
+  CHECK(next_archive_event(archive) == NULL);
+  CHECK(nb_events == NBTRACES * NBTHREAD * 5 * (NBITER + NBITER / 100)
+        + NBSTRING_EVENTS);
+  CHECK(nb_runs > NBTRACES * 5);
+
+  // the batches hold the events of a single process
+  litl_read_seek_time(sorted, 0);
+  batch = litl_read_init_batch(1000);
+  nb_events = 0;
+  while (litl_read_next_batch(sorted, batch)) {
+    CHECK(batch->process->index < NBTRACES);
+    CHECK(batch->process == sorted->event_processes[batch->process->index]);
+    for (i = 0; i < batch->nb_events; i++) {
+      CHECK(batch->codes[i] != LITL_RUN_CODE);
+      CHECK(litl_read_find_thread(batch->process, batch->tids[i]));
+      if (batch->types[i] == LITL_TYPE_REGULAR && batch->codes[i] != 0x300)
+        CHECK(batch->params[1][i] == batch->process->index);
+    }
+    nb_events += batch->nb_events;
+  }
+  litl_read_finalize_batch(batch);
+  CHECK(nb_events == NBTRACES * NBTHREAD * 5 * (NBITER + NBITER / 100)
+        + NBSTRING_EVENTS);
+
+  // the chunk index is a time index of the sorted events
+  chunks = litl_read_get_thread_chunks(sorted, sorted->processes[0],
+                                       sorted->processes[0]->threads[0],
+                                       &nb_chunks);
+  CHECK(nb_chunks > 1);
+  middle_time = chunks[nb_chunks / 2].first_time + 1;
+  litl_read_seek_time(sorted, middle_time);
+  do {
+    event = litl_read_next_event(sorted);
+  } while (event && LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET);
+  CHECK(event && LITL_READ_GET_TIME(event) >= middle_time);
+  CHECK(LITL_READ_GET_CUR_PROCESS(sorted) != sorted->processes[0]);
+
+  litl_read_finalize_trace(sorted);
+
+  // the events of a thread are filtered in the runs
+  sorted = litl_read_open_trace(sorted_name);
+  litl_read_init_processes(sorted);
+  thread_stats = litl_read_get_thread_stats(sorted, sorted->event_processes[1],
+                                            &nb_stats);
+  tid = thread_stats[0].tid;
+  litl_read_filter_tid(sorted, tid);
+  nb_events = 0;
+  while ((event = litl_read_next_event(sorted)) != NULL ) {
+    if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+      continue;
+    CHECK(LITL_READ_GET_TID(event) == tid);
+    if (LITL_READ_GET_CUR_PROCESS(sorted) == sorted->event_processes[1])
+      nb_events++;
+  }
+  CHECK(nb_events == thread_stats[0].nb_events);
+
+  litl_read_finalize_trace(sorted);
+  litl_read_finalize_trace(archive);
+}
+
+/*
+ * Returns the buffer size a trace was recorded with
+ */
+static litl_size_t get_buffer_size(char* trace_name) {
+  litl_read_trace_t* trace;
+  litl_size_t buffer_size;
+
+  trace = litl_read_open_trace(trace_name);
+  litl_read_init_processes(trace);
+  buffer_size = litl_read_get_recorded_buffer_size(trace->processes[0]);
+  litl_read_finalize_trace(trace);
+
+  return buffer_size;
+}
+
+int main(int argc, char **argv) {
+  char* filename;
+  char archive_name[1024], sorted_name[1024], resorted_name[1024];
+  char** filenames;
+  int j;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_merge_sorted.trace";
+  sprintf(archive_name, "%s.archive", filename);
+  sprintf(sorted_name, "%s.sorted", filename);
+  sprintf(resorted_name, "%s.resorted", filename);
+
+  filenames = malloc(NBTRACES * sizeof(char*));
+  for (j = 0; j < NBTRACES; j++)
+    CHECK(asprintf(&filenames[j], "%s_%d", filename, j) > 0);
+
+  printf("Recording %d traces of %d threads\n\n", NBTRACES, NBTHREAD);
+  write_traces(filenames);
+
+  printf("Merging and sorting the traces\n\n");
+  litl_merge_traces(archive_name, filenames, NBTRACES);
+  CHECK(litl_merge_sort_trace(sorted_name, archive_name)
+        == NBTRACES * NBTHREAD * 5 * (NBITER + NBITER / 100)
+           + NBSTRING_EVENTS);
+  check_sorted(archive_name, sorted_name);
+  CHECK(get_buffer_size(sorted_name)
+        == 16 * 1024 + __litl_get_reg_event_size(2));
+
+  // the large raw events would not fit in smaller buffers, and sorting the
+  //   sorted trace again keeps its buffer size
+  setenv("LITL_BUFFER_SIZE", "200", 1);
+  CHECK(litl_merge_sort_trace(sorted_name, archive_name)
+        == NBTRACES * NBTHREAD * 5 * (NBITER + NBITER / 100)
+           + NBSTRING_EVENTS);
+  check_sorted(archive_name, sorted_name);
+  CHECK(get_buffer_size(sorted_name)
+        == 16 * 1024 + __litl_get_reg_event_size(2));
+  CHECK(litl_merge_sort_trace(resorted_name, sorted_name)
+        == NBTRACES * NBTHREAD * 5 * (NBITER + NBITER / 100)
+           + NBSTRING_EVENTS);
+  check_sorted(archive_name, resorted_name);
+  CHECK(get_buffer_size(resorted_name)
+        == 16 * 1024 + __litl_get_reg_event_size(2));
+  unsetenv("LITL_BUFFER_SIZE");
+
+  printf("Yes, the archive was sorted successfully\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the pairing of the entry and exit events: the nested
+ * intervals are found with their depth, the entries without an exit are
+ * closed as incomplete intervals, and the stacks of the threads are bounded
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_pair.h"
+#include "litl_convert.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+#define RECURSION_DEPTH 20
+
+#define CODE_OUTER 0x101
+#define CODE_INNER 0x102
+#define CODE_RECURSION 0x110
+#define CODE_UNPAIRED 0xf001
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER, i));
+    CHECK(litl_write_probe_reg_0(__trace, CODE_INNER));
+    CHECK(litl_write_probe_reg_0(__trace, CODE_UNPAIRED));
+    // some inner intervals are not closed
+    if (i % 100)
+      CHECK(litl_write_probe_reg_0(__trace, CODE_INNER + LITL_PAIR_EXIT_OFFSET));
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER + LITL_PAIR_EXIT_OFFSET, i));
+  }
+
+  for (i = 0; i < RECURSION_DEPTH; i++)
+    CHECK(litl_write_probe_reg_0(__trace, CODE_RECURSION));
+  for (i = 0; i < RECURSION_DEPTH; i++)
+    CHECK(litl_write_probe_reg_0(__trace, CODE_RECURSION + LITL_PAIR_EXIT_OFFSET));
+
+  return NULL ;
+}
+
+typedef struct {
+  uint64_t nb_intervals;
+  uint64_t nb_complete;
+  uint64_t nb_complete_per_code[3];
+  litl_time_t outer_end;
+} pair_counts_t;
+
+static void count_interval(const litl_interval_t* interval, void* arg) {
+  pair_counts_t* counts = (pair_counts_t*) arg;
+
+  counts->nb_intervals++;
+  if (!interval->is_complete)
+    return;
+  counts->nb_complete++;
+
+  switch (interval->code) {
+  case CODE_OUTER:
+    CHECK(interval->depth == 0);
+    counts->nb_complete_per_code[0]++;
+    break;
+  case CODE_INNER:
+    CHECK(interval->depth == 1);
+    counts->nb_complete_per_code[1]++;
+    break;
+  case CODE_RECURSION:
+    CHECK(interval->depth < RECURSION_DEPTH);
+    counts->nb_complete_per_code[2]++;
+    break;
+  default:
+    CHECK(0);
+  }
+}
+
+static void pair_trace(char* filename, pair_counts_t* counts) {
+  litl_read_trace_t* trace;
+
+  memset(counts, 0, sizeof(pair_counts_t));
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(litl_pair_trace(trace, count_interval, counts) == counts->nb_intervals);
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Converts the trace with slices, and returns the number of slices, each of
+ *   which is begun and ended
+ */
+static int convert_trace(char* filename, char* json_filename) {
+  litl_read_trace_t* trace;
+  litl_trace_convert_t* convert;
+  litl_read_event_t* event;
+  FILE* f;
+  char line[4096];
+  int nb_slices = 0, nb_begins = 0;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  convert = litl_convert_init(trace, json_filename, LITL_CONVERT_CHROME_JSON);
+  litl_convert_pair_events(convert);
+  while ((event = litl_read_next_ordered_event(trace)) != NULL )
+    litl_convert_event(convert, LITL_READ_GET_CUR_PROCESS(trace), event);
+  litl_convert_finalize(convert);
+  litl_read_finalize_trace(trace);
+
+  f = fopen(json_filename, "r");
+  CHECK(f);
+  while (fgets(line, sizeof(line), f))
+    if (strstr(line, "\"ph\":\"E\""))
+      nb_slices++;
+    else if (strstr(line, "\"ph\":\"B\""))
+      nb_begins++;
+    else
+      // only the unpaired events are left as instant events
+      CHECK(!strstr(line, "\"ph\":\"i\"") || strstr(line, "\"0xf001\""));
+  fclose(f);
+  CHECK(nb_begins == nb_slices);
+
+  return nb_slices;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  char json_filename[1024];
+  pthread_t tid[NBTHREAD];
+  pair_counts_t counts;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_pair.trace";
+  sprintf(json_filename, "%s.json", filename);
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Pairing the entry and exit events\n\n");
+  pair_trace(filename, &counts);
+  CHECK(counts.nb_intervals == NBTHREAD * (2 * NBITER + RECURSION_DEPTH));
+  CHECK(counts.nb_complete_per_code[0] == NBTHREAD * NBITER);
+  CHECK(counts.nb_complete_per_code[1]
+        == NBTHREAD * (NBITER - NBITER / 100));
+  CHECK(counts.nb_complete_per_code[2] == NBTHREAD * RECURSION_DEPTH);
+
+  // with bounded stacks, the outermost recursive entries are given up, and
+  //   their exits are taken for entries that are never closed
+  setenv("LITL_PAIR_MAX_DEPTH", "8", 1);
+  pair_trace(filename, &counts);
+  CHECK(counts.nb_complete_per_code[0] == NBTHREAD * NBITER);
+  CHECK(counts.nb_complete_per_code[2] == NBTHREAD * 8);
+  CHECK(counts.nb_intervals
+        == NBTHREAD * (2 * NBITER + 8 + 2 * (RECURSION_DEPTH - 8)));
+  unsetenv("LITL_PAIR_MAX_DEPTH");
+
+  printf("Converting the intervals to slices\n\n");
+  CHECK(convert_trace(filename, json_filename)
+        == NBTHREAD * (2 * NBITER + RECURSION_DEPTH));
+
+  printf("Yes, the events were paired successfully\n");
+
+  return EXIT_SUCCESS;
+}
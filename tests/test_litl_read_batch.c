@@ -0,0 +1,207 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the decoding of events into batches: the batches hold
+ * the same events as the ones returned one at a time. It also compares the
+ * throughput of both ways of reading
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_timer.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_tools.h"
+
+#define NBTHREAD 4
+#define NBITER 100000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+  litl_data_t data[32] = "raw data";
+
+  for (i = 0; i < NBITER; i++) {
+    switch (i % 5) {
+    case 0:
+      CHECK(litl_write_probe_reg_0(__trace, 0x100));
+      break;
+    case 1:
+      CHECK(litl_write_probe_reg_1(__trace, 0x101, i));
+      break;
+    case 2:
+      CHECK(litl_write_probe_reg_3(__trace, 0x103, i, 2 * i, 3 * i));
+      break;
+    case 3:
+      CHECK(litl_write_probe_str(__trace, 0x104, i % 2 ? "odd" : "even"));
+      break;
+    default:
+      CHECK(litl_write_probe_raw(__trace, 0x105, sizeof(data), data));
+      break;
+    }
+  }
+
+  return NULL ;
+}
+
+/*
+ * Checks that the batches of each thread hold the same events as the ones
+ *   returned by litl_read_next_thread_event
+ */
+static void check_batches(char* filename, litl_size_t capacity) {
+  litl_read_trace_t* trace, *ref;
+  litl_read_process_t* process, *ref_process;
+  litl_read_batch_t* batch;
+  litl_read_event_t* event;
+  litl_med_size_t thread_index;
+  litl_size_t i;
+  litl_data_t p;
+  int nb_events = 0;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  ref = litl_read_open_trace(filename);
+  litl_read_init_processes(ref);
+  process = trace->processes[0];
+  ref_process = ref->processes[0];
+  batch = litl_read_init_batch(capacity);
+
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    litl_read_thread_t* thread = process->threads[thread_index];
+    litl_read_thread_t* ref_thread = ref_process->threads[thread_index];
+
+    while (litl_read_next_thread_batch(trace, process, thread, batch)) {
+      CHECK(batch->nb_events <= capacity);
+      CHECK(batch->process == process);
+      for (i = 0; i < batch->nb_events; i++) {
+        event = litl_read_next_thread_event(ref, ref_process, ref_thread);
+        CHECK(event && event->event);
+        CHECK(batch->times[i] == LITL_READ_GET_TIME(event));
+        CHECK(batch->codes[i] == LITL_READ_GET_CODE(event));
+        CHECK(batch->types[i] == LITL_READ_GET_TYPE(event));
+        CHECK(batch->tids[i] == LITL_READ_GET_TID(event));
+        CHECK(memcmp(batch->events[i], event->event,
+                     __litl_get_gen_event_size(event->event)) == 0);
+        if (batch->types[i] == LITL_TYPE_REGULAR) {
+          CHECK(batch->nb_params[i] == event->event->parameters.regular.nb_params);
+          for (p = 0; p < batch->nb_params[i]; p++)
+            CHECK(batch->params[p][i] == event->event->parameters.regular.param[p]);
+        } else
+          CHECK(batch->nb_params[i] == 0);
+        nb_events++;
+      }
+    }
+    event = litl_read_next_thread_event(ref, ref_process, ref_thread);
+    CHECK(!event || !event->event);
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+
+  // the strings are defined while decoding the batches
+  CHECK(litl_read_get_string(process, 0) != NULL);
+
+  litl_read_finalize_batch(batch);
+  litl_read_finalize_trace(ref);
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Sums the first parameter of the events with a given code, reading the
+ *   events one at a time or by batches, and returns the time it took (in ns)
+ */
+static litl_time_t sum_params(char* filename, int by_batch, litl_param_t* sum) {
+  litl_read_trace_t* trace;
+  litl_read_event_t* event;
+  litl_read_batch_t* batch;
+  litl_time_t start;
+  litl_size_t i;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  *sum = 0;
+
+  start = litl_get_time();
+  if (by_batch) {
+    batch = litl_read_init_batch(4096);
+    while (litl_read_next_batch(trace, batch))
+      for (i = 0; i < batch->nb_events; i++)
+        if (batch->codes[i] == 0x103)
+          *sum += batch->params[1][i];
+    litl_read_finalize_batch(batch);
+  } else {
+    while ((event = litl_read_next_event(trace)) != NULL )
+      if (LITL_READ_GET_CODE(event) == 0x103)
+        *sum += event->event->parameters.regular.param[1];
+  }
+  start = litl_get_time() - start;
+
+  litl_read_finalize_trace(trace);
+
+  return start;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  litl_param_t sum, batch_sum;
+  litl_time_t duration, batch_duration;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_batch.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(64 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Decoding the events into batches\n\n");
+  check_batches(filename, 1);
+  check_batches(filename, 7);
+  check_batches(filename, 4096);
+  setenv("LITL_READ_MMAP", "0", 1);
+  check_batches(filename, 7);
+  check_batches(filename, 4096);
+
+  batch_duration = sum_params(filename, 1, &batch_sum);
+  unsetenv("LITL_READ_MMAP");
+  CHECK(sum_params(filename, 1, &batch_sum) > 0);
+  batch_duration = sum_params(filename, 1, &batch_sum);
+  duration = sum_params(filename, 0, &sum);
+  CHECK(sum == batch_sum);
+  printf("Reading events one at a time: %.2f Mevents/s\n",
+         (double) NBTHREAD * NBITER * 1e3 / duration);
+  printf("Reading events by batches: %.2f Mevents/s\n\n",
+         (double) NBTHREAD * NBITER * 1e3 / batch_duration);
+
+  printf("Yes, the events were decoded into batches successfully\n");
+
+  return EXIT_SUCCESS;
+}
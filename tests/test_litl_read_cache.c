@@ -0,0 +1,112 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the reading of a trace with pread when the memory is
+ * limited: the threads share a chunk cache that holds fewer buffers than there
+ * are threads, so that the buffers are evicted and loaded again
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 32
+#define NBITER 5000
+#define NBBUFFERS 3
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg) {
+  int i;
+  litl_param_t thread_no = (litl_param_t) (intptr_t) arg;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_2(__trace, 0x100, thread_no, i));
+    if (i % 500 == 0)
+      usleep(10);
+  }
+
+  return NULL ;
+}
+
+static void read_trace(char* filename) {
+  int nb_events = 0;
+  litl_param_t thread_no, i;
+  litl_param_t next[NBTHREAD] = { 0 };
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_size_t buffer_size;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_set_cache_size(trace, 0);
+  litl_read_init_processes(trace);
+
+  // opening the trace does not load any buffer
+  CHECK(trace->cache_size == 0);
+
+  // the cache holds a few buffers, while the threads are interleaved
+  buffer_size = litl_read_get_buffer_size(trace);
+  litl_read_set_cache_size(trace, NBBUFFERS * buffer_size);
+
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    litl_read_get_param_2(event, thread_no, i);
+    CHECK(thread_no < NBTHREAD);
+    CHECK(i == next[thread_no]);
+    next[thread_no]++;
+    nb_events++;
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+  CHECK(trace->cache_size <= NBBUFFERS * buffer_size);
+
+  litl_read_finalize_trace(trace);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_cache.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, (void*) (intptr_t) i);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Reading the events with %d buffers\n\n", NBBUFFERS);
+  setenv("LITL_READ_MMAP", "0", 1);
+  read_trace(filename);
+
+  printf("Yes, the events were read within the memory budget\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the filters of the reader: only the events whose code,
+ * thread and time pass the filters are read, whatever the way of reading them.
+ * The chunks that do not hold a rare code are skipped thanks to the summaries
+ * of their codes
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_tools.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+#define NBCODES 8
+#define RARE_CODE 0x200
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg) {
+  int i;
+  litl_param_t thread_no = (litl_param_t) (intptr_t) arg;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_2(__trace, 0x100 + i % NBCODES, thread_no, i));
+    if (thread_no == 0 && i == NBITER / 2)
+      CHECK(litl_write_probe_reg_0(__trace, RARE_CODE));
+    if (i % 100 == 0)
+      usleep(10);
+  }
+
+  return NULL ;
+}
+
+typedef struct {
+  litl_code_t first, last;
+  litl_tid_t tid;
+  litl_time_t start, end;
+} filter_t;
+
+/*
+ * Returns whether an event passes the filters
+ */
+static int pass(filter_t* filter, litl_read_event_t* event) {
+  return LITL_READ_GET_CODE(event) >= filter->first
+    && LITL_READ_GET_CODE(event) <= filter->last
+    && (!filter->tid || LITL_READ_GET_TID(event) == filter->tid)
+    && LITL_READ_GET_TIME(event) >= filter->start
+    && LITL_READ_GET_TIME(event) <= filter->end;
+}
+
+/*
+ * Returns the number of events that pass the filters, by reading all the
+ *   events
+ */
+static int count_events(char* filename, filter_t* filter) {
+  int nb_events = 0;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  while ((event = litl_read_next_event(trace)) != NULL )
+    nb_events += pass(filter, event);
+  litl_read_finalize_trace(trace);
+
+  return nb_events;
+}
+
+static litl_read_trace_t* open_trace(char* filename, filter_t* filter) {
+  litl_read_trace_t* trace;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  litl_read_filter_codes(trace, filter->first, filter->last);
+  if (filter->tid)
+    litl_read_filter_tid(trace, filter->tid);
+  litl_read_set_time_window(trace, filter->start, filter->end);
+
+  return trace;
+}
+
+/*
+ * The state shared by the workers that visit the events
+ */
+typedef struct {
+  filter_t* filter;
+  int nb_events;
+} visit_t;
+
+/*
+ * Counts the visited events, which must pass the filters
+ */
+static void visit_event(litl_read_trace_t* trace __attribute__ ((__unused__)),
+                        litl_read_process_t* process __attribute__ ((__unused__)),
+                        litl_read_event_t* event, void* state) {
+  visit_t* visit = (visit_t*) state;
+
+  CHECK(pass(visit->filter, event));
+  __atomic_fetch_add(&visit->nb_events, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Reads the events that pass the filters, in order, by batches and with the
+ *   visitor, and checks their number
+ */
+static void read_trace(char* filename, filter_t* filter) {
+  int nb_events = 0, expected;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_read_batch_t* batch;
+  litl_size_t i;
+  visit_t visit;
+  void* states[3];
+
+  expected = count_events(filename, filter);
+  CHECK(expected > 0);
+
+  trace = open_trace(filename, filter);
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    CHECK(pass(filter, event));
+    nb_events++;
+  }
+  CHECK(nb_events == expected);
+  litl_read_finalize_trace(trace);
+
+  nb_events = 0;
+  trace = open_trace(filename, filter);
+  batch = litl_read_init_batch(1000);
+  while (litl_read_next_batch(trace, batch))
+    for (i = 0; i < batch->nb_events; i++) {
+      CHECK(batch->codes[i] >= filter->first && batch->codes[i] <= filter->last);
+      CHECK(!filter->tid || batch->tids[i] == filter->tid);
+      CHECK(batch->times[i] >= filter->start && batch->times[i] <= filter->end);
+      nb_events++;
+    }
+  CHECK(nb_events == expected);
+  litl_read_finalize_batch(batch);
+  litl_read_finalize_trace(trace);
+
+  visit.filter = filter;
+  visit.nb_events = 0;
+  states[0] = states[1] = states[2] = &visit;
+  trace = open_trace(filename, filter);
+  litl_read_visit_events(trace, 3, visit_event, states);
+  CHECK(visit.nb_events == expected);
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Returns the ID and the time window of a thread
+ */
+static litl_tid_t get_thread(char* filename, litl_time_t* start,
+                             litl_time_t* end) {
+  litl_read_trace_t* trace;
+  litl_read_process_t* process;
+  const litl_chunk_t* chunks;
+  litl_size_t nb_chunks;
+  litl_tid_t tid;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  process = trace->processes[0];
+  chunks = litl_read_get_thread_chunks(trace, process, process->threads[1],
+                                       &nb_chunks);
+  CHECK(nb_chunks > 2);
+  *start = chunks[1].first_time;
+  *end = chunks[nb_chunks - 2].last_time;
+  tid = process->threads[1]->thread_pair->tid;
+  litl_read_finalize_trace(trace);
+
+  return tid;
+}
+
+/*
+ * Checks that few chunks may hold a rare code, and that it is found
+ */
+static void find_rare_code(char* filename) {
+  litl_read_trace_t* trace;
+  litl_read_process_t* process;
+  litl_read_event_t* event;
+  const litl_chunk_t* chunks;
+  litl_size_t nb_chunks, i, nb_candidates = 0, nb_all_chunks = 0;
+  litl_med_size_t thread_index;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  process = trace->processes[0];
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    chunks = litl_read_get_thread_chunks(trace, process,
+                                         process->threads[thread_index],
+                                         &nb_chunks);
+    for (i = 0; i < nb_chunks; i++) {
+      CHECK(chunks[i].min_code >= 0x100 && chunks[i].max_code <= RARE_CODE);
+      CHECK(__litl_chunk_may_hold_codes(&chunks[i], 0x100, 0x100 + NBCODES - 1));
+      if (chunks[i].max_code < RARE_CODE)
+        CHECK(!__litl_chunk_may_hold_codes(&chunks[i], 0x100 + NBCODES, 0x1ff));
+      nb_candidates += __litl_chunk_may_hold_codes(&chunks[i], RARE_CODE,
+                                                   RARE_CODE);
+    }
+    nb_all_chunks += nb_chunks;
+  }
+  CHECK(nb_candidates >= 1 && nb_candidates < nb_all_chunks / 4);
+
+  litl_read_filter_codes(trace, RARE_CODE, RARE_CODE);
+  event = litl_read_next_ordered_event(trace);
+  CHECK(event && LITL_READ_GET_CODE(event) == RARE_CODE);
+  CHECK(litl_read_next_ordered_event(trace) == NULL);
+
+  litl_read_finalize_trace(trace);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  filter_t filter;
+  litl_time_t start, end;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_filter.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, (void*) (intptr_t) i);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Reading the events that pass the filters\n\n");
+  filter.tid = get_thread(filename, &start, &end);
+  for (i = 0; i < 2; i++) {
+    // by code
+    filter = (filter_t) { 0x102, 0x104, 0, 0, LITL_MAX_TIME };
+    read_trace(filename, &filter);
+
+    // by thread
+    filter.first = 0;
+    filter.last = (litl_code_t) -1;
+    filter.tid = get_thread(filename, &start, &end);
+    read_trace(filename, &filter);
+
+    // by time, along with the others
+    filter = (filter_t) { 0x101, 0x101, filter.tid, start, end };
+    read_trace(filename, &filter);
+
+    // a rare code
+    find_rare_code(filename);
+
+    setenv("LITL_READ_MMAP", "0", 1);
+  }
+
+  printf("Yes, the events were filtered successfully\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the reading of a trace recorded by many threads: the
+ * events of all the threads are returned in chronological order
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_timer.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 500
+#define NBITER 200
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg) {
+  int i;
+  litl_param_t thread_id = (litl_param_t) (uintptr_t) arg;
+
+  for (i = 0; i < NBITER; i++)
+    litl_write_probe_reg_2(__trace, 0x601, thread_id, i);
+
+  return NULL ;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_time_t prev_time = 0, start;
+  int nb_events = 0;
+  int next_iter[NBTHREAD];
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_many_threads.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, (void*) (uintptr_t) i);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Reading the events in chronological order\n\n");
+
+  memset(next_iter, 0, sizeof(next_iter));
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  start = litl_get_time();
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    litl_param_t thread_id, iter;
+
+    CHECK(LITL_READ_GET_TIME(event) >= prev_time);
+    prev_time = LITL_READ_GET_TIME(event);
+
+    // the events of each thread are read in the order they were recorded
+    litl_read_get_param_2(event, thread_id, iter);
+    CHECK(thread_id < NBTHREAD);
+    CHECK(iter == (litl_param_t) next_iter[thread_id]++);
+    nb_events++;
+  }
+  printf("%d events read in %.2f ms\n", nb_events,
+         (litl_get_time() - start) / 1e6);
+
+  litl_read_finalize_trace(trace);
+
+  CHECK(nb_events == NBTHREAD * NBITER);
+  for (i = 0; i < NBTHREAD; i++)
+    CHECK(next_iter[i] == NBITER);
+
+  printf("Yes, the events were read in chronological order\n");
+
+  return EXIT_SUCCESS;
+}
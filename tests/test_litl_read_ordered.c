@@ -0,0 +1,89 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the chronological reading of an archive: two traces
+ * are recorded at the same time and merged, and their events are read
+ * interleaved
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_merge.h"
+
+#define NBITER 10000
+#define NBTRACES 2
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+int main(int argc __attribute__((unused)), char **argv __attribute__((unused))) {
+  int i, j;
+  char** filenames;
+  char* archive = "/tmp/test_litl_read_ordered.trace";
+  litl_write_trace_t* traces[NBTRACES];
+  litl_read_trace_t* trace;
+  litl_read_event_t* event;
+  litl_time_t prev_time = 0;
+  litl_param_t iter;
+  int nb_events = 0;
+
+  // the names of the traces are freed when the traces are merged
+  filenames = malloc(NBTRACES * sizeof(char*));
+  for (j = 0; j < NBTRACES; j++)
+    CHECK(asprintf(&filenames[j], "/tmp/test_litl_read_ordered_%d.trace", j) > 0);
+
+  printf("Recording %d traces at the same time\n\n", NBTRACES);
+  for (j = 0; j < NBTRACES; j++) {
+    traces[j] = litl_write_init_trace(16 * 1024);
+    litl_write_set_filename(traces[j], filenames[j]);
+    litl_write_buffer_flush_on(traces[j]);
+  }
+  for (i = 0; i < NBITER; i++)
+    for (j = 0; j < NBTRACES; j++)
+      CHECK(litl_write_probe_reg_1(traces[j], 0x701 + j, i));
+  for (j = 0; j < NBTRACES; j++)
+    litl_write_finalize_trace(traces[j]);
+
+  litl_merge_traces(archive, filenames, NBTRACES);
+
+  printf("Reading the archive in chronological order\n\n");
+  trace = litl_read_open_trace(archive);
+  litl_read_init_processes(trace);
+  CHECK(trace->nb_processes == NBTRACES);
+
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    CHECK(LITL_READ_GET_TIME(event) >= prev_time);
+    prev_time = LITL_READ_GET_TIME(event);
+
+    // the events of the traces are interleaved as they were recorded
+    CHECK(LITL_READ_GET_CODE(event)
+          == (litl_code_t) (0x701 + nb_events % NBTRACES));
+    CHECK(LITL_READ_GET_CUR_PROCESS(trace)
+          == trace->processes[nb_events % NBTRACES]);
+    litl_read_get_param_1(event, iter);
+    CHECK(iter == (litl_param_t) nb_events / NBTRACES);
+    nb_events++;
+  }
+  CHECK(nb_events == NBITER * NBTRACES);
+
+  litl_read_finalize_trace(trace);
+
+  printf("Yes, the events were read in chronological order\n");
+
+  return EXIT_SUCCESS;
+}
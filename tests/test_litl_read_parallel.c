@@ -0,0 +1,130 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the parallel reading of a trace: the events are
+ * counted by several workers, each with its own counters, and the counters
+ * are compared with the ones computed by the sequential reading
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_timer.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 16
+#define NBITER 20000
+#define NBCODES 8
+#define NBWORKERS 4
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+struct counters {
+  uint64_t nb_events[NBCODES];
+  uint64_t sum;
+};
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++)
+    litl_write_probe_reg_2(__trace, i % NBCODES, i, CUR_TID);
+
+  return NULL ;
+}
+
+static void count_event(litl_read_trace_t* trace __attribute__ ((__unused__)),
+                        litl_read_process_t* process __attribute__ ((__unused__)),
+                        litl_read_event_t* event, void* state) {
+  struct counters* counters = state;
+  litl_param_t iter, tid;
+
+  litl_read_get_param_2(event, iter, tid);
+  CHECK(tid == LITL_READ_GET_TID(event));
+  counters->nb_events[LITL_READ_GET_CODE(event)]++;
+  counters->sum += iter;
+}
+
+int main(int argc, char **argv) {
+  int i, j;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_time_t start;
+  struct counters expected, results[NBWORKERS];
+  void* states[NBWORKERS];
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_parallel.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+  __trace = litl_write_init_trace(64 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+  litl_write_finalize_trace(__trace);
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  printf("Counting the events with %d workers\n\n", NBWORKERS);
+  memset(results, 0, sizeof(results));
+  for (i = 0; i < NBWORKERS; i++)
+    states[i] = &results[i];
+  start = litl_get_time();
+  litl_read_visit_events(trace, NBWORKERS, count_event, states);
+  printf("Parallel reading: %.2f ms\n", (litl_get_time() - start) / 1e6);
+
+  // reduce the counters of the workers
+  for (i = 1; i < NBWORKERS; i++) {
+    for (j = 0; j < NBCODES; j++)
+      results[0].nb_events[j] += results[i].nb_events[j];
+    results[0].sum += results[i].sum;
+  }
+
+  // the trace can still be read sequentially
+  memset(&expected, 0, sizeof(expected));
+  start = litl_get_time();
+  while ((event = litl_read_next_event(trace)) != NULL )
+    count_event(trace, LITL_READ_GET_CUR_PROCESS(trace), event, &expected);
+  printf("Sequential reading: %.2f ms\n\n", (litl_get_time() - start) / 1e6);
+
+  for (j = 0; j < NBCODES; j++) {
+    CHECK(expected.nb_events[j] == NBTHREAD * NBITER / NBCODES);
+    CHECK(results[0].nb_events[j] == expected.nb_events[j]);
+  }
+  CHECK(results[0].sum == expected.sum);
+
+  // the trace can be visited again
+  litl_read_visit_events(trace, 1, count_event, states);
+  CHECK(results[0].sum == 2 * expected.sum);
+
+  litl_read_finalize_trace(trace);
+
+  printf("Yes, the events were read in parallel successfully\n");
+
+  return EXIT_SUCCESS;
+}
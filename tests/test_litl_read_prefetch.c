@@ -0,0 +1,122 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the prefetching of the chunks of events: the events
+ * that are read do not depend on the prefetch depth, and the chunks ahead of
+ * each thread are prefetched
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg) {
+  int i;
+  litl_param_t thread_no = (litl_param_t) (intptr_t) arg;
+
+  for (i = 0; i < NBITER; i++)
+    CHECK(litl_write_probe_reg_2(__trace, 0x100, thread_no, i));
+
+  return NULL ;
+}
+
+/*
+ * Reads the events in order with a given prefetch depth and returns a
+ *   checksum of their parameters
+ */
+static uint64_t read_trace(char* filename, unsigned depth) {
+  int nb_events = 0;
+  uint64_t checksum = 0;
+  litl_param_t thread_no, i;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_read_thread_t* thread;
+  litl_med_size_t thread_index;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_set_prefetch_depth(trace, depth);
+  litl_read_init_processes(trace);
+
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    litl_read_get_param_2(event, thread_no, i);
+    checksum = checksum * 31 + thread_no * NBITER + i;
+    nb_events++;
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+
+  // all the chunks, but the first one, were prefetched
+  for (thread_index = 0; thread_index < trace->processes[0]->nb_threads;
+      thread_index++) {
+    thread = trace->processes[0]->threads[thread_index];
+    CHECK(thread->nb_chunks > 1);
+    if (depth)
+      CHECK(thread->prefetch_offset
+            == thread->chunks[thread->nb_chunks - 1].offset);
+    else
+      CHECK(thread->prefetch_offset == 0);
+  }
+
+  litl_read_finalize_trace(trace);
+
+  return checksum;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  uint64_t checksum;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_read_prefetch.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, (void*) (intptr_t) i);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Reading the events with and without prefetching\n\n");
+  checksum = read_trace(filename, 0);
+  CHECK(read_trace(filename, 1) == checksum);
+  CHECK(read_trace(filename, 8) == checksum);
+  setenv("LITL_READ_MMAP", "0", 1);
+  CHECK(read_trace(filename, 0) == checksum);
+  CHECK(read_trace(filename, 4) == checksum);
+
+  printf("Yes, the chunks were prefetched successfully\n");
+
+  return EXIT_SUCCESS;
+}
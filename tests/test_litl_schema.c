@@ -0,0 +1,129 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the recording of typed events: the event schemas are
+ * stored in the trace and the parameters are decoded according to them
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NB_EVENTS 1000
+
+#define CODE_SEND 0x201
+#define CODE_SCALE 0x202
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static void write_trace(char* filename) {
+  int i;
+  litl_write_trace_t* trace;
+  const litl_param_type_t send_types[] = { LITL_PARAM_UINT8, LITL_PARAM_INT32,
+      LITL_PARAM_UINT64 };
+  const litl_param_type_t scale_types[] = { LITL_PARAM_INT16,
+      LITL_PARAM_DOUBLE, LITL_PARAM_FLOAT };
+
+  trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(trace, filename);
+  litl_write_buffer_flush_on(trace);
+
+  CHECK(litl_write_register_event(trace, CODE_SEND, "send", 3, send_types) == 0);
+  CHECK(litl_write_register_event(trace, CODE_SCALE, "scale", 3, scale_types) == 0);
+  // a code can be registered only once
+  CHECK(litl_write_register_event(trace, CODE_SEND, "send", 3, send_types) == -1);
+  // unregistered codes can not be recorded as typed events
+  CHECK(litl_write_probe_typed(trace, 0x203, 1) == NULL);
+
+  for (i = 0; i < NB_EVENTS; i++) {
+    litl_t* evt = litl_write_probe_typed(trace, CODE_SEND, (uint8_t) i, -i,
+                                         (uint64_t) i << 40);
+    CHECK(evt && evt->parameters.packed.size == 1 + 4 + 8);
+    evt = litl_write_probe_typed(trace, CODE_SCALE, -i, i * 0.5, (float) i);
+    CHECK(evt && evt->parameters.packed.size == 2 + 8 + 4);
+    CHECK(litl_write_probe_reg_1(trace, 0x204, i));
+  }
+
+  litl_write_finalize_trace(trace);
+}
+
+static void read_trace(char* filename) {
+  int nb_send = 0, nb_scale = 0, nb_regular = 0;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_event_schema_t* schema;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  schema = litl_read_get_event_schema(trace->processes[0], CODE_SEND);
+  CHECK(schema && schema->nb_params == 3);
+  CHECK(strcmp((char*) schema->name, "send") == 0);
+  CHECK(litl_read_get_event_schema(trace->processes[0], 0x204) == NULL);
+
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    litl_read_process_t* process = LITL_READ_GET_CUR_PROCESS(trace);
+    switch (LITL_READ_GET_CODE(event)) {
+    case CODE_SEND:
+      CHECK(litl_read_get_typed_params(process, event, params) == 3);
+      CHECK(params[0].type == LITL_PARAM_UINT8);
+      CHECK(params[0].value.u == (uint8_t) nb_send);
+      CHECK(params[1].value.i == -nb_send);
+      CHECK(params[2].value.u == (uint64_t) nb_send << 40);
+      nb_send++;
+      break;
+    case CODE_SCALE:
+      CHECK(litl_read_get_typed_params(process, event, params) == 3);
+      CHECK(params[0].value.i == -nb_scale);
+      CHECK(params[1].value.d == nb_scale * 0.5);
+      CHECK(params[2].value.d == (float) nb_scale);
+      nb_scale++;
+      break;
+    default:
+      CHECK(litl_read_get_typed_params(process, event, params) == -1);
+      nb_regular++;
+      break;
+    }
+  }
+
+  litl_read_finalize_trace(trace);
+
+  CHECK(nb_send == NB_EVENTS);
+  CHECK(nb_scale == NB_EVENTS);
+  CHECK(nb_regular == NB_EVENTS);
+}
+
+int main(int argc, char **argv) {
+  char* filename;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_schema.trace";
+
+  printf("Recording typed events\n\n");
+  write_trace(filename);
+
+  printf("Decoding typed events\n\n");
+  read_trace(filename);
+
+  printf("Yes, the typed events were recorded successfully\n");
+
+  return EXIT_SUCCESS;
+}
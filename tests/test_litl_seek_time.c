@@ -0,0 +1,180 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the chunk index: the reading of a trace starts from a
+ * given time, or is restricted to a time window, both with the index stored
+ * in the trace and with the index built when the trace has none
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+static litl_time_t __times[NBTHREAD * NBITER];
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_1(__trace, 0x100, i));
+    if (i % 100 == 0)
+      usleep(10);
+  }
+
+  return NULL ;
+}
+
+/*
+ * Reads the events in order, from the beginning of the trace or within a
+ *   time window, and returns their number
+ */
+static int read_events(litl_read_trace_t* trace, int store_times) {
+  int nb_events = 0;
+  litl_read_event_t* event;
+  litl_time_t time = 0;
+
+  while ((event = litl_read_next_ordered_event(trace)) != NULL ) {
+    CHECK(LITL_READ_GET_TIME(event) >= time);
+    time = LITL_READ_GET_TIME(event);
+    if (store_times)
+      __times[nb_events] = time;
+    nb_events++;
+  }
+
+  return nb_events;
+}
+
+/*
+ * Returns the number of events that occurred within a time window
+ */
+static int count_events(litl_time_t start, litl_time_t end) {
+  int i, nb_events = 0;
+
+  for (i = 0; i < NBTHREAD * NBITER; i++)
+    if (__times[i] >= start && __times[i] <= end)
+      nb_events++;
+
+  return nb_events;
+}
+
+static void read_trace(char* filename, int has_index) {
+  litl_read_trace_t* trace;
+  litl_read_process_t* process;
+  litl_read_event_t* event;
+  const litl_chunk_t* chunks;
+  litl_size_t nb_chunks, i;
+  litl_med_size_t thread_index;
+  litl_time_t start, end;
+  int nb_events = 0;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  process = trace->processes[0];
+
+  CHECK(read_events(trace, 1) == NBTHREAD * NBITER);
+
+  // the chunks of each thread are sorted and cover all its events
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    chunks = litl_read_get_thread_chunks(trace, process,
+                                         process->threads[thread_index],
+                                         &nb_chunks);
+    CHECK(nb_chunks > 1);
+    for (i = 0; i < nb_chunks; i++) {
+      CHECK(chunks[i].first_time <= chunks[i].last_time);
+      CHECK(i == 0 || chunks[i - 1].last_time <= chunks[i].first_time);
+      nb_events += chunks[i].nb_events;
+    }
+  }
+  CHECK(nb_events == NBTHREAD * NBITER);
+  CHECK((process->sections != NULL) == has_index);
+
+  // start from the middle of the trace
+  start = __times[NBTHREAD * NBITER / 2];
+  litl_read_seek_time(trace, start);
+  CHECK(read_events(trace, 0) == count_events(start, LITL_MAX_TIME));
+
+  // read a time window
+  start = __times[NBTHREAD * NBITER / 3];
+  end = __times[NBTHREAD * NBITER / 3 + 1000];
+  litl_read_set_time_window(trace, start, end);
+  CHECK(read_events(trace, 0) == count_events(start, end));
+
+  // the threads can be read separately
+  litl_read_seek_thread_time(trace, process, process->threads[0], end);
+  event = litl_read_next_thread_event(trace, process, process->threads[0]);
+  CHECK(!event || !event->event || LITL_READ_GET_TIME(event) >= end);
+
+  // before and after all the events
+  litl_read_set_time_window(trace, 0, LITL_MAX_TIME);
+  CHECK(read_events(trace, 0) == NBTHREAD * NBITER);
+  litl_read_seek_time(trace, __times[NBTHREAD * NBITER - 1] + 1);
+  CHECK(read_events(trace, 0) == 0);
+
+  litl_read_finalize_trace(trace);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  struct stat st;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_seek_time.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Seeking with the chunk index of the trace\n\n");
+  read_trace(filename, 1);
+  setenv("LITL_READ_MMAP", "0", 1);
+  read_trace(filename, 1);
+  unsetenv("LITL_READ_MMAP");
+
+  // without the trailer, the chunk index is built by reading the trace
+  printf("Seeking with the chunk index built by the reader\n\n");
+  CHECK(stat(filename, &st) == 0);
+  CHECK(truncate(filename, st.st_size - 1) == 0);
+  read_trace(filename, 0);
+  setenv("LITL_READ_MMAP", "0", 1);
+  read_trace(filename, 0);
+
+  printf("Yes, the events were found from their time\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the statistics of the events stored at the end of a
+ * trace: they match the events that are read, both when they are read from the
+ * trace and when they are computed for a trace that has none
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "litl_types.h"
+#include "litl_tools.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+#define NBCODES 16
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg) {
+  int i;
+  litl_param_t thread_no = (litl_param_t) (intptr_t) arg;
+  litl_data_t data[16] = "raw data";
+
+  for (i = 0; i < NBITER; i++) {
+    // each thread records a different mix of codes and types
+    switch ((i + thread_no) % 4) {
+    case 0:
+      CHECK(litl_write_probe_reg_1(__trace, 0x100 + i % NBCODES, i));
+      break;
+    case 1:
+      CHECK(litl_write_probe_reg_3(__trace, 0x100 + i % NBCODES, i, i, i));
+      break;
+    case 2:
+      CHECK(litl_write_probe_raw(__trace, 0x200, 1 + i % sizeof(data), data));
+      break;
+    default:
+      CHECK(litl_write_probe_str(__trace, 0x300, i % 2 ? "odd" : "even"));
+      break;
+    }
+  }
+
+  return NULL ;
+}
+
+/*
+ * Reads all the events and checks that the statistics match them
+ */
+static void check_stats(char* filename) {
+  litl_read_trace_t* trace;
+  litl_read_process_t* process;
+  litl_read_thread_t* thread;
+  litl_read_event_t* event;
+  const litl_thread_stats_t* thread_stats;
+  const litl_code_stats_t* code_stats;
+  litl_size_t nb_threads, nb_codes, i;
+  litl_med_size_t thread_index;
+  uint64_t nb_events = 0, size = 0, total = 0;
+  litl_time_t first_time = 0, last_time = 0;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  process = trace->processes[0];
+
+  // per thread
+  thread_stats = litl_read_get_thread_stats(trace, process, &nb_threads);
+  CHECK(nb_threads == NBTHREAD);
+  for (thread_index = 0; thread_index < process->nb_threads; thread_index++) {
+    thread = process->threads[thread_index];
+    nb_events = size = 0;
+    while ((event = litl_read_next_thread_event(trace, process, thread)) != NULL
+           && event->event) {
+      if (!nb_events)
+        first_time = LITL_READ_GET_TIME(event);
+      last_time = LITL_READ_GET_TIME(event);
+      nb_events++;
+      size += __litl_get_gen_event_size(event->event);
+    }
+    for (i = 0; i < nb_threads; i++)
+      if (thread_stats[i].tid == thread->thread_pair->tid)
+        break;
+    CHECK(i < nb_threads);
+    CHECK(thread_stats[i].nb_events == nb_events);
+    CHECK(thread_stats[i].size == size);
+    CHECK(thread_stats[i].first_time == first_time);
+    CHECK(thread_stats[i].last_time == last_time);
+    total += nb_events;
+  }
+  CHECK(total == NBTHREAD * NBITER);
+  litl_read_finalize_trace(trace);
+
+  // per code
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  process = trace->processes[0];
+  code_stats = litl_read_get_code_stats(trace, process, &nb_codes);
+  CHECK(nb_codes == NBCODES + 2);
+  for (i = 0; i < nb_codes; i++) {
+    CHECK(i == 0 || code_stats[i - 1].code < code_stats[i].code);
+    CHECK(litl_read_find_code_stats(trace, process, code_stats[i].code)
+          == &code_stats[i]);
+    litl_read_filter_codes(trace, code_stats[i].code, code_stats[i].code);
+    nb_events = size = 0;
+    while ((event = litl_read_next_event(trace)) != NULL ) {
+      nb_events++;
+      size += __litl_get_gen_event_size(event->event);
+    }
+    CHECK(code_stats[i].nb_events == nb_events);
+    CHECK(code_stats[i].size == size);
+    litl_read_finalize_trace(trace);
+
+    trace = litl_read_open_trace(filename);
+    litl_read_init_processes(trace);
+    process = trace->processes[0];
+    code_stats = litl_read_get_code_stats(trace, process, &nb_codes);
+  }
+  CHECK(litl_read_find_code_stats(trace, process, 0x400) == NULL);
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Changes the type of the sections of statistics, so that the reader ignores
+ *   them, and keeps the other sections, e.g. the chunk index
+ */
+static void hide_stats_sections(char* filename) {
+  litl_read_trace_t* trace;
+  litl_trailer_t trailer;
+  litl_section_header_t header;
+  litl_offset_t offset, end;
+  int fd;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  offset = trace->processes[0]->header->offset;
+  end = offset + trace->processes[0]->header->trace_size
+    - sizeof(litl_trailer_t);
+  litl_read_finalize_trace(trace);
+
+  fd = open(filename, O_RDWR);
+  CHECK(fd >= 0);
+  CHECK(pread(fd, &trailer, sizeof(trailer), end) == sizeof(trailer));
+  for (offset += trailer.sections_offset; offset < end;
+       offset += sizeof(header) + header.size) {
+    CHECK(pread(fd, &header, sizeof(header), offset) == sizeof(header));
+    if (header.type == LITL_SECTION_THREAD_STATS
+        || header.type == LITL_SECTION_CODE_STATS) {
+      header.type = 0;
+      CHECK(pwrite(fd, &header, sizeof(header), offset) == sizeof(header));
+    }
+  }
+  close(fd);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  struct stat st;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_stats.trace";
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, (void*) (intptr_t) i);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Checking the statistics stored in the trace\n\n");
+  check_stats(filename);
+
+  // without the sections of statistics, they are computed by reading the
+  //   trace, even though the chunk index is loaded from its section
+  printf("Checking the statistics of a trace without them\n\n");
+  hide_stats_sections(filename);
+  check_stats(filename);
+
+  // without the trailer, the statistics are computed by reading the trace
+  printf("Checking the statistics of a truncated trace\n\n");
+  CHECK(stat(filename, &st) == 0);
+  CHECK(truncate(filename, st.st_size - 1) == 0);
+  check_stats(filename);
+  setenv("LITL_READ_MMAP", "0", 1);
+  check_stats(filename);
+
+  printf("Yes, the statistics of the events are correct\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the recording of interned strings by several threads:
+ * each string is defined once, and the events only store its ID
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+
+#define NBTHREAD 4
+#define NBITER 1000
+#define NBSTRINGS 5
+
+#define CODE_FUNCTION 0x301
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+static const char* __strings[NBSTRINGS] = { "main", "MPI_Send", "MPI_Recv",
+    "compute_kernel", "a rather long function name that would not fit in a regular event" };
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++)
+    CHECK(litl_write_probe_str(__trace, CODE_FUNCTION, __strings[i % NBSTRINGS]));
+
+  return NULL ;
+}
+
+/*
+ * Reads the trace and returns the number of string events
+ */
+static int read_trace(char* filename, int check_params) {
+  int i, nb_events = 0;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_string_id_t id;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    litl_read_process_t* process = LITL_READ_GET_CUR_PROCESS(trace);
+    CHECK(LITL_READ_GET_CODE(event) == CODE_FUNCTION);
+    CHECK(LITL_READ_PACKED(event)->size == sizeof(litl_string_id_t));
+
+    if (check_params) {
+      CHECK(litl_read_get_typed_params(process, event, params) == 1);
+      CHECK(params[0].type == LITL_PARAM_STRING);
+      CHECK(params[0].value.s);
+      for (i = 0; i < NBSTRINGS; i++)
+        if (strcmp(params[0].value.s, __strings[i]) == 0)
+          break;
+      CHECK(i < NBSTRINGS);
+    }
+
+    // the string is known, either from the dictionary or from its definition
+    litl_read_get_param_1(event, id);
+    CHECK(litl_read_get_string(process, id) != NULL);
+    nb_events++;
+  }
+
+  for (id = 0; id < NBSTRINGS; id++)
+    CHECK(litl_read_get_string(trace->processes[0], id) != NULL);
+  CHECK(litl_read_get_string(trace->processes[0], NBSTRINGS) == NULL);
+
+  litl_read_finalize_trace(trace);
+
+  return nb_events;
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  pthread_t tid[NBTHREAD];
+  struct stat st;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_strings.trace";
+
+  printf("Recording interned strings by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(64 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  CHECK(__trace->nb_strings == NBSTRINGS);
+  litl_write_finalize_trace(__trace);
+
+  printf("Checking the strings\n\n");
+  CHECK(read_trace(filename, 1) == NBTHREAD * NBITER);
+
+  // without the trailer, the strings are found from their definitions
+  printf("Checking the strings of a truncated trace\n\n");
+  CHECK(stat(filename, &st) == 0);
+  CHECK(truncate(filename, st.st_size - 1) == 0);
+  CHECK(read_trace(filename, 0) == NBTHREAD * NBITER);
+
+  printf("Yes, the strings were recorded successfully\n");
+
+  return EXIT_SUCCESS;
+}
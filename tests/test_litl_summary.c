@@ -0,0 +1,197 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the timeline summaries: each level holds all the events
+ * and all the busy time of each thread, the summary does not depend on the
+ * number of workers that build it, and the rendering of a time window
+ * matches the buckets
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_pair.h"
+#include "litl_summary.h"
+
+#define NBTHREAD 4
+#define NBITER 20000
+#define NBPIXELS 100
+
+#define CODE_OUTER 0x101
+#define CODE_INNER 0x102
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+void* write_trace(void *arg __attribute__ ((__unused__))) {
+  int i;
+
+  for (i = 0; i < NBITER; i++) {
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER, i));
+    CHECK(litl_write_probe_reg_0(__trace, CODE_INNER));
+    CHECK(litl_write_probe_reg_0(__trace, CODE_INNER + LITL_PAIR_EXIT_OFFSET));
+    CHECK(litl_write_probe_reg_1(__trace, CODE_OUTER + LITL_PAIR_EXIT_OFFSET, i));
+    // the threads are idle between the intervals
+    if (i % 100 == 0)
+      usleep(10);
+  }
+
+  return NULL ;
+}
+
+static void build_summary(char* filename, char* summary_filename,
+                          unsigned nb_workers) {
+  litl_read_trace_t* trace;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(litl_summary_build(trace, summary_filename, nb_workers)
+        == NBTHREAD * NBITER * 4);
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Compares the content of two files
+ */
+static int compare_files(char* filename, char* other_filename) {
+  FILE *f = fopen(filename, "r"), *other = fopen(other_filename, "r");
+  int c, res = 1;
+
+  CHECK(f && other);
+  do {
+    c = fgetc(f);
+    if (c != fgetc(other))
+      res = 0;
+  } while (res && c != EOF);
+
+  fclose(f);
+  fclose(other);
+  return res;
+}
+
+static void check_summary(char* summary_filename) {
+  litl_summary_t* summary;
+  const litl_summary_bucket_t* buckets;
+  litl_summary_bucket_t pixels[NBPIXELS], total;
+  litl_size_t thread, nb_buckets, i;
+  litl_time_t busy_time, span;
+  unsigned level;
+
+  summary = litl_summary_open(summary_filename);
+  CHECK(summary->header->nb_threads == NBTHREAD);
+  CHECK(summary->header->nb_levels > 1);
+  span = summary->header->end_time - summary->header->start_time;
+
+  for (thread = 0; thread < NBTHREAD; thread++) {
+    // the coarsest level holds the whole thread
+    buckets = litl_summary_get_buckets(summary,
+                                       summary->header->nb_levels - 1, thread,
+                                       &nb_buckets);
+    CHECK(nb_buckets == 1);
+    CHECK(buckets[0].nb_events == NBITER * 4);
+    busy_time = buckets[0].busy_time;
+    CHECK(busy_time > 0 && busy_time <= span);
+
+    for (level = 0; level < summary->header->nb_levels; level++) {
+      buckets = litl_summary_get_buckets(summary, level, thread, &nb_buckets);
+      CHECK(nb_buckets == ((span >> (summary->header->shift + level)) + 1));
+      memset(&total, 0, sizeof(total));
+      for (i = 0; i < nb_buckets; i++) {
+        CHECK(buckets[i].busy_time
+              <= (litl_time_t) 1 << (summary->header->shift + level));
+        total.nb_events += buckets[i].nb_events;
+        total.busy_time += buckets[i].busy_time;
+      }
+      CHECK(total.nb_events == NBITER * 4);
+      CHECK(total.busy_time == busy_time);
+    }
+
+    // the rendering of the whole trace loses no event, and shares the busy
+    //   time among the pixels
+    litl_summary_render(summary, thread, 0, LITL_MAX_TIME, NBPIXELS, pixels);
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < NBPIXELS; i++) {
+      total.nb_events += pixels[i].nb_events;
+      total.busy_time += pixels[i].busy_time;
+    }
+    CHECK(total.nb_events == NBITER * 4);
+    CHECK(total.busy_time <= busy_time);
+    CHECK(total.busy_time + 4 * NBPIXELS >= busy_time);
+
+    // a window of the finest buckets is rendered as is
+    level = litl_summary_find_level(summary, 1);
+    CHECK(level == 0);
+    buckets = litl_summary_get_buckets(summary, 0, thread, &nb_buckets);
+    CHECK(nb_buckets > NBPIXELS);
+    litl_summary_render(
+        summary, thread, summary->header->start_time,
+        summary->header->start_time
+          + ((litl_time_t) NBPIXELS << summary->header->shift),
+        NBPIXELS, pixels);
+    CHECK(memcmp(pixels, buckets, sizeof(pixels)) == 0);
+  }
+
+  litl_summary_close(summary);
+}
+
+int main(int argc, char **argv) {
+  int i;
+  char* filename;
+  char summary_filename[1024], parallel_filename[1024];
+  pthread_t tid[NBTHREAD];
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_summary.trace";
+  sprintf(summary_filename, "%s.summary", filename);
+  sprintf(parallel_filename, "%s.parallel.summary", filename);
+
+  printf("Recording events by %d threads\n\n", NBTHREAD);
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_create(&tid[i], NULL, write_trace, NULL);
+  for (i = 0; i < NBTHREAD; i++)
+    pthread_join(tid[i], NULL );
+
+  litl_write_finalize_trace(__trace);
+
+  printf("Building the summary with 1 and 3 workers\n\n");
+  build_summary(filename, summary_filename, 1);
+  build_summary(filename, parallel_filename, 3);
+  CHECK(compare_files(summary_filename, parallel_filename));
+
+  printf("Checking the levels of the summary\n\n");
+  check_summary(summary_filename);
+
+  // the levels are consistent with fewer buckets at the finest level
+  setenv("LITL_SUMMARY_NB_BUCKETS", "300", 1);
+  build_summary(filename, parallel_filename, 2);
+  unsetenv("LITL_SUMMARY_NB_BUCKETS");
+  check_summary(parallel_filename);
+
+  printf("Yes, the summary was built successfully\n");
+
+  return EXIT_SUCCESS;
+}
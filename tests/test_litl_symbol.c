@@ -0,0 +1,133 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test validates the recording of code addresses: only the addresses are
+ * recorded, and they are mapped to modules and functions when the trace is read
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "litl_types.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_symbol.h"
+
+#define NBITER 100
+
+#define CODE_CALL_SITE 0x501
+#define CODE_CALLER 0x502
+#define CODE_LIBC 0x503
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+
+__attribute__((noinline)) void record_call_site(int i) {
+  CHECK(litl_write_probe_call_site(__trace, CODE_CALL_SITE));
+  // prevent the call from being a tail call
+  __asm__ __volatile__("" : : "r" (i) : "memory");
+}
+
+__attribute__((noinline)) void record_caller() {
+  CHECK(litl_write_probe_caller(__trace, CODE_CALLER));
+  __asm__ __volatile__("" : : : "memory");
+}
+
+__attribute__((noinline)) static void write_trace(char* filename) {
+  int i;
+  void (*libc_function)(void*, size_t, size_t,
+                        int (*)(const void*, const void*)) = qsort;
+
+  __trace = litl_write_init_trace(16 * 1024);
+  litl_write_set_filename(__trace, filename);
+  litl_write_buffer_flush_on(__trace);
+
+  for (i = 0; i < NBITER; i++) {
+    record_call_site(i);
+    record_caller();
+    CHECK(litl_write_probe_address(__trace, CODE_LIBC, libc_function));
+  }
+  litl_write_update_modules(__trace);
+  CHECK(__trace->nb_modules > 1);
+
+  litl_write_finalize_trace(__trace);
+}
+
+static void read_trace(char* filename) {
+  int nb_events = 0;
+  litl_read_event_t* event;
+  litl_read_trace_t* trace;
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_symbolizer_t* symbolizer;
+  litl_symbol_t symbol;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+
+  CHECK(trace->processes[0]->nb_modules > 1);
+  symbolizer = litl_symbol_init(trace->processes[0]);
+
+  while ((event = litl_read_next_event(trace)) != NULL ) {
+    CHECK(litl_read_get_typed_params(trace->processes[0], event, params) == 1);
+    CHECK(params[0].type == LITL_PARAM_ADDRESS);
+    CHECK(litl_symbol_resolve(symbolizer, params[0].value.u,
+                              LITL_READ_GET_TIME(event), &symbol) == 0);
+    CHECK(symbol.module && symbol.name);
+
+    switch (LITL_READ_GET_CODE(event)) {
+    case CODE_CALL_SITE:
+      CHECK(strcmp(symbol.name, "record_call_site") == 0);
+      CHECK(symbol.name_offset > 0);
+      break;
+    case CODE_CALLER:
+      CHECK(strcmp(symbol.name, "write_trace") == 0);
+      break;
+    case CODE_LIBC:
+      CHECK(strstr((char*) symbol.module->path, "libc") != NULL);
+      CHECK(symbol.name_offset == 0);
+      break;
+    default:
+      CHECK(0);
+    }
+    nb_events++;
+  }
+  CHECK(nb_events == 3 * NBITER);
+
+  // the address of the stack is not in any module
+  CHECK(litl_symbol_resolve(symbolizer, (litl_param_t) &symbol, 0, &symbol) == -1);
+
+  litl_symbol_finalize(symbolizer);
+  litl_read_finalize_trace(trace);
+}
+
+int main(int argc, char **argv) {
+  char* filename;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    filename = argv[2];
+  else
+    filename = "/tmp/test_litl_symbol.trace";
+
+  printf("Recording code addresses\n\n");
+  write_trace(filename);
+
+  printf("Symbolizing code addresses\n\n");
+  read_trace(filename);
+
+  printf("Yes, the code addresses were symbolized successfully\n");
+
+  return EXIT_SUCCESS;
+}
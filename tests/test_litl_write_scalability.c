@@ -0,0 +1,157 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/*
+ * This test measures the recording throughput when an increasing number of
+ * threads record events concurrently. Since each thread records into its own
+ * buffer, the throughput per thread should stay constant, i.e. the total
+ * throughput should scale linearly with the number of threads. The events
+ * recorded concurrently are read back to check that no event was lost or
+ * mixed with the events of another thread
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "litl_types.h"
+#include "litl_timer.h"
+#include "litl_write.h"
+#include "litl_read.h"
+#include "litl_tools.h"
+
+#define MAX_NBTHREAD 64
+#define NB_EVENTS 200000
+
+#define CHECK(cond) do {					\
+    if(!(cond)){						\
+      fprintf(stderr, "test failed at line %d\n", __LINE__);	\
+      abort();							\
+    }								\
+  } while(0)
+
+static litl_write_trace_t* __trace;
+static pthread_barrier_t __barrier;
+
+/*
+ * Records NB_EVENTS events and returns the time it took (in ns)
+ */
+void* write_trace(void *arg) {
+  int i;
+  litl_time_t* duration = (litl_time_t*) arg;
+  litl_time_t start;
+
+  // the first event allocates the thread buffer
+  litl_write_probe_reg_0(__trace, 0x100);
+  pthread_barrier_wait(&__barrier);
+
+  start = litl_get_time();
+  for (i = 0; i < NB_EVENTS; i++)
+    litl_write_probe_reg_2(__trace, 0x101, i, i + 1);
+  *duration = litl_get_time() - start;
+
+  return NULL ;
+}
+
+/*
+ * Checks that each thread recorded all its events in order
+ */
+static void check_trace(int nb_threads, const char* filename) {
+  litl_read_trace_t* trace;
+  litl_read_process_t* process;
+  litl_read_event_t* event;
+  litl_param_t param, next_param;
+  litl_param_t expected[MAX_NBTHREAD];
+  int i;
+
+  trace = litl_read_open_trace(filename);
+  litl_read_init_processes(trace);
+  CHECK(trace->nb_processes == 1);
+  process = trace->processes[0];
+  CHECK((int) process->nb_threads == nb_threads);
+
+  memset(expected, 0, sizeof(expected));
+  for (i = 0; i < nb_threads; i++)
+    while ((event = litl_read_next_thread_event(trace, process,
+                                                process->threads[i])) != NULL
+           && event->event) {
+      if (LITL_READ_GET_CODE(event) != 0x101)
+        continue;
+      litl_read_get_param_2(event, param, next_param);
+      CHECK(param == expected[i] && next_param == param + 1);
+      expected[i]++;
+    }
+
+  for (i = 0; i < nb_threads; i++)
+    CHECK(expected[i] == NB_EVENTS);
+
+  litl_read_finalize_trace(trace);
+}
+
+/*
+ * Records events with nb_threads threads and returns the throughput
+ *   (in millions of events per second)
+ */
+static double run_test(int nb_threads, const char* filename) {
+  int i;
+  pthread_t tid[MAX_NBTHREAD];
+  litl_time_t durations[MAX_NBTHREAD];
+  litl_time_t max_duration = 0;
+
+  // each buffer can store all the events, so that flushes do not interfere
+  //   with the measurement
+  __trace = litl_write_init_trace((NB_EVENTS + 1) * __litl_get_reg_event_size(2)
+                                  + 1024);
+  litl_write_set_filename(__trace, (char*) filename);
+  litl_write_buffer_flush_off(__trace);
+  pthread_barrier_init(&__barrier, NULL, nb_threads);
+
+  for (i = 0; i < nb_threads; i++)
+    pthread_create(&tid[i], NULL, write_trace, &durations[i]);
+
+  for (i = 0; i < nb_threads; i++) {
+    pthread_join(tid[i], NULL );
+    if (durations[i] > max_duration)
+      max_duration = durations[i];
+  }
+
+  litl_write_finalize_trace(__trace);
+  pthread_barrier_destroy(&__barrier);
+  check_trace(nb_threads, filename);
+
+  return (double) nb_threads * NB_EVENTS * 1e3 / max_duration;
+}
+
+int main(int argc, char **argv) {
+  int nb_threads, max_threads;
+  double throughput, base_throughput = 0;
+  char* filename = "/tmp/test_litl_write_scalability.trace";
+
+  max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (argc == 2)
+    max_threads = atoi(argv[1]);
+  if (max_threads > MAX_NBTHREAD)
+    max_threads = MAX_NBTHREAD;
+  if (max_threads < 1)
+    max_threads = 1;
+
+  litl_time_initialize();
+
+  printf("Recording %d events per thread\n", NB_EVENTS);
+  printf("Threads \t Mevents/s \t Speedup\n");
+  for (nb_threads = 1; nb_threads <= max_threads; nb_threads *= 2) {
+    throughput = run_test(nb_threads, filename);
+    if (nb_threads == 1)
+      base_throughput = throughput;
+    printf("%d \t\t %.2f \t\t %.2f\n", nb_threads, throughput,
+           throughput / base_throughput);
+  }
+
+  return EXIT_SUCCESS;
+}
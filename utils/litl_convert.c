@@ -0,0 +1,117 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/**
+ *  \file utils/litl_convert.c
+ *  \brief litl_convert A utility for converting traces to the formats of trace
+ *  viewers (Chrome JSON or Perfetto protobuf) or of analytical tools (Arrow)
+ *
+ *  \authors
+ *    Developers are: \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+
+#include "litl_read.h"
+#include "litl_convert.h"
+#include "litl_arrow.h"
+
+static char *__input_filename = "";
+static char *__output_filename = "-";
+static litl_convert_format_t __format = LITL_CONVERT_CHROME_JSON;
+static int __is_arrow = 0;
+static int __is_paired = 0;
+static unsigned __nb_workers = 0;
+
+static void __usage(int argc __attribute__((unused)), char **argv) {
+  fprintf(stderr,
+          "Usage: %s [-f input_filename] [-o output_filename] [-F json|perfetto|arrow] [-j nb_workers] [-p] \n",
+          argv[0]);
+  printf("       -o:        Write to the given file (default: stdout)\n");
+  printf("       -F:        Output format (default: json)\n");
+  printf("       -j:        Number of workers for the arrow format (default: one per CPU)\n");
+  printf("       -p:        Convert the entry and exit events as slices\n");
+  printf("       -?, -h:    Display this help and exit\n");
+}
+
+static void __parse_args(int argc, char **argv) {
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-f") == 0)) {
+      __input_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-o") == 0)) {
+      __output_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-F") == 0) && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "json") == 0)
+        __format = LITL_CONVERT_CHROME_JSON;
+      else if (strcmp(argv[i], "perfetto") == 0)
+        __format = LITL_CONVERT_PERFETTO;
+      else if (strcmp(argv[i], "arrow") == 0)
+        __is_arrow = 1;
+      else {
+        fprintf(stderr, "Unknown format %s\n", argv[i]);
+        __usage(argc, argv);
+        exit(-1);
+      }
+    } else if ((strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+      __nb_workers = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-p") == 0)) {
+      __is_paired = 1;
+    } else if ((strcmp(argv[i], "-h") || strcmp(argv[i], "-?")) == 0) {
+      __usage(argc, argv);
+      exit(-1);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      __usage(argc, argv);
+      exit(-1);
+    }
+  }
+
+  if (strcmp(__input_filename, "") == 0 || !__output_filename) {
+    __usage(argc, argv);
+    exit(-1);
+  }
+
+  // the record batches are written at increasing offsets by the workers
+  if (__is_arrow && strcmp(__output_filename, "-") == 0) {
+    fprintf(stderr, "The arrow format requires an output file (-o)\n");
+    exit(-1);
+  }
+}
+
+int main(int argc, char **argv) {
+  litl_read_trace_t *trace;
+  litl_trace_convert_t *convert;
+  litl_read_event_t *event;
+
+  // parse the arguments passed to this program
+  __parse_args(argc, argv);
+
+  trace = litl_read_open_trace(__input_filename);
+  litl_read_init_processes(trace);
+
+  if (__is_arrow)
+    litl_arrow_export(trace, __output_filename, __nb_workers);
+  else {
+    // the events are streamed in chronological order
+    convert = litl_convert_init(trace, __output_filename, __format);
+    if (__is_paired)
+      litl_convert_pair_events(convert);
+    while ((event = litl_read_next_ordered_event(trace)) != NULL )
+      litl_convert_event(convert, LITL_READ_GET_CUR_PROCESS(trace), event);
+    litl_convert_finalize(convert);
+  }
+
+  litl_read_finalize_trace(trace);
+
+  return EXIT_SUCCESS;
+}
@@ -21,29 +21,84 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 
 #include "litl_merge.h"
 
 static char* __arch_name;
+static char* __sorted_name;
 static char** __trace_names;
 static int __nb_traces;
+static int __nb_allocated_traces;
+static unsigned __nb_workers = 1;
 
 static void __usage(int argc __attribute__((unused)), char **argv) {
   fprintf(stderr,
-          "Usage: %s [-o archive_name] input_filename input_filename ... \n",
+          "Usage: %s [-o archive_name] [-s sorted_filename] [-j nb_workers] [-l list_filename] input_filename input_filename ... \n",
           argv[0]);
+  printf("       -s:        Also write the events sorted by time across all the processes and threads (without -o: sort a single input trace)\n");
+  printf("       -j:        Number of workers copying the traces (default: 1, 0: one per CPU)\n");
+  printf("       -l:        Also merge the traces listed in a file, one per line\n");
   printf("       -?, -h:    Display this help and exit\n");
 }
 
+static void __add_trace(const char* trace_name) {
+  int res __attribute__ ((__unused__));
+
+  if (__nb_traces == __nb_allocated_traces) {
+    __nb_allocated_traces = __nb_allocated_traces ?
+      2 * __nb_allocated_traces : 16;
+    __trace_names = (char **) realloc(__trace_names,
+                                      __nb_allocated_traces * sizeof(char *));
+    if (!__trace_names) {
+      perror("Could not allocate memory for the names of the traces!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  res = asprintf(&__trace_names[__nb_traces], "%s", trace_name);
+  __nb_traces++;
+}
+
+/*
+ * Adds the traces listed in a file, e.g. when they are too many for the
+ *   command line
+ */
+static void __add_trace_list(const char* list_name) {
+  FILE* list;
+  char* line = NULL;
+  size_t line_size = 0;
+  ssize_t length;
+
+  if ((list = fopen(list_name, "r")) == NULL ) {
+    fprintf(stderr, "Cannot open %s\n", list_name);
+    exit(EXIT_FAILURE);
+  }
+  while ((length = getline(&line, &line_size, list)) != -1) {
+    if (length > 0 && line[length - 1] == '\n')
+      line[--length] = '\0';
+    if (length > 0)
+      __add_trace(line);
+  }
+  free(line);
+  fclose(list);
+}
+
 static void __parse_args(int argc, char **argv) {
   int i, res __attribute__ ((__unused__));
 
-  __trace_names = (char **) malloc((argc - 3) * sizeof(char *));
+  __trace_names = NULL;
   __nb_traces = 0;
+  __nb_allocated_traces = 0;
 
   for (i = 1; i < argc; i++) {
     if ((strcmp(argv[i], "-o") == 0)) {
       res = asprintf(&__arch_name, "%s", argv[++i]);
+    } else if ((strcmp(argv[i], "-s") == 0) && i + 1 < argc) {
+      __sorted_name = argv[++i];
+    } else if ((strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+      __nb_workers = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-l") == 0) && i + 1 < argc) {
+      __add_trace_list(argv[++i]);
     } else if ((strcmp(argv[i], "-h") || strcmp(argv[i], "-?")) == 0) {
       __usage(argc, argv);
       exit(-1);
@@ -52,21 +107,41 @@ static void __parse_args(int argc, char **argv) {
       __usage(argc, argv);
       exit(-1);
     } else {
-      res = asprintf(&__trace_names[__nb_traces], "%s", argv[i]);
-      __nb_traces++;
+      __add_trace(argv[i]);
     }
   }
 
-  if (__arch_name == NULL )
+  if (__arch_name == NULL && (__sorted_name == NULL || __nb_traces != 1)) {
     __usage(argc, argv);
+    exit(-1);
+  }
 }
 
 int main(int argc, char **argv) {
+  struct rlimit limit;
 
   // parse the arguments passed to this program
   __parse_args(argc, argv);
 
-  litl_merge_traces(__arch_name, __trace_names, __nb_traces);
+  // the merge keeps as many traces open as the limit of file descriptors
+  //   allows, so the limit is raised as much as possible
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+      && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  if (__arch_name == NULL ) {
+    // a single trace is sorted without being merged
+    litl_merge_sort_trace(__sorted_name, __trace_names[0]);
+    return EXIT_SUCCESS;
+  }
+
+  litl_merge_traces_parallel(__arch_name, __trace_names, __nb_traces,
+                             __nb_workers);
+
+  if (__sorted_name)
+    litl_merge_sort_trace(__sorted_name, __arch_name);
 
   return EXIT_SUCCESS;
 }
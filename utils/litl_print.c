@@ -17,14 +17,32 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
+#include <pthread.h>
 
 #include "litl_tools.h"
 #include "litl_read.h"
+#include "litl_symbol.h"
 
 static char* __input_filename = "trace";
+static int __sorted = 0;
+static int __stats = 0;
+static char* __codes = NULL;
+static char* __tids = NULL;
+static char* __window = NULL;
+static litl_symbolizer_t** __symbolizers = NULL;
+static int __nb_workers = 1;
 
 static void __litl_read_usage(int argc __attribute__((unused)), char **argv) {
-  fprintf(stderr, "Usage: %s [-f input_filename] \n", argv[0]);
+  fprintf(stderr,
+          "Usage: %s [-f input_filename] [-s] [-S] [-j nb_workers] [-c codes] [-t tids] [-w start:end] \n",
+          argv[0]);
+  printf("       -s:        Print the events of all the processes in chronological order\n");
+  printf("       -S:        Print the statistics of the events per thread and per code, without reading the events\n");
+  printf("       -j nb_workers: Format the events with several threads\n");
+  printf("       -c codes:  Only print the events whose code is in a list of codes or ranges of codes (e.g. 100,200-2ff, in hexadecimal)\n");
+  printf("       -t tids:   Only print the events of a list of threads (e.g. 1234,1235)\n");
+  printf("       -w start:end: Only print the events that occurred within a time window\n");
   printf("       -?, -h:    Display this help and exit\n");
 }
 
@@ -34,6 +52,20 @@ static void __litl_read_parse_args(int argc, char **argv) {
   for (i = 1; i < argc; i++) {
     if ((strcmp(argv[i], "-f") == 0)) {
       __input_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-s") == 0)) {
+      __sorted = 1;
+    } else if ((strcmp(argv[i], "-S") == 0)) {
+      __stats = 1;
+    } else if ((strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+      __nb_workers = atoi(argv[++i]);
+      if (__nb_workers < 1)
+        __nb_workers = 1;
+    } else if ((strcmp(argv[i], "-c") == 0) && i + 1 < argc) {
+      __codes = argv[++i];
+    } else if ((strcmp(argv[i], "-t") == 0) && i + 1 < argc) {
+      __tids = argv[++i];
+    } else if ((strcmp(argv[i], "-w") == 0) && i + 1 < argc) {
+      __window = argv[++i];
     } else if ((strcmp(argv[i], "-h") || strcmp(argv[i], "-?")) == 0) {
       __litl_read_usage(argc, argv);
       exit(-1);
@@ -50,12 +82,588 @@ static void __litl_read_parse_args(int argc, char **argv) {
   }
 }
 
-int main(int argc, char **argv) {
+/*
+ * Sets the filters of the trace from the arguments
+ */
+static void __litl_print_set_filters(litl_read_trace_t* trace) {
+  char* str, *end;
+  litl_code_t first, last;
+  litl_time_t start;
+
+  for (str = __codes; str && *str; str = end + (*end == ',')) {
+    first = last = strtoul(str, &end, 16);
+    if (*end == '-')
+      last = strtoul(end + 1, &end, 16);
+    if (end == str || (*end && *end != ',')) {
+      fprintf(stderr, "Invalid list of codes %s\n", __codes);
+      exit(-1);
+    }
+    litl_read_filter_codes(trace, first, last);
+  }
+
+  for (str = __tids; str && *str; str = end + (*end == ',')) {
+    litl_read_filter_tid(trace, strtoull(str, &end, 10));
+    if (end == str || (*end && *end != ',')) {
+      fprintf(stderr, "Invalid list of threads %s\n", __tids);
+      exit(-1);
+    }
+  }
+
+  if (__window) {
+    start = strtoull(__window, &end, 10);
+    if (*end != ':') {
+      fprintf(stderr, "Invalid time window %s\n", __window);
+      exit(-1);
+    }
+    str = end + 1;
+    litl_read_set_time_window(trace, start,
+                              *str ? strtoull(str, NULL, 10) : LITL_MAX_TIME);
+  }
+}
+
+/*
+ * Prints the statistics of the events of each process, which are stored in
+ *   the trace
+ */
+static void __litl_print_stats(litl_read_trace_t* trace) {
+  const litl_thread_stats_t* thread_stats;
+  const litl_code_stats_t* code_stats;
+  litl_size_t nb_threads, nb_codes, i;
+  litl_med_size_t process_index;
+
+  for (process_index = 0; process_index < trace->nb_event_processes;
+      process_index++) {
+    litl_read_process_t* process = trace->event_processes[process_index];
+
+    if (trace->nb_event_processes > 1)
+      printf(" process %d\n", process_index);
+
+    thread_stats = litl_read_get_thread_stats(trace, process, &nb_threads);
+    printf("[ThreadID]\t[NbEvents]\t[Size]\t[FirstTimestamp]\t[LastTimestamp]\n");
+    for (i = 0; i < nb_threads; i++)
+      printf("%"PRTIu64" \t%"PRIu64" \t%"PRIu64" \t%"PRTIu64" \t%"PRTIu64"\n",
+             thread_stats[i].tid, thread_stats[i].nb_events,
+             (uint64_t) thread_stats[i].size, thread_stats[i].first_time,
+             thread_stats[i].last_time);
+
+    code_stats = litl_read_get_code_stats(trace, process, &nb_codes);
+    printf("[EventCode]\t[NbEvents]\t[Size]\n");
+    for (i = 0; i < nb_codes; i++)
+      printf("%"PRTIx32" \t%"PRIu64" \t%"PRIu64"\n", code_stats[i].code,
+             code_stats[i].nb_events, (uint64_t) code_stats[i].size);
+  }
+}
+
+/*
+ * The events are formatted into large buffers, which are written to the
+ *   standard output at once. With several workers, the events are copied into
+ *   blocks that are formatted in parallel, and the blocks are written in order
+ */
+#ifndef LITL_PRINT_BUFFER_SIZE
+#define LITL_PRINT_BUFFER_SIZE (1 << 20)
+#endif
+
+#ifndef LITL_PRINT_BLOCK_EVENTS
+#define LITL_PRINT_BLOCK_EVENTS 16384
+#endif
+
+typedef struct {
+  char* data; /* the formatted text */
+  size_t size; /* a size of the formatted text */
+  size_t capacity; /* a size of the buffer */
+  int is_flushed; /* indicates that the buffer is written to the standard
+                     output when it is full, instead of growing */
+} litl_print_buffer_t;
+
+typedef enum {
+  LITL_PRINT_BLOCK_FREE,
+  LITL_PRINT_BLOCK_FILLED,
+  LITL_PRINT_BLOCK_RENDERED
+} litl_print_block_state_t;
+
+typedef struct {
+  litl_buffer_t events; /* copies of the events */
+  size_t events_size; /* a size of the copies */
+  size_t events_capacity; /* a size of the buffer of copies */
+  litl_tid_t* tids; /* the threads of the events */
+  litl_read_process_t** processes; /* the processes of the events */
+  litl_size_t nb_events; /* a number of events in the block */
+  litl_print_buffer_t output; /* the formatted events */
+  litl_print_block_state_t state;
+} litl_print_block_t;
+
+static pthread_mutex_t __lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __cond = PTHREAD_COND_INITIALIZER;
+static litl_print_block_t* __blocks;
+static unsigned __nb_blocks;
+static unsigned long __nb_filled_blocks; /* the blocks published for rendering */
+static unsigned long __nb_rendered_blocks; /* the blocks taken by a worker */
+static int __is_done;
+
+static const char __digits[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/*
+ * Writes the formatted text to the standard output
+ */
+static void __litl_print_flush(litl_print_buffer_t* out) {
+  if (out->size && fwrite(out->data, 1, out->size, stdout) != out->size) {
+    perror("Could not write the events!");
+    exit(EXIT_FAILURE);
+  }
+  out->size = 0;
+}
+
+/*
+ * Makes room for len more characters
+ */
+static void __litl_print_reserve(litl_print_buffer_t* out, size_t len) {
+  if (out->size + len <= out->capacity)
+    return;
+
+  if (out->is_flushed)
+    __litl_print_flush(out);
+  if (out->size + len > out->capacity) {
+    while (out->size + len > out->capacity)
+      out->capacity = out->capacity ? 2 * out->capacity : LITL_PRINT_BUFFER_SIZE;
+    out->data = realloc(out->data, out->capacity);
+    if (!out->data) {
+      perror("Could not allocate memory for the output!");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+static inline void __litl_print_str(litl_print_buffer_t* out, const char* str,
+                                    size_t len) {
+  __litl_print_reserve(out, len);
+  memcpy(out->data + out->size, str, len);
+  out->size += len;
+}
+
+#define __litl_print_lit(out, str) __litl_print_str(out, str, sizeof(str) - 1)
+
+/*
+ * Prints an unsigned integer in decimal, two digits at a time
+ */
+static inline void __litl_print_dec(litl_print_buffer_t* out, uint64_t value) {
+  char tmp[20];
+  char* pos = tmp + sizeof(tmp);
+
+  while (value >= 100) {
+    pos -= 2;
+    memcpy(pos, &__digits[2 * (value % 100)], 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    pos -= 2;
+    memcpy(pos, &__digits[2 * value], 2);
+  } else
+    *--pos = '0' + value;
+
+  __litl_print_str(out, pos, tmp + sizeof(tmp) - pos);
+}
+
+static inline void __litl_print_signed(litl_print_buffer_t* out,
+                                       int64_t value) {
+  if (value < 0) {
+    __litl_print_lit(out, "-");
+    __litl_print_dec(out, -(uint64_t) value);
+  } else
+    __litl_print_dec(out, value);
+}
+
+/*
+ * Prints an unsigned integer in hexadecimal, as %x does
+ */
+static inline void __litl_print_hex(litl_print_buffer_t* out, uint64_t value) {
+  char tmp[16];
+  char* pos = tmp + sizeof(tmp);
+
+  do {
+    *--pos = "0123456789abcdef"[value & 0xf];
+    value >>= 4;
+  } while (value);
+
+  __litl_print_str(out, pos, tmp + sizeof(tmp) - pos);
+}
+
+/*
+ * Prints an unsigned integer in hexadecimal, as %#x does
+ */
+static inline void __litl_print_alt_hex(litl_print_buffer_t* out,
+                                        uint64_t value) {
+  if (value)
+    __litl_print_lit(out, "0x");
+  __litl_print_hex(out, value);
+}
+
+/*
+ * Returns the symbolizer of a process
+ */
+static litl_symbolizer_t* __litl_print_get_symbolizer(litl_read_trace_t* trace,
+                                                      litl_read_process_t* process) {
   litl_med_size_t i;
+
+  if (!__symbolizers)
+    __symbolizers = calloc(trace->nb_event_processes,
+                           sizeof(litl_symbolizer_t*));
+
+  i = process->index;
+  if (!__symbolizers[i])
+    __symbolizers[i] = litl_symbol_init(process);
+  return __symbolizers[i];
+}
+
+/*
+ * Prints a code address as function+offset (module)
+ */
+static void __litl_print_address(litl_print_buffer_t* out,
+                                 litl_read_trace_t* trace,
+                                 litl_read_process_t* process,
+                                 litl_read_event_t* event,
+                                 litl_param_t address) {
+  litl_symbol_t symbol;
+  int res;
+
+  __litl_print_lit(out, "\t ");
+  __litl_print_alt_hex(out, address);
+
+  // the symbol tables are loaded on demand, so the workers take turns
+  pthread_mutex_lock(&__lock);
+  res = litl_symbol_resolve(__litl_print_get_symbolizer(trace, process),
+                            address, LITL_READ_GET_TIME(event), &symbol);
+  pthread_mutex_unlock(&__lock);
+  if (res != 0)
+    return;
+
+  if (symbol.name) {
+    __litl_print_lit(out, " <");
+    __litl_print_str(out, symbol.name, strlen(symbol.name));
+    __litl_print_lit(out, "+");
+    __litl_print_alt_hex(out, symbol.name_offset);
+    __litl_print_lit(out, ">");
+  }
+  __litl_print_lit(out, " (");
+  __litl_print_str(out, (const char*) symbol.module->path,
+                   strlen((const char*) symbol.module->path));
+  __litl_print_lit(out, "+");
+  __litl_print_alt_hex(out, symbol.offset);
+  __litl_print_lit(out, ")");
+}
+
+/*
+ * Prints a parameter decoded according to an event schema
+ */
+static void __litl_print_typed_param(litl_print_buffer_t* out,
+                                     litl_read_trace_t* trace,
+                                     litl_read_process_t* process,
+                                     litl_read_event_t* event,
+                                     litl_typed_param_t* param) {
+  switch (param->type) {
+  case LITL_PARAM_INT8:
+  case LITL_PARAM_INT16:
+  case LITL_PARAM_INT32:
+  case LITL_PARAM_INT64:
+    __litl_print_lit(out, "\t ");
+    __litl_print_signed(out, param->value.i);
+    break;
+  case LITL_PARAM_FLOAT:
+  case LITL_PARAM_DOUBLE:
+    __litl_print_reserve(out, 64);
+    out->size += snprintf(out->data + out->size, 64, "\t %g", param->value.d);
+    break;
+  case LITL_PARAM_POINTER:
+    __litl_print_lit(out, "\t ");
+    __litl_print_alt_hex(out, param->value.u);
+    break;
+  case LITL_PARAM_STRING:
+    __litl_print_lit(out, "\t ");
+    if (param->value.s)
+      __litl_print_str(out, param->value.s, strlen(param->value.s));
+    else
+      __litl_print_lit(out, "(unknown string)");
+    break;
+  case LITL_PARAM_ADDRESS:
+    __litl_print_address(out, trace, process, event, param->value.u);
+    break;
+  default:
+    __litl_print_lit(out, "\t ");
+    __litl_print_dec(out, param->value.u);
+    break;
+  }
+}
+
+/*
+ * Prints the time, the thread and the type of an event
+ */
+static inline void __litl_print_prefix(litl_print_buffer_t* out,
+                                       litl_read_event_t* event,
+                                       const char* type, size_t len) {
+  __litl_print_dec(out, LITL_READ_GET_TIME(event));
+  __litl_print_str(out, type, len);
+  __litl_print_dec(out, LITL_READ_GET_TID(event));
+}
+
+/*
+ * Prints an event on a line
+ */
+static void __litl_print_event(litl_print_buffer_t* out,
+                               litl_read_trace_t* trace,
+                               litl_read_process_t* process,
+                               litl_read_event_t* event) {
+  litl_typed_param_t params[LITL_MAX_PARAMS];
+  litl_size_t i;
+
+  switch (LITL_READ_GET_TYPE(event)) {
+  case LITL_TYPE_REGULAR: { // regular event
+    __litl_print_prefix(out, event, " \t", 2);
+    __litl_print_lit(out, " \t  Reg   ");
+    __litl_print_hex(out, LITL_READ_GET_CODE(event));
+    __litl_print_lit(out, " \t ");
+    __litl_print_dec(out, LITL_READ_REGULAR(event)->nb_params);
+
+    for (i = 0; i < LITL_READ_REGULAR(event)->nb_params; i++) {
+      __litl_print_lit(out, "\t ");
+      __litl_print_hex(out, LITL_READ_REGULAR(event)->param[i]);
+    }
+    break;
+  }
+  case LITL_TYPE_RAW: { // raw event
+    __litl_print_prefix(out, event, "\t", 1);
+    __litl_print_lit(out, " \t  Raw   ");
+    __litl_print_hex(out, LITL_READ_GET_CODE(event));
+    __litl_print_lit(out, " \t ");
+    __litl_print_dec(out, LITL_READ_RAW(event)->size);
+    __litl_print_lit(out, "\t ");
+    __litl_print_str(out, (const char*) LITL_READ_RAW(event)->data,
+                     strnlen((const char*) LITL_READ_RAW(event)->data,
+                             LITL_READ_RAW(event)->size));
+    break;
+  }
+  case LITL_TYPE_PACKED: { // packed event
+    // decode the parameters if the event code has a schema. The dictionary of
+    //   strings may grow while the workers format the events
+    int res;
+    litl_size_t nb_params;
+    if (__nb_workers > 1)
+      pthread_mutex_lock(&process->lock_strings);
+    res = litl_read_get_typed_params(process, event, params);
+    if (__nb_workers > 1)
+      pthread_mutex_unlock(&process->lock_strings);
+
+    __litl_print_prefix(out, event, " \t", 2);
+    __litl_print_lit(out, " \t  Packed   ");
+    __litl_print_hex(out, LITL_READ_GET_CODE(event));
+    __litl_print_lit(out, " \t ");
+    if (res >= 0) {
+      const char* name = (const char*) litl_read_get_event_schema(
+          process, LITL_READ_GET_CODE(event))->name;
+      nb_params = res;
+      __litl_print_dec(out, nb_params);
+      __litl_print_lit(out, "\t ");
+      __litl_print_str(out, name, strlen(name));
+      for (i = 0; i < nb_params; i++)
+        __litl_print_typed_param(out, trace, process, event, &params[i]);
+      break;
+    }
+
+    __litl_print_dec(out, LITL_READ_PACKED(event)->size);
+    __litl_print_lit(out, "\t");
+    for (i = 0; i < LITL_READ_PACKED(event)->size; i++) {
+      __litl_print_lit(out, " ");
+      __litl_print_hex(out, LITL_READ_PACKED(event)->param[i]);
+    }
+    break;
+  }
+  case LITL_TYPE_OFFSET: { // offset event
+    return;
+  }
+  default: {
+    fprintf(stderr, "Unknown event type %d\n", LITL_READ_GET_TYPE(event));
+    abort();
+  }
+  }
+
+  __litl_print_lit(out, "\n");
+}
+
+static litl_read_event_t* __litl_print_next_event(litl_read_trace_t* trace) {
+  if (__sorted)
+    return litl_read_next_ordered_event(trace);
+  return litl_read_next_event(trace);
+}
+
+/*
+ * Formats the events of a block
+ */
+static void __litl_print_render_block(litl_read_trace_t* trace,
+                                      litl_print_block_t* block) {
+  litl_read_event_t event;
+  litl_buffer_t pos = block->events;
+  litl_size_t i;
+
+  block->output.size = 0;
+  for (i = 0; i < block->nb_events; i++) {
+    event.event = (litl_t*) pos;
+    event.tid = block->tids[i];
+    __litl_print_event(&block->output, trace, block->processes[i], &event);
+    pos += __litl_get_gen_event_size(event.event);
+  }
+}
+
+/*
+ * Formats the blocks in the order they were filled
+ */
+static void* __litl_print_worker(void* arg) {
+  litl_read_trace_t* trace = (litl_read_trace_t*) arg;
+  litl_print_block_t* block;
+
+  pthread_mutex_lock(&__lock);
+  for (;;) {
+    while (__nb_rendered_blocks == __nb_filled_blocks && !__is_done)
+      pthread_cond_wait(&__cond, &__lock);
+    if (__nb_rendered_blocks == __nb_filled_blocks)
+      break;
+    block = &__blocks[__nb_rendered_blocks++ % __nb_blocks];
+    pthread_mutex_unlock(&__lock);
+
+    __litl_print_render_block(trace, block);
+
+    pthread_mutex_lock(&__lock);
+    block->state = LITL_PRINT_BLOCK_RENDERED;
+    pthread_cond_broadcast(&__cond);
+  }
+  pthread_mutex_unlock(&__lock);
+
+  return NULL ;
+}
+
+/*
+ * Writes the next block once it is formatted. Returns 0 when all the filled
+ *   blocks are written
+ */
+static int __litl_print_write_block(unsigned long* nb_written_blocks) {
+  litl_print_block_t* block;
+
+  if (*nb_written_blocks == __nb_filled_blocks)
+    return 0;
+
+  block = &__blocks[*nb_written_blocks % __nb_blocks];
+  pthread_mutex_lock(&__lock);
+  while (block->state != LITL_PRINT_BLOCK_RENDERED)
+    pthread_cond_wait(&__cond, &__lock);
+  pthread_mutex_unlock(&__lock);
+
+  __litl_print_flush(&block->output);
+  block->nb_events = 0;
+  block->events_size = 0;
+  block->state = LITL_PRINT_BLOCK_FREE;
+  (*nb_written_blocks)++;
+
+  return 1;
+}
+
+/*
+ * Reads the events while several workers format them. The events are copied
+ *   into blocks, since the buffers of the reader are reused
+ */
+static void __litl_print_parallel(litl_read_trace_t* trace) {
+  litl_read_event_t* event;
+  litl_print_block_t* block;
+  pthread_t* workers;
+  unsigned long nb_written_blocks = 0;
+  litl_size_t size;
+  unsigned i;
+
+  __nb_blocks = 2 * __nb_workers;
+  __blocks = calloc(__nb_blocks, sizeof(litl_print_block_t));
+  workers = malloc(__nb_workers * sizeof(pthread_t));
+  if (!__blocks || !workers) {
+    perror("Could not allocate memory for the blocks of events!");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < __nb_blocks; i++) {
+    __blocks[i].tids = malloc(LITL_PRINT_BLOCK_EVENTS * sizeof(litl_tid_t));
+    __blocks[i].processes = malloc(
+        LITL_PRINT_BLOCK_EVENTS * sizeof(litl_read_process_t*));
+    if (!__blocks[i].tids || !__blocks[i].processes) {
+      perror("Could not allocate memory for the blocks of events!");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (i = 0; i < (unsigned) __nb_workers; i++)
+    pthread_create(&workers[i], NULL, __litl_print_worker, trace);
+
+  block = &__blocks[0];
+  while ((event = __litl_print_next_event(trace)) != NULL ) {
+    if (LITL_READ_GET_TYPE(event) == LITL_TYPE_OFFSET)
+      continue;
+
+    // wait for the block to be written before filling it again
+    while (block->state != LITL_PRINT_BLOCK_FREE)
+      __litl_print_write_block(&nb_written_blocks);
+
+    size = __litl_get_gen_event_size(event->event);
+    if (block->events_size + size > block->events_capacity) {
+      block->events_capacity = block->events_capacity ?
+        2 * block->events_capacity : LITL_PRINT_BUFFER_SIZE;
+      block->events = realloc(block->events, block->events_capacity);
+      if (!block->events) {
+        perror("Could not allocate memory for the blocks of events!");
+        exit(EXIT_FAILURE);
+      }
+    }
+    memcpy(block->events + block->events_size, event->event, size);
+    block->events_size += size;
+    block->tids[block->nb_events] = LITL_READ_GET_TID(event);
+    block->processes[block->nb_events] = LITL_READ_GET_CUR_PROCESS(trace);
+
+    if (++block->nb_events == LITL_PRINT_BLOCK_EVENTS) {
+      pthread_mutex_lock(&__lock);
+      block->state = LITL_PRINT_BLOCK_FILLED;
+      __nb_filled_blocks++;
+      pthread_cond_broadcast(&__cond);
+      pthread_mutex_unlock(&__lock);
+      block = &__blocks[__nb_filled_blocks % __nb_blocks];
+    }
+  }
+
+  pthread_mutex_lock(&__lock);
+  if (block->nb_events) {
+    block->state = LITL_PRINT_BLOCK_FILLED;
+    __nb_filled_blocks++;
+  }
+  __is_done = 1;
+  pthread_cond_broadcast(&__cond);
+  pthread_mutex_unlock(&__lock);
+
+  while (__litl_print_write_block(&nb_written_blocks))
+    ;
+
+  for (i = 0; i < (unsigned) __nb_workers; i++)
+    pthread_join(workers[i], NULL );
+
+  for (i = 0; i < __nb_blocks; i++) {
+    free(__blocks[i].events);
+    free(__blocks[i].tids);
+    free(__blocks[i].processes);
+    free(__blocks[i].output.data);
+  }
+  free(__blocks);
+  free(workers);
+}
+
+int main(int argc, char **argv) {
+  litl_size_t i;
   litl_read_event_t* event;
   litl_read_trace_t *trace;
   litl_general_header_t* trace_header;
   litl_process_header_t* process_header;
+  litl_print_buffer_t out = { NULL, 0, 0, 1 };
 
   // parse the arguments passed to this program
   __litl_read_parse_args(argc, argv);
@@ -63,66 +671,44 @@ int main(int argc, char **argv) {
   trace = litl_read_open_trace(__input_filename);
 
   litl_read_init_processes(trace);
+  __litl_print_set_filters(trace);
 
   trace_header = litl_read_get_trace_header(trace);
-  process_header = litl_read_get_process_header(trace->processes[0]);
+  // the header of a sorted trace describes the processes of the source trace
+  process_header = litl_read_get_process_header(trace->event_processes[0]);
 
   // print the header
   printf(" LiTL v.%s\n", trace_header->litl_ver);
   printf(" %s\n", trace_header->sysinfo);
-  printf(" nb_processes \t %d\n", trace_header->nb_processes);
-  if (trace_header->nb_processes == 1)
+  printf(" nb_processes \t %d\n", trace->nb_event_processes);
+  if (trace->nb_event_processes == 1)
     printf(" nb_threads \t %d\n", process_header->nb_threads);
-  printf(
-      " buffer_size \t %d\n",
-      trace->processes[0]->header->buffer_size
-        - __litl_get_reg_event_size(LITL_MAX_PARAMS)
-        - __litl_get_reg_event_size(0));
+  printf(" buffer_size \t %d\n",
+         litl_read_get_recorded_buffer_size(trace->event_processes[0]));
+
+  if (__stats) {
+    __litl_print_stats(trace);
+    litl_read_finalize_trace(trace);
+    return EXIT_SUCCESS;
+  }
 
   printf(
       "[Timestamp]\t[ThreadID]\t[EventType]\t[EventCode]\t[NbParam]\t[Parameters]\n");
-  while (1) {
-    event = litl_read_next_event(trace);
-
-    if (event == NULL )
-      break;
 
-    switch (LITL_READ_GET_TYPE(event)) {
-    case LITL_TYPE_REGULAR: { // regular event
-      printf("%"PRTIu64" \t%"PRTIu64" \t  Reg   %"PRTIx32" \t %"PRTIu32,
-             LITL_READ_GET_TIME(event), LITL_READ_GET_TID(event),
-             LITL_READ_GET_CODE(event), LITL_READ_REGULAR(event)->nb_params);
-
-      for (i = 0; i < LITL_READ_REGULAR(event)->nb_params; i++)
-        printf("\t %"PRTIx64, LITL_READ_REGULAR(event)->param[i]);
-      break;
-    }
-    case LITL_TYPE_RAW: { // raw event
-      printf("%"PRTIu64"\t%"PRTIu64" \t  Raw   %"PRTIx32" \t %"PRTIu32,
-             LITL_READ_GET_TIME(event), LITL_READ_GET_TID(event),
-             LITL_READ_GET_CODE(event), LITL_READ_RAW(event)->size);
-      printf("\t %s", (litl_data_t *) LITL_READ_RAW(event)->data);
-      break;
-    }
-    case LITL_TYPE_PACKED: { // packed event
-      printf("%"PRTIu64" \t%"PRTIu64" \t  Packed   %"PRTIx32" \t %"PRTIu32"\t",
-             LITL_READ_GET_TIME(event), LITL_READ_GET_TID(event),
-             LITL_READ_GET_CODE(event), LITL_READ_PACKED(event)->size);
-      for (i = 0; i < LITL_READ_PACKED(event)->size; i++) {
-        printf(" %x", LITL_READ_PACKED(event)->param[i]);
-      }
-      break;
-    }
-    case LITL_TYPE_OFFSET: { // offset event
-      continue;
-    }
-    default: {
-      fprintf(stderr, "Unknown event type %d\n", LITL_READ_GET_TYPE(event));
-      abort();
-    }
-    }
+  if (__nb_workers > 1)
+    __litl_print_parallel(trace);
+  else {
+    while ((event = __litl_print_next_event(trace)) != NULL )
+      __litl_print_event(&out, trace, LITL_READ_GET_CUR_PROCESS(trace), event);
+    __litl_print_flush(&out);
+    free(out.data);
+  }
 
-    printf("\n");
+  if (__symbolizers) {
+    for (i = 0; i < trace->nb_event_processes; i++)
+      if (__symbolizers[i])
+        litl_symbol_finalize(__symbolizers[i]);
+    free(__symbolizers);
   }
 
   litl_read_finalize_trace(trace);
@@ -0,0 +1,130 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/**
+ *  \file utils/litl_stats.c
+ *  \brief litl_stats A utility for printing the distributions of the
+ *  durations of the intervals between the entry and exit events of a trace
+ *
+ *  \authors
+ *    Developers are: \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "litl_read.h"
+#include "litl_stats.h"
+
+static char *__input_filename = "";
+static unsigned __nb_workers = 0;
+static int __print_threads = 0;
+
+static void __usage(int argc __attribute__((unused)), char **argv) {
+  fprintf(stderr, "Usage: %s [-f input_filename] [-j nb_workers] [-t] \n",
+          argv[0]);
+  printf("       -j:        Number of workers (default: one per CPU)\n");
+  printf("       -t:        Also print the durations per thread\n");
+  printf("       -?, -h:    Display this help and exit\n");
+}
+
+static void __parse_args(int argc, char **argv) {
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-f") == 0)) {
+      __input_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+      __nb_workers = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-t") == 0)) {
+      __print_threads = 1;
+    } else if ((strcmp(argv[i], "-h") || strcmp(argv[i], "-?")) == 0) {
+      __usage(argc, argv);
+      exit(-1);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      __usage(argc, argv);
+      exit(-1);
+    }
+  }
+
+  if (strcmp(__input_filename, "") == 0) {
+    __usage(argc, argv);
+    exit(-1);
+  }
+}
+
+/*
+ * Returns the name of a code in the schemas of the processes, if any
+ */
+static const char* __code_name(litl_read_trace_t* trace, litl_code_t code) {
+  litl_event_schema_t* schema;
+  litl_med_size_t i;
+
+  for (i = 0; i < trace->nb_event_processes; i++) {
+    schema = litl_read_get_event_schema(trace->event_processes[i], code);
+    if (schema)
+      return (const char*) schema->name;
+  }
+
+  return "";
+}
+
+static void __print_histogram(const litl_histogram_t* histogram) {
+  printf(" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+         histogram->nb_values, histogram->min,
+         litl_histogram_quantile(histogram, 0.5),
+         litl_histogram_quantile(histogram, 0.99),
+         litl_histogram_quantile(histogram, 0.999), histogram->max,
+         histogram->sum / histogram->nb_values);
+}
+
+int main(int argc, char **argv) {
+  litl_read_trace_t *trace;
+  litl_duration_stats_t *stats;
+  litl_size_t i;
+
+  // parse the arguments passed to this program
+  __parse_args(argc, argv);
+
+  trace = litl_read_open_trace(__input_filename);
+  litl_read_init_processes(trace);
+
+  stats = litl_stats_trace(trace, __nb_workers);
+
+  printf("Durations per code (ns)\n");
+  printf("%10s %-24s %10s %10s %10s %10s %10s %10s %10s\n", "code", "name",
+         "count", "min", "p50", "p99", "p99.9", "max", "mean");
+  for (i = 0; i < stats->nb_codes; i++) {
+    printf("%#10"PRTIx32" %-24.24s", stats->codes[i].code,
+           __code_name(trace, stats->codes[i].code));
+    __print_histogram(stats->codes[i].histogram);
+  }
+
+  if (__print_threads) {
+    printf("\nDurations per thread (ns)\n");
+    printf("%7s %-28s %10s %10s %10s %10s %10s %10s %10s\n", "process",
+           "tid", "count", "min", "p50", "p99", "p99.9", "max", "mean");
+    for (i = 0; i < stats->nb_threads; i++) {
+      printf("%7u %-28"PRIu64, (unsigned) stats->threads[i].process_index,
+             (uint64_t) stats->threads[i].tid);
+      __print_histogram(stats->threads[i].histogram);
+    }
+  }
+
+  if (stats->nb_incomplete)
+    printf("\n%"PRIu64" intervals without an exit event were ignored\n",
+           stats->nb_incomplete);
+
+  litl_stats_finalize(stats);
+  litl_read_finalize_trace(trace);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/* -*- c-file-style: "GNU" -*- */
+/*
+ * Copyright © Télécom SudParis.
+ * See COPYING in top-level directory.
+ */
+
+/**
+ *  \file utils/litl_summary.c
+ *  \brief litl_summary A utility for building the timeline summary of a
+ *  trace, and for rendering the activity of its threads at any zoom level
+ *  from the summary
+ *
+ *  \authors
+ *    Developers are: \n
+ *        Roman Iakymchuk   -- roman.iakymchuk@telecom-sudparis.eu \n
+ *        Francois Trahay   -- francois.trahay@telecom-sudparis.eu \n
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "litl_read.h"
+#include "litl_summary.h"
+
+// the busy ratio of a pixel, from idle to fully busy
+static const char __shades[] = " .:-=+*#%@";
+
+static char *__input_filename = "";
+static char *__summary_filename = "";
+static unsigned __nb_workers = 0;
+static litl_size_t __width = 0;
+static litl_time_t __start = 0;
+static litl_time_t __end = LITL_MAX_TIME;
+
+static void __usage(int argc __attribute__((unused)), char **argv) {
+  fprintf(stderr,
+          "Usage: %s [-f input_filename] [-s summary_filename] [-j nb_workers] [-w width] [-b start] [-e end] \n",
+          argv[0]);
+  printf("       -f:        Build the summary of a trace (default summary file: input_filename.summary)\n");
+  printf("       -j:        Number of workers (default: one per CPU)\n");
+  printf("       -w:        Render the threads on width columns\n");
+  printf("       -b, -e:    Render the time window between start and end (ns)\n");
+  printf("       -?, -h:    Display this help and exit\n");
+}
+
+static void __parse_args(int argc, char **argv) {
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-f") == 0)) {
+      __input_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-s") == 0) && i + 1 < argc) {
+      __summary_filename = argv[++i];
+    } else if ((strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+      __nb_workers = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "-w") == 0) && i + 1 < argc) {
+      __width = atol(argv[++i]);
+    } else if ((strcmp(argv[i], "-b") == 0) && i + 1 < argc) {
+      __start = strtoull(argv[++i], NULL, 10);
+    } else if ((strcmp(argv[i], "-e") == 0) && i + 1 < argc) {
+      __end = strtoull(argv[++i], NULL, 10);
+    } else if ((strcmp(argv[i], "-h") || strcmp(argv[i], "-?")) == 0) {
+      __usage(argc, argv);
+      exit(-1);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      __usage(argc, argv);
+      exit(-1);
+    }
+  }
+
+  if (strcmp(__input_filename, "") == 0
+      && strcmp(__summary_filename, "") == 0) {
+    __usage(argc, argv);
+    exit(-1);
+  }
+}
+
+/*
+ * Renders each thread on a line of characters
+ */
+static void __render(litl_summary_t* summary) {
+  litl_summary_bucket_t* pixels;
+  litl_size_t thread, pixel;
+  litl_time_t start, end;
+  double pixel_width, ratio;
+  int shade;
+  char* line;
+
+  start = __start > summary->header->start_time ?
+    __start : summary->header->start_time;
+  end = __end <= summary->header->end_time ?
+    __end : summary->header->end_time + 1;
+  if (start >= end) {
+    fprintf(stderr, "The time window is empty\n");
+    exit(EXIT_FAILURE);
+  }
+  pixel_width = (double) (end - start) / __width;
+
+  pixels = malloc(__width * sizeof(litl_summary_bucket_t));
+  line = malloc(__width + 1);
+  if (!pixels || !line) {
+    perror("Could not allocate memory for rendering the summary!");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("\nFrom %"PRIu64" to %"PRIu64" ns, level %u\n", (uint64_t) start,
+         (uint64_t) end, litl_summary_find_level(summary, pixel_width));
+  for (thread = 0; thread < summary->header->nb_threads; thread++) {
+    litl_summary_render(summary, thread, start, end, __width, pixels);
+    for (pixel = 0; pixel < __width; pixel++) {
+      ratio = pixels[pixel].busy_time / pixel_width;
+      shade = ratio * (sizeof(__shades) - 2) + 0.999;
+      if (shade == 0 && pixels[pixel].nb_events)
+        shade = 1;
+      line[pixel] = __shades[shade < (int) sizeof(__shades) - 2 ?
+                             shade : (int) sizeof(__shades) - 2];
+    }
+    line[__width] = '\0';
+    printf("%7u %-20"PRIu64" |%s|\n",
+           (unsigned) summary->threads[thread].process_index,
+           (uint64_t) summary->threads[thread].tid, line);
+  }
+
+  free(line);
+  free(pixels);
+}
+
+int main(int argc, char **argv) {
+  litl_read_trace_t *trace;
+  litl_summary_t *summary;
+  char* filename = NULL;
+  uint64_t nb_events = 0;
+
+  // parse the arguments passed to this program
+  __parse_args(argc, argv);
+
+  if (strcmp(__input_filename, "") != 0) {
+    if (strcmp(__summary_filename, "") == 0) {
+      filename = malloc(strlen(__input_filename) + strlen(".summary") + 1);
+      sprintf(filename, "%s.summary", __input_filename);
+      __summary_filename = filename;
+    }
+
+    trace = litl_read_open_trace(__input_filename);
+    litl_read_init_processes(trace);
+    nb_events = litl_summary_build(trace, __summary_filename, __nb_workers);
+    litl_read_finalize_trace(trace);
+  }
+
+  summary = litl_summary_open(__summary_filename);
+  if (strcmp(__input_filename, "") != 0)
+    printf("%"PRIu64" events summarized into %s\n", nb_events,
+           __summary_filename);
+  printf("%"PRIu32" threads from %"PRIu64" to %"PRIu64" ns, %"PRIu32" levels of buckets from %"PRIu64" ns\n",
+         summary->header->nb_threads, (uint64_t) summary->header->start_time,
+         (uint64_t) summary->header->end_time, summary->header->nb_levels,
+         (uint64_t) 1 << summary->header->shift);
+
+  if (__width)
+    __render(summary);
+
+  litl_summary_close(summary);
+  free(filename);
+
+  return EXIT_SUCCESS;
+}